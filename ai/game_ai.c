@@ -12,16 +12,80 @@
 
 #include <retro_assert.h>
 #include <compat/strl.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "../deps/game_ai_lib/GameAI.h"
+#include "../verbosity.h"
 
 #define GAME_AI_MAX_PLAYERS 2
 
+/* Everything the model needs to think about one frame */
+typedef struct
+{
+   uint8_t       *ram;
+   uint8_t       *frame;
+   size_t         frame_cap;
+   /* Either 'frame', or the pointer handed over by the
+    * core if the frame could not be copied (NULL, or a
+    * hardware rendered frame) */
+   const void    *frame_data;
+   uint64_t       frame_count;
+   unsigned int   frame_width;
+   unsigned int   frame_height;
+   unsigned int   frame_pitch;
+   unsigned int   pixel_format;
+   bool           override_p1;
+   bool           override_p2;
+   bool           show_debug;
+} game_ai_snapshot_t;
+
+typedef struct
+{
+   uint64_t       thinks;
+   uint64_t       predictions;
+   uint64_t       staleness_sum;
+   uint64_t       staleness_max;
+   uint64_t       dropped_frames;
+   retro_time_t   think_time_sum;
+   retro_time_t   think_time_max;
+} game_ai_stats_t;
+
 void *                     ga = NULL;
 volatile void *            g_ram_ptr = NULL;
 volatile int               g_ram_size = 0;
+/* Inputs seen by the core, latched on every poll */
 volatile signed short int  g_buttons_bits[GAME_AI_MAX_PLAYERS] = {0};
 volatile int               g_frameCount = 0;
+/* Number of frames run since content was loaded */
+static uint64_t            g_frames_run = 0;
+/* Inputs most recently predicted by the model, and the
+ * frame they were predicted from */
+static signed short int    g_predicted_bits[GAME_AI_MAX_PLAYERS] = {0};
+static uint64_t            g_predicted_frame = 0;
+static bool                g_predicted_new = false;
+static game_ai_stats_t     g_stats = {0};
+/* RAM copy the model was initialised with; refreshed from
+ * a snapshot before every think */
+static uint8_t *           g_model_ram = NULL;
+static game_ai_snapshot_t  g_work = {0};
+
+#ifdef HAVE_THREADS
+/* Latest-frame mailbox: the emulation thread fills 'g_fill'
+ * without holding the lock and swaps it with the mailbox;
+ * the inference thread swaps whatever is there with
+ * 'g_work' once it is done with the previous frame */
+static game_ai_snapshot_t  g_fill = {0};
+static game_ai_snapshot_t  g_mailbox = {0};
+static bool                g_mailbox_full = false;
+static bool                g_thread_quit = false;
+static sthread_t *         g_thread = NULL;
+static slock_t *           g_lock = NULL;
+static scond_t *           g_cond = NULL;
+#endif
 volatile char              game_ai_lib_path[1024] = {0};
 volatile char              g_game_name[1024] = {0};
 retro_log_printf_t         g_log = NULL;
@@ -58,16 +122,294 @@ void array_to_bits_16(volatile signed short *result, const bool b[16])
       *result |= b[bit] ? (1 << bit) : 0;
 }
 
+static void game_ai_snapshot_free(game_ai_snapshot_t *snap)
+{
+   if (snap->ram)
+      free(snap->ram);
+   if (snap->frame)
+      free(snap->frame);
+   memset(snap, 0, sizeof(*snap));
+}
+
+/* Copies RAM and the current frame into 'snap',
+ * so the core may carry on running while the model
+ * thinks about it. Returns false on allocation failure. */
+static bool game_ai_snapshot_fill(game_ai_snapshot_t *snap,
+      bool override_p1, bool override_p2, bool show_debug,
+      const void *frame_data, unsigned int frame_width,
+      unsigned int frame_height, unsigned int frame_pitch,
+      unsigned int pixel_format)
+{
+   size_t frame_size = (size_t)frame_pitch * frame_height;
+
+   if (!snap->ram && !(snap->ram = (uint8_t*)malloc(g_ram_size)))
+      return false;
+   memcpy(snap->ram, (const void*)g_ram_ptr, g_ram_size);
+
+   snap->frame_data = frame_data;
+   if (     frame_data
+         && frame_data != RETRO_HW_FRAME_BUFFER_VALID
+         && frame_size)
+   {
+      if (frame_size > snap->frame_cap)
+      {
+         uint8_t *frame = (uint8_t*)realloc(snap->frame, frame_size);
+         if (!frame)
+            return false;
+         snap->frame     = frame;
+         snap->frame_cap = frame_size;
+      }
+      memcpy(snap->frame, frame_data, frame_size);
+      snap->frame_data = snap->frame;
+   }
+
+   snap->frame_count  = g_frames_run;
+   snap->frame_width  = frame_width;
+   snap->frame_height = frame_height;
+   snap->frame_pitch  = frame_pitch;
+   snap->pixel_format = pixel_format;
+   snap->override_p1  = override_p1;
+   snap->override_p2  = override_p2;
+   snap->show_debug   = show_debug;
+   return true;
+}
+
+/* Loads the model for the current game, if not done yet.
+ * The model is handed a private copy of RAM, which is
+ * refreshed from a snapshot before every think. */
+static bool game_ai_create(void)
+{
+   if (ga)
+      return true;
+
+   if (!create_game_ai || g_ram_size <= 0)
+      return false;
+
+   if (!g_model_ram && !(g_model_ram = (uint8_t*)calloc(1, g_ram_size)))
+      return false;
+
+   ga = create_game_ai((char *) &g_game_name[0]);
+   retro_assert(ga);
+
+   if (ga)
+   {
+      char data_path[1024] = {0};
+      strcpy(&data_path[0], (char *)game_ai_lib_path);
+      strcat(&data_path[0], "/data/");
+      strcat(&data_path[0], (char *)g_game_name);
+
+      game_ai_lib_init(ga, g_model_ram, g_ram_size);
+      game_ai_lib_set_debug_log(ga, game_ai_debug_log);
+   }
+
+   return ga != NULL;
+}
+
+static void game_ai_run_snapshot(const game_ai_snapshot_t *snap,
+      signed short int bits[GAME_AI_MAX_PLAYERS])
+{
+   bool b[GAMEAI_MAX_BUTTONS];
+
+   memcpy(g_model_ram, snap->ram, g_ram_size);
+   game_ai_lib_set_show_debug(ga, snap->show_debug);
+
+   bits[0] = 0;
+   bits[1] = 0;
+
+   if (snap->override_p1)
+   {
+      memset(b, 0, sizeof(b));
+      game_ai_lib_think(ga, b, 0, snap->frame_data, snap->frame_width,
+            snap->frame_height, snap->frame_pitch, snap->pixel_format);
+      array_to_bits_16(&bits[0], b);
+   }
+
+   if (snap->override_p2)
+   {
+      memset(b, 0, sizeof(b));
+      game_ai_lib_think(ga, b, 1, snap->frame_data, snap->frame_width,
+            snap->frame_height, snap->frame_pitch, snap->pixel_format);
+      array_to_bits_16(&bits[1], b);
+   }
+}
+
+/* Must hold g_lock when threaded */
+static void game_ai_publish(const signed short int bits[GAME_AI_MAX_PLAYERS],
+      uint64_t frame_count, retro_time_t think_time)
+{
+   g_predicted_bits[0]  = bits[0];
+   g_predicted_bits[1]  = bits[1];
+   g_predicted_frame    = frame_count;
+   g_predicted_new      = true;
+
+   g_stats.thinks++;
+   g_stats.think_time_sum += think_time;
+   if (think_time > g_stats.think_time_max)
+      g_stats.think_time_max = think_time;
+}
+
+static void game_ai_stats_log(void)
+{
+   if (!g_stats.thinks)
+      return;
+
+   RARCH_LOG("[Game AI] %" PRIu64 " inferences, avg %.2f ms, max %.2f ms, "
+         "%" PRIu64 " frames dropped.\n",
+         g_stats.thinks,
+         (double)g_stats.think_time_sum / g_stats.thinks / 1000.0,
+         (double)g_stats.think_time_max / 1000.0,
+         g_stats.dropped_frames);
+
+   if (g_stats.predictions)
+      RARCH_LOG("[Game AI] %" PRIu64 " predictions applied, input staleness "
+            "avg %.2f frames, max %" PRIu64 " frames.\n",
+            g_stats.predictions,
+            (double)g_stats.staleness_sum / g_stats.predictions,
+            g_stats.staleness_max);
+}
+
+#ifdef HAVE_THREADS
+static void game_ai_thread(void *data)
+{
+   slock_lock(g_lock);
+
+   for (;;)
+   {
+      game_ai_snapshot_t tmp;
+      signed short int   bits[GAME_AI_MAX_PLAYERS];
+      retro_time_t       start;
+      bool               ok;
+
+      while (!g_mailbox_full && !g_thread_quit)
+         scond_wait(g_cond, g_lock);
+
+      if (g_thread_quit)
+         break;
+
+      /* Take the latest frame, and leave our previous
+       * buffers behind to be refilled */
+      tmp            = g_work;
+      g_work         = g_mailbox;
+      g_mailbox      = tmp;
+      g_mailbox_full = false;
+      slock_unlock(g_lock);
+
+      start = cpu_features_get_time_usec();
+      if ((ok = game_ai_create()))
+         game_ai_run_snapshot(&g_work, bits);
+
+      slock_lock(g_lock);
+      if (ok)
+         game_ai_publish(bits, g_work.frame_count,
+               cpu_features_get_time_usec() - start);
+   }
+
+   slock_unlock(g_lock);
+}
+
+static bool game_ai_thread_start(void)
+{
+   if (g_thread)
+      return true;
+
+   if (!g_lock && !(g_lock = slock_new()))
+      return false;
+   if (!g_cond && !(g_cond = scond_new()))
+      return false;
+
+   g_thread_quit  = false;
+   g_mailbox_full = false;
+
+   return (g_thread = sthread_create(game_ai_thread, NULL)) != NULL;
+}
+
+/* Waits for the inference in progress, if any */
+static void game_ai_thread_stop(void)
+{
+   if (!g_thread)
+      return;
+
+   slock_lock(g_lock);
+   g_thread_quit = true;
+   scond_signal(g_cond);
+   slock_unlock(g_lock);
+
+   sthread_join(g_thread);
+   g_thread = NULL;
+}
+#endif
+
+/* Stops inference and drops the model along with
+ * all state belonging to the current game */
+static void game_ai_reset(void)
+{
+#ifdef HAVE_THREADS
+   game_ai_thread_stop();
+   game_ai_snapshot_free(&g_fill);
+   game_ai_snapshot_free(&g_mailbox);
+   g_mailbox_full = false;
+#endif
+
+   game_ai_stats_log();
+
+   if (ga)
+   {
+      destroy_game_ai(ga);
+      ga = NULL;
+   }
+
+   game_ai_snapshot_free(&g_work);
+   if (g_model_ram)
+      free(g_model_ram);
+   g_model_ram       = NULL;
+
+   memset(&g_stats, 0, sizeof(g_stats));
+   memset((void*)g_buttons_bits, 0, sizeof(g_buttons_bits));
+   memset(g_predicted_bits, 0, sizeof(g_predicted_bits));
+   g_predicted_new   = false;
+   g_predicted_frame = 0;
+   g_frames_run      = 0;
+   g_frameCount      = 0;
+}
+
 /* Interface to RA */
 
 signed short int game_ai_input(unsigned int port, unsigned int device,
       unsigned int idx, unsigned int id, signed short int result)
 {
-   if (ga && (port < GAME_AI_MAX_PLAYERS))
+   /* Stays zero until the first prediction is polled */
+   if (port < GAME_AI_MAX_PLAYERS)
       return g_buttons_bits[port];
    return 0;
 }
 
+void game_ai_poll(void)
+{
+#ifdef HAVE_THREADS
+   if (g_lock)
+      slock_lock(g_lock);
+#endif
+
+   if (g_predicted_new)
+   {
+      uint64_t staleness  = g_frames_run - g_predicted_frame;
+
+      g_buttons_bits[0]   = g_predicted_bits[0];
+      g_buttons_bits[1]   = g_predicted_bits[1];
+      g_predicted_new     = false;
+
+      g_stats.predictions++;
+      g_stats.staleness_sum += staleness;
+      if (staleness > g_stats.staleness_max)
+         g_stats.staleness_max = staleness;
+   }
+
+#ifdef HAVE_THREADS
+   if (g_lock)
+      slock_unlock(g_lock);
+#endif
+}
+
 void game_ai_init(void)
 {
    if (!create_game_ai)
@@ -135,11 +477,15 @@ void game_ai_shutdown(void)
 {
    if (g_lib_handle)
    {
-      if (ga)
-      {
-         destroy_game_ai(ga);
-         ga = NULL;
-      }
+      game_ai_reset();
+#ifdef HAVE_THREADS
+      if (g_cond)
+         scond_free(g_cond);
+      if (g_lock)
+         slock_free(g_lock);
+      g_cond = NULL;
+      g_lock = NULL;
+#endif
 #ifdef _WIN32
       FreeLibrary(g_lib_handle);
 #else
@@ -148,68 +494,84 @@ void game_ai_shutdown(void)
    }
 }
 
+void game_ai_unload(void)
+{
+   /* Core memory goes away with the content */
+   game_ai_reset();
+
+   g_ram_ptr  = NULL;
+   g_ram_size = 0;
+}
+
 void game_ai_load(const char * name, void * ram_ptr, int ram_size, retro_log_printf_t log)
 {
+   /* The old model may still be thinking about the
+    * previous game */
+   game_ai_reset();
+
    strcpy((char *) &g_game_name[0], name);
 
    g_ram_ptr  = ram_ptr;
    g_ram_size = ram_size;
 
    g_log      = log;
-
-   if (ga)
-   {
-      destroy_game_ai(ga);
-      ga = NULL;
-   }
 }
 
 void game_ai_think(bool override_p1, bool override_p2, bool show_debug,
       const void *frame_data, unsigned int frame_width, unsigned int frame_height,
       unsigned int frame_pitch, unsigned int pixel_format)
 {
-   if (ga)
-      game_ai_lib_set_show_debug(ga, show_debug);
-
-   if (!ga && g_ram_ptr)
+   g_frames_run++;
+
+   /* Nothing to predict, or no model library to predict with */
+   if (     (!override_p1 && !override_p2)
+         || !create_game_ai
+         || !g_ram_ptr
+         || g_ram_size <= 0)
+      return;
+
+#ifdef HAVE_THREADS
+   /* Hand the frame over to the inference thread; its
+    * predictions are picked up by game_ai_poll() */
+   if (game_ai_thread_start())
    {
-      ga = create_game_ai((char *) &g_game_name[0]);
-      retro_assert(ga);
-
-      if (ga)
-      {
-         char data_path[1024] = {0};
-         strcpy(&data_path[0], (char *)game_ai_lib_path);
-         strcat(&data_path[0], "/data/");
-         strcat(&data_path[0], (char *)g_game_name);
-
-         game_ai_lib_init(ga, (void *) g_ram_ptr, g_ram_size);
-         game_ai_lib_set_debug_log(ga, game_ai_debug_log);
-      }
+      game_ai_snapshot_t tmp;
+
+      if (!game_ai_snapshot_fill(&g_fill,
+               override_p1, override_p2, show_debug,
+               frame_data, frame_width, frame_height,
+               frame_pitch, pixel_format))
+         return;
+
+      slock_lock(g_lock);
+      if (g_mailbox_full)
+         g_stats.dropped_frames++;
+      tmp            = g_mailbox;
+      g_mailbox      = g_fill;
+      g_fill         = tmp;
+      g_mailbox_full = true;
+      scond_signal(g_cond);
+      slock_unlock(g_lock);
+      return;
    }
+#endif
 
    if (g_frameCount >= (GAMEAI_SKIPFRAMES - 1))
    {
-      if (ga)
+      signed short int bits[GAME_AI_MAX_PLAYERS];
+      retro_time_t     start = cpu_features_get_time_usec();
+
+      if (     game_ai_snapshot_fill(&g_work,
+                  override_p1, override_p2, show_debug,
+                  frame_data, frame_width, frame_height,
+                  frame_pitch, pixel_format)
+            && game_ai_create())
       {
-         bool b[GAMEAI_MAX_BUTTONS] = {0};
-
-         g_buttons_bits[0]=0;
-         g_buttons_bits[1]=0;
-
-         if (override_p1)
-         {
-            game_ai_lib_think(ga, b, 0, frame_data, frame_width, frame_height, frame_pitch, pixel_format);
-            array_to_bits_16(&g_buttons_bits[0], b);
-         }
-
-         if (override_p2)
-         {
-            game_ai_lib_think(ga, b, 1, frame_data, frame_width, frame_height, frame_pitch, pixel_format);
-            array_to_bits_16(&g_buttons_bits[1], b);
-         }
+         game_ai_run_snapshot(&g_work, bits);
+         game_ai_publish(bits, g_work.frame_count,
+               cpu_features_get_time_usec() - start);
       }
-      g_frameCount=0;
+      g_frameCount = 0;
    }
    else
       g_frameCount++;
@@ -28,6 +28,10 @@ RETRO_BEGIN_DECLS
 signed short int game_ai_input(unsigned int port, unsigned int device,
       unsigned int idx, unsigned int id, signed short int result);
 
+/* Applies the most recent predicted inputs;
+ * called once per input poll */
+void game_ai_poll(void);
+
 void game_ai_init(void);
 
 void game_ai_shutdown(void);
@@ -35,6 +39,13 @@ void game_ai_shutdown(void);
 void game_ai_load(const char * name, void * ram_ptr,
       int ram_size, retro_log_printf_t log);
 
+/* Stops inference, logs its metrics and drops the model;
+ * called before the core unloads its content */
+void game_ai_unload(void);
+
+/* Queues the current frame and a copy of RAM for
+ * inference. With threads, the model runs on its own
+ * thread and only ever sees the latest frame. */
 void game_ai_think(bool override_p1, bool override_p2, bool show_debug,
       const void *frame_data, unsigned int frame_w, unsigned int frame_h,
       unsigned int frame_pitch, unsigned int pixel_format);
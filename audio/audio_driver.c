@@ -64,6 +64,10 @@
 #include "../retroarch.h"
 #include "../list_special.h"
 #include "../file_path_special.h"
+#include "../performance_counters.h"
+#ifdef HAVE_SHM_EXPORT
+#include "../shm_export.h"
+#endif
 #include "../record/record_driver.h"
 #include "../tasks/task_content.h"
 #include "../runloop.h"
@@ -455,6 +459,7 @@ static void audio_driver_flush(audio_driver_state_t *audio_st,
          (audio_st->mute_enable || audio_st->flags & AUDIO_FLAG_MUTED)
                ? 0.0f
                : audio_st->volume_gain;
+   retro_time_t trace_start          = rarch_trace_begin();
 
    src_data.data_out                 = NULL;
    src_data.output_frames            = 0;
@@ -620,6 +625,8 @@ static void audio_driver_flush(audio_driver_state_t *audio_st,
       audio_st->current_audio->write(audio_st->context_audio_data,
             output_data, output_frames * 2);
    }
+
+   rarch_trace_end("audio_flush", trace_start);
 }
 
 #ifdef HAVE_AUDIOMIXER
@@ -884,6 +891,11 @@ void audio_driver_sample(int16_t left, int16_t right)
       recording_st->driver->push_audio(recording_st->data, &ffemu_data);
    }
 
+#ifdef HAVE_SHM_EXPORT
+   shm_export_push_audio(audio_st->output_samples_conv_buf,
+         audio_st->data_ptr / 2);
+#endif
+
    if (!(    (runloop_flags   & RUNLOOP_FLAG_PAUSED)
          || !(audio_st->flags & AUDIO_FLAG_ACTIVE)
          || !(audio_st->output_samples_buf)))
@@ -918,6 +930,10 @@ size_t audio_driver_sample_batch(const int16_t *data, size_t frames)
            && record_st->driver
            && record_st->driver->push_audio;
 
+#ifdef HAVE_SHM_EXPORT
+   shm_export_push_audio(data, frames);
+#endif
+
    /* We want to run this loop at least once, so use a
     * do...while (do...while has only a single conditional
     * jump, as opposed to for and while which have a
@@ -63,8 +63,12 @@
 #include "cheat_manager.h"
 #include "content.h"
 #include "dynamic.h"
+#ifdef HAVE_ENV_HOST
+#include "env_host.h"
+#endif
 #include "list_special.h"
 #include "paths.h"
+#include "performance_counters.h"
 #include "retroarch.h"
 #include "runloop.h"
 #include "verbosity.h"
@@ -806,6 +810,31 @@ bool command_play_replay_slot(command_t *cmd, const char *arg)
 #endif
 }
 
+bool command_seek_replay(command_t *cmd, const char *arg)
+{
+#ifdef HAVE_BSV_MOVIE
+   char reply[128];
+   input_driver_state_t *input_st = input_state_get_ptr();
+   bsv_movie_t *handle            = input_st->bsv_movie_state_handle;
+   uint64_t frame                 = (uint64_t)strtoull(arg, NULL, 10);
+   bool ret                       = handle
+      && (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_PLAYBACK)
+      && bsv_movie_seek(handle, frame);
+   size_t _len;
+   /* Replies with the frame playback resumes from, the
+    * frames up to the target then run headless */
+   if (ret)
+      _len = (size_t)snprintf(reply, sizeof(reply), "SEEK_REPLAY %llu\n",
+            (unsigned long long)handle->frame_counter);
+   else
+      _len = strlcpy(reply, "SEEK_REPLAY -1\n", sizeof(reply));
+   cmd->replier(cmd, reply, _len);
+   return ret;
+#else
+   return false;
+#endif
+}
+
 bool command_save_savefiles(command_t *cmd, const char* arg)
 {
    char reply[4];
@@ -1024,6 +1053,42 @@ bool command_get_status(command_t *cmd, const char* arg)
    return true;
 }
 
+bool command_trace(command_t *cmd, const char *arg)
+{
+   size_t _len;
+   char reply[256];
+   const char *path = NULL;
+
+   if (!arg)
+      arg = "";
+   if ((path = strchr(arg, ' ')))
+      path++;
+
+   if (string_starts_with_size(arg, "START", STRLEN_CONST("START")))
+   {
+      rarch_trace_start(path);
+      _len = strlcpy(reply, "TRACE STARTED\n", sizeof(reply));
+   }
+   else if (string_is_equal(arg, "STOP"))
+   {
+      rarch_trace_stop();
+      _len = strlcpy(reply, "TRACE STOPPED\n", sizeof(reply));
+   }
+   else if (string_starts_with_size(arg, "EXPORT", STRLEN_CONST("EXPORT")))
+   {
+      if (rarch_trace_export(path))
+         _len = strlcpy(reply, "TRACE EXPORTED\n", sizeof(reply));
+      else
+         _len = strlcpy(reply, "TRACE -1 no output path\n", sizeof(reply));
+   }
+   else
+      _len = strlcpy(reply, "TRACE -1 unknown argument\n", sizeof(reply));
+
+   cmd->replier(cmd, reply, _len);
+
+   return true;
+}
+
 bool command_read_memory(command_t *cmd, const char *arg)
 {
    unsigned i;
@@ -1067,6 +1132,167 @@ bool command_read_memory(command_t *cmd, const char *arg)
    return true;
 }
 
+#ifdef HAVE_ENV_HOST
+static void command_env_reply(command_t *cmd, const char *name, bool ok)
+{
+   char reply[128];
+   size_t _len = snprintf(reply, sizeof(reply), "%s %s\n",
+         name, ok ? "OK" : "-1");
+   cmd->replier(cmd, reply, _len);
+}
+
+bool command_env_create(command_t *cmd, const char *arg)
+{
+   unsigned num_instances = (unsigned)strtoul(arg, NULL, 10);
+   command_env_reply(cmd, "ENV_CREATE", env_host_init(num_instances));
+   return true;
+}
+
+bool command_env_destroy(command_t *cmd, const char *arg)
+{
+   env_host_deinit();
+   command_env_reply(cmd, "ENV_DESTROY", true);
+   return true;
+}
+
+bool command_env_input(command_t *cmd, const char *arg)
+{
+   unsigned instance, port, buttons;
+
+   if (sscanf(arg, "%u %u %x", &instance, &port, &buttons) != 3)
+      return false;
+
+   command_env_reply(cmd, "ENV_INPUT",
+         env_host_set_input(instance, port, (uint16_t)buttons));
+   return true;
+}
+
+/* ENV_STEP <frames> [<port 0 buttons of instance 0> ...] */
+bool command_env_step(command_t *cmd, const char *arg)
+{
+   unsigned i;
+   char *end       = NULL;
+   unsigned frames = (unsigned)strtoul(arg, &end, 10);
+
+   if (end == arg)
+      return false;
+
+   for (i = 0; i < env_host_get_num_instances(); i++)
+   {
+      const char *next = end;
+      unsigned buttons = (unsigned)strtoul(next, &end, 16);
+      if (end == next)
+         break;
+      env_host_set_input(i, 0, (uint16_t)buttons);
+   }
+
+   command_env_reply(cmd, "ENV_STEP", env_host_step(frames));
+   return true;
+}
+
+bool command_env_reset(command_t *cmd, const char *arg)
+{
+   command_env_reply(cmd, "ENV_RESET", env_host_reset());
+   return true;
+}
+
+/* Replies with 'header' followed by a hex dump of 'data',
+ * in the READ_CORE_MEMORY format */
+static bool command_env_dump(command_t *cmd, const char *header,
+      size_t header_len, const uint8_t *data, unsigned nbytes)
+{
+   unsigned i;
+   char *reply;
+   char *reply_at;
+   size_t _len;
+
+   if (!(reply = (char*)malloc(header_len + nbytes * 3 + 2)))
+      return false;
+   memcpy(reply, header, header_len);
+   reply_at = reply + header_len;
+
+   for (i = 0; i < nbytes; i++)
+      snprintf(reply_at + 3 * i, 4, " %02X", data[i]);
+
+   reply_at[3 * nbytes] = '\n';
+   _len                 = reply_at + 3 * nbytes + 1 - reply;
+
+   cmd->replier(cmd, reply, _len);
+   free(reply);
+   return true;
+}
+
+/* Replies with the frame count of the instance and a hex
+ * dump of its system RAM */
+bool command_env_observe(command_t *cmd, const char *arg)
+{
+   char header[96];
+   size_t _len;
+   size_t size             = 0;
+   unsigned instance       = 0;
+   unsigned offset         = 0;
+   unsigned nbytes         = 0;
+   const uint8_t *data     = NULL;
+
+   if (sscanf(arg, "%u %x %u", &instance, &offset, &nbytes) != 3)
+      return false;
+
+   data = env_host_get_memory(instance, RETRO_MEMORY_SYSTEM_RAM, &size);
+   if (!data || offset >= size)
+   {
+      command_env_reply(cmd, "ENV_OBSERVE", false);
+      return true;
+   }
+   if (nbytes > size - offset)
+      nbytes = (unsigned)(size - offset);
+
+   _len = (size_t)snprintf(header, sizeof(header),
+         "ENV_OBSERVE %u %" PRIu64 " %x",
+         instance, env_host_get_frame_count(instance), offset);
+
+   return command_env_dump(cmd, header, _len, data + offset, nbytes);
+}
+
+/* Replies with the frame count of the instance, the
+ * geometry and RETRO_PIXEL_FORMAT_* of its last frame and a
+ * hex dump of the frame, whose rows are tightly packed */
+bool command_env_observe_frame(command_t *cmd, const char *arg)
+{
+   char header[160];
+   size_t _len;
+   size_t size                    = 0;
+   size_t pitch                   = 0;
+   unsigned width                 = 0;
+   unsigned height                = 0;
+   unsigned instance              = 0;
+   unsigned offset                = 0;
+   unsigned nbytes                = 0;
+   enum retro_pixel_format format = RETRO_PIXEL_FORMAT_0RGB1555;
+   const uint8_t *data            = NULL;
+
+   if (sscanf(arg, "%u %x %u", &instance, &offset, &nbytes) != 3)
+      return false;
+
+   data = (const uint8_t*)env_host_get_frame(instance,
+         &width, &height, &pitch, &format);
+   size = pitch * height;
+   if (!data || offset >= size)
+   {
+      command_env_reply(cmd, "ENV_OBSERVE_FRAME", false);
+      return true;
+   }
+   if (nbytes > size - offset)
+      nbytes = (unsigned)(size - offset);
+
+   _len = (size_t)snprintf(header, sizeof(header),
+         "ENV_OBSERVE_FRAME %u %" PRIu64 " %u %u %u %d %x",
+         instance, env_host_get_frame_count(instance),
+         width, height, (unsigned)pitch, (int)format, offset);
+
+   return command_env_dump(cmd, header, _len, data + offset, nbytes);
+}
+#endif
+
 bool command_write_memory(command_t *cmd, const char *arg)
 {
    unsigned int address         = (unsigned int)strtoul(arg, (char**)&arg, 16);
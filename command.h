@@ -417,10 +417,12 @@ struct cmd_action_map
 
 bool command_version(command_t *cmd, const char* arg);
 bool command_get_status(command_t *cmd, const char* arg);
+bool command_trace(command_t *cmd, const char *arg);
 bool command_get_config_param(command_t *cmd, const char* arg);
 bool command_show_osd_msg(command_t *cmd, const char* arg);
 bool command_load_state_slot(command_t *cmd, const char* arg);
 bool command_play_replay_slot(command_t *cmd, const char* arg);
+bool command_seek_replay(command_t *cmd, const char* arg);
 bool command_save_savefiles(command_t *cmd, const char* arg);
 bool command_load_savefiles(command_t *cmd, const char* arg);
 #ifdef HAVE_CHEEVOS
@@ -429,6 +431,15 @@ bool command_write_ram(command_t *cmd, const char *arg);
 #endif
 bool command_read_memory(command_t *cmd, const char *arg);
 bool command_write_memory(command_t *cmd, const char *arg);
+#ifdef HAVE_ENV_HOST
+bool command_env_create(command_t *cmd, const char *arg);
+bool command_env_destroy(command_t *cmd, const char *arg);
+bool command_env_input(command_t *cmd, const char *arg);
+bool command_env_step(command_t *cmd, const char *arg);
+bool command_env_reset(command_t *cmd, const char *arg);
+bool command_env_observe(command_t *cmd, const char *arg);
+bool command_env_observe_frame(command_t *cmd, const char *arg);
+#endif
 
 static const struct cmd_action_map action_map[] = {
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
@@ -436,6 +447,7 @@ static const struct cmd_action_map action_map[] = {
 #endif
    { "VERSION",          command_version,          "No argument"},
    { "GET_STATUS",       command_get_status,       "No argument" },
+   { "TRACE",            command_trace,            "<START [path]|STOP|EXPORT [path]>" },
    { "GET_CONFIG_PARAM", command_get_config_param, "<param name>" },
    { "SHOW_MSG",         command_show_osd_msg,     "No argument" },
 #if defined(HAVE_CHEEVOS)
@@ -449,9 +461,20 @@ static const struct cmd_action_map action_map[] = {
 
    { "LOAD_STATE_SLOT",command_load_state_slot, "<slot number>"},
    { "PLAY_REPLAY_SLOT",command_play_replay_slot, "<slot number>"},
+   { "SEEK_REPLAY",command_seek_replay, "<frame number>"},
 
    { "SAVE_FILES", command_save_savefiles, "No argument"},
    { "LOAD_FILES", command_load_savefiles, "No argument"},
+
+#ifdef HAVE_ENV_HOST
+   { "ENV_CREATE",        command_env_create,         "<number of instances>" },
+   { "ENV_DESTROY",       command_env_destroy,        "No argument" },
+   { "ENV_INPUT",         command_env_input,          "<instance> <port> <hex button mask>" },
+   { "ENV_STEP",          command_env_step,           "<frames> [<hex port 0 buttons per instance> ...]" },
+   { "ENV_RESET",         command_env_reset,          "No argument" },
+   { "ENV_OBSERVE",       command_env_observe,        "<instance> <address> <number of bytes>" },
+   { "ENV_OBSERVE_FRAME", command_env_observe_frame,  "<instance> <offset> <number of bytes>" },
+#endif
 };
 
 static const struct cmd_map map[] = {
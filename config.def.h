@@ -1151,6 +1151,10 @@
 /* Display a white flashing effect with the desired
  * duration when taking a screenshot*/
 #define DEFAULT_NOTIFICATION_SHOW_SCREENSHOT_FLASH 0
+
+/* Image format of screenshots. Savestate thumbnails
+ * are always PNG. */
+#define DEFAULT_SCREENSHOT_FORMAT SCREENSHOT_FORMAT_PNG
 #endif
 
 /* Display a notification when setting the refresh rate*/
@@ -1593,6 +1597,10 @@
 #define DEFAULT_TURBO_BUTTON RETRO_DEVICE_ID_JOYPAD_B
 #define DEFAULT_TURBO_ALLOW_DPAD false
 
+/* Resolve the input of each port once per poll and
+ * answer core queries from that snapshot */
+#define DEFAULT_INPUT_STATE_SNAPSHOT true
+
 /* Enable automatic mouse grab by default
  * only on Android */
 #if defined(ANDROID)
@@ -1653,6 +1661,12 @@
 
 #define DEFAULT_GFX_THUMBNAIL_UPSCALE_THRESHOLD 0
 
+/* Number of threads decoding images (thumbnails,
+ * wallpapers) in the background, so that several
+ * decode at once. 0 decodes them on the task thread,
+ * a slice per frame. */
+#define DEFAULT_IMAGE_DECODE_THREADS 2
+
 #ifdef HAVE_MENU
 #if defined(RS90) || defined(MIYOO)
 /* The RS-90 has a hardware clock that is neither
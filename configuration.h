@@ -80,6 +80,15 @@ enum crt_switch_type
    CRT_SWITCH_INI
 };
 
+enum screenshot_format
+{
+   SCREENSHOT_FORMAT_PNG = 0,
+   /* Lossless, much faster to encode than PNG */
+   SCREENSHOT_FORMAT_QOI,
+   /* Uncompressed */
+   SCREENSHOT_FORMAT_BMP
+};
+
 enum override_type
 {
    OVERRIDE_NONE = 0,
@@ -276,6 +285,7 @@ typedef struct settings
 #ifdef HAVE_SCREENSHOTS
       unsigned notification_show_screenshot_duration;
       unsigned notification_show_screenshot_flash;
+      unsigned screenshot_format;
 #endif
 
       /* Accessibility */
@@ -287,6 +297,7 @@ typedef struct settings
       unsigned menu_left_thumbnails;
       unsigned menu_icon_thumbnails;
       unsigned gfx_thumbnail_upscale_threshold;
+      unsigned image_decode_threads;
       unsigned menu_rgui_thumbnail_downscaler;
       unsigned menu_rgui_thumbnail_delay;
       unsigned menu_rgui_color_theme;
@@ -699,6 +710,7 @@ typedef struct settings
 
       /* Input */
       bool input_remap_binds_enable;
+      bool input_state_snapshot;
       bool input_remap_sort_by_controller_enable;
       bool input_autodetect_enable;
       bool input_sensors_enable;
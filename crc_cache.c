@@ -0,0 +1,288 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2023 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/file_path.h>
+#include <string/stdstring.h>
+#include <streams/file_stream.h>
+#include <array/rhmap.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "verbosity.h"
+
+#include "crc_cache.h"
+
+/* Upper bound on the number of recorded files;
+ * once reached, only existing entries are updated */
+#define CRC_CACHE_MAX_ENTRIES 4096
+
+#define CRC_CACHE_HEADER "# RetroArch CRC cache v1: crc size mtime path"
+
+typedef struct
+{
+   int64_t size;
+   int64_t mtime;
+   uint32_t crc;
+} crc_cache_entry_t;
+
+struct crc_cache
+{
+   crc_cache_entry_t *entries; /* rhmap, keyed by path */
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+   char *path;
+   bool modified;
+};
+
+#ifdef HAVE_THREADS
+#define CRC_CACHE_LOCK(cache)   slock_lock((cache)->lock)
+#define CRC_CACHE_UNLOCK(cache) slock_unlock((cache)->lock)
+#else
+#define CRC_CACHE_LOCK(cache)
+#define CRC_CACHE_UNLOCK(cache)
+#endif
+
+/* Parses a single 'crc size mtime path' line.
+ * Returns false if the line is malformed */
+static bool crc_cache_parse_line(char *line,
+      crc_cache_entry_t *entry, char **entry_path)
+{
+   char *tok = line;
+   char *end = NULL;
+
+   entry->crc   = (uint32_t)strtoul(tok, &end, 16);
+   if (end == tok || *end != ' ')
+      return false;
+   tok          = end + 1;
+
+   entry->size  = (int64_t)strtoull(tok, &end, 10);
+   if (end == tok || *end != ' ')
+      return false;
+   tok          = end + 1;
+
+   entry->mtime = (int64_t)strtoull(tok, &end, 10);
+   if (end == tok || *end != ' ')
+      return false;
+   tok          = end + 1;
+
+   if (string_is_empty(tok))
+      return false;
+
+   *entry_path  = tok;
+   return true;
+}
+
+static void crc_cache_load(crc_cache_t *cache)
+{
+   char *line    = NULL;
+   RFILE *file   = filestream_open(cache->path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return;
+
+   while (     !filestream_eof(file)
+         && (line = filestream_getline(file)))
+   {
+      crc_cache_entry_t entry;
+      char *entry_path = NULL;
+
+      if (     *line != '#'
+            && RHMAP_LEN(cache->entries) < CRC_CACHE_MAX_ENTRIES
+            && crc_cache_parse_line(line, &entry, &entry_path))
+         RHMAP_SET_STR(cache->entries, entry_path, entry);
+
+      free(line);
+   }
+
+   filestream_close(file);
+}
+
+crc_cache_t *crc_cache_new(const char *path)
+{
+   crc_cache_t *cache = (crc_cache_t*)calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+#ifdef HAVE_THREADS
+   if (!(cache->lock = slock_new()))
+   {
+      free(cache);
+      return NULL;
+   }
+#endif
+
+   if (!string_is_empty(path))
+   {
+      cache->path = strdup(path);
+      crc_cache_load(cache);
+   }
+
+   return cache;
+}
+
+bool crc_cache_save(crc_cache_t *cache)
+{
+   size_t i, cap;
+   RFILE *file = NULL;
+   bool ret    = true;
+
+   if (!cache)
+      return false;
+
+   CRC_CACHE_LOCK(cache);
+
+   if (!cache->path || !cache->modified)
+      goto end;
+
+   if (!(file = filestream_open(cache->path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_WARN("[CRC Cache] Failed to write \"%s\".\n", cache->path);
+      ret = false;
+      goto end;
+   }
+
+   filestream_printf(file, "%s\n", CRC_CACHE_HEADER);
+
+   for (i = 0, cap = RHMAP_CAP(cache->entries); i != cap; i++)
+   {
+      const crc_cache_entry_t *entry = NULL;
+      if (!RHMAP_KEY(cache->entries, i))
+         continue;
+      entry = &cache->entries[i];
+      filestream_printf(file, "%08x %" PRIu64 " %" PRIu64 " %s\n",
+            (unsigned)entry->crc,
+            (uint64_t)entry->size,
+            (uint64_t)entry->mtime,
+            RHMAP_KEY_STR(cache->entries, i));
+   }
+
+   filestream_close(file);
+   cache->modified = false;
+
+end:
+   CRC_CACHE_UNLOCK(cache);
+   return ret;
+}
+
+void crc_cache_free(crc_cache_t *cache)
+{
+   if (!cache)
+      return;
+
+   crc_cache_save(cache);
+
+   RHMAP_FREE(cache->entries);
+#ifdef HAVE_THREADS
+   slock_free(cache->lock);
+#endif
+   if (cache->path)
+      free(cache->path);
+   free(cache);
+}
+
+bool crc_cache_lookup_stat(crc_cache_t *cache,
+      const char *path, int64_t size, int64_t mtime,
+      uint32_t *crc)
+{
+   ptrdiff_t idx;
+   bool found = false;
+
+   if (!cache || string_is_empty(path))
+      return false;
+
+   CRC_CACHE_LOCK(cache);
+
+   if ((idx = RHMAP_IDX_STR(cache->entries, path)) >= 0)
+   {
+      const crc_cache_entry_t *entry = &cache->entries[idx];
+
+      if (     entry->size  == size
+            && entry->mtime == mtime)
+      {
+         if (crc)
+            *crc = entry->crc;
+         found   = true;
+      }
+      else
+      {
+         /* File has changed since it was hashed */
+         if (RHMAP_DEL_STR(cache->entries, path))
+            cache->modified = true;
+      }
+   }
+
+   CRC_CACHE_UNLOCK(cache);
+   return found;
+}
+
+bool crc_cache_lookup(crc_cache_t *cache,
+      const char *path, uint32_t *crc)
+{
+   int64_t size  = 0;
+   int64_t mtime = 0;
+
+   if (!cache || !path_get_size_mtime(path, &size, &mtime))
+      return false;
+
+   return crc_cache_lookup_stat(cache, path, size, mtime, crc);
+}
+
+void crc_cache_insert_stat(crc_cache_t *cache,
+      const char *path, int64_t size, int64_t mtime,
+      uint32_t crc)
+{
+   crc_cache_entry_t entry;
+
+   if (!cache || string_is_empty(path))
+      return;
+
+   entry.size  = size;
+   entry.mtime = mtime;
+   entry.crc   = crc;
+
+   CRC_CACHE_LOCK(cache);
+
+   if (     RHMAP_LEN(cache->entries) < CRC_CACHE_MAX_ENTRIES
+         || RHMAP_HAS_STR(cache->entries, path))
+   {
+      RHMAP_SET_STR(cache->entries, path, entry);
+      cache->modified = true;
+   }
+
+   CRC_CACHE_UNLOCK(cache);
+}
+
+void crc_cache_insert(crc_cache_t *cache,
+      const char *path, uint32_t crc)
+{
+   int64_t size  = 0;
+   int64_t mtime = 0;
+
+   if (!cache || !path_get_size_mtime(path, &size, &mtime))
+      return;
+
+   crc_cache_insert_stat(cache, path, size, mtime, crc);
+}
@@ -0,0 +1,80 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2023 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CRC_CACHE_H
+#define __CRC_CACHE_H
+
+#include <stdint.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/* Persistent map of file path -> CRC32, used to avoid
+ * re-hashing large files that have not changed since
+ * they were last seen. An entry is only considered
+ * valid if both the size and the modification time
+ * of the file still match the recorded values.
+ *
+ * All functions are thread safe. */
+typedef struct crc_cache crc_cache_t;
+
+/* Creates a new cache backed by the file at 'path'.
+ * If the file exists, its entries are loaded.
+ * 'path' may be NULL, in which case the cache is
+ * kept in memory only.
+ * Returns NULL on allocation failure. */
+crc_cache_t *crc_cache_new(const char *path);
+
+/* Writes the cache to its backing file, if any,
+ * and frees it */
+void crc_cache_free(crc_cache_t *cache);
+
+/* Fetches the CRC32 of the file at 'path'.
+ * Performs a stat() of the file to validate the
+ * cached entry; stale entries are discarded.
+ * Returns false on cache miss. */
+bool crc_cache_lookup(crc_cache_t *cache,
+      const char *path, uint32_t *crc);
+
+/* Same as crc_cache_lookup(), but validates the
+ * entry against a known size and modification
+ * time instead of querying the file system */
+bool crc_cache_lookup_stat(crc_cache_t *cache,
+      const char *path, int64_t size, int64_t mtime,
+      uint32_t *crc);
+
+/* Records the CRC32 of the file at 'path',
+ * along with its current size and modification
+ * time. Does nothing if the file cannot be
+ * queried. */
+void crc_cache_insert(crc_cache_t *cache,
+      const char *path, uint32_t crc);
+
+/* Same as crc_cache_insert(), using a known size
+ * and modification time */
+void crc_cache_insert_stat(crc_cache_t *cache,
+      const char *path, int64_t size, int64_t mtime,
+      uint32_t crc);
+
+/* Writes the cache to its backing file if it has
+ * been modified since it was loaded/last saved.
+ * Returns false on error. */
+bool crc_cache_save(crc_cache_t *cache);
+
+RETRO_END_DECLS
+
+#endif
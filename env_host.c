@@ -0,0 +1,577 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2023 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <dynamic/dylib.h>
+#include <rthreads/rthreads.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "configuration.h"
+#include "content.h"
+#include "dynamic.h"
+#include "env_host.h"
+#include "paths.h"
+#include "runahead.h"
+#include "runloop.h"
+#include "verbosity.h"
+
+enum env_host_cmd
+{
+   ENV_HOST_CMD_NONE = 0,
+   ENV_HOST_CMD_LOAD,
+   ENV_HOST_CMD_STEP,
+   ENV_HOST_CMD_RESET,
+   ENV_HOST_CMD_QUIT
+};
+
+typedef struct env_host_instance
+{
+   struct retro_core_t core;
+   sthread_t *thread;
+   dylib_t lib_handle;
+   char *library_path;
+   uint8_t *frame;
+   size_t frame_capacity;
+   size_t pitch;
+   uint64_t frame_count;
+   /* Last command generation this instance has seen */
+   unsigned generation;
+   unsigned index;
+   unsigned width;
+   unsigned height;
+   enum retro_pixel_format pix_fmt;
+   uint16_t input[ENV_HOST_MAX_PORTS];
+   bool loaded;
+   bool has_frame;
+} env_host_instance_t;
+
+/* The main thread publishes a command by bumping
+ * 'generation', then waits for 'pending' to drop to zero.
+ * Instance state is only touched by its own thread while
+ * a command runs, and by the main thread otherwise. */
+typedef struct
+{
+   env_host_instance_t *instances;
+   slock_t *lock;
+   scond_t *cmd_cond;
+   scond_t *done_cond;
+   /* Serialises calls forwarded to the frontend's
+    * environment callback */
+   slock_t *env_lock;
+   sthread_tls_t tls;
+   unsigned num_instances;
+   unsigned generation;
+   unsigned pending;
+   unsigned frames;
+   enum env_host_cmd cmd;
+   bool tls_inited;
+} env_host_state_t;
+
+static env_host_state_t env_host_st;
+
+static env_host_instance_t *env_host_get_instance(void)
+{
+   return (env_host_instance_t*)sthread_tls_get(&env_host_st.tls);
+}
+
+/* Instances are headless: anything touching the video or
+ * audio driver is refused, queries about paths and core
+ * options are answered by the frontend, and registrations
+ * already made by the primary copy of the core are
+ * accepted and ignored. */
+static bool env_host_environment_cb(unsigned cmd, void *data)
+{
+   env_host_instance_t *inst = env_host_get_instance();
+
+   if (!inst)
+      return false;
+
+   switch (cmd & ~RETRO_ENVIRONMENT_EXPERIMENTAL)
+   {
+      case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+         {
+            enum retro_pixel_format pix_fmt =
+               *(const enum retro_pixel_format*)data;
+            if (pix_fmt > RETRO_PIXEL_FORMAT_RGB565)
+               return false;
+            inst->pix_fmt = pix_fmt;
+         }
+         return true;
+      case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+         *(bool*)data = true;
+         return true;
+      case RETRO_ENVIRONMENT_GET_OVERSCAN:
+      case RETRO_ENVIRONMENT_GET_FASTFORWARDING:
+      case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+         *(bool*)data = false;
+         return true;
+      case RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE:
+         /* Video only; the cores may skip audio */
+         *(int*)data  = 1;
+         return true;
+      case RETRO_ENVIRONMENT_GET_INPUT_BITMASKS:
+      case RETRO_ENVIRONMENT_SET_ROTATION:
+      case RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL:
+      case RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME:
+      case RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS:
+      case RETRO_ENVIRONMENT_SET_CONTROLLER_INFO:
+      case RETRO_ENVIRONMENT_SET_SUBSYSTEM_INFO:
+      case RETRO_ENVIRONMENT_SET_MEMORY_MAPS:
+      case RETRO_ENVIRONMENT_SET_GEOMETRY:
+      case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+      case RETRO_ENVIRONMENT_SET_SUPPORT_ACHIEVEMENTS:
+      case RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS:
+      case RETRO_ENVIRONMENT_SET_VARIABLES:
+      case RETRO_ENVIRONMENT_SET_CORE_OPTIONS:
+      case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_INTL:
+      case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2:
+      case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_V2_INTL:
+      case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY:
+      case RETRO_ENVIRONMENT_SET_CORE_OPTIONS_UPDATE_DISPLAY_CALLBACK:
+      case RETRO_ENVIRONMENT_SET_CONTENT_INFO_OVERRIDE:
+      case RETRO_ENVIRONMENT_SET_MINIMUM_AUDIO_LATENCY:
+      case RETRO_ENVIRONMENT_SET_MESSAGE:
+      case RETRO_ENVIRONMENT_SET_MESSAGE_EXT:
+         return true;
+      case RETRO_ENVIRONMENT_GET_VARIABLE:
+      case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+      case RETRO_ENVIRONMENT_GET_PERF_INTERFACE:
+      case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+      case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+      case RETRO_ENVIRONMENT_GET_CORE_ASSETS_DIRECTORY:
+      case RETRO_ENVIRONMENT_GET_LIBRETRO_PATH:
+      case RETRO_ENVIRONMENT_GET_LANGUAGE:
+      case RETRO_ENVIRONMENT_GET_USERNAME:
+      case RETRO_ENVIRONMENT_GET_CORE_OPTIONS_VERSION:
+      case RETRO_ENVIRONMENT_GET_MESSAGE_INTERFACE_VERSION:
+      case RETRO_ENVIRONMENT_GET_INPUT_MAX_USERS:
+      case RETRO_ENVIRONMENT_GET_GAME_INFO_EXT:
+         {
+            bool ret;
+            slock_lock(env_host_st.env_lock);
+            ret = runloop_environment_cb(cmd, data);
+            slock_unlock(env_host_st.env_lock);
+            return ret;
+         }
+      default:
+         break;
+   }
+
+   return false;
+}
+
+static void env_host_video_refresh(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   unsigned y;
+   size_t row_size, size;
+   env_host_instance_t *inst = env_host_get_instance();
+
+   /* NULL is a duped frame: keep the previous one */
+   if (!inst || !data || data == RETRO_HW_FRAME_BUFFER_VALID)
+      return;
+
+   row_size = width * ((inst->pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+         ? sizeof(uint32_t) : sizeof(uint16_t));
+   size     = row_size * height;
+
+   if (size > inst->frame_capacity)
+   {
+      uint8_t *frame = (uint8_t*)realloc(inst->frame, size);
+      if (!frame)
+         return;
+      inst->frame          = frame;
+      inst->frame_capacity = size;
+   }
+
+   /* Stored tightly packed */
+   for (y = 0; y < height; y++)
+      memcpy(inst->frame + y * row_size,
+            (const uint8_t*)data + y * pitch, row_size);
+
+   inst->width     = width;
+   inst->height    = height;
+   inst->pitch     = row_size;
+   inst->has_frame = true;
+}
+
+static void env_host_audio_sample(int16_t left, int16_t right) { }
+
+static size_t env_host_audio_sample_batch(const int16_t *data,
+      size_t frames)
+{
+   return frames;
+}
+
+static void env_host_input_poll(void) { }
+
+static int16_t env_host_input_state(unsigned port,
+      unsigned device, unsigned idx, unsigned id)
+{
+   env_host_instance_t *inst = env_host_get_instance();
+
+   if (     !inst
+         || port >= ENV_HOST_MAX_PORTS
+         || (device & RETRO_DEVICE_MASK) != RETRO_DEVICE_JOYPAD)
+      return 0;
+
+   if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+      return (int16_t)inst->input[port];
+   if (id < 16)
+      return (inst->input[port] >> id) & 1;
+   return 0;
+}
+
+static void env_host_instance_unload(env_host_instance_t *inst)
+{
+   if (inst->core.flags & RETRO_CORE_FLAG_GAME_LOADED)
+      inst->core.retro_unload_game();
+   if (inst->core.flags & RETRO_CORE_FLAG_INITED)
+      inst->core.retro_deinit();
+   memset(&inst->core, 0, sizeof(inst->core));
+
+   if (inst->lib_handle)
+      dylib_close(inst->lib_handle);
+   inst->lib_handle = NULL;
+
+   if (inst->library_path)
+   {
+      filestream_delete(inst->library_path);
+      free(inst->library_path);
+   }
+   inst->library_path = NULL;
+   inst->loaded       = false;
+}
+
+/* Runs on the instance thread, so the environment
+ * callbacks made by retro_init() and retro_load_game()
+ * already find their instance */
+static bool env_host_instance_load(env_host_instance_t *inst)
+{
+   char prefix[32];
+   unsigned port;
+   runloop_state_t *runloop_st            = runloop_state_get_ptr();
+   settings_t *settings                   = config_get_ptr();
+   const retro_ctx_load_content_info_t
+      *content                            = runloop_st->load_content_info;
+   const struct retro_game_info *info     = NULL;
+
+   if (     content->content
+         && content->content->size > 0
+         && content->content->elems[0].data)
+      info = content->info;
+   else if (!(content_get_flags() & CONTENT_ST_FLAG_CORE_DOES_NOT_NEED_CONTENT))
+      return false;
+
+   snprintf(prefix, sizeof(prefix), "env%u_", inst->index);
+   if (!(inst->library_path = runahead_copy_core_to_temp_file(
+               path_get(RARCH_PATH_CORE),
+               settings->paths.directory_libretro, prefix)))
+      return false;
+
+   if (!runloop_init_libretro_symbols(runloop_st,
+            CORE_TYPE_PLAIN, &inst->core,
+            inst->library_path, &inst->lib_handle))
+      return false;
+
+   inst->core.flags |= RETRO_CORE_FLAG_SYMBOLS_INITED;
+   inst->pix_fmt     = RETRO_PIXEL_FORMAT_0RGB1555;
+   inst->core.retro_set_environment(env_host_environment_cb);
+   inst->core.retro_init();
+   inst->core.flags |= RETRO_CORE_FLAG_INITED;
+
+   if (!inst->core.retro_load_game(info))
+      return false;
+   inst->core.flags |= RETRO_CORE_FLAG_GAME_LOADED;
+
+   inst->core.retro_set_video_refresh(env_host_video_refresh);
+   inst->core.retro_set_audio_sample(env_host_audio_sample);
+   inst->core.retro_set_audio_sample_batch(env_host_audio_sample_batch);
+   inst->core.retro_set_input_poll(env_host_input_poll);
+   inst->core.retro_set_input_state(env_host_input_state);
+
+   for (port = 0; port < runloop_st->system.ports.size
+         && port < ENV_HOST_MAX_PORTS; port++)
+      inst->core.retro_set_controller_port_device(port,
+            RETRO_DEVICE_JOYPAD);
+
+   return true;
+}
+
+static void env_host_thread(void *data)
+{
+   env_host_instance_t *inst = (env_host_instance_t*)data;
+   env_host_state_t *host    = &env_host_st;
+
+   sthread_tls_set(&host->tls, inst);
+
+   for (;;)
+   {
+      unsigned i, frames;
+      enum env_host_cmd cmd;
+
+      slock_lock(host->lock);
+      while (host->generation == inst->generation)
+         scond_wait(host->cmd_cond, host->lock);
+      inst->generation = host->generation;
+      cmd              = host->cmd;
+      frames           = host->frames;
+      slock_unlock(host->lock);
+
+      switch (cmd)
+      {
+         case ENV_HOST_CMD_LOAD:
+            if (!(inst->loaded = env_host_instance_load(inst)))
+               env_host_instance_unload(inst);
+            break;
+         case ENV_HOST_CMD_STEP:
+            if (inst->loaded)
+            {
+               for (i = 0; i < frames; i++)
+                  inst->core.retro_run();
+               inst->frame_count += frames;
+            }
+            break;
+         case ENV_HOST_CMD_RESET:
+            if (inst->loaded)
+               inst->core.retro_reset();
+            break;
+         case ENV_HOST_CMD_QUIT:
+            env_host_instance_unload(inst);
+            break;
+         default:
+            break;
+      }
+
+      slock_lock(host->lock);
+      if (--host->pending == 0)
+         scond_signal(host->done_cond);
+      slock_unlock(host->lock);
+
+      if (cmd == ENV_HOST_CMD_QUIT)
+         break;
+   }
+}
+
+/* Runs 'cmd' on every instance thread and waits for all
+ * of them to finish it */
+static void env_host_dispatch(enum env_host_cmd cmd, unsigned frames)
+{
+   unsigned i;
+   env_host_state_t *host = &env_host_st;
+
+   slock_lock(host->lock);
+   host->cmd     = cmd;
+   host->frames  = frames;
+   host->pending = 0;
+   for (i = 0; i < host->num_instances; i++)
+      if (host->instances[i].thread)
+         host->pending++;
+   host->generation++;
+   scond_broadcast(host->cmd_cond);
+   while (host->pending)
+      scond_wait(host->done_cond, host->lock);
+   slock_unlock(host->lock);
+}
+
+/* Also cleans up after a partially failed env_host_init() */
+void env_host_deinit(void)
+{
+   unsigned i;
+   env_host_state_t *host = &env_host_st;
+
+   if (!host->instances)
+      return;
+
+   if (host->lock && host->cmd_cond && host->done_cond)
+      env_host_dispatch(ENV_HOST_CMD_QUIT, 0);
+
+   for (i = 0; i < host->num_instances; i++)
+   {
+      if (host->instances[i].thread)
+         sthread_join(host->instances[i].thread);
+      free(host->instances[i].frame);
+   }
+
+   free(host->instances);
+   if (host->cmd_cond)
+      scond_free(host->cmd_cond);
+   if (host->done_cond)
+      scond_free(host->done_cond);
+   if (host->lock)
+      slock_free(host->lock);
+   if (host->env_lock)
+      slock_free(host->env_lock);
+
+   host->instances     = NULL;
+   host->cmd_cond      = NULL;
+   host->done_cond     = NULL;
+   host->lock          = NULL;
+   host->env_lock      = NULL;
+   host->num_instances = 0;
+
+   /* Every instance thread has been joined */
+   if (host->tls_inited)
+      sthread_tls_delete(&host->tls);
+   host->tls_inited    = false;
+
+   RARCH_LOG("[EnvHost] Instances unloaded.\n");
+}
+
+bool env_host_init(unsigned num_instances)
+{
+   unsigned i, loaded     = 0;
+   env_host_state_t *host = &env_host_st;
+   runloop_state_t *runloop_st = runloop_state_get_ptr();
+
+   env_host_deinit();
+
+   if (     !num_instances
+         || num_instances > ENV_HOST_MAX_INSTANCES
+         || !(runloop_st->flags & RUNLOOP_FLAG_CORE_RUNNING)
+         || (runloop_st->last_core_type != CORE_TYPE_PLAIN)
+         || !runloop_st->load_content_info
+         || runloop_st->load_content_info->special)
+   {
+      RARCH_ERR("[EnvHost] Needs a dynamic core with content loaded "
+            "(no subsystems), and 1 to %u instances.\n",
+            ENV_HOST_MAX_INSTANCES);
+      return false;
+   }
+
+   if (!(host->instances = (env_host_instance_t*)calloc(
+         num_instances, sizeof(*host->instances))))
+      return false;
+
+   if (     !(host->tls_inited = sthread_tls_create(&host->tls))
+         || !(host->lock      = slock_new())
+         || !(host->env_lock  = slock_new())
+         || !(host->cmd_cond  = scond_new())
+         || !(host->done_cond = scond_new()))
+      goto error;
+
+   host->num_instances = num_instances;
+
+   for (i = 0; i < num_instances; i++)
+   {
+      env_host_instance_t *inst = &host->instances[i];
+      inst->index               = i;
+      inst->generation          = host->generation;
+      if (!(inst->thread = sthread_create(env_host_thread, inst)))
+         goto error;
+   }
+
+   env_host_dispatch(ENV_HOST_CMD_LOAD, 0);
+
+   for (i = 0; i < num_instances; i++)
+      if (host->instances[i].loaded)
+         loaded++;
+
+   if (loaded != num_instances)
+   {
+      RARCH_ERR("[EnvHost] Only %u of %u instances could be loaded.\n",
+            loaded, num_instances);
+      goto error;
+   }
+
+   RARCH_LOG("[EnvHost] Loaded %u instances of \"%s\".\n",
+         num_instances, path_get(RARCH_PATH_CORE));
+   return true;
+
+error:
+   env_host_deinit();
+   return false;
+}
+
+unsigned env_host_get_num_instances(void)
+{
+   return env_host_st.num_instances;
+}
+
+bool env_host_set_input(unsigned instance, unsigned port,
+      uint16_t buttons)
+{
+   if (instance >= env_host_st.num_instances || port >= ENV_HOST_MAX_PORTS)
+      return false;
+   env_host_st.instances[instance].input[port] = buttons;
+   return true;
+}
+
+bool env_host_step(unsigned frames)
+{
+   if (!env_host_st.num_instances)
+      return false;
+   env_host_dispatch(ENV_HOST_CMD_STEP, frames);
+   return true;
+}
+
+bool env_host_reset(void)
+{
+   if (!env_host_st.num_instances)
+      return false;
+   env_host_dispatch(ENV_HOST_CMD_RESET, 0);
+   return true;
+}
+
+uint64_t env_host_get_frame_count(unsigned instance)
+{
+   if (instance >= env_host_st.num_instances)
+      return 0;
+   return env_host_st.instances[instance].frame_count;
+}
+
+const uint8_t *env_host_get_memory(unsigned instance,
+      unsigned type, size_t *size)
+{
+   env_host_instance_t *inst;
+
+   *size = 0;
+   if (instance >= env_host_st.num_instances)
+      return NULL;
+
+   inst  = &env_host_st.instances[instance];
+   if (!inst->loaded)
+      return NULL;
+
+   *size = inst->core.retro_get_memory_size(type);
+   return (const uint8_t*)inst->core.retro_get_memory_data(type);
+}
+
+const void *env_host_get_frame(unsigned instance,
+      unsigned *width, unsigned *height, size_t *pitch,
+      enum retro_pixel_format *format)
+{
+   env_host_instance_t *inst;
+
+   if (instance >= env_host_st.num_instances)
+      return NULL;
+
+   inst = &env_host_st.instances[instance];
+   if (!inst->has_frame)
+      return NULL;
+
+   *width  = inst->width;
+   *height = inst->height;
+   *pitch  = inst->pitch;
+   *format = inst->pix_fmt;
+   return inst->frame;
+}
@@ -0,0 +1,85 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2023 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ENV_HOST_H
+#define __ENV_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Environment host
+ *
+ * Runs several independent copies of the loaded core and
+ * content, each on its own thread and with its own input,
+ * memory and frame buffer, for batch stepping by external
+ * tools (reinforcement learning, regression testing).
+ *
+ * Like the run-ahead secondary core, every instance loads
+ * a private copy of the core library so that cores with
+ * static globals stay independent. Instances run headless:
+ * hardware rendered cores are not supported and audio is
+ * discarded.
+ *
+ * All functions must be called from the main thread. The
+ * batch calls block until every instance is done, so the
+ * primary core never runs concurrently with them.
+ */
+
+#define ENV_HOST_MAX_INSTANCES 64
+#define ENV_HOST_MAX_PORTS     4
+
+/* Loads 'num_instances' copies of the running core and
+ * content. Replaces any previous set of instances. */
+bool env_host_init(unsigned num_instances);
+
+void env_host_deinit(void);
+
+unsigned env_host_get_num_instances(void);
+
+/* Sets the RetroPad buttons (RETRO_DEVICE_ID_JOYPAD_*
+ * bitmask) seen by 'instance' on 'port' from the next step
+ * on */
+bool env_host_set_input(unsigned instance, unsigned port,
+      uint16_t buttons);
+
+/* Runs every instance for 'frames' frames */
+bool env_host_step(unsigned frames);
+
+/* Resets every instance */
+bool env_host_reset(void);
+
+/* Frames run by 'instance' since it was loaded */
+uint64_t env_host_get_frame_count(unsigned instance);
+
+/* Returns memory of type RETRO_MEMORY_* of 'instance',
+ * or NULL. Only valid until the next batch call. */
+const uint8_t *env_host_get_memory(unsigned instance,
+      unsigned type, size_t *size);
+
+/* Returns the last frame of 'instance', or NULL if it has
+ * not output one. Only valid until the next batch call. */
+const void *env_host_get_frame(unsigned instance,
+      unsigned *width, unsigned *height, size_t *pitch,
+      enum retro_pixel_format *format);
+
+RETRO_END_DECLS
+
+#endif
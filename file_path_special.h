@@ -106,11 +106,14 @@ RETRO_BEGIN_DECLS
 #define FILE_PATH_STANDALONE_EXEMPT_EXTENSION ".lsae"
 #define FILE_PATH_STANDALONE_EXEMPT_EXTENSION_NO_DOT "lsae"
 #define FILE_PATH_BACKUP_EXTENSION ".bak"
+#define FILE_PATH_THUMBNAIL_MANIFEST_EXTENSION ".lthm"
 #if defined(RARCH_MOBILE)
 #define FILE_PATH_DEFAULT_OVERLAY "gamepads/neo-retropad/neo-retropad.cfg"
 #endif
 #define FILE_PATH_CORE_INFO_CACHE "core_info.cache"
 #define FILE_PATH_CORE_INFO_CACHE_REFRESH "core_info.refresh"
+#define FILE_PATH_CONTENT_CRC_CACHE "content_crc.cache"
+#define FILE_PATH_CORE_CRC_CACHE "core_crc.cache"
 
 #ifdef HAVE_LAKKA
  #ifdef HAVE_LAKKA_SERVER
@@ -17,6 +17,7 @@
 #include <ctype.h>
 
 #include <file/file_path.h>
+#include <lists/lru_map.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
@@ -38,32 +39,26 @@
 #undef STATIC
 #endif
 
-#define STB_UNICODE_ATLAS_ROWS 16
-#define STB_UNICODE_ATLAS_COLS 16
-#define STB_UNICODE_ATLAS_SIZE (STB_UNICODE_ATLAS_ROWS * STB_UNICODE_ATLAS_COLS)
+/* Slots per atlas row and column, sized as in freetype.c */
+#define STB_UNICODE_ATLAS_MIN_DIM 16
+#define STB_UNICODE_ATLAS_MAX_DIM 32
+#define STB_UNICODE_ATLAS_MAX_PIXELS 2048
 /* Padding is required between each glyph in
  * the atlas to prevent texture bleed when
  * drawing with linear filtering enabled */
 #define STB_UNICODE_ATLAS_PADDING 1
 
-typedef struct stb_unicode_atlas_slot
-{
-   struct stb_unicode_atlas_slot* next;
-   struct font_glyph glyph;      /* unsigned alignment */
-   unsigned charcode;
-   unsigned last_used;
-} stb_unicode_atlas_slot_t;
-
 typedef struct
 {
    uint8_t *font_data;
    struct font_atlas atlas;               /* ptr alignment */
-   stb_unicode_atlas_slot_t* uc_map[0x100];
-   stb_unicode_atlas_slot_t atlas_slots[STB_UNICODE_ATLAS_SIZE];
+   /* Charcode -> atlas slot, least recently used
+    * slots are reused first */
+   lru_map_t *slot_map;
+   struct font_glyph *atlas_slots;
    stbtt_fontinfo info;                   /* ptr alignment */
    int max_glyph_width;
    int max_glyph_height;
-   unsigned usage_counter;
    float scale_factor;
    struct font_line_metrics line_metrics; /* float alignment */
 } stb_unicode_font_renderer_t;
@@ -79,46 +74,23 @@ static void font_renderer_stb_unicode_free(void *data)
    stb_unicode_font_renderer_t *self = (stb_unicode_font_renderer_t*)data;
 
    free(self->atlas.buffer);
+   free(self->atlas_slots);
+   lru_map_free(self->slot_map);
    free(self->font_data);
    free(self);
 }
 
-static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_font_renderer_t *handle)
-{
-   int i, map_id;
-   unsigned oldest = 0;
-
-   for (i = 1; i < STB_UNICODE_ATLAS_SIZE; i++)
-      if ((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
-
-   /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if (handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
-   else if (handle->uc_map[map_id])
-   {
-      stb_unicode_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while (ptr->next && ptr->next != &handle->atlas_slots[oldest])
-         ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
-   }
-
-   return &handle->atlas_slots[oldest];
-}
-
 static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
       void *data, uint32_t charcode)
 {
+   int slot                             = 0;
    int glyph_index                      = 0;
    int x0                               = 0;
    int y1                               = 0;
    int advance_width                    = 0;
    int left_side_bearing                = 0;
-   unsigned map_id                      = 0;
    uint8_t *dst                         = NULL;
-   stb_unicode_atlas_slot_t* atlas_slot = NULL;
+   struct font_glyph *glyph             = NULL;
    stb_unicode_font_renderer_t *self    = (stb_unicode_font_renderer_t*)data;
    float glyph_advance_x                = 0.0f;
    float glyph_draw_offset_y            = 0.0f;
@@ -126,28 +98,15 @@ static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
    if (!self)
       return NULL;
 
-   map_id                               = charcode & 0xFF;
-   atlas_slot                           = self->uc_map[map_id];
+   if ((slot = lru_map_get(self->slot_map, charcode)) >= 0)
+      return &self->atlas_slots[slot];
 
-   while (atlas_slot)
-   {
-      if (atlas_slot->charcode == charcode)
-      {
-         atlas_slot->last_used = self->usage_counter++;
-         return &atlas_slot->glyph;
-      }
-      atlas_slot = atlas_slot->next;
-   }
+   glyph                            = &self->atlas_slots[
+      lru_map_put(self->slot_map, charcode, NULL, NULL)];
+   glyph_index                      = stbtt_FindGlyphIndex(&self->info, charcode);
 
-   atlas_slot             = font_renderer_stb_unicode_get_slot(self);
-   atlas_slot->charcode   = charcode;
-   atlas_slot->next       = self->uc_map[map_id];
-   self->uc_map[map_id]   = atlas_slot;
-
-   glyph_index            = stbtt_FindGlyphIndex(&self->info, charcode);
-
-   dst = (uint8_t*)self->atlas.buffer + atlas_slot->glyph.atlas_offset_x
-         + atlas_slot->glyph.atlas_offset_y * self->atlas.width;
+   dst = (uint8_t*)self->atlas.buffer + glyph->atlas_offset_x
+         + glyph->atlas_offset_y * self->atlas.width;
 
    stbtt_GetGlyphHMetrics(&self->info, glyph_index, &advance_width, &left_side_bearing);
 
@@ -165,61 +124,70 @@ static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
             dst[x + (y * self->atlas.width)] = 0;
    }
 
-   atlas_slot->glyph.width          = self->max_glyph_width;
-   atlas_slot->glyph.height         = self->max_glyph_height;
+   glyph->width                     = self->max_glyph_width;
+   glyph->height                    = self->max_glyph_height;
 
    /* advance_x must always be rounded to the
     * *nearest* integer */
    glyph_advance_x                  = (float)advance_width * self->scale_factor;
-   atlas_slot->glyph.advance_x      = (int)((glyph_advance_x > 0.0f)
+   glyph->advance_x                 = (int)((glyph_advance_x > 0.0f)
          ? (glyph_advance_x + 0.5f) 
          : (glyph_advance_x - 0.5f));
    /* advance_y is always zero */
-   atlas_slot->glyph.advance_y      = 0;
+   glyph->advance_y                 = 0;
 
    /* draw_offset_x must always be rounded *down*
     * to the nearest integer */
-   atlas_slot->glyph.draw_offset_x  = (int)((float)x0 * self->scale_factor);
+   glyph->draw_offset_x             = (int)((float)x0 * self->scale_factor);
 
    /* draw_offset_y must always be rounded *up*
     * to the nearest integer */
    glyph_draw_offset_y              = (float)(-y1) * self->scale_factor;
-   atlas_slot->glyph.draw_offset_y  = (int)((glyph_draw_offset_y < 0.0f)
+   glyph->draw_offset_y             = (int)((glyph_draw_offset_y < 0.0f)
          ? floor((double)glyph_draw_offset_y) 
          : ceil((double)glyph_draw_offset_y));
 
    self->atlas.dirty                = true;
-   atlas_slot->last_used            = self->usage_counter++;
-   return &atlas_slot->glyph;
+   return glyph;
 }
 
 static bool font_renderer_stb_unicode_create_atlas(
       stb_unicode_font_renderer_t *self, float font_size)
 {
    unsigned i, x, y;
-   stb_unicode_atlas_slot_t* slot = NULL;
+   struct font_glyph *slot        = NULL;
    int max_glyph_size             = (font_size < 0) ? -font_size : font_size;
+   unsigned dim                   = STB_UNICODE_ATLAS_MAX_PIXELS
+      / (max_glyph_size + STB_UNICODE_ATLAS_PADDING);
+
+   if (dim < STB_UNICODE_ATLAS_MIN_DIM)
+      dim = STB_UNICODE_ATLAS_MIN_DIM;
+   else if (dim > STB_UNICODE_ATLAS_MAX_DIM)
+      dim = STB_UNICODE_ATLAS_MAX_DIM;
 
    self->max_glyph_width          = max_glyph_size;
    self->max_glyph_height         = max_glyph_size;
 
-   self->atlas.width              = (self->max_glyph_width  + STB_UNICODE_ATLAS_PADDING) * STB_UNICODE_ATLAS_COLS;
-   self->atlas.height             = (self->max_glyph_height + STB_UNICODE_ATLAS_PADDING) * STB_UNICODE_ATLAS_ROWS;
+   self->atlas.width              = (self->max_glyph_width  + STB_UNICODE_ATLAS_PADDING) * dim;
+   self->atlas.height             = (self->max_glyph_height + STB_UNICODE_ATLAS_PADDING) * dim;
 
    self->atlas.buffer             = (uint8_t*)calloc(
       self->atlas.width * self->atlas.height, sizeof(uint8_t));
+   self->atlas_slots              = (struct font_glyph*)calloc(
+      dim * dim, sizeof(struct font_glyph));
+   self->slot_map                 = lru_map_new(dim * dim);
 
-   if (!self->atlas.buffer)
+   if (!self->atlas.buffer || !self->atlas_slots || !self->slot_map)
       return false;
 
    slot = self->atlas_slots;
 
-   for (y = 0; y < STB_UNICODE_ATLAS_ROWS; y++)
+   for (y = 0; y < dim; y++)
    {
-      for (x = 0; x < STB_UNICODE_ATLAS_COLS; x++)
+      for (x = 0; x < dim; x++)
       {
-         slot->glyph.atlas_offset_x = x * (self->max_glyph_width  + STB_UNICODE_ATLAS_PADDING);
-         slot->glyph.atlas_offset_y = y * (self->max_glyph_height + STB_UNICODE_ATLAS_PADDING);
+         slot->atlas_offset_x = x * (self->max_glyph_width  + STB_UNICODE_ATLAS_PADDING);
+         slot->atlas_offset_y = y * (self->max_glyph_height + STB_UNICODE_ATLAS_PADDING);
          slot++;
       }
    }
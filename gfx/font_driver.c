@@ -15,14 +15,23 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#include <features/features_cpu.h>
+#include <lists/lru_map.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #ifdef HAVE_CONFIG_H
 #include "../config.h"
 #endif
 
 #include "font_driver.h"
+#include "video_driver.h"
 #include "video_thread_wrapper.h"
+#include "../verbosity.h"
 
 /* TODO/FIXME - global */
 static void *video_font_driver = NULL;
@@ -403,6 +412,188 @@ static bool font_init_first(
    return false;
 }
 
+/* Cache of message widths and reshaped messages
+ *
+ * Menu drivers and widgets measure the same labels many
+ * times per frame, and every render of a right-to-left
+ * message reshapes it again. Results are kept per font,
+ * keyed by a hash of kind, scale and the message bytes,
+ * and dropped least recently used first. Each slot of the
+ * map holds one entry; messages whose hashes collide share
+ * it. Cache and font go away together, so a new font or
+ * size starts out empty. */
+
+#define FONT_CACHE_SIZE    512
+
+#ifdef HAVE_THREADS
+#define FONT_CACHE_LOCK(cache)   slock_lock((cache)->lock)
+#define FONT_CACHE_UNLOCK(cache) slock_unlock((cache)->lock)
+#else
+#define FONT_CACHE_LOCK(cache)
+#define FONT_CACHE_UNLOCK(cache)
+#endif
+
+enum font_cache_kind
+{
+   FONT_CACHE_WIDTH = 0,
+   FONT_CACHE_RESHAPE
+};
+
+struct font_cache_entry
+{
+   char *msg;
+   /* Reshaped message for FONT_CACHE_RESHAPE entries */
+   char *reshaped;
+   size_t len;
+   float scale;
+   int width;
+   uint8_t kind;
+};
+
+typedef struct font_cache
+{
+   /* Indexed by the slots of map */
+   struct font_cache_entry entries[FONT_CACHE_SIZE];
+   lru_map_t *map;
+#ifdef HAVE_THREADS
+   /* Widths are measured on the main thread and messages
+    * rendered on the video thread */
+   slock_t *lock;
+#endif
+   uint64_t first_frame;
+   uint64_t hits;
+   uint64_t misses;
+   retro_time_t miss_time;
+} font_cache_t;
+
+static uint32_t font_cache_hash(const char *msg, size_t len,
+      float scale, uint8_t kind)
+{
+   size_t i;
+   uint32_t scale_bits;
+   uint32_t hash = 2166136261u ^ kind;
+
+   memcpy(&scale_bits, &scale, sizeof(scale_bits));
+   hash = (hash ^ scale_bits) * 16777619u;
+   for (i = 0; i < len; i++)
+      hash = (hash ^ (uint8_t)msg[i]) * 16777619u;
+   return hash;
+}
+
+static font_cache_t *font_cache_new(void)
+{
+   font_cache_t *cache = (font_cache_t*)calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+   if (!(cache->map = lru_map_new(FONT_CACHE_SIZE)))
+   {
+      free(cache);
+      return NULL;
+   }
+
+#ifdef HAVE_THREADS
+   if (!(cache->lock = slock_new()))
+   {
+      lru_map_free(cache->map);
+      free(cache);
+      return NULL;
+   }
+#endif
+
+   cache->first_frame = video_state_get_ptr()->frame_count;
+   return cache;
+}
+
+static void font_cache_free(font_cache_t *cache)
+{
+   unsigned i;
+
+   if (cache->hits || cache->misses)
+   {
+      uint64_t frames = video_state_get_ptr()->frame_count
+         - cache->first_frame;
+      /* A hit saves about what an average miss costs */
+      double saved    = cache->misses
+         ? (double)cache->hits * cache->miss_time / cache->misses : 0.0;
+      RARCH_LOG("[Font] Cache: %llu hits, %llu misses (%.1f%%), "
+            "%.1f us saved per frame.\n",
+            (unsigned long long)cache->hits,
+            (unsigned long long)cache->misses,
+            100.0 * cache->hits / (cache->hits + cache->misses),
+            frames ? saved / frames : 0.0);
+   }
+
+   for (i = 0; i < FONT_CACHE_SIZE; i++)
+   {
+      free(cache->entries[i].msg);
+      free(cache->entries[i].reshaped);
+   }
+   lru_map_free(cache->map);
+#ifdef HAVE_THREADS
+   slock_free(cache->lock);
+#endif
+   free(cache);
+}
+
+/* Returns the matching entry, now the most recently used,
+ * or NULL */
+static struct font_cache_entry *font_cache_find(font_cache_t *cache,
+      uint8_t kind, const char *msg, size_t len, float scale,
+      uint32_t hash)
+{
+   struct font_cache_entry *entry;
+   int slot = lru_map_get(cache->map, hash);
+
+   if (slot >= 0)
+   {
+      entry = &cache->entries[slot];
+      if (     entry->kind  == kind
+            && entry->len   == len
+            && entry->scale == scale
+            && !memcmp(entry->msg, msg, len))
+      {
+         cache->hits++;
+         return entry;
+      }
+   }
+
+   cache->misses++;
+   return NULL;
+}
+
+/* Adds an entry, replacing the one in the slot of its
+ * hash or else the least recently used one once the cache
+ * is full. Returns NULL if out of memory. */
+static struct font_cache_entry *font_cache_insert(font_cache_t *cache,
+      uint8_t kind, const char *msg, size_t len, float scale,
+      uint32_t hash)
+{
+   int slot;
+   struct font_cache_entry *entry;
+   char *copy = (char*)malloc(len + 1);
+
+   if (!copy)
+      return NULL;
+   memcpy(copy, msg, len);
+   copy[len] = '\0';
+
+   if ((slot = lru_map_get(cache->map, hash)) < 0)
+      slot = (int)lru_map_put(cache->map, hash, NULL, NULL);
+
+   entry           = &cache->entries[slot];
+   free(entry->msg);
+   free(entry->reshaped);
+   entry->msg      = copy;
+   entry->reshaped = NULL;
+   entry->len      = len;
+   entry->scale    = scale;
+   entry->width    = 0;
+   entry->kind     = kind;
+   return entry;
+}
+
 #ifdef HAVE_LANGEXTRA
 /* ASCII:       0xxxxxxx  (c & 0x80) == 0x00
  * other start: 11xxxxxx  (c & 0xC0) == 0xC0
@@ -760,6 +951,57 @@ static char* font_driver_reshape_msg(const char* msg, unsigned char *buffer, siz
 
    return (char*)dst_buffer;
 }
+
+/* Only right-to-left text comes out of reshaping changed */
+static bool font_driver_msg_has_rtl(const char *msg)
+{
+   const unsigned char *src = (const unsigned char*)msg;
+   for (; *src; src++)
+      if (IS_RTL(src))
+         return true;
+   return false;
+}
+
+/* The reshaped message is copied out of the cache, which
+ * may drop it while the message renders */
+static char *font_driver_reshape_msg_cached(font_cache_t *cache,
+      const char *msg, unsigned char *buffer, size_t buffer_size)
+{
+   retro_time_t start;
+   struct font_cache_entry *entry;
+   char *out   = NULL;
+   size_t _len = strlen(msg);
+   uint32_t hash = font_cache_hash(msg, _len, 0.0f, FONT_CACHE_RESHAPE);
+
+   FONT_CACHE_LOCK(cache);
+   if ((entry = font_cache_find(cache, FONT_CACHE_RESHAPE,
+               msg, _len, 0.0f, hash)))
+   {
+      size_t out_len = strlen(entry->reshaped) + 1;
+      out            = (out_len <= buffer_size)
+         ? (char*)buffer : (char*)malloc(out_len);
+      if (out)
+         memcpy(out, entry->reshaped, out_len);
+   }
+   FONT_CACHE_UNLOCK(cache);
+
+   if (out)
+      return out;
+
+   start = cpu_features_get_time_usec();
+   out   = font_driver_reshape_msg(msg, buffer, buffer_size);
+
+   FONT_CACHE_LOCK(cache);
+   cache->miss_time += cpu_features_get_time_usec() - start;
+   if (     out
+         && !entry
+         && (entry = font_cache_insert(cache, FONT_CACHE_RESHAPE,
+               msg, _len, 0.0f, hash)))
+      entry->reshaped = strdup(out);
+   FONT_CACHE_UNLOCK(cache);
+
+   return out;
+}
 #endif
 
 void font_driver_render_msg(void *data, const char *msg,
@@ -772,14 +1014,19 @@ void font_driver_render_msg(void *data, const char *msg,
    {
 #ifdef HAVE_LANGEXTRA
       unsigned char tmp_buffer[64];
-      char *new_msg = font_driver_reshape_msg(msg, tmp_buffer, sizeof(tmp_buffer));
+      char *new_msg = (char*)msg;
+      if (font_driver_msg_has_rtl(msg))
+         new_msg    = font->cache
+            ? font_driver_reshape_msg_cached(font->cache,
+                  msg, tmp_buffer, sizeof(tmp_buffer))
+            : font_driver_reshape_msg(msg, tmp_buffer, sizeof(tmp_buffer));
 #else
       char *new_msg = (char*)msg;
 #endif
       font->renderer->render_msg(data,
             font->renderer_data, new_msg, params);
 #ifdef HAVE_LANGEXTRA
-      if (new_msg != (char*)tmp_buffer)
+      if (new_msg != msg && new_msg != (char*)tmp_buffer)
          free(new_msg);
 #endif
    }
@@ -809,12 +1056,41 @@ void font_flush(
 int font_driver_get_message_width(void *font_data,
       const char *msg, size_t len, float scale)
 {
+   int width;
+   uint32_t hash;
+   retro_time_t start;
+   font_cache_t *cache;
+   struct font_cache_entry *entry;
    font_data_t *font = (font_data_t*)(font_data ? font_data : video_font_driver);
    if (len == 0 && msg)
       len = strlen(msg);
-   if (font && font->renderer && font->renderer->get_message_width)
+   if (!font || !font->renderer || !font->renderer->get_message_width)
+      return -1;
+   if (!(cache = font->cache) || !msg)
       return font->renderer->get_message_width(font->renderer_data, msg, len, scale);
-   return -1;
+
+   hash = font_cache_hash(msg, len, scale, FONT_CACHE_WIDTH);
+   FONT_CACHE_LOCK(cache);
+   if ((entry = font_cache_find(cache, FONT_CACHE_WIDTH,
+               msg, len, scale, hash)))
+   {
+      width = entry->width;
+      FONT_CACHE_UNLOCK(cache);
+      return width;
+   }
+   FONT_CACHE_UNLOCK(cache);
+
+   start = cpu_features_get_time_usec();
+   width = font->renderer->get_message_width(font->renderer_data, msg, len, scale);
+
+   FONT_CACHE_LOCK(cache);
+   cache->miss_time += cpu_features_get_time_usec() - start;
+   if ((entry = font_cache_insert(cache, FONT_CACHE_WIDTH,
+               msg, len, scale, hash)))
+      entry->width = width;
+   FONT_CACHE_UNLOCK(cache);
+
+   return width;
 }
 
 int font_driver_get_line_height(font_data_t *font, float scale)
@@ -883,9 +1159,12 @@ void font_driver_free(font_data_t *font)
 
       if (font->renderer && font->renderer->free)
          font->renderer->free(font->renderer_data, is_threaded);
+      if (font->cache)
+         font_cache_free(font->cache);
 
       font->renderer      = NULL;
       font->renderer_data = NULL;
+      font->cache         = NULL;
 
       free(font);
    }
@@ -919,6 +1198,7 @@ font_data_t *font_driver_init_first(
       {
          font->renderer      = (const font_renderer_t*)font_driver;
          font->renderer_data = font_handle;
+         font->cache         = font_cache_new();
          font->size          = font_size;
          return font;
       }
@@ -71,6 +71,8 @@ typedef struct
 {
    const font_renderer_t *renderer;
    void *renderer_data;
+   /* Message widths and reshaped messages */
+   struct font_cache *cache;
    float size;
 } font_data_t;
 
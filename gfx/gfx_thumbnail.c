@@ -148,6 +148,9 @@ static void gfx_thumbnail_handle_upload(
    gfx_thumbnail_tag_t *thumbnail_tag = (gfx_thumbnail_tag_t*)user_data;
    bool fade_enabled                  = false;
 
+   if (p_gfx_thumb->pending_loads > 0)
+      p_gfx_thumb->pending_loads--;
+
    /* Sanity check */
    if (!thumbnail_tag)
       goto end;
@@ -228,6 +231,13 @@ void gfx_thumbnail_cancel_pending_requests(void)
    p_gfx_thumb->list_id++;
 }
 
+/* Returns true while any requested image load has
+ * not yet completed */
+bool gfx_thumbnail_is_loading(void)
+{
+   return gfx_thumb_st.pending_loads > 0;
+}
+
 /* Fetches the current thumbnail file path of the
  * specified thumbnail 'type'.
  * Returns true if path is valid. */
@@ -327,7 +337,10 @@ void gfx_thumbnail_request(
                         thumbnail_path, video_driver_supports_rgba(),
                         gfx_thumbnail_upscale_threshold,
                         gfx_thumbnail_handle_upload, thumbnail_tag))
+               {
                   thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+                  p_gfx_thumb->pending_loads++;
+               }
             }
 #ifdef HAVE_NETWORKING
             /* Handle on demand thumbnail downloads */
@@ -432,7 +445,10 @@ void gfx_thumbnail_request_file(
          file_path, video_driver_supports_rgba(),
          gfx_thumbnail_upscale_threshold,
          gfx_thumbnail_handle_upload, thumbnail_tag))
+   {
       thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+      p_gfx_thumb->pending_loads++;
+   }
 }
 
 /* Resets (and free()s the current texture of) the
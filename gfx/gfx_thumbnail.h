@@ -124,6 +124,10 @@ struct gfx_thumbnail_state
    /* Duration in ms of the thumbnail 'fade in' animation */
    float fade_duration;
 
+   /* Number of image loads that have not yet
+    * completed */
+   unsigned pending_loads;
+
    /* When true, 'fade in' animation will also be
     * triggered for missing thumbnails */
    bool fade_missing;
@@ -161,6 +165,10 @@ void gfx_thumbnail_set_fade_missing(bool fade_missing);
  *    heap-use-after-free errors *will* occur */
 void gfx_thumbnail_cancel_pending_requests(void);
 
+/* Returns true while any requested image load has
+ * not yet completed */
+bool gfx_thumbnail_is_loading(void);
+
 /* Requests loading of the specified thumbnail
  * - If operation fails, 'thumbnail->status' will be set to
  *   MUI_THUMBNAIL_STATUS_MISSING
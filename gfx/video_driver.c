@@ -62,7 +62,11 @@
 #include "../driver.h"
 #include "../file_path_special.h"
 #include "../list_special.h"
+#include "../performance_counters.h"
 #include "../retroarch.h"
+#ifdef HAVE_SHM_EXPORT
+#include "../shm_export.h"
+#endif
 #include "../verbosity.h"
 
 #define TIME_TO_FPS(last_time, new_time, frames) ((1000000.0f * (frames)) / ((new_time) - (last_time)))
@@ -2797,6 +2801,7 @@ void video_driver_cached_frame(void)
 
    /* Cannot allow recording when pushing duped frames. */
    recording_st->data             = NULL;
+   video_st->flags               |= VIDEO_FLAG_CACHED_FRAME;
 
    if (runloop_st->current_core.flags & RETRO_CORE_FLAG_INITED)
       cbs->frame_cb(
@@ -2807,6 +2812,7 @@ void video_driver_cached_frame(void)
             video_st->frame_cache_height,
             video_st->frame_cache_pitch);
 
+   video_st->flags               &= ~VIDEO_FLAG_CACHED_FRAME;
    recording_st->data             = recording;
 }
 
@@ -3703,6 +3709,7 @@ void video_driver_frame(const void *data, unsigned width,
    static bool last_frame_duped   = true;
    bool render_frame              = true;
    retro_time_t new_time;
+   retro_time_t trace_start;
    video_frame_info_t video_info;
    size_t _len                    = 0;
    video_driver_state_t *video_st = &video_driver_st;
@@ -3724,6 +3731,7 @@ void video_driver_frame(const void *data, unsigned width,
    if (!video_driver_active)
       return;
 
+   trace_start                   = rarch_trace_begin();
    new_time                      = cpu_features_get_time_usec();
    runloop_st->core_run_time     = new_time - runloop_st->core_run_time;
 
@@ -3737,6 +3745,14 @@ void video_driver_frame(const void *data, unsigned width,
    video_st->frame_cache_height  = height;
    video_st->frame_cache_pitch   = pitch;
 
+#ifdef HAVE_SHM_EXPORT
+   /* Dupes (data == NULL) publish audio and memory only */
+   if (!(video_st->flags & VIDEO_FLAG_CACHED_FRAME))
+      shm_export_push_video(data,
+            width, height, pitch, video_driver_pix_fmt,
+            video_st->frame_count);
+#endif
+
    if (
             video_st->scaler_ptr
          && data
@@ -4279,6 +4295,7 @@ void video_driver_frame(const void *data, unsigned width,
          && video_st->current_video
          && video_st->current_video->frame)
    {
+      retro_time_t upload_start   = rarch_trace_begin();
       video_info.current_subframe = 0;
       if (video_st->current_video->frame(
                video_st->data, data, width, height,
@@ -4295,6 +4312,7 @@ void video_driver_frame(const void *data, unsigned width,
          video_st->flags |=  VIDEO_FLAG_ACTIVE;
       else
          video_st->flags &= ~VIDEO_FLAG_ACTIVE;
+      rarch_trace_end("video_upload", upload_start);
    }
 
    video_st->frame_count++;
@@ -4369,6 +4387,8 @@ void video_driver_frame(const void *data, unsigned width,
    else if (!video_info.crt_switch_resolution)
 #endif
       video_st->flags          &= ~VIDEO_FLAG_CRT_SWITCHING_ACTIVE;
+
+   rarch_trace_end("video_frame", trace_start);
 }
 
 static void video_driver_reinit_context(settings_t *settings, int flags)
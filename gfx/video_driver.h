@@ -166,7 +166,10 @@ enum video_driver_state_flags
    VIDEO_FLAG_IS_SWITCHING_DISPLAY_MODE           = (1 << 14),
    VIDEO_FLAG_SHADER_PRESETS_NEED_RELOAD          = (1 << 15),
    VIDEO_FLAG_CLI_SHADER_DISABLE                  = (1 << 16),
-   VIDEO_FLAG_RUNAHEAD_IS_ACTIVE                  = (1 << 17)
+   VIDEO_FLAG_RUNAHEAD_IS_ACTIVE                  = (1 << 17),
+   /* The frame being output is a repeat of the cached
+    * frame, not new output from the core */
+   VIDEO_FLAG_CACHED_FRAME                        = (1 << 18)
 };
 
 struct LinkInfo
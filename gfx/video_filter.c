@@ -14,6 +14,7 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <compat/strl.h>
@@ -29,6 +30,11 @@
 #include "../config.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
+
 #include "../frontend/frontend_driver.h"
 #include "../dynamic.h"
 #include "../performance_counters.h"
@@ -44,64 +50,131 @@ struct rarch_soft_plug
    const struct softfilter_implementation *impl;
 };
 
-struct rarch_softfilter
+/* Softfilters are asked to split each frame into this many
+ * bands per worker thread. Workers claim bands one at a time,
+ * so a thread which drew cheap bands picks up more of them
+ * instead of idling until the slowest band is done. */
+#define SOFTFILTER_BANDS_PER_THREAD 4
+/* ...but never make bands thinner than this many rows. */
+#define SOFTFILTER_MIN_BAND_HEIGHT  8
+
+/* One stage of a softfilter chain. Every pass but the
+ * last one renders into its own intermediate buffer,
+ * which is allocated once for the maximum input size
+ * and then fed to the next pass. */
+struct rarch_softfilter_pass
 {
-   config_file_t *conf;
-
    const struct softfilter_implementation *impl;
    void *impl_data;
 
+   struct softfilter_work_packet *packets;
+   unsigned bands;
+
+   void *buffer;
+   size_t buffer_stride;
+   unsigned out_width, out_height;
+
+   /* Set if this pass reads rows written by other bands
+    * of the previous pass, so it cannot start before every
+    * band of that pass is finished. Otherwise each band
+    * goes on to this pass right after the previous one. */
+   bool sync;
+#ifdef HAVE_THREADS
+   /* Bands of the run of passes starting here which have
+    * been claimed and finished in the current frame */
+   unsigned claimed, finished;
+#endif
+};
+
+struct rarch_softfilter
+{
+   config_file_t *conf;
+
    struct rarch_soft_plug *plugs;
    unsigned num_plugs;
 
+   struct rarch_softfilter_pass *passes;
+   unsigned num_passes;
+
    unsigned max_width, max_height;
    enum retro_pixel_format pix_fmt, out_pix_fmt;
 
-   struct softfilter_work_packet *packets;
    unsigned threads;
 
 #ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
+   tpool_t *pool;
+   slock_t *lock;
+   scond_t *cond;
 #endif
-};
 
-#ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
+   /* Per-frame processing time, in microseconds */
+   retro_time_t frame_time_total;
+   retro_time_t frame_time_max;
+   unsigned frame_count;
+};
 
-struct filter_thread_data
+static void softfilter_pass_work(void *data, unsigned index)
 {
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
-   void *userdata;
-   bool die;
-   bool done;
-};
+   const struct rarch_softfilter_pass *pass =
+      (const struct rarch_softfilter_pass*)data;
+
+   if (pass->packets[index].work)
+      pass->packets[index].work(pass->impl_data,
+            pass->packets[index].thread_data);
+}
 
-static void filter_thread_loop(void *data)
+#ifdef HAVE_THREADS
+/* Runs the whole chain for one frame. Jobs claim bands of
+ * a run of passes without sync points between them, and
+ * carry each band through all of these passes while its
+ * rows are still in cache. Only a pass which needs rows
+ * of other bands makes every job wait. Bands still running
+ * were claimed by other jobs, which are busy finishing
+ * them, so waiting never depends on a job yet to start. */
+static void softfilter_chain_work(void *data, unsigned job)
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   rarch_softfilter_t *filt = (rarch_softfilter_t*)data;
+   unsigned first           = 0;
 
-   for (;;)
+   while (first < filt->num_passes)
    {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
-         break;
+      unsigned i, band;
+      struct rarch_softfilter_pass *head = &filt->passes[first];
+      unsigned last                      = first + 1;
+
+      while (last < filt->num_passes && !filt->passes[last].sync)
+         last++;
+
+      for (;;)
+      {
+         slock_lock(filt->lock);
+         band = head->claimed;
+         if (band < head->bands)
+            head->claimed++;
+         slock_unlock(filt->lock);
+
+         if (band >= head->bands)
+            break;
+
+         for (i = first; i < last; i++)
+            softfilter_pass_work(&filt->passes[i], band);
+
+         slock_lock(filt->lock);
+         if (++head->finished == head->bands)
+            scond_broadcast(filt->cond);
+         slock_unlock(filt->lock);
+      }
 
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
+      /* The end of the frame is waited for by the caller */
+      if (last < filt->num_passes)
+      {
+         slock_lock(filt->lock);
+         while (head->finished < head->bands)
+            scond_wait(filt->cond, filt->lock);
+         slock_unlock(filt->lock);
+      }
 
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
+      first = last;
    }
 }
 #endif
@@ -130,56 +203,60 @@ static const struct softfilter_config softfilter_config = {
    config_userdata_free,
 };
 
-static bool create_softfilter_graph(rarch_softfilter_t *filt,
+static bool softfilter_pixel_format_to_fmt(enum retro_pixel_format fmt,
+      unsigned *softfilter_fmt)
+{
+   switch (fmt)
+   {
+      case RETRO_PIXEL_FORMAT_XRGB8888:
+         *softfilter_fmt = SOFTFILTER_FMT_XRGB8888;
+         return true;
+      case RETRO_PIXEL_FORMAT_RGB565:
+         *softfilter_fmt = SOFTFILTER_FMT_RGB565;
+         return true;
+      default:
+         break;
+   }
+
+   return false;
+}
+
+static bool create_softfilter_pass(rarch_softfilter_t *filt,
+      struct rarch_softfilter_pass *pass, const char *key,
       enum retro_pixel_format in_pixel_format,
+      enum retro_pixel_format *out_pixel_format,
       unsigned max_width, unsigned max_height,
       softfilter_simd_mask_t cpu_features,
-      unsigned threads)
+      unsigned bands)
 {
    unsigned input_fmts, input_fmt, output_fmts;
+   unsigned output_fmt = SOFTFILTER_FMT_NONE;
    struct config_file_userdata userdata;
-   char key[64], name[64];
+   char name[64];
    name[0] = '\0';
-   strlcpy(key, "filter", sizeof(key));
 
    if (!config_get_array(filt->conf, key, name, sizeof(name)))
    {
-      RARCH_ERR("[SoftFilter] Could not find \"filter\" array in config.\n");
-      return false;
-   }
-
-   if (filt->num_plugs == 0)
-   {
-      RARCH_ERR("[SoftFilter] No filter plugs found. Exiting...\n");
+      RARCH_ERR("[SoftFilter] Could not find \"%s\" array in config.\n", key);
       return false;
    }
 
-   if (!(filt->impl = softfilter_find_implementation(filt, name)))
+   if (!(pass->impl = softfilter_find_implementation(filt, name)))
    {
-      RARCH_ERR("[SoftFilter] Could not find implementation.\n");
+      RARCH_ERR("[SoftFilter] Could not find implementation \"%s\".\n", name);
       return false;
    }
 
    userdata.conf      = filt->conf;
    /* Index-specific configs take priority over ident-specific. */
    userdata.prefix[0] = key;
-   userdata.prefix[1] = filt->impl->short_ident;
+   userdata.prefix[1] = pass->impl->short_ident;
 
    /* Simple assumptions. */
-   filt->pix_fmt      = in_pixel_format;
-   input_fmts         = filt->impl->query_input_formats();
+   input_fmts         = pass->impl->query_input_formats();
 
-   switch (in_pixel_format)
-   {
-      case RETRO_PIXEL_FORMAT_XRGB8888:
-         input_fmt = SOFTFILTER_FMT_XRGB8888;
-         break;
-      case RETRO_PIXEL_FORMAT_RGB565:
-         input_fmt = SOFTFILTER_FMT_RGB565;
-         break;
-      default:
-         return false;
-   }
+   if (!softfilter_pixel_format_to_fmt(in_pixel_format, &input_fmt))
+      return false;
 
    if (!(input_fmt & input_fmts))
    {
@@ -187,79 +264,177 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       return false;
    }
 
-   output_fmts = filt->impl->query_output_formats(input_fmt);
+   output_fmts = pass->impl->query_output_formats(input_fmt);
    /* If we have a match of input/output formats, use that. */
    if (output_fmts & input_fmt)
-      filt->out_pix_fmt = in_pixel_format;
+      *out_pixel_format = in_pixel_format;
    else if (output_fmts & SOFTFILTER_FMT_XRGB8888)
-      filt->out_pix_fmt = RETRO_PIXEL_FORMAT_XRGB8888;
+      *out_pixel_format = RETRO_PIXEL_FORMAT_XRGB8888;
    else if (output_fmts & SOFTFILTER_FMT_RGB565)
-      filt->out_pix_fmt = RETRO_PIXEL_FORMAT_RGB565;
+      *out_pixel_format = RETRO_PIXEL_FORMAT_RGB565;
    else
    {
       RARCH_ERR("[SoftFilter] Did not find suitable output format.\n");
       return false;
    }
 
-   filt->max_width = max_width;
-   filt->max_height = max_height;
+   softfilter_pixel_format_to_fmt(*out_pixel_format, &output_fmt);
 
-   filt->impl_data = filt->impl->create(
-         &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads :
-         cpu_features_get_core_amount(), cpu_features,
-         &userdata);
-   if (!filt->impl_data)
+   pass->impl_data = pass->impl->create(
+         &softfilter_config, input_fmt, output_fmt, max_width, max_height,
+         bands, cpu_features, &userdata);
+   if (!pass->impl_data)
    {
       RARCH_ERR("[SoftFilter] Failed to create softfilter state.\n");
       return false;
    }
 
-   threads = filt->impl->query_num_threads(filt->impl_data);
-   if (!threads)
+   /* Filters that cannot be split return fewer bands */
+   pass->bands = pass->impl->query_num_threads(pass->impl_data);
+   if (!pass->bands)
    {
       RARCH_ERR("[SoftFilter] Invalid number of threads.\n");
       return false;
    }
 
-   filt->threads = threads;
-   RARCH_LOG("[SoftFilter] Using %u threads for softfilter.\n", threads);
-
-   filt->packets = (struct softfilter_work_packet*)
-      calloc(threads, sizeof(*filt->packets));
-   if (!filt->packets)
+   pass->packets = (struct softfilter_work_packet*)
+      calloc(pass->bands, sizeof(*pass->packets));
+   if (!pass->packets)
    {
       RARCH_ERR("[SoftFilter] Failed to allocate softfilter packets.\n");
       return false;
    }
 
+   return true;
+}
+
+/* A .filt file either names a single filter:
+ *
+ *    filter = scanline2x
+ *
+ * or a chain which is applied in order:
+ *
+ *    filters = 2
+ *    filter0 = blargg_ntsc_snes
+ *    filter1 = scanline2x
+ */
+static bool create_softfilter_graph(rarch_softfilter_t *filt,
+      enum retro_pixel_format in_pixel_format,
+      unsigned max_width, unsigned max_height,
+      softfilter_simd_mask_t cpu_features,
+      unsigned threads)
+{
+   unsigned i;
+   unsigned num_passes            = 0;
+   bool chained                   = config_get_uint(
+         filt->conf, "filters", &num_passes);
+   enum retro_pixel_format pix_fmt = in_pixel_format;
+   unsigned width                 = max_width;
+   unsigned height                = max_height;
+
+   if (!chained)
+      num_passes = 1;
+   else if (num_passes == 0)
+   {
+      RARCH_ERR("[SoftFilter] \"filters\" must be at least 1.\n");
+      return false;
+   }
+
+   if (filt->num_plugs == 0)
+   {
+      RARCH_ERR("[SoftFilter] No filter plugs found. Exiting...\n");
+      return false;
+   }
+
+   if (!(filt->passes = (struct rarch_softfilter_pass*)
+         calloc(num_passes, sizeof(*filt->passes))))
+      return false;
+
+   filt->num_passes = num_passes;
+   filt->pix_fmt    = in_pixel_format;
+   filt->max_width  = max_width;
+   filt->max_height = max_height;
+   filt->threads    = 1;
+
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   filt->threads    = (threads != RARCH_SOFTFILTER_THREADS_AUTO)
+      ? threads : cpu_features_get_core_amount();
+   if (filt->threads < 1)
+      filt->threads = 1;
+#endif
+
+   for (i = 0; i < num_passes; i++)
    {
-      unsigned i;
-      if (!(filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data))))
-         return false;
+      char key[64];
+      struct rarch_softfilter_pass *pass = &filt->passes[i];
+      enum retro_pixel_format out_fmt    = pix_fmt;
+      unsigned bands                     = 1;
 
-      for (i = 0; i < threads; i++)
+      if (filt->threads > 1)
       {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done     = true;
+         bands = MIN(filt->threads * SOFTFILTER_BANDS_PER_THREAD,
+               height / SOFTFILTER_MIN_BAND_HEIGHT);
+         bands = MAX(bands, filt->threads);
+      }
 
-         filt->thread_data[i].lock     = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond     = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread   = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
+      if (chained)
+         snprintf(key, sizeof(key), "filter%u", i);
+      else
+         strlcpy(key, "filter", sizeof(key));
+
+      if (!create_softfilter_pass(filt, pass, key, pix_fmt, &out_fmt,
+               width, height, cpu_features, bands))
+         return false;
+
+      pass->impl->query_output_size(pass->impl_data,
+            &pass->out_width, &pass->out_height, width, height);
+
+      /* Intermediate buffers are sized for the largest
+       * possible input, so they never need to grow. */
+      if (i + 1 < num_passes)
+      {
+         size_t bpp = (out_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+            ? SOFTFILTER_BPP_XRGB8888 : SOFTFILTER_BPP_RGB565;
+
+         pass->buffer_stride = pass->out_width * bpp;
+         if (!(pass->buffer  = malloc(
+                     pass->buffer_stride * pass->out_height)))
+         {
+            RARCH_ERR("[SoftFilter] Failed to allocate intermediate buffer.\n");
             return false;
+         }
       }
+
+      pix_fmt = out_fmt;
+      width   = pass->out_width;
+      height  = pass->out_height;
+
+      /* The softfilter API does not tell which input rows a
+       * band reads, so a band can only be carried into the
+       * next pass when neither pass is split into bands. */
+      if (i > 0)
+         pass->sync = filt->passes[i - 1].bands > 1 || pass->bands > 1;
+
+      RARCH_LOG("[SoftFilter] Pass #%u: %s (%u bands).\n",
+            i, pass->impl->ident, pass->bands);
+   }
+
+   filt->out_pix_fmt = pix_fmt;
+
+#ifdef HAVE_THREADS
+   if (filt->threads > 1)
+   {
+      /* The thread calling rarch_softfilter_process()
+       * works on the bands as well. */
+      if (     !(filt->pool = tpool_create(filt->threads - 1))
+            || !(filt->lock = slock_new())
+            || !(filt->cond = scond_new()))
+         return false;
    }
 #endif
 
+   RARCH_LOG("[SoftFilter] Using %u threads for softfilter.\n", filt->threads);
+
    return true;
 }
 
@@ -483,9 +658,34 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    if (!filt)
       return;
 
-   free(filt->packets);
-   if (filt->impl && filt->impl_data)
-      filt->impl->destroy(filt->impl_data);
+   if (filt->frame_count)
+      RARCH_LOG("[SoftFilter] %u frames, %.3f ms average, %.3f ms worst.\n",
+            filt->frame_count,
+            (filt->frame_time_total / filt->frame_count) / 1000.0,
+            filt->frame_time_max / 1000.0);
+
+#ifdef HAVE_THREADS
+   /* Workers must be gone before the passes they run are */
+   if (filt->pool)
+      tpool_destroy(filt->pool);
+   if (filt->lock)
+      slock_free(filt->lock);
+   if (filt->cond)
+      scond_free(filt->cond);
+#endif
+
+   if (filt->passes)
+   {
+      for (i = 0; i < filt->num_passes; i++)
+      {
+         struct rarch_softfilter_pass *pass = &filt->passes[i];
+         free(pass->packets);
+         free(pass->buffer);
+         if (pass->impl && pass->impl_data)
+            pass->impl->destroy(pass->impl_data);
+      }
+      free(filt->passes);
+   }
 
 #ifdef HAVE_DYLIB
    for (i = 0; i < filt->num_plugs; i++)
@@ -496,25 +696,6 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    free(filt->plugs);
 #endif
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
-#endif
-
    if (filt->conf)
       config_file_free(filt->conf);
 
@@ -532,9 +713,21 @@ void rarch_softfilter_get_output_size(rarch_softfilter_t *filt,
       unsigned *out_width, unsigned *out_height,
       unsigned width, unsigned height)
 {
-   if (filt && filt->impl && filt->impl->query_output_size)
-      filt->impl->query_output_size(filt->impl_data, out_width,
-            out_height, width, height);
+   unsigned i;
+
+   if (!filt || !filt->passes)
+      return;
+
+   for (i = 0; i < filt->num_passes; i++)
+   {
+      const struct rarch_softfilter_pass *pass = &filt->passes[i];
+      if (pass->impl && pass->impl->query_output_size)
+         pass->impl->query_output_size(pass->impl_data,
+               &width, &height, width, height);
+   }
+
+   *out_width  = width;
+   *out_height = height;
 }
 
 enum retro_pixel_format rarch_softfilter_get_output_format(
@@ -548,40 +741,57 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       const void *input, unsigned width, unsigned height,
       size_t input_stride)
 {
-   unsigned i;
+   unsigned i, j;
+   retro_time_t frame_time;
 
    if (!filt)
       return;
 
-   if (filt->impl && filt->impl->get_work_packets)
-      filt->impl->get_work_packets(filt->impl_data, filt->packets,
-            output, output_stride, input, width, height, input_stride);
+   frame_time = cpu_features_get_time_usec();
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   /* Buffers between passes never move, so the work of
+    * every pass can be handed out before any of it runs */
+   for (i = 0; i < filt->num_passes; i++)
    {
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
+      struct rarch_softfilter_pass *pass = &filt->passes[i];
+      bool last_pass                     = (i + 1 == filt->num_passes);
+      void *pass_output                  = last_pass
+         ? output        : pass->buffer;
+      size_t pass_output_stride          = last_pass
+         ? output_stride : pass->buffer_stride;
+
+      if (pass->impl->get_work_packets)
+         pass->impl->get_work_packets(pass->impl_data, pass->packets,
+               pass_output, pass_output_stride,
+               input, width, height, input_stride);
 
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-      return;
+#ifdef HAVE_THREADS
+      pass->claimed  = 0;
+      pass->finished = 0;
+#endif
+
+      pass->impl->query_output_size(pass->impl_data,
+            &width, &height, width, height);
+      input        = pass_output;
+      input_stride = pass_output_stride;
    }
+
+#ifdef HAVE_THREADS
+   /* One job per thread; the frame is joined once */
+   if (filt->pool)
+      tpool_run_batch(filt->pool, softfilter_chain_work,
+            filt, filt->threads);
+   else
 #endif
+   {
+      for (i = 0; i < filt->num_passes; i++)
+         for (j = 0; j < filt->passes[i].bands; j++)
+            softfilter_pass_work(&filt->passes[i], j);
+   }
 
-   for (i = 0; i < filt->threads; i++)
-      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
+   frame_time = cpu_features_get_time_usec() - frame_time;
+   filt->frame_time_total += frame_time;
+   if (frame_time > filt->frame_time_max)
+      filt->frame_time_max = frame_time;
+   filt->frame_count++;
 }
@@ -177,6 +177,7 @@ CONTENT METADATA RECORDS
 ============================================================ */
 #include "../runtime_file.c"
 #include "../disk_index_file.c"
+#include "../crc_cache.c"
 
 /*============================================================
 ACHIEVEMENTS
@@ -420,6 +421,7 @@ VIDEO IMAGE
 #endif
 
 #include "../libretro-common/formats/bmp/rbmp_encode.c"
+#include "../libretro-common/formats/qoi/rqoi_encode.c"
 #ifdef HAVE_RWAV
 #include "../libretro-common/formats/wav/rwav.c"
 #endif
@@ -619,6 +621,7 @@ INPUT
 #ifdef HAVE_OVERLAY
 #include "../led/drivers/led_overlay.c"
 #include "../tasks/task_overlay.c"
+#include "../libretro-common/lists/box_grid.c"
 #endif
 
 #ifdef HAVE_X11
@@ -1058,6 +1061,7 @@ FILE
 #include "../libretro-common/lists/string_list.c"
 #include "../libretro-common/lists/nested_list.c"
 #include "../libretro-common/lists/file_list.c"
+#include "../libretro-common/lists/lru_map.c"
 #include "../libretro-common/file/retro_dirent.c"
 #include "../libretro-common/streams/file_stream.c"
 #include "../libretro-common/streams/file_stream_transforms.c"
@@ -1183,9 +1187,16 @@ RETROARCH
 ============================================================ */
 #include "../retroarch.c"
 #include "../runloop.c"
+#include "../performance_counters.c"
 #ifdef HAVE_RUNAHEAD
 #include "../runahead.c"
 #endif
+#ifdef HAVE_ENV_HOST
+#include "../env_host.c"
+#endif
+#ifdef HAVE_SHM_EXPORT
+#include "../shm_export.c"
+#endif
 #include "../command.c"
 #include "../ui/ui_companion_driver.c"
 #include "../libretro-common/queues/task_queue.c"
@@ -1237,6 +1248,7 @@ THREAD
 #endif
 
 #include "../libretro-common/rthreads/rthreads.c"
+#include "../libretro-common/rthreads/tpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
 #endif
@@ -1682,7 +1694,6 @@ FFMPEG
 #ifdef HAVE_FFMPEG
 #include "../cores/libretro-ffmpeg/packet_buffer.c"
 #include "../cores/libretro-ffmpeg/video_buffer.c"
-#include "../libretro-common/rthreads/tpool.c"
 #endif
 
 /*============================================================
@@ -1702,6 +1713,7 @@ CLOUD SYNC
 ============================================================ */
 #ifdef HAVE_CLOUDSYNC
 #include "../tasks/task_cloudsync.c"
+#include "../libretro-common/file/file_hash_cache.c"
 #include "../network/cloud_sync_driver.c"
 #include "../network/cloud_sync/webdav.c"
 #endif
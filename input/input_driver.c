@@ -59,6 +59,10 @@
 #include "../performance_counters.h"
 #include "../retroarch.h"
 #ifdef HAVE_BSV_MOVIE
+#include <encodings/crc32.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include "../tasks/task_content.h"
 #endif
 #if defined(HAVE_ZLIB) && defined(HAVE_BSV_MOVIE)
@@ -2083,6 +2087,88 @@ static int16_t input_state_internal(
    return result;
 }
 
+/* Answers core queries from the port's snapshot. The
+ * RetroPad buttons are resolved together as one mask, the
+ * analog axes, analog buttons and first pointer one by
+ * one; anything else is resolved on every query. */
+static int16_t input_state_snapshot_get(
+      input_driver_state_t *input_st,
+      settings_t *settings,
+      unsigned port, unsigned device,
+      unsigned idx, unsigned id)
+{
+   input_state_snapshot_t *snap = NULL;
+   unsigned slot                = 0;
+
+   if (port >= MAX_USERS)
+      return input_state_internal(input_st, settings,
+            port, device, idx, id);
+
+   snap = &input_st->snapshot[port];
+
+   if (snap->serial != input_st->poll_serial)
+   {
+      snap->serial        = input_st->poll_serial;
+      snap->analog_valid  = 0;
+      snap->pointer_valid = 0;
+      snap->buttons_valid = false;
+   }
+
+   switch (device & RETRO_DEVICE_MASK)
+   {
+      case RETRO_DEVICE_JOYPAD:
+         if (idx != 0)
+            break;
+         if (     id >= RARCH_FIRST_CUSTOM_BIND
+               && id != RETRO_DEVICE_ID_JOYPAD_MASK)
+            break;
+         if (!snap->buttons_valid)
+         {
+            snap->buttons       = input_state_internal(input_st,
+                  settings, port, RETRO_DEVICE_JOYPAD, 0,
+                  RETRO_DEVICE_ID_JOYPAD_MASK);
+            snap->buttons_valid = true;
+         }
+         if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+            return snap->buttons;
+         return (snap->buttons >> id) & 1;
+
+      case RETRO_DEVICE_ANALOG:
+         if (     idx <= RETRO_DEVICE_INDEX_ANALOG_RIGHT
+               && id  <= RETRO_DEVICE_ID_ANALOG_Y)
+            slot = idx * 2 + id;
+         else if (idx == RETRO_DEVICE_INDEX_ANALOG_BUTTON
+               && id  <  RARCH_FIRST_CUSTOM_BIND)
+            slot = 4 + id;
+         else
+            break;
+         if (!(snap->analog_valid & (1 << slot)))
+         {
+            snap->analog[slot]  = input_state_internal(input_st,
+                  settings, port, device, idx, id);
+            snap->analog_valid |= (1 << slot);
+         }
+         return snap->analog[slot];
+
+      case RETRO_DEVICE_POINTER:
+         if (idx != 0 || id > RETRO_DEVICE_ID_POINTER_COUNT)
+            break;
+         if (!(snap->pointer_valid & (1 << id)))
+         {
+            snap->pointer[id]    = input_state_internal(input_st,
+                  settings, port, device, idx, id);
+            snap->pointer_valid |= (1 << id);
+         }
+         return snap->pointer[id];
+
+      default:
+         break;
+   }
+
+   return input_state_internal(input_st, settings,
+         port, device, idx, id);
+}
+
 
 #ifdef HAVE_OVERLAY
 /**
@@ -2485,7 +2571,9 @@ static bool input_overlay_poll(
       int touch_idx, int old_touch_idx,
       int16_t norm_x, int16_t norm_y, float touch_scale)
 {
-   size_t i, j;
+   size_t i, j, k;
+   size_t num_candidates;
+   const unsigned *candidates = NULL;
    struct overlay_desc *descs = ol->active->descs;
    unsigned int highest_prio  = 0;
    bool any_hitbox_pressed    = false;
@@ -2504,12 +2592,23 @@ static bool input_overlay_poll(
    x *= touch_scale;
    y *= touch_scale;
 
-   for (i = 0; i < ol->active->size; i++)
+   /* Only descs whose hitbox bounds contain the point,
+    * in desc order so that priorities resolve as before */
+   if (ol->active->hit_grid)
+      candidates = box_grid_query(ol->active->hit_grid,
+            x, y, &num_candidates);
+   else
+      num_candidates = ol->active->size;
+
+   for (k = 0; k < num_candidates; k++)
    {
       float x_dist, y_dist;
       unsigned int base         = 0;
       unsigned int desc_prio    = 0;
-      struct overlay_desc *desc = &descs[i];
+      struct overlay_desc *desc;
+
+      i    = candidates ? candidates[k] : k;
+      desc = &descs[i];
 
       /* Use range_mod if this touch pointer contributed
        * to desc's touch_mask in the previous poll */
@@ -2533,8 +2632,9 @@ static bool input_overlay_poll(
       {
          highest_prio = desc_prio;
          memset(out, 0, sizeof(*out));
-         for (j = 0; j < i; j++)
-            BIT32_CLEAR(descs[j].touch_mask, touch_idx);
+         for (j = 0; j < k; j++)
+            BIT32_CLEAR(descs[candidates ? candidates[j] : j].touch_mask,
+                  touch_idx);
       }
 
       BIT32_SET(desc->touch_mask, touch_idx);
@@ -2664,6 +2764,54 @@ static void input_overlay_desc_init_hitbox(struct overlay_desc *desc)
    desc->range_y_mod    = desc->range_y_hitbox * desc->range_mod;
 }
 
+/**
+ * input_overlay_build_hit_grid:
+ * @ol                    : Overlay handle.
+ *
+ * (Re)builds the spatial index of the overlay's hitboxes
+ * used by input_overlay_poll(). Each desc's box covers
+ * both its normal and its range_mod hitbox. Without an
+ * index every desc is tested.
+ **/
+static void input_overlay_build_hit_grid(struct overlay *ol)
+{
+   size_t i;
+   box_grid_box_t *boxes = NULL;
+
+   box_grid_free(ol->hit_grid);
+   ol->hit_grid = NULL;
+
+   if (!ol->size || !(boxes = (box_grid_box_t*)
+            malloc(ol->size * sizeof(*boxes))))
+      return;
+
+   for (i = 0; i < ol->size; i++)
+   {
+      const struct overlay_desc *desc = &ol->descs[i];
+      /* Padded so that rounding in the hitbox tests
+       * can't reach past the box */
+      float range_x = MAX(desc->range_x_hitbox, desc->range_x_mod) + 0.0001f;
+      float range_y = MAX(desc->range_y_hitbox, desc->range_y_mod) + 0.0001f;
+
+      if (desc->hitbox == OVERLAY_HITBOX_NONE)
+      {
+         boxes[i].x_min = 1.0f;
+         boxes[i].x_max = 0.0f;
+         boxes[i].y_min = 1.0f;
+         boxes[i].y_max = 0.0f;
+         continue;
+      }
+
+      boxes[i].x_min = desc->x_hitbox - range_x;
+      boxes[i].x_max = desc->x_hitbox + range_x;
+      boxes[i].y_min = desc->y_hitbox - range_y;
+      boxes[i].y_max = desc->y_hitbox + range_y;
+   }
+
+   ol->hit_grid = box_grid_new(boxes, ol->size);
+   free(boxes);
+}
+
 /**
  * input_overlay_scale:
  * @ol                    : Overlay handle.
@@ -2722,6 +2870,8 @@ static void input_overlay_scale(struct overlay *ol,
 
       input_overlay_desc_init_hitbox(desc);
    }
+
+   input_overlay_build_hit_grid(ol);
 }
 
 static void input_overlay_parse_layout(
@@ -3009,6 +3159,8 @@ void input_overlay_free_overlay(struct overlay *overlay)
    if (overlay->descs)
       free(overlay->descs);
    overlay->descs       = NULL;
+   box_grid_free(overlay->hit_grid);
+   overlay->hit_grid    = NULL;
    image_texture_free(&overlay->image);
 }
 
@@ -5967,6 +6119,9 @@ void bsv_movie_frame_rewind(void)
       return;
 
    handle->did_rewind = true;
+   /* Truncation below needs the whole file written */
+   if (recording)
+      bsv_movie_flush_checkpoint(handle);
 
    if (     ( (handle->frame_counter & handle->frame_mask) <= 1)
          && (handle->frame_pos[0] == handle->min_file_pos))
@@ -6026,6 +6181,9 @@ void bsv_movie_frame_rewind(void)
          intfstream_write(handle->file, handle->state, handle->state_size);
       }
    }
+
+   if (recording)
+      bsv_movie_truncate_checkpoints(handle, intfstream_tell(handle->file));
 }
 
 void bsv_movie_handle_push_key_event(bsv_movie_t *movie,
@@ -6091,203 +6249,921 @@ void bsv_movie_finish_rewind(input_driver_state_t *input_st)
    handle->did_rewind     = false;
 }
 
-bool bsv_movie_load_checkpoint(bsv_movie_t *handle, uint8_t compression, uint8_t encoding)
+/* Checkpoints from one RAW keyframe to the next */
+#define REPLAY_CHECKPOINT_KEYFRAME_INTERVAL 10
+#define REPLAY_CHECKPOINT_DELTA_BLOCK       256
+#define REPLAY_CHECKPOINT_DELTA_HEADER      (2 * sizeof(uint32_t))
+
+struct bsv_checkpoint_codec
+{
+   /* Last RAW checkpoint, the base of DELTA ones */
+   uint8_t *keyframe;
+   size_t keyframe_cap;
+   size_t keyframe_size;
+   /* Its data_pos, or -1 if there is none */
+   int64_t keyframe_pos;
+   uint32_t keyframe_crc;
+   unsigned since_keyframe;
+
+   /* Reused by every checkpoint */
+   uint8_t *state;
+   size_t state_cap;
+   size_t state_size;
+   uint8_t *encoded;
+   size_t encoded_cap;
+   uint8_t *compressed;
+   size_t compressed_cap;
+#ifdef HAVE_ZSTD
+   ZSTD_CCtx *cctx;
+   ZSTD_DCtx *dctx;
+#endif
+
+   /* Checkpoint being written */
+   const uint8_t *out;
+   uint64_t job_frame;
+   int64_t job_record_pos;
+   size_t out_size;
+   size_t encoded_size;
+   uint8_t compression;
+   uint8_t encoding;
+   bool want_keyframe;
+   bool ok;
+   bool in_flight;
+
+   /* Records written while it is compressed, and the
+    * frames whose frame_pos is an offset into them */
+   uint8_t *pending;
+   size_t pending_cap;
+   size_t pending_size;
+   uint64_t pending_first_frame;
+   size_t pending_frames;
+
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool job_ready;
+   bool job_done;
+   bool quit;
+#endif
+};
+typedef struct bsv_checkpoint_codec bsv_checkpoint_codec_t;
+
+static bool bsv_checkpoint_reserve(uint8_t **buf, size_t *cap, size_t len)
+{
+   uint8_t *tmp;
+   if (len <= *cap)
+      return true;
+   if (!(tmp = (uint8_t*)realloc(*buf, len)))
+      return false;
+   *buf = tmp;
+   *cap = len;
+   return true;
+}
+
+static bsv_checkpoint_codec_t *bsv_movie_get_codec(bsv_movie_t *handle)
+{
+   if (!handle->codec)
+   {
+      bsv_checkpoint_codec_t *codec = (bsv_checkpoint_codec_t*)
+         calloc(1, sizeof(*codec));
+      if (!codec)
+         return NULL;
+      codec->keyframe_pos = -1;
+      handle->codec       = codec;
+   }
+   return handle->codec;
+}
+
+static bool bsv_checkpoint_set_keyframe(bsv_checkpoint_codec_t *codec,
+      const uint8_t *data, size_t len, int64_t data_pos)
+{
+   codec->keyframe_pos = -1;
+   if (!bsv_checkpoint_reserve(&codec->keyframe, &codec->keyframe_cap, len))
+      return false;
+   memcpy(codec->keyframe, data, len);
+   codec->keyframe_size = len;
+   codec->keyframe_crc  = encoding_crc32(0, codec->keyframe, len);
+   codec->keyframe_pos  = data_pos;
+   return true;
+}
+
+static size_t bsv_checkpoint_delta_bound(size_t len)
+{
+   size_t blocks = (len + REPLAY_CHECKPOINT_DELTA_BLOCK - 1)
+      / REPLAY_CHECKPOINT_DELTA_BLOCK;
+   return REPLAY_CHECKPOINT_DELTA_HEADER + (blocks + 7) / 8 + len;
+}
+
+/* Returns the encoded size, or 0 when more than half of
+ * the blocks changed and a new keyframe is the better deal */
+static size_t bsv_checkpoint_delta_encode(const uint8_t *state,
+      const uint8_t *base, size_t len, uint32_t base_crc, uint8_t *out)
 {
+   size_t i, j;
+   uint32_t val;
+   size_t blocks    = (len + REPLAY_CHECKPOINT_DELTA_BLOCK - 1)
+      / REPLAY_CHECKPOINT_DELTA_BLOCK;
+   size_t changed   = 0;
+   uint8_t *bitmap  = out + REPLAY_CHECKPOINT_DELTA_HEADER;
+   uint8_t *data    = bitmap + (blocks + 7) / 8;
+
+   val = swap_if_big32(REPLAY_CHECKPOINT_DELTA_BLOCK);
+   memcpy(out, &val, sizeof(val));
+   val = swap_if_big32(base_crc);
+   memcpy(out + sizeof(val), &val, sizeof(val));
+   memset(bitmap, 0, (blocks + 7) / 8);
+
+   for (i = 0; i < blocks; i++)
+   {
+      size_t offset = i * REPLAY_CHECKPOINT_DELTA_BLOCK;
+      size_t _len   = MIN(REPLAY_CHECKPOINT_DELTA_BLOCK, len - offset);
+      if (!memcmp(state + offset, base + offset, _len))
+         continue;
+      if (++changed > blocks / 2)
+         return 0;
+      bitmap[i >> 3] |= 1 << (i & 7);
+      for (j = 0; j < _len; j++)
+         data[j] = state[offset + j] ^ base[offset + j];
+      data += _len;
+   }
+
+   return (size_t)(data - out);
+}
+
+static bool bsv_checkpoint_delta_decode(const uint8_t *in, size_t in_len,
+      const uint8_t *base, size_t len, uint32_t base_crc, uint8_t *out)
+{
+   size_t i, j, block, blocks, bitmap_len;
+   uint32_t val;
+   const uint8_t *bitmap;
+   const uint8_t *data;
+   const uint8_t *end = in + in_len;
+
+   if (in_len < REPLAY_CHECKPOINT_DELTA_HEADER)
+      return false;
+   memcpy(&val, in, sizeof(val));
+   if (!(block = swap_if_big32(val)))
+      return false;
+   memcpy(&val, in + sizeof(val), sizeof(val));
+   if (swap_if_big32(val) != base_crc)
+   {
+      RARCH_WARN("[Replay] Delta checkpoint doesn't match its keyframe.\n");
+      return false;
+   }
+
+   blocks     = (len + block - 1) / block;
+   bitmap_len = (blocks + 7) / 8;
+   if (in_len - REPLAY_CHECKPOINT_DELTA_HEADER < bitmap_len)
+      return false;
+   bitmap     = in + REPLAY_CHECKPOINT_DELTA_HEADER;
+   data       = bitmap + bitmap_len;
+
+   memcpy(out, base, len);
+   for (i = 0; i < blocks; i++)
+   {
+      size_t offset, _len;
+      if (!(bitmap[i >> 3] & (1 << (i & 7))))
+         continue;
+      offset = i * block;
+      _len   = MIN(block, len - offset);
+      if ((size_t)(end - data) < _len)
+         return false;
+      for (j = 0; j < _len; j++)
+         out[offset + j] ^= data[j];
+      data += _len;
+   }
+
+   return true;
+}
+
+static bool bsv_checkpoint_compress(bsv_checkpoint_codec_t *codec,
+      const uint8_t *data, size_t len)
+{
+   switch (codec->compression)
+   {
+      case REPLAY_CHECKPOINT2_COMPRESSION_NONE:
+         codec->out      = data;
+         codec->out_size = len;
+         return true;
+#ifdef HAVE_ZLIB
+      case REPLAY_CHECKPOINT2_COMPRESSION_ZLIB:
+      {
+         uLongf _len = compressBound(len);
+         if (     !bsv_checkpoint_reserve(&codec->compressed,
+                     &codec->compressed_cap, _len)
+               || compress2(codec->compressed, &_len, data, len, 6) != Z_OK)
+            return false;
+         codec->out      = codec->compressed;
+         codec->out_size = _len;
+         return true;
+      }
+#endif
 #ifdef HAVE_ZSTD
-   size_t uncompressed_size_big;
+      case REPLAY_CHECKPOINT2_COMPRESSION_ZSTD:
+      {
+         size_t _len = ZSTD_compressBound(len);
+         if (     !bsv_checkpoint_reserve(&codec->compressed,
+                     &codec->compressed_cap, _len)
+               || (!codec->cctx && !(codec->cctx = ZSTD_createCCtx())))
+            return false;
+         _len = ZSTD_compressCCtx(codec->cctx, codec->compressed, _len,
+               data, len, 9);
+         if (ZSTD_isError(_len))
+            return false;
+         codec->out      = codec->compressed;
+         codec->out_size = _len;
+         return true;
+      }
+#endif
+      default:
+         break;
+   }
+   return false;
+}
+
+/* Encodes and compresses codec->state. Runs on the
+ * writer thread, the main thread leaves the codec alone
+ * until it's done. */
+static void bsv_checkpoint_run_job(bsv_checkpoint_codec_t *codec)
+{
+   size_t encoded_size = 0;
+
+   if (     !codec->want_keyframe
+         && bsv_checkpoint_reserve(&codec->encoded, &codec->encoded_cap,
+               bsv_checkpoint_delta_bound(codec->state_size)))
+      encoded_size = bsv_checkpoint_delta_encode(codec->state,
+            codec->keyframe, codec->state_size, codec->keyframe_crc,
+            codec->encoded);
+
+   if (encoded_size)
+   {
+      codec->encoding     = REPLAY_CHECKPOINT2_ENCODING_DELTA;
+      codec->encoded_size = encoded_size;
+      codec->ok           = bsv_checkpoint_compress(codec,
+            codec->encoded, encoded_size);
+   }
+   else
+   {
+      /* The state becomes the keyframe; the old keyframe
+       * buffer takes the next state */
+      uint8_t *tmp         = codec->keyframe;
+      size_t tmp_cap       = codec->keyframe_cap;
+      codec->keyframe      = codec->state;
+      codec->keyframe_cap  = codec->state_cap;
+      codec->state         = tmp;
+      codec->state_cap     = tmp_cap;
+      codec->keyframe_size = codec->state_size;
+      codec->keyframe_crc  = encoding_crc32(0, codec->keyframe,
+            codec->keyframe_size);
+      codec->encoding      = REPLAY_CHECKPOINT2_ENCODING_RAW;
+      codec->encoded_size  = codec->keyframe_size;
+      codec->ok            = bsv_checkpoint_compress(codec,
+            codec->keyframe, codec->keyframe_size);
+   }
+}
+
+#ifdef HAVE_THREADS
+static void bsv_checkpoint_thread(void *data)
+{
+   bsv_checkpoint_codec_t *codec = (bsv_checkpoint_codec_t*)data;
+
+   slock_lock(codec->lock);
+   for (;;)
+   {
+      while (!codec->job_ready && !codec->quit)
+         scond_wait(codec->cond, codec->lock);
+      if (codec->quit)
+         break;
+      codec->job_ready = false;
+      slock_unlock(codec->lock);
+
+      bsv_checkpoint_run_job(codec);
+
+      slock_lock(codec->lock);
+      codec->job_done = true;
+      scond_broadcast(codec->cond);
+   }
+   slock_unlock(codec->lock);
+}
+
+static bool bsv_checkpoint_thread_start(bsv_checkpoint_codec_t *codec)
+{
+   if (codec->thread)
+      return true;
+   if (!codec->lock && !(codec->lock = slock_new()))
+      return false;
+   if (!codec->cond && !(codec->cond = scond_new()))
+      return false;
+   codec->quit = false;
+   return (codec->thread = sthread_create(bsv_checkpoint_thread, codec))
+      != NULL;
+}
 #endif
+
+static void bsv_movie_add_checkpoint(bsv_movie_t *handle, uint64_t frame,
+      int64_t record_pos, int64_t data_pos, uint8_t token, uint8_t encoding)
+{
+   bsv_checkpoint_t *entry;
+
+   if (handle->checkpoint_count == handle->checkpoint_cap)
+   {
+      size_t cap            = handle->checkpoint_cap
+         ? handle->checkpoint_cap * 2 : 64;
+      bsv_checkpoint_t *tmp = (bsv_checkpoint_t*)realloc(
+            handle->checkpoints, cap * sizeof(*tmp));
+      if (!tmp)
+         return;
+      handle->checkpoints    = tmp;
+      handle->checkpoint_cap = cap;
+   }
+
+   entry             = &handle->checkpoints[handle->checkpoint_count++];
+   entry->frame      = frame;
+   entry->record_pos = record_pos;
+   entry->data_pos   = data_pos;
+   entry->token      = token;
+   entry->encoding   = encoding;
+}
+
+void bsv_movie_truncate_checkpoints(bsv_movie_t *handle, int64_t pos)
+{
+   while (     handle->checkpoint_count
+         && (handle->checkpoints[handle->checkpoint_count - 1].record_pos >= pos))
+      handle->checkpoint_count--;
+   if (handle->codec && handle->codec->keyframe_pos >= pos)
+      handle->codec->keyframe_pos = -1;
+}
+
+/* The keyframe of the DELTA checkpoint at 'data_pos' */
+static const bsv_checkpoint_t *bsv_movie_find_keyframe(
+      const bsv_movie_t *handle, int64_t data_pos)
+{
+   size_t lo = 0;
+   size_t hi = handle->checkpoint_count;
+
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      if (handle->checkpoints[mid].data_pos < data_pos)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   while (lo-- > 0)
+   {
+      const bsv_checkpoint_t *entry = &handle->checkpoints[lo];
+      if (     entry->token    == REPLAY_TOKEN_CHECKPOINT2_FRAME
+            && entry->encoding == REPLAY_CHECKPOINT2_ENCODING_RAW)
+         return entry;
+   }
+   return NULL;
+}
+
+/* Writes the compressed checkpoint, then the records that
+ * came after it */
+static void bsv_movie_write_checkpoint(bsv_movie_t *handle,
+      bsv_checkpoint_codec_t *codec)
+{
+   size_t i;
+   int64_t base;
+   uint8_t frame_tok = REPLAY_TOKEN_CHECKPOINT2_FRAME;
+
+   if (codec->ok)
+   {
+      uint32_t size_;
+      int64_t data_pos;
+
+      intfstream_write(handle->file, &frame_tok, sizeof(uint8_t));
+      data_pos = intfstream_tell(handle->file);
+      /* compression and encoding schemes */
+      intfstream_write(handle->file, &codec->compression, sizeof(uint8_t));
+      intfstream_write(handle->file, &codec->encoding, sizeof(uint8_t));
+      /* uncompressed, unencoded size */
+      size_ = swap_if_big32((uint32_t)codec->state_size);
+      intfstream_write(handle->file, &size_, sizeof(uint32_t));
+      /* uncompressed, encoded size */
+      size_ = swap_if_big32((uint32_t)codec->encoded_size);
+      intfstream_write(handle->file, &size_, sizeof(uint32_t));
+      /* compressed, encoded size */
+      size_ = swap_if_big32((uint32_t)codec->out_size);
+      intfstream_write(handle->file, &size_, sizeof(uint32_t));
+      /* data */
+      intfstream_write(handle->file, codec->out, codec->out_size);
+
+      if (codec->encoding == REPLAY_CHECKPOINT2_ENCODING_RAW)
+      {
+         codec->keyframe_pos   = data_pos;
+         codec->since_keyframe = 0;
+      }
+      codec->since_keyframe++;
+
+      bsv_movie_add_checkpoint(handle, codec->job_frame,
+            codec->job_record_pos, data_pos, frame_tok, codec->encoding);
+   }
+   else
+   {
+      RARCH_ERR("[Replay] Failed to compress checkpoint, skipping it.\n");
+      if (codec->encoding == REPLAY_CHECKPOINT2_ENCODING_RAW)
+         codec->keyframe_pos = -1;
+      frame_tok = REPLAY_TOKEN_REGULAR_FRAME;
+      intfstream_write(handle->file, &frame_tok, sizeof(uint8_t));
+   }
+
+   base = intfstream_tell(handle->file);
+   if (codec->pending_size)
+      intfstream_write(handle->file, codec->pending, codec->pending_size);
+   for (i = 0; i < codec->pending_frames; i++)
+      handle->frame_pos[(codec->pending_first_frame + i)
+         & handle->frame_mask] += base;
+   codec->pending_size   = 0;
+   codec->pending_frames = 0;
+}
+
+/* Writes out the checkpoint once compressed. Returns
+ * false if it isn't yet and 'wait' is not set. */
+static bool bsv_movie_finish_checkpoint(bsv_movie_t *handle, bool wait)
+{
+   bsv_checkpoint_codec_t *codec = handle->codec;
+
+   if (!codec || !codec->in_flight)
+      return true;
+
+#ifdef HAVE_THREADS
+   if (codec->thread)
+   {
+      slock_lock(codec->lock);
+      if (!codec->job_done && !wait)
+      {
+         slock_unlock(codec->lock);
+         return false;
+      }
+      while (!codec->job_done)
+         scond_wait(codec->cond, codec->lock);
+      codec->job_done = false;
+      slock_unlock(codec->lock);
+   }
+#endif
+
+   codec->in_flight = false;
+   bsv_movie_write_checkpoint(handle, codec);
+   return true;
+}
+
+void bsv_movie_flush_checkpoint(bsv_movie_t *handle)
+{
+   bsv_movie_finish_checkpoint(handle, true);
+}
+
+/* Serializes the core and hands the state to the writer
+ * thread. The checkpoint is written once compressed, with
+ * the records written meanwhile held back until then. */
+static void bsv_movie_submit_checkpoint(bsv_movie_t *handle,
+      uint8_t compression, int64_t record_pos)
+{
    retro_ctx_serialize_info_t serial_info;
+   bsv_checkpoint_codec_t *codec = bsv_movie_get_codec(handle);
+   size_t _len                   = core_serialize_size();
+
+   if (     !codec
+         || !bsv_checkpoint_reserve(&codec->state, &codec->state_cap, _len))
+   {
+      uint8_t frame_tok = REPLAY_TOKEN_REGULAR_FRAME;
+      RARCH_ERR("[Replay] Failed to allocate checkpoint, skipping it.\n");
+      intfstream_write(handle->file, &frame_tok, sizeof(uint8_t));
+      return;
+   }
+
+   serial_info.data      = codec->state;
+   serial_info.size      = _len;
+   core_serialize(&serial_info);
+
+   codec->state_size     = _len;
+   codec->compression    = compression;
+   codec->want_keyframe  = (codec->keyframe_pos < 0)
+      || (codec->keyframe_size != _len)
+      || (codec->since_keyframe >= REPLAY_CHECKPOINT_KEYFRAME_INTERVAL);
+   codec->job_frame      = handle->frame_counter;
+   codec->job_record_pos = record_pos;
+   codec->pending_size   = 0;
+   codec->pending_frames = 0;
+   codec->ok             = false;
+   codec->in_flight      = true;
+
+#ifdef HAVE_THREADS
+   if (bsv_checkpoint_thread_start(codec))
+   {
+      slock_lock(codec->lock);
+      codec->job_ready = true;
+      codec->job_done  = false;
+      scond_broadcast(codec->cond);
+      slock_unlock(codec->lock);
+      return;
+   }
+#endif
+
+   bsv_checkpoint_run_job(codec);
+   bsv_movie_finish_checkpoint(handle, true);
+}
+
+/* Writes behind the checkpoint being compressed, if any */
+static void bsv_movie_write(bsv_movie_t *handle, const void *data, size_t len)
+{
+   bsv_checkpoint_codec_t *codec = handle->codec;
+
+   if (codec && codec->in_flight)
+   {
+      size_t cap = MAX(codec->pending_size + len, codec->pending_cap * 2);
+      if (bsv_checkpoint_reserve(&codec->pending, &codec->pending_cap,
+               (codec->pending_size + len > codec->pending_cap) ? cap : 0))
+      {
+         memcpy(codec->pending + codec->pending_size, data, len);
+         codec->pending_size += len;
+         return;
+      }
+      bsv_movie_finish_checkpoint(handle, true);
+   }
+
+   intfstream_write(handle->file, data, len);
+}
+
+static void bsv_movie_set_frame_pos(bsv_movie_t *handle)
+{
+   bsv_checkpoint_codec_t *codec = handle->codec;
+   size_t *frame_pos             = &handle->frame_pos[
+      handle->frame_counter & handle->frame_mask];
+
+   /* Relative to the held back records for now */
+   if (codec && codec->in_flight)
+   {
+      if (!codec->pending_frames++)
+         codec->pending_first_frame = handle->frame_counter;
+      *frame_pos = codec->pending_size;
+   }
+   else
+      *frame_pos = intfstream_tell(handle->file);
+}
+
+void bsv_movie_free_checkpoints(bsv_movie_t *handle)
+{
+   bsv_checkpoint_codec_t *codec = handle->codec;
+
+   if (codec)
+   {
+      bsv_movie_flush_checkpoint(handle);
+#ifdef HAVE_THREADS
+      if (codec->thread)
+      {
+         slock_lock(codec->lock);
+         codec->quit = true;
+         scond_broadcast(codec->cond);
+         slock_unlock(codec->lock);
+         sthread_join(codec->thread);
+      }
+      if (codec->cond)
+         scond_free(codec->cond);
+      if (codec->lock)
+         slock_free(codec->lock);
+#endif
+#ifdef HAVE_ZSTD
+      if (codec->cctx)
+         ZSTD_freeCCtx(codec->cctx);
+      if (codec->dctx)
+         ZSTD_freeDCtx(codec->dctx);
+#endif
+      free(codec->keyframe);
+      free(codec->state);
+      free(codec->encoded);
+      free(codec->compressed);
+      free(codec->pending);
+      free(codec);
+      handle->codec = NULL;
+   }
+
+   free(handle->checkpoints);
+   handle->checkpoints      = NULL;
+   handle->checkpoint_count = 0;
+   handle->checkpoint_cap   = 0;
+}
+
+bool bsv_movie_scan_checkpoints(bsv_movie_t *handle)
+{
+   uint64_t frame = 0;
+   int64_t pos    = intfstream_tell(handle->file);
+
+   handle->checkpoint_count = 0;
+
+   /* Version 0 replays have no frame records */
+   if (handle->version == 0)
+      return false;
+
+   intfstream_seek(handle->file, (int64_t)handle->min_file_pos, SEEK_SET);
+
+   for (;; frame++)
+   {
+      uint8_t key_count, frame_tok;
+      uint16_t input_count;
+      int64_t data_pos;
+      int64_t record_pos = intfstream_tell(handle->file);
+
+      if (     intfstream_read(handle->file, &key_count, 1) != 1
+            || intfstream_seek(handle->file,
+               key_count * sizeof(bsv_key_data_t), SEEK_CUR) < 0
+            || intfstream_read(handle->file, &input_count, 2) != 2
+            || intfstream_seek(handle->file,
+               swap_if_big16(input_count) * sizeof(bsv_input_data_t),
+               SEEK_CUR) < 0
+            || intfstream_read(handle->file, &frame_tok, 1) != 1)
+         break;
+
+      data_pos = intfstream_tell(handle->file);
+
+      if (frame_tok == REPLAY_TOKEN_CHECKPOINT2_FRAME)
+      {
+         uint32_t compressed_size;
+         uint8_t header[2 + 3 * sizeof(uint32_t)];
+         if (intfstream_read(handle->file, header, sizeof(header))
+               != sizeof(header))
+            break;
+         memcpy(&compressed_size, header + 2 + 2 * sizeof(uint32_t),
+               sizeof(uint32_t));
+         bsv_movie_add_checkpoint(handle, frame, record_pos, data_pos,
+               frame_tok, header[1]);
+         intfstream_seek(handle->file, swap_if_big32(compressed_size),
+               SEEK_CUR);
+      }
+      else if (frame_tok == REPLAY_TOKEN_CHECKPOINT_FRAME)
+      {
+         uint64_t _len;
+         if (intfstream_read(handle->file, &_len, sizeof(uint64_t))
+               != sizeof(uint64_t))
+            break;
+         bsv_movie_add_checkpoint(handle, frame, record_pos, data_pos,
+               frame_tok, REPLAY_CHECKPOINT2_ENCODING_RAW);
+         intfstream_seek(handle->file, (int64_t)swap_if_big64(_len),
+               SEEK_CUR);
+      }
+      else if (frame_tok != REPLAY_TOKEN_REGULAR_FRAME)
+         break;
+   }
+
+   intfstream_seek(handle->file, pos, SEEK_SET);
+   return true;
+}
+
+/* The last checkpoint restored no later than 'frame' */
+static const bsv_checkpoint_t *bsv_movie_find_checkpoint(
+      const bsv_movie_t *handle, uint64_t frame)
+{
+   size_t lo = 0;
+   size_t hi = handle->checkpoint_count;
+
+   /* The record of frame n is read while the counter is
+    * at n - 1, restoring its checkpoint before frame n runs */
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      if (handle->checkpoints[mid].frame <= frame + 1)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo ? &handle->checkpoints[lo - 1] : NULL;
+}
+
+bool bsv_movie_seek_checkpoint(bsv_movie_t *handle, uint64_t frame,
+      uint64_t *checkpoint_frame)
+{
+   const bsv_checkpoint_t *entry;
+
+   if (!handle->playback || handle->version == 0)
+      return false;
+
+   if (!(entry = bsv_movie_find_checkpoint(handle, frame)))
+   {
+      /* Before the first checkpoint, start over from the
+       * state at the top of the file */
+      retro_ctx_serialize_info_t serial_info;
+      if (!handle->state)
+         return false;
+      serial_info.data_const = handle->state;
+      serial_info.size       = handle->state_size;
+      if (     !core_unserialize(&serial_info)
+            || intfstream_seek(handle->file,
+               (int64_t)handle->min_file_pos, SEEK_SET) < 0)
+         return false;
+      handle->frame_counter = 0;
+      handle->frame_pos[0]  = handle->min_file_pos;
+      bsv_movie_read_next_events(handle);
+      if (checkpoint_frame)
+         *checkpoint_frame = 0;
+      return true;
+   }
+
+   if (intfstream_seek(handle->file, entry->record_pos, SEEK_SET) < 0)
+      return false;
+
+   /* DELTA keyframes get loaded along with the checkpoint */
+   handle->frame_counter = entry->frame - 1;
+   if (entry->frame >= 2)
+      handle->frame_pos[(entry->frame - 2) & handle->frame_mask] =
+         (size_t)entry->record_pos;
+   if (checkpoint_frame)
+      *checkpoint_frame = handle->frame_counter;
+   return true;
+}
+
+bool bsv_movie_seek(bsv_movie_t *handle, uint64_t frame)
+{
+   const bsv_checkpoint_t *entry;
+
+   if (!handle->playback || handle->version == 0)
+      return false;
+
+   entry = bsv_movie_find_checkpoint(handle, frame);
+   /* Checkpoints at or before the current frame don't help
+    * going forward */
+   if (     frame < handle->frame_counter
+         || (entry && entry->frame - 1 > handle->frame_counter))
+   {
+      if (!bsv_movie_seek_checkpoint(handle, frame, NULL))
+         return false;
+   }
+
+   handle->seek_frame = frame;
+   handle->seeking    = frame > handle->frame_counter;
+   RARCH_LOG("[Replay] Seeking to frame %llu from frame %llu.\n",
+         (unsigned long long)frame,
+         (unsigned long long)handle->frame_counter);
+   return true;
+}
+
+/* Reads the sizes and data of a CHECKPOINT2 checkpoint
+ * and decompresses it. Returns the encoded data, valid
+ * until the next checkpoint, or NULL. */
+static uint8_t *bsv_movie_read_checkpoint(bsv_movie_t *handle,
+      bsv_checkpoint_codec_t *codec, uint8_t compression,
+      uint32_t *size, uint32_t *encoded_size)
+{
+   uint32_t compressed_encoded_size;
    input_driver_state_t *input_st = input_state_get_ptr();
-   uint32_t compressed_encoded_size, encoded_size, size;
-   uint8_t *compressed_data = NULL;
-   uint8_t *encoded_data    = NULL;
-   uint8_t *state           = NULL;
-   bool ret                 = true;
 
-   if (intfstream_read(handle->file, &(size),
+   if (intfstream_read(handle->file, size,
                sizeof(uint32_t)) != sizeof(uint32_t))
    {
       RARCH_ERR("[Replay] Replay truncated before uncompressed unencoded size\n");
-      ret = false;
-      goto exit;
+      return NULL;
    }
-   if (intfstream_read(handle->file, &(encoded_size),
+   if (intfstream_read(handle->file, encoded_size,
                sizeof(uint32_t)) != sizeof(uint32_t))
    {
       RARCH_ERR("[Replay] Replay truncated before uncompressed encoded size\n");
-      ret = false;
-      goto exit;
+      return NULL;
    }
-   if (intfstream_read(handle->file, &(compressed_encoded_size),
+   if (intfstream_read(handle->file, &compressed_encoded_size,
                sizeof(uint32_t)) != sizeof(uint32_t))
    {
       RARCH_ERR("[Replay] Replay truncated before compressed encoded size\n");
-      ret = false;
-      goto exit;
+      return NULL;
    }
-   size                    = swap_if_big32(size);
-   encoded_size            = swap_if_big32(encoded_size);
+   *size                   = swap_if_big32(*size);
+   *encoded_size           = swap_if_big32(*encoded_size);
    compressed_encoded_size = swap_if_big32(compressed_encoded_size);
-   compressed_data         = (uint8_t*)malloc(compressed_encoded_size);
-   if (intfstream_read(handle->file, compressed_data, compressed_encoded_size) != (int64_t)compressed_encoded_size)
+
+   if (     !bsv_checkpoint_reserve(&codec->compressed,
+               &codec->compressed_cap, compressed_encoded_size)
+         || intfstream_read(handle->file, codec->compressed,
+               compressed_encoded_size) != (int64_t)compressed_encoded_size)
    {
       RARCH_ERR("[Replay] Truncated checkpoint, terminating movie\n");
       input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
-      ret = false;
-      goto exit;
+      return NULL;
    }
+
    switch (compression)
    {
       case REPLAY_CHECKPOINT2_COMPRESSION_NONE:
-         encoded_data    = compressed_data;
-         compressed_data = NULL;
-         break;
+         *encoded_size = compressed_encoded_size;
+         return codec->compressed;
 #ifdef HAVE_ZLIB
       case REPLAY_CHECKPOINT2_COMPRESSION_ZLIB:
          {
 #ifdef EMSCRIPTEN
-            uLongf uncompressed_size_zlib = encoded_size;
+            uLongf uncompressed_size_zlib   = *encoded_size;
 #else
-            uint32_t uncompressed_size_zlib = encoded_size;
-#endif
-            encoded_data = (uint8_t*)calloc(encoded_size, sizeof(uint8_t));
-            if (uncompress(encoded_data, &uncompressed_size_zlib, compressed_data, compressed_encoded_size) != Z_OK)
-            {
-               ret = false;
-               goto exit;
-            }
-            break;
+            uint32_t uncompressed_size_zlib = *encoded_size;
+#endif
+            if (     !bsv_checkpoint_reserve(&codec->encoded,
+                        &codec->encoded_cap, *encoded_size)
+                  || uncompress(codec->encoded, &uncompressed_size_zlib,
+                        codec->compressed, compressed_encoded_size) != Z_OK)
+               return NULL;
+            return codec->encoded;
          }
 #endif
 #ifdef HAVE_ZSTD
       case REPLAY_CHECKPOINT2_COMPRESSION_ZSTD:
-         /* TODO: figure out how to support in-place decompression to
-            avoid allocating a second buffer; would need to allocate
-            the compressed_data buffer to be decompressed size +
-            margin.  but, how could the margin be known without
-            calling the function that takes the compressed frames as
-            an input?  */
-         encoded_data = (uint8_t*)calloc(encoded_size, sizeof(uint8_t));
-         uncompressed_size_big = ZSTD_decompress(encoded_data, encoded_size, compressed_data, compressed_encoded_size);
-         if (ZSTD_isError(uncompressed_size_big))
          {
-            ret = false;
-            goto exit;
+            size_t uncompressed_size_big;
+            if (     !bsv_checkpoint_reserve(&codec->encoded,
+                        &codec->encoded_cap, *encoded_size)
+                  || (!codec->dctx && !(codec->dctx = ZSTD_createDCtx())))
+               return NULL;
+            uncompressed_size_big = ZSTD_decompressDCtx(codec->dctx,
+                  codec->encoded, *encoded_size,
+                  codec->compressed, compressed_encoded_size);
+            if (ZSTD_isError(uncompressed_size_big))
+               return NULL;
+            return codec->encoded;
          }
-         break;
 #endif
       default:
          RARCH_WARN("[Replay] Unrecognized compression scheme %d\n", compression);
-         ret = false;
-         goto exit;
-   }
-   switch (encoding)
-   {
-      case REPLAY_CHECKPOINT2_ENCODING_RAW:
-         size         = encoded_size;
-         state        = encoded_data;
-         encoded_data = NULL;
          break;
-      default:
-         RARCH_WARN("[Replay] Unrecognized encoding scheme %d\n", encoding);
-         ret = false;
-         goto exit;
    }
-   serial_info.data_const = state;
-   serial_info.size       = size;
-   if (!core_unserialize(&serial_info))
-   {
-      ret = false;
-      goto exit;
-   }
- exit:
-   if (compressed_data)
-      free(compressed_data);
-   if (encoded_data)
-      free(encoded_data);
-   if (state)
-      free(state);
+   return NULL;
+}
+
+/* Reads the RAW checkpoint 'keyframe' into the codec
+ * without loading it */
+static bool bsv_movie_load_keyframe(bsv_movie_t *handle,
+      bsv_checkpoint_codec_t *codec, const bsv_checkpoint_t *keyframe)
+{
+   uint8_t schemes[2];
+   uint32_t size, encoded_size;
+   uint8_t *data;
+   bool ret    = false;
+   int64_t pos = intfstream_tell(handle->file);
+
+   intfstream_seek(handle->file, keyframe->data_pos, SEEK_SET);
+   if (     intfstream_read(handle->file, schemes, 2) == 2
+         && schemes[1] == REPLAY_CHECKPOINT2_ENCODING_RAW
+         && (data = bsv_movie_read_checkpoint(handle, codec, schemes[0],
+               &size, &encoded_size)))
+      ret = bsv_checkpoint_set_keyframe(codec, data, encoded_size,
+            keyframe->data_pos);
+   intfstream_seek(handle->file, pos, SEEK_SET);
    return ret;
 }
 
-bool bsv_movie_write_checkpoint(bsv_movie_t *handle, uint8_t compression, uint8_t encoding, retro_ctx_serialize_info_t serial_info)
+bool bsv_movie_load_checkpoint(bsv_movie_t *handle, uint8_t compression, uint8_t encoding)
 {
-   bool ret = true;
-   uint32_t encoded_size, compressed_encoded_size, size_;
-   uint8_t *encoded_data            = NULL;
-   uint8_t *compressed_encoded_data = NULL;
-   bool owns_encoded                = false;
-   bool owns_compressed_encoded     = false;
-   switch (encoding)
+   retro_ctx_serialize_info_t serial_info;
+   uint32_t size, encoded_size;
+   uint8_t *data;
+   const uint8_t *state          = NULL;
+   bsv_checkpoint_codec_t *codec = bsv_movie_get_codec(handle);
+   /* Where the compression and encoding bytes were read */
+   int64_t data_pos              = intfstream_tell(handle->file) - 2;
+
+   if (!codec)
+      return false;
+
+   /* After seeking or rewinding, the keyframe in memory
+    * may not be this checkpoint's */
+   if (encoding == REPLAY_CHECKPOINT2_ENCODING_DELTA)
    {
-      case REPLAY_CHECKPOINT2_ENCODING_RAW:
-         encoded_size = serial_info.size;
-         encoded_data = (uint8_t*)serial_info.data;
-         break;
-      default:
-         RARCH_ERR("[Replay] Unrecognized encoding scheme %d\n", encoding);
-         ret = false;
-         goto exit;
+      const bsv_checkpoint_t *keyframe = bsv_movie_find_keyframe(
+            handle, data_pos);
+      if (keyframe && keyframe->data_pos != codec->keyframe_pos)
+         bsv_movie_load_keyframe(handle, codec, keyframe);
    }
-   switch (compression)
+
+   if (!(data = bsv_movie_read_checkpoint(handle, codec, compression,
+               &size, &encoded_size)))
+      return false;
+
+   switch (encoding)
    {
-      case REPLAY_CHECKPOINT2_COMPRESSION_NONE:
-         compressed_encoded_size = encoded_size;
-         compressed_encoded_data = (uint8_t*)encoded_data;
-         break;
-#ifdef HAVE_ZLIB
-      case REPLAY_CHECKPOINT2_COMPRESSION_ZLIB:
-      {
-         uLongf zlib_compressed_encoded_size = compressBound(encoded_size);
-         compressed_encoded_data = (uint8_t*)calloc(zlib_compressed_encoded_size, sizeof(uint8_t));
-         owns_compressed_encoded = true;
-         if (compress2(compressed_encoded_data, &zlib_compressed_encoded_size, encoded_data, encoded_size, 6) != Z_OK)
-         {
-            ret = false;
-            goto exit;
-         }
-         compressed_encoded_size = zlib_compressed_encoded_size;
+      case REPLAY_CHECKPOINT2_ENCODING_RAW:
+         size  = encoded_size;
+         state = data;
+         bsv_checkpoint_set_keyframe(codec, data, size, data_pos);
          break;
-      }
-#endif
-#ifdef HAVE_ZSTD
-      case REPLAY_CHECKPOINT2_COMPRESSION_ZSTD:
-      {
-         size_t compressed_encoded_size_big = ZSTD_compressBound(encoded_size);
-         compressed_encoded_data = (uint8_t*)calloc(compressed_encoded_size_big, sizeof(uint8_t));
-         owns_compressed_encoded = true;
-         compressed_encoded_size_big = ZSTD_compress(compressed_encoded_data, compressed_encoded_size_big, encoded_data, encoded_size, 9);
-         if (ZSTD_isError(compressed_encoded_size_big))
+      case REPLAY_CHECKPOINT2_ENCODING_DELTA:
+         if (     codec->keyframe_pos < 0
+               || codec->keyframe_pos >= data_pos
+               || codec->keyframe_size != size
+               || !bsv_checkpoint_reserve(&codec->state,
+                     &codec->state_cap, size)
+               || !bsv_checkpoint_delta_decode(data, encoded_size,
+                     codec->keyframe, size, codec->keyframe_crc,
+                     codec->state))
          {
-            ret = false;
-            goto exit;
+            RARCH_WARN("[Replay] No keyframe for delta checkpoint\n");
+            return false;
          }
-         compressed_encoded_size = compressed_encoded_size_big;
+         state = codec->state;
          break;
-      }
-#endif
       default:
-         RARCH_WARN("[Replay] Unrecognized compression scheme %d\n", compression);
-         ret = false;
-         goto exit;
+         RARCH_WARN("[Replay] Unrecognized encoding scheme %d\n", encoding);
+         return false;
    }
-   /* uncompressed, unencoded size */
-   size_ = swap_if_big32(serial_info.size);
-   intfstream_write(handle->file, &size_, sizeof(uint32_t));
-   /* uncompressed, encoded size */
-   size_ = swap_if_big32(encoded_size);
-   intfstream_write(handle->file, &size_, sizeof(uint32_t));
-   /* compressed, encoded size */
-   size_ = swap_if_big32(compressed_encoded_size);
-   intfstream_write(handle->file, &size_, sizeof(uint32_t));
-   /* data */
-   intfstream_write(handle->file, compressed_encoded_data, compressed_encoded_size);
- exit:
-   if (encoded_data && owns_encoded)
-      free(encoded_data);
-   if (compressed_encoded_data && owns_compressed_encoded)
-      free(compressed_encoded_data);
-   return ret;
+
+   serial_info.data_const = state;
+   serial_info.size       = size;
+   return core_unserialize(&serial_info);
 }
 
 void bsv_movie_read_next_events(bsv_movie_t *handle)
@@ -6426,29 +7302,34 @@ void bsv_movie_next_frame(input_driver_state_t *input_st)
    if (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_RECORDING)
    {
       int i;
+      int64_t record_pos = 0;
       uint16_t evt_count = swap_if_big16(handle->input_event_count);
+      bool checkpoint    = (checkpoint_interval != 0)
+            && (handle->frame_counter > 0)
+            && (handle->frame_counter % (checkpoint_interval*60) == 0);
+      /* Write out the last checkpoint if it is compressed
+       * by now, or in any case before taking the next one */
+      bsv_movie_finish_checkpoint(handle, checkpoint);
+      if (checkpoint)
+         record_pos = intfstream_tell(handle->file);
       /* write key events, frame is over */
-      intfstream_write(handle->file, &(handle->key_event_count), 1);
+      bsv_movie_write(handle, &(handle->key_event_count), 1);
       for (i = 0; i < handle->key_event_count; i++)
-         intfstream_write(handle->file, &(handle->key_events[i]),
+         bsv_movie_write(handle, &(handle->key_events[i]),
                sizeof(bsv_key_data_t));
       /* Zero out key events when playing back or recording */
       handle->key_event_count = 0;
       /* write input events, frame is over */
-      intfstream_write(handle->file, &evt_count, 2);
+      bsv_movie_write(handle, &evt_count, 2);
       for (i = 0; i < handle->input_event_count; i++)
-         intfstream_write(handle->file, &(handle->input_events[i]),
+         bsv_movie_write(handle, &(handle->input_events[i]),
                sizeof(bsv_input_data_t));
       /* Zero out input events when playing back or recording */
       handle->input_event_count = 0;
 
       /* Maybe record checkpoint */
-      if (     (checkpoint_interval != 0)
-            && (handle->frame_counter > 0)
-            && (handle->frame_counter % (checkpoint_interval*60) == 0))
+      if (checkpoint)
       {
-         uint8_t frame_tok   = REPLAY_TOKEN_CHECKPOINT2_FRAME;
-         retro_ctx_serialize_info_t serial_info;
 #if defined(HAVE_ZSTD)
          uint8_t compression = REPLAY_CHECKPOINT2_COMPRESSION_ZSTD;
 #elif defined(HAVE_ZLIB)
@@ -6456,42 +7337,30 @@ void bsv_movie_next_frame(input_driver_state_t *input_st)
 #else
          uint8_t compression = REPLAY_CHECKPOINT2_COMPRESSION_NONE;
 #endif
-         uint8_t encoding    = REPLAY_CHECKPOINT2_ENCODING_RAW;
-         size_t _len         = core_serialize_size();
-         uint8_t *st         = (uint8_t*)malloc(_len);
-         serial_info.data    = st;
-         serial_info.size    = _len;
-         core_serialize(&serial_info);
-         /* "next frame is a checkpoint" */
-         intfstream_write(handle->file, (uint8_t *)(&frame_tok), sizeof(uint8_t));
-         /* compression and encoding schemes */
-         intfstream_write(handle->file, (uint8_t *)(&compression), sizeof(uint8_t));
-         intfstream_write(handle->file, (uint8_t *)(&encoding), sizeof(uint8_t));
-         if (!bsv_movie_write_checkpoint(handle, compression, encoding, serial_info))
-         {
-            RARCH_ERR("[Replay] failed to write checkpoint, exiting record\n");
-            input_st->bsv_movie_state.flags |= BSV_FLAG_MOVIE_END;
-         }
-         free(st);
+         /* "next frame is a checkpoint", written along with it */
+         bsv_movie_submit_checkpoint(handle, compression, record_pos);
       }
       else
       {
          uint8_t frame_tok = REPLAY_TOKEN_REGULAR_FRAME;
          /* write "next frame is not a checkpoint" */
-         intfstream_write(handle->file, (uint8_t *)(&frame_tok), sizeof(uint8_t));
+         bsv_movie_write(handle, &frame_tok, sizeof(uint8_t));
       }
    }
 
    if (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_PLAYBACK)
       bsv_movie_read_next_events(handle);
-   handle->frame_pos[handle->frame_counter & handle->frame_mask] = intfstream_tell(handle->file);
+   bsv_movie_set_frame_pos(handle);
 }
 
 size_t replay_get_serialize_size(void)
 {
    input_driver_state_t *input_st = &input_driver_st;
    if (input_st->bsv_movie_state.flags & (BSV_FLAG_MOVIE_RECORDING | BSV_FLAG_MOVIE_PLAYBACK))
+   {
+      bsv_movie_flush_checkpoint(input_st->bsv_movie_state_handle);
       return sizeof(uint32_t)+intfstream_tell(input_st->bsv_movie_state_handle->file);
+   }
    return 0;
 }
 
@@ -6506,6 +7375,7 @@ bool replay_get_serialized_data(void* buffer)
       int64_t read_amt        = 0;
       int32_t file_end_       = swap_if_big32(file_end);
       uint8_t *buf;
+      /* Already flushed by replay_get_serialize_size() */
       ((uint32_t *)buffer)[0] = file_end_;
       buf                     = ((uint8_t *)buffer) + sizeof(uint32_t);
       intfstream_rewind(handle->file);
@@ -6728,9 +7598,13 @@ bool replay_set_serialized_data(void* buf)
 
       if (ident == movie->identifier) /* is compatible? */
       {
-         int64_t _len       = (int64_t)swap_if_big32(((uint32_t *)buffer)[0]);
-         int64_t handle_idx = intfstream_tell(movie->file);
-         bool same_timeline = replay_check_same_timeline(movie, (uint8_t *)header, _len);
+         int64_t _len;
+         int64_t handle_idx;
+         bool same_timeline;
+         bsv_movie_flush_checkpoint(movie);
+         _len               = (int64_t)swap_if_big32(((uint32_t *)buffer)[0]);
+         handle_idx         = intfstream_tell(movie->file);
+         same_timeline      = replay_check_same_timeline(movie, (uint8_t *)header, _len);
          /* If the state is part of this replay, go back to that state
             and rewind/fast forward the replay.
 
@@ -6768,12 +7642,18 @@ bool replay_set_serialized_data(void* buf)
             }
             intfstream_rewind(movie->file);
             intfstream_write(movie->file, buffer+sizeof(int32_t), _len);
+            /* None of the old checkpoints can be trusted */
+            bsv_movie_truncate_checkpoints(movie, 0);
+            bsv_movie_scan_checkpoints(movie);
          }
          else
          {
             intfstream_seek(movie->file, _len, SEEK_SET);
             if (recording)
+            {
                intfstream_truncate(movie->file, _len);
+               bsv_movie_truncate_checkpoints(movie, _len);
+            }
          }
       }
       else
@@ -6820,6 +7700,19 @@ void input_driver_poll(void)
    bool input_remap_binds_enable  = settings->bools.input_remap_binds_enable;
    float input_axis_threshold     = settings->floats.input_axis_threshold;
    uint8_t max_users              = (uint8_t)settings->uints.input_max_users;
+   retro_time_t trace_start       = rarch_trace_begin();
+
+   /* Record the input queries of the last frame as one span */
+   if (input_st->state_query_start)
+   {
+      rarch_trace_record("input_state", input_st->state_query_start,
+            input_st->state_query_start + input_st->state_query_time);
+      input_st->state_query_start = 0;
+      input_st->state_query_time  = 0;
+   }
+
+   /* Core queries from now on need the new input */
+   input_st->poll_serial++;
 
    if (joypad && joypad->poll)
       joypad->poll();
@@ -6829,12 +7722,17 @@ void input_driver_poll(void)
          && input_st->current_driver->poll)
       input_st->current_driver->poll(input_st->current_data);
 
+#ifdef HAVE_GAME_AI
+   game_ai_poll();
+#endif
+
    input_st->turbo_btns.count++;
 
    if (input_st->flags & INP_FLAG_BLOCK_LIBRETRO_INPUT)
    {
       for (i = 0; i < max_users; i++)
          input_st->turbo_btns.frame_enable[i] = 0;
+      rarch_trace_end("input_poll", trace_start);
       return;
    }
 
@@ -7227,7 +8125,10 @@ void input_driver_poll(void)
 #else
             if (input_st->remote->net_fd[user] < 0)
 #endif
+            {
+               rarch_trace_end("input_poll", trace_start);
                return;
+            }
 
             FD_ZERO(&fds);
             FD_SET(input_st->remote->net_fd[user], &fds);
@@ -7278,6 +8179,8 @@ void input_driver_poll(void)
       }
    }
 #endif
+
+   rarch_trace_end("input_poll", trace_start);
 }
 
 int16_t input_driver_state_wrapper(unsigned port, unsigned device,
@@ -7287,6 +8190,7 @@ int16_t input_driver_state_wrapper(unsigned port, unsigned device,
       *input_st                = &input_driver_st;
    settings_t *settings        = config_get_ptr();
    int16_t result              = 0;
+   retro_time_t query_start    = rarch_trace_begin();
 #ifdef HAVE_BSV_MOVIE
    /* Load input from BSV record, if enabled */
    if (BSV_MOVIE_IS_PLAYBACK_ON())
@@ -7307,7 +8211,12 @@ int16_t input_driver_state_wrapper(unsigned port, unsigned device,
 #endif
 
    /* Read input state */
-   result = input_state_internal(input_st, settings, port, device, idx, id);
+   if (settings->bools.input_state_snapshot)
+      result = input_state_snapshot_get(input_st, settings,
+            port, device, idx, id);
+   else
+      result = input_state_internal(input_st, settings,
+            port, device, idx, id);
 
    /* Register any analog stick input requests for
     * this 'virtual' (core) port */
@@ -7338,6 +8247,16 @@ int16_t input_driver_state_wrapper(unsigned port, unsigned device,
       result |= game_ai_input(port, device, idx, id, result);
 #endif
 
+   /* Queries are far shorter than the timer resolution,
+    * but the sum over a frame still averages out */
+   if (query_start)
+   {
+      if (!input_st->state_query_start)
+         input_st->state_query_start = query_start;
+      input_st->state_query_time    += cpu_features_get_time_usec()
+         - query_start;
+   }
+
    return result;
 }
 
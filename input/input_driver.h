@@ -143,8 +143,14 @@
 #define REPLAY_CHECKPOINT2_COMPRESSION_ZSTD 2
 
 /* Which encoding to use.
-   RAW: Just raw checkpoint data, possibly compressed. */
-#define REPLAY_CHECKPOINT2_ENCODING_RAW 0
+   RAW: Just raw checkpoint data, possibly compressed.
+   DELTA: Changes against the keyframe, the closest preceding RAW
+          CHECKPOINT2 checkpoint, which has the same size. A 4-byte
+          block size and the 4-byte CRC32 of the keyframe, then one
+          bit per block (LSB first) set for blocks that differ, then
+          each of those blocks XORed with the keyframe's. */
+#define REPLAY_CHECKPOINT2_ENCODING_RAW   0
+#define REPLAY_CHECKPOINT2_ENCODING_DELTA 1
 
 /**
  * Takes as input analog key identifiers and converts them to corresponding
@@ -241,6 +247,22 @@ struct bsv_input_data
 };
 typedef struct bsv_input_data bsv_input_data_t;
 
+/* A checkpoint in a replay file */
+struct bsv_checkpoint
+{
+   /* Frame whose record holds the checkpoint */
+   uint64_t frame;
+   /* Start of that record */
+   int64_t record_pos;
+   /* Right after the record's frame token */
+   int64_t data_pos;
+   /* REPLAY_TOKEN_CHECKPOINT_FRAME or REPLAY_TOKEN_CHECKPOINT2_FRAME */
+   uint8_t token;
+   /* REPLAY_CHECKPOINT2_ENCODING_*; RAW for CHECKPOINT frames */
+   uint8_t encoding;
+};
+typedef struct bsv_checkpoint bsv_checkpoint_t;
+
 struct bsv_movie
 {
    intfstream_t *file;
@@ -256,6 +278,19 @@ struct bsv_movie
    size_t frame_mask;
    uint64_t frame_counter;
 
+   /* Every checkpoint of the file, in file order */
+   bsv_checkpoint_t *checkpoints;
+   size_t checkpoint_count;
+   size_t checkpoint_cap;
+   /* Checkpoint encoding and writer state */
+   struct bsv_checkpoint_codec *codec;
+   /* Where the checkpoint index is kept between runs */
+   char index_path[PATH_MAX_LENGTH];
+
+   /* Playback runs headless up to this frame while seeking */
+   uint64_t seek_frame;
+   bool seeking;
+
    /* Staging variables for events */
    uint8_t key_event_count;
    uint16_t input_event_count;
@@ -350,6 +385,25 @@ typedef struct input_remote_state
    int16_t analog[4][MAX_USERS];
 } input_remote_state_t;
 
+/* Results of core queries on one 'virtual' port,
+ * resolved at most once per input_driver_poll() */
+typedef struct input_state_snapshot
+{
+   /* Left X, Left Y, Right X, Right Y, then the analog
+    * buttons (RETRO_DEVICE_INDEX_ANALOG_BUTTON) */
+   int16_t analog[4 + RARCH_FIRST_CUSTOM_BIND];
+   /* X, Y, pressed and count of the first pointer */
+   int16_t pointer[4];
+   int16_t buttons;        /* RETRO_DEVICE_ID_JOYPAD_MASK */
+   /* Which fields are resolved; bit n of 'analog_valid'
+    * stands for analog[n] */
+   uint32_t analog_valid;
+   uint8_t pointer_valid;
+   bool buttons_valid;
+   /* Poll the fields were resolved for */
+   uint32_t serial;
+} input_state_snapshot_t;
+
 typedef struct input_list_element_t
 {
    int16_t *state;
@@ -551,6 +605,11 @@ typedef struct
     */
    rarch_timer_t combo_timers[INPUT_COMBO_LAST];
 
+   /* Time the core spent in input queries since the last
+    * poll, and when the first one started (benchmark) */
+   retro_time_t state_query_time;                        /* uint64_t alignment */
+   retro_time_t state_query_start;
+
 #if defined(HAVE_NETWORKING) && defined(HAVE_NETWORKGAMEPAD)
    input_remote_state_t remote_st_ptr;        /* uint64_t alignment */
 #endif
@@ -598,6 +657,9 @@ typedef struct
    turbo_buttons_t turbo_btns; /* int32_t alignment */
 
    input_mapper_t mapper;          /* uint32_t alignment */
+   input_state_snapshot_t snapshot[MAX_USERS]; /* uint32_t alignment */
+   /* Incremented by every poll, invalidating 'snapshot' */
+   uint32_t poll_serial;
    input_remap_cache_t remapping_cache;
    input_device_info_t input_device_info[MAX_INPUT_DEVICES]; /* unsigned alignment */
    input_mouse_info_t input_mouse_info[MAX_INPUT_DEVICES];
@@ -1084,6 +1146,27 @@ void bsv_movie_deinit(input_driver_state_t *input_st);
 void bsv_movie_deinit_full(input_driver_state_t *input_st);
 void bsv_movie_enqueue(input_driver_state_t *input_st, bsv_movie_t *state, enum bsv_flags flags);
 
+/* Writes out the checkpoint being compressed, if any.
+ * Must be called before using the file directly. */
+void bsv_movie_flush_checkpoint(bsv_movie_t *handle);
+/* Stops the checkpoint writer and frees its buffers */
+void bsv_movie_free_checkpoints(bsv_movie_t *handle);
+/* Drops checkpoints from 'pos' on after the file was
+ * truncated there */
+void bsv_movie_truncate_checkpoints(bsv_movie_t *handle, int64_t pos);
+/* Rebuilds the checkpoint index from the file */
+bool bsv_movie_scan_checkpoints(bsv_movie_t *handle);
+/* Positions playback on the last checkpoint at or before
+ * 'frame', which gets restored on the next frame. Sets
+ * 'checkpoint_frame' to the frame counter playback resumes
+ * from. */
+bool bsv_movie_seek_checkpoint(bsv_movie_t *handle, uint64_t frame,
+      uint64_t *checkpoint_frame);
+/* Seeks playback to 'frame': restores the closest checkpoint
+ * unless replaying from the current frame is quicker, then
+ * lets the runloop run the frames in between headless */
+bool bsv_movie_seek(bsv_movie_t *handle, uint64_t frame);
+
 bool movie_start_playback(input_driver_state_t *input_st, char *path);
 bool movie_start_record(input_driver_state_t *input_st, char *path);
 bool movie_stop_playback(input_driver_state_t *input_st);
@@ -23,6 +23,7 @@
 #include <retro_common_api.h>
 #include <retro_miscellaneous.h>
 #include <formats/image.h>
+#include <lists/box_grid.h>
 #include <queues/task_queue.h>
 
 #include "input_types.h"
@@ -255,6 +256,8 @@ struct overlay
 {
    struct overlay_desc *descs;
    struct texture_image *load_images;
+   /* Hitboxes of 'descs', rebuilt whenever they are scaled */
+   box_grid_t *hit_grid;
 
    struct texture_image image;
 
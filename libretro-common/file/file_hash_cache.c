@@ -0,0 +1,280 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (file_hash_cache.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <array/rhmap.h>
+#include <compat/strl.h>
+#include <file/file_hash_cache.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+/* Files stat'ed and hashed per tpool_run_batch() call */
+#define FILE_HASH_CACHE_BATCH 64
+
+typedef struct
+{
+   int64_t size;
+   int64_t mtime;
+   char    hash[FILE_HASH_CACHE_MAX_HASH + 1];
+   /* Looked up or inserted since loading */
+   bool    seen;
+} file_hash_cache_entry_t;
+
+struct file_hash_cache
+{
+   /* rhmap of path -> entry */
+   file_hash_cache_entry_t *entries;
+   size_t hash_len;
+};
+
+typedef struct
+{
+   const char *path;
+   char       *hash;
+   int64_t     size;
+   int64_t     mtime;
+   bool        has_stat;
+} file_hash_cache_job_t;
+
+typedef struct
+{
+   file_hash_cache_job_t *jobs;
+   file_hash_cache_hash_t hash_fn;
+} file_hash_cache_batch_t;
+
+file_hash_cache_t *file_hash_cache_new(size_t hash_len)
+{
+   file_hash_cache_t *cache = NULL;
+
+   if (!hash_len || hash_len > FILE_HASH_CACHE_MAX_HASH)
+      return NULL;
+   if (!(cache = (file_hash_cache_t*)calloc(1, sizeof(*cache))))
+      return NULL;
+
+   cache->hash_len = hash_len;
+   return cache;
+}
+
+void file_hash_cache_free(file_hash_cache_t *cache)
+{
+   if (!cache)
+      return;
+   RHMAP_FREE(cache->entries);
+   free(cache);
+}
+
+/* Parses a single 'hash size mtime path' line.
+ * Returns false if the line is malformed */
+static bool file_hash_cache_parse_line(const file_hash_cache_t *cache,
+      char *line, file_hash_cache_entry_t *entry, char **entry_path)
+{
+   char *tok = line;
+   char *end = strchr(tok, ' ');
+
+   if (!end || (size_t)(end - tok) != cache->hash_len)
+      return false;
+   memcpy(entry->hash, tok, cache->hash_len);
+   entry->hash[cache->hash_len] = '\0';
+   tok             = end + 1;
+
+   entry->size     = (int64_t)strtoull(tok, &end, 10);
+   if (end == tok || *end != ' ')
+      return false;
+   tok             = end + 1;
+
+   entry->mtime    = (int64_t)strtoull(tok, &end, 10);
+   if (end == tok || *end != ' ')
+      return false;
+   tok             = end + 1;
+
+   if (string_is_empty(tok))
+      return false;
+
+   entry->seen     = false;
+   *entry_path     = tok;
+   return true;
+}
+
+bool file_hash_cache_load(file_hash_cache_t *cache, const char *path)
+{
+   char  *line = NULL;
+   RFILE *file = NULL;
+
+   if (!cache || !(file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   while (     !filestream_eof(file)
+         && (line = filestream_getline(file)))
+   {
+      file_hash_cache_entry_t entry;
+      char *entry_path = NULL;
+
+      if (     *line != '#'
+            && file_hash_cache_parse_line(cache, line, &entry, &entry_path))
+         RHMAP_SET_STR(cache->entries, entry_path, entry);
+
+      free(line);
+   }
+
+   filestream_close(file);
+   return true;
+}
+
+bool file_hash_cache_save(file_hash_cache_t *cache, const char *path,
+      const char *header)
+{
+   size_t i, cap;
+   RFILE *file = NULL;
+
+   if (!cache || !(file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   if (header)
+      filestream_printf(file, "%s\n", header);
+
+   for (i = 0, cap = RHMAP_CAP(cache->entries); i != cap; i++)
+   {
+      const file_hash_cache_entry_t *entry = NULL;
+      if (!RHMAP_KEY(cache->entries, i))
+         continue;
+      entry = &cache->entries[i];
+      if (!entry->seen)
+         continue;
+      filestream_printf(file, "%s %" PRIu64 " %" PRIu64 " %s\n",
+            entry->hash,
+            (uint64_t)entry->size,
+            (uint64_t)entry->mtime,
+            RHMAP_KEY_STR(cache->entries, i));
+   }
+
+   return filestream_close(file) == 0;
+}
+
+const char *file_hash_cache_lookup(file_hash_cache_t *cache,
+      const char *path, int64_t size, int64_t mtime)
+{
+   ptrdiff_t idx;
+   file_hash_cache_entry_t *entry = NULL;
+
+   if (!cache || (idx = RHMAP_IDX_STR(cache->entries, path)) < 0)
+      return NULL;
+
+   entry = &cache->entries[idx];
+   if (entry->size != size || entry->mtime != mtime)
+      return NULL;
+
+   entry->seen = true;
+   return entry->hash;
+}
+
+bool file_hash_cache_insert(file_hash_cache_t *cache, const char *path,
+      int64_t size, int64_t mtime, const char *hash)
+{
+   file_hash_cache_entry_t entry;
+
+   if (     !cache
+         || string_is_empty(path)
+         || !hash
+         || strlen(hash) != cache->hash_len)
+      return false;
+
+   entry.size  = size;
+   entry.mtime = mtime;
+   entry.seen  = true;
+   strlcpy(entry.hash, hash, sizeof(entry.hash));
+
+   RHMAP_SET_STR(cache->entries, path, entry);
+   return true;
+}
+
+static void file_hash_cache_worker(void *arg, unsigned index)
+{
+   file_hash_cache_batch_t *batch = (file_hash_cache_batch_t*)arg;
+   file_hash_cache_job_t   *job   = &batch->jobs[index];
+
+   job->hash = batch->hash_fn(job->path);
+}
+
+size_t file_hash_cache_fill(file_hash_cache_t *cache, tpool_t *pool,
+      file_hash_cache_hash_t hash_fn, const char **paths, char **hashes,
+      size_t count)
+{
+   size_t                  i = 0;
+   size_t                  misses = 0;
+   file_hash_cache_job_t   jobs[FILE_HASH_CACHE_BATCH];
+   size_t                  job_idx[FILE_HASH_CACHE_BATCH];
+   file_hash_cache_batch_t batch;
+
+   batch.jobs    = jobs;
+   batch.hash_fn = hash_fn;
+
+   while (i < count)
+   {
+      size_t   j;
+      unsigned num_jobs = 0;
+
+      /* Cache hits are filled in right away, the others
+       * are queued until the batch is full */
+      for (; i < count && num_jobs < FILE_HASH_CACHE_BATCH; i++)
+      {
+         const char            *hash = NULL;
+         file_hash_cache_job_t *job  = &jobs[num_jobs];
+
+         job->path     = paths[i];
+         job->hash     = NULL;
+         job->has_stat = path_get_size_mtime(paths[i],
+               &job->size, &job->mtime);
+
+         if (     job->has_stat
+               && (hash = file_hash_cache_lookup(cache, paths[i],
+                     job->size, job->mtime)))
+         {
+            hashes[i] = strdup(hash);
+            continue;
+         }
+
+         job_idx[num_jobs++] = i;
+      }
+
+      if (!num_jobs)
+         continue;
+
+      /* Runs on the calling thread alone if the pool is missing */
+      tpool_run_batch(pool, file_hash_cache_worker, &batch, num_jobs);
+      misses += num_jobs;
+
+      for (j = 0; j < num_jobs; j++)
+      {
+         hashes[job_idx[j]] = jobs[j].hash;
+         if (jobs[j].hash && jobs[j].has_stat)
+            file_hash_cache_insert(cache, jobs[j].path,
+                  jobs[j].size, jobs[j].mtime, jobs[j].hash);
+      }
+   }
+
+   return misses;
+}
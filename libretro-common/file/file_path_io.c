@@ -44,6 +44,7 @@ struct tm { unsigned int time; };
 
 #ifdef _WIN32
 #include <direct.h>
+#include <encodings/utf.h>
 #else
 #include <unistd.h> /* stat() is defined here */
 #endif
@@ -104,6 +105,68 @@ int32_t path_get_size(const char *path)
    return -1;
 }
 
+/**
+ * path_get_size_mtime:
+ * @path               : path
+ * @size               : returned file size in bytes
+ * @mtime              : returned modification time
+ *
+ * Queries size and last modification time of a file
+ * with a single stat() call. Unlike path_get_size(),
+ * the size is not truncated to 32 bits. Intended for
+ * cache validation, so the modification time is only
+ * meaningful when compared against another value
+ * returned by this function.
+ *
+ * @return true on success, false if the file does not
+ * exist or the platform provides no modification time.
+ **/
+bool path_get_size_mtime(const char *path, int64_t *size, int64_t *mtime)
+{
+#if defined(PSX) || defined(VITA) || defined(__PSL1GHT__) || defined(__PS3__) || defined(_XBOX)
+   return false;
+#else
+#if defined(_WIN32) && !defined(LEGACY_WIN32)
+   struct _stat64 stat_buf;
+   wchar_t *path_wide = NULL;
+#elif defined(_WIN32)
+   struct _stat stat_buf;
+   char *path_local   = NULL;
+#else
+   struct stat stat_buf;
+#endif
+   int ret            = -1;
+
+   if (!path || !*path)
+      return false;
+
+#if defined(_WIN32) && !defined(LEGACY_WIN32)
+   if ((path_wide = utf8_to_utf16_string_alloc(path)))
+   {
+      ret = _wstat64(path_wide, &stat_buf);
+      free(path_wide);
+   }
+#elif defined(_WIN32)
+   if ((path_local = utf8_to_local_string_alloc(path)))
+   {
+      ret = _stat(path_local, &stat_buf);
+      free(path_local);
+   }
+#else
+   ret = stat(path, &stat_buf);
+#endif
+
+   if (ret != 0)
+      return false;
+
+   if (size)
+      *size  = (int64_t)stat_buf.st_size;
+   if (mtime)
+      *mtime = (int64_t)stat_buf.st_mtime;
+   return true;
+#endif
+}
+
 /**
  * path_mkdir:
  * @dir                : directory
@@ -39,6 +39,13 @@
 
 #include "rpng_internal.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RPNG_NEON
+#endif
+
 enum png_ihdr_color_type
 {
    PNG_IHDR_COLOR_GRAY       = 0,
@@ -254,11 +261,29 @@ static void rpng_reverse_filter_copy_line_rgb(uint32_t *data,
 static void rpng_reverse_filter_copy_line_rgba(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
-   int i;
+   int i = 0;
 
    bpp /= 8;
 
-   for (i = 0; i < (int)width; i++)
+#if defined(__SSE2__)
+   /* 8-bit RGBA in memory is ABGR as a little-endian
+    * word; swap R and B to get ARGB */
+   if (bpp == 1)
+   {
+      const __m128i rb_mask = _mm_set1_epi32(0x00ff00ff);
+      for (; i + 4 <= (int)width; i += 4, decoded += 16)
+      {
+         __m128i px = _mm_loadu_si128((const __m128i*)decoded);
+         __m128i rb = _mm_and_si128(px, rb_mask);
+         __m128i ga = _mm_andnot_si128(rb_mask, px);
+         rb         = _mm_or_si128(_mm_slli_epi32(rb, 16),
+               _mm_srli_epi32(rb, 16));
+         _mm_storeu_si128((__m128i*)(data + i), _mm_or_si128(ga, rb));
+      }
+   }
+#endif
+
+   for (; i < (int)width; i++)
    {
       uint32_t r, g, b, a;
       r        = *decoded;
@@ -480,6 +505,207 @@ static void rpng_reverse_filter_adam7_deinterlace_pass(uint32_t *data,
    }
 }
 
+/* Unfiltering.
+ *
+ * Sub, average and Paeth depend on the pixel to the left,
+ * so the SIMD versions still go one pixel at a time, but
+ * handle all channels of a 3 or 4 byte pixel at once. A 3
+ * byte pixel is loaded as 4 bytes while at least 4 are
+ * left in the line, and stored as 3. */
+
+#if defined(__SSE2__)
+static INLINE __m128i rpng_load_pixel(const uint8_t *p, unsigned n)
+{
+   int32_t v = 0;
+   memcpy(&v, p, n);
+   return _mm_cvtsi32_si128(v);
+}
+
+static INLINE void rpng_store_pixel(uint8_t *p, __m128i v, unsigned n)
+{
+   int32_t t = _mm_cvtsi128_si32(v);
+   memcpy(p, &t, n);
+}
+
+static INLINE __m128i rpng_abs_epi16(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static INLINE __m128i rpng_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#elif defined(RPNG_NEON)
+static INLINE uint8x8_t rpng_load_pixel(const uint8_t *p, unsigned n)
+{
+   uint32_t v = 0;
+   memcpy(&v, p, n);
+   return vreinterpret_u8_u32(vdup_n_u32(v));
+}
+
+static INLINE void rpng_store_pixel(uint8_t *p, uint8x8_t v, unsigned n)
+{
+   uint32_t t = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+   memcpy(p, &t, n);
+}
+#endif
+
+static void rpng_unfilter_sub(uint8_t *line, unsigned pitch, unsigned bpp)
+{
+   unsigned i = bpp;
+#if defined(__SSE2__) || defined(RPNG_NEON)
+   if (bpp == 3 || bpp == 4)
+   {
+#if defined(__SSE2__)
+      __m128i a = _mm_setzero_si128();
+#else
+      uint8x8_t a = vdup_n_u8(0);
+#endif
+      for (i = 0; i < pitch; i += bpp)
+      {
+         unsigned n = (pitch - i < 4) ? bpp : 4;
+#if defined(__SSE2__)
+         a = _mm_add_epi8(rpng_load_pixel(line + i, n), a);
+#else
+         a = vadd_u8(rpng_load_pixel(line + i, n), a);
+#endif
+         rpng_store_pixel(line + i, a, bpp);
+      }
+      return;
+   }
+#endif
+   for (; i < pitch; i++)
+      line[i] += line[i - bpp];
+}
+
+static void rpng_unfilter_up(uint8_t *line, const uint8_t *prev,
+      unsigned pitch)
+{
+   unsigned i = 0;
+#if defined(__SSE2__)
+   for (; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(line + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= pitch; i += 16)
+      vst1q_u8(line + i, vaddq_u8(vld1q_u8(line + i), vld1q_u8(prev + i)));
+#endif
+   for (; i < pitch; i++)
+      line[i] += prev[i];
+}
+
+static void rpng_unfilter_avg(uint8_t *line, const uint8_t *prev,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+#if defined(__SSE2__) || defined(RPNG_NEON)
+   if (bpp == 3 || bpp == 4)
+   {
+#if defined(__SSE2__)
+      const __m128i one = _mm_set1_epi8(1);
+      __m128i a         = _mm_setzero_si128();
+#else
+      uint8x8_t a       = vdup_n_u8(0);
+#endif
+      for (i = 0; i < pitch; i += bpp)
+      {
+         unsigned n = (pitch - i < 4) ? bpp : 4;
+#if defined(__SSE2__)
+         __m128i b   = rpng_load_pixel(prev + i, n);
+         /* _mm_avg_epu8 rounds up, PNG rounds down */
+         __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+               _mm_and_si128(_mm_xor_si128(a, b), one));
+         a           = _mm_add_epi8(rpng_load_pixel(line + i, n), avg);
+#else
+         uint8x8_t b = rpng_load_pixel(prev + i, n);
+         a           = vadd_u8(rpng_load_pixel(line + i, n), vhadd_u8(a, b));
+#endif
+         rpng_store_pixel(line + i, a, bpp);
+      }
+      return;
+   }
+#endif
+   for (i = 0; i < bpp; i++)
+      line[i] += prev[i] >> 1;
+   for (i = bpp; i < pitch; i++)
+      line[i] += (line[i - bpp] + prev[i]) >> 1;
+}
+
+static void rpng_unfilter_paeth(uint8_t *line, const uint8_t *prev,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+#if defined(__SSE2__)
+   if (bpp == 3 || bpp == 4)
+   {
+      /* a: left, b: above, c: above left; as 16-bit lanes */
+      const __m128i zero = _mm_setzero_si128();
+      __m128i a          = zero;
+      __m128i c          = zero;
+      for (i = 0; i < pitch; i += bpp)
+      {
+         __m128i pa, pb, pc, smallest, nearest;
+         unsigned n = (pitch - i < 4) ? bpp : 4;
+         __m128i b  = _mm_unpacklo_epi8(rpng_load_pixel(prev + i, n), zero);
+         __m128i d  = rpng_load_pixel(line + i, n);
+
+         /* With p = a + b - c: |p - a| = |b - c|,
+          * |p - b| = |a - c|, |p - c| = |a - c + b - c| */
+         pa         = _mm_sub_epi16(b, c);
+         pb         = _mm_sub_epi16(a, c);
+         pc         = _mm_add_epi16(pa, pb);
+         pa         = rpng_abs_epi16(pa);
+         pb         = rpng_abs_epi16(pb);
+         pc         = rpng_abs_epi16(pc);
+         smallest   = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+         nearest    = rpng_select(_mm_cmpeq_epi16(smallest, pa), a,
+               rpng_select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+         d          = _mm_add_epi8(d, _mm_packus_epi16(nearest, nearest));
+         rpng_store_pixel(line + i, d, bpp);
+         a          = _mm_unpacklo_epi8(d, zero);
+         c          = b;
+      }
+      return;
+   }
+#elif defined(RPNG_NEON)
+   if (bpp == 3 || bpp == 4)
+   {
+      int16x8_t a = vdupq_n_s16(0);
+      int16x8_t c = vdupq_n_s16(0);
+      for (i = 0; i < pitch; i += bpp)
+      {
+         int16x8_t pa, pb, pc, smallest, nearest;
+         unsigned n  = (pitch - i < 4) ? bpp : 4;
+         int16x8_t b = vreinterpretq_s16_u16(
+               vmovl_u8(rpng_load_pixel(prev + i, n)));
+         uint8x8_t d = rpng_load_pixel(line + i, n);
+
+         pa          = vsubq_s16(b, c);
+         pb          = vsubq_s16(a, c);
+         pc          = vabsq_s16(vaddq_s16(pa, pb));
+         pa          = vabsq_s16(pa);
+         pb          = vabsq_s16(pb);
+         smallest    = vminq_s16(pc, vminq_s16(pa, pb));
+         nearest     = vbslq_s16(vceqq_s16(smallest, pa), a,
+               vbslq_s16(vceqq_s16(smallest, pb), b, c));
+
+         d           = vadd_u8(d, vmovn_u16(vreinterpretq_u16_s16(nearest)));
+         rpng_store_pixel(line + i, d, bpp);
+         a           = vreinterpretq_s16_u16(vmovl_u8(d));
+         c           = b;
+      }
+      return;
+   }
+#endif
+   for (i = 0; i < bpp; i++)
+      line[i] += prev[i];
+   for (i = bpp; i < pitch; i++)
+      line[i] += paeth(line[i - bpp], prev[i], prev[i - bpp]);
+}
+
 static void rpng_reverse_filter_deinit(struct rpng_process *pngp)
 {
    if (!pngp)
@@ -566,46 +792,32 @@ static int rpng_reverse_filter_copy_line(uint32_t *data,
       const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
-   unsigned i;
+   uint8_t *tmp;
+
+   if (filter > PNG_FILTER_PAETH)
+      return IMAGE_PROCESS_ERROR_END;
+
+   memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
 
    switch (filter)
    {
-      case PNG_FILTER_NONE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         break;
       case PNG_FILTER_SUB:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += pngp->decoded_scanline[i - pngp->bpp];
+         rpng_unfilter_sub(pngp->decoded_scanline, pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_UP:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += pngp->prev_scanline[i];
+         rpng_unfilter_up(pngp->decoded_scanline, pngp->prev_scanline,
+               pngp->pitch);
          break;
       case PNG_FILTER_AVERAGE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] += avg;
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-         {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] += avg;
-         }
+         rpng_unfilter_avg(pngp->decoded_scanline, pngp->prev_scanline,
+               pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_PAETH:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] += pngp->prev_scanline[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] += paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]);
+         rpng_unfilter_paeth(pngp->decoded_scanline, pngp->prev_scanline,
+               pngp->pitch, pngp->bpp);
          break;
       default:
-         return IMAGE_PROCESS_ERROR_END;
+         break;
    }
 
    switch (ihdr->color_type)
@@ -630,7 +842,10 @@ static int rpng_reverse_filter_copy_line(uint32_t *data,
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+   /* This line is the next one's previous line */
+   tmp                    = pngp->prev_scanline;
+   pngp->prev_scanline    = pngp->decoded_scanline;
+   pngp->decoded_scanline = tmp;
 
    return IMAGE_PROCESS_NEXT;
 }
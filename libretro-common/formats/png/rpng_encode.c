@@ -21,14 +21,22 @@
  */
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <zlib.h>
+
 #include <libretro.h>
 #include <encodings/crc32.h>
 #include <streams/interface_stream.h>
 #include <streams/trans_stream.h>
 
+#ifdef HAVE_THREADS
+#include <features/features_cpu.h>
+#include <rthreads/tpool.h>
+#endif
+
 #include "rpng_internal.h"
 
 #undef GOTO_END_ERROR
@@ -202,67 +210,89 @@ static unsigned filter_paeth(uint8_t *target,
    return count_sad(target, width);
 }
 
-bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
-      unsigned width, unsigned height, signed pitch, unsigned bpp)
-{
-   unsigned h;
-   struct png_ihdr ihdr = {0};
-   bool ret = true;
-   const struct trans_stream_backend *stream_backend = NULL;
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   uint32_t total_in       = 0;
-   uint32_t total_out      = 0;
-
-   if (!intf_s)
-      GOTO_END_ERROR();
-
-   stream_backend = trans_stream_get_zlib_deflate_backend();
-
-   if (intfstream_write(intf_s, png_magic, sizeof(png_magic)) != sizeof(png_magic))
-      GOTO_END_ERROR();
-
-   ihdr.width = width;
-   ihdr.height = height;
-   ihdr.depth = 8;
-   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
-   if (!png_write_ihdr_string(intf_s, &ihdr))
-      GOTO_END_ERROR();
-
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf      = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
-
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+/* Rows are filtered and compressed in strips, each as a
+ * separate raw deflate stream. All but the last strip end
+ * with a sync flush, so they can be concatenated into one
+ * zlib stream. Strips are independent, which lets them be
+ * encoded in parallel at a small cost in compression. */
+#define RPNG_ENCODE_MIN_STRIP_ROWS 32
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
+struct rpng_encode_strip
+{
+   uint8_t *out;
+   size_t out_size;
+   uint32_t adler;
+   unsigned first_row;
+   unsigned num_rows;
+   bool ok;
+};
+
+struct rpng_encode_job
+{
+   const uint8_t *data;
+   uint8_t *encode_buf;
+   struct rpng_encode_strip *strips;
+   const struct trans_stream_backend *stream_backend;
+   signed pitch;
+   unsigned width;
+   unsigned bpp;
+   unsigned num_strips;
+};
+
+static void rpng_encode_copy_line(uint8_t *dst, const uint8_t *src,
+      unsigned width, unsigned bpp)
+{
+   if (bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, width);
+   else
+      copy_bgr24_line(dst, src, width);
+}
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+static void rpng_encode_strip(struct rpng_encode_job *job, unsigned index)
+{
+   unsigned h;
+   uint32_t total_in, total_out;
+   enum trans_stream_error err;
+   struct rpng_encode_strip *strip = &job->strips[index];
+   bool last                       = (index == job->num_strips - 1);
+   unsigned width                  = job->width;
+   unsigned bpp                    = job->bpp;
+   size_t line_size                = (size_t)width * bpp;
+   size_t in_size                  = (line_size + 1) * strip->num_rows;
+   uint8_t *encode_start           = job->encode_buf
+      + (line_size + 1) * strip->first_row;
+   uint8_t *encode_target          = encode_start;
+   const uint8_t *data             = job->data
+      + (ptrdiff_t)job->pitch * strip->first_row;
+   const struct trans_stream_backend
+      *stream_backend              = job->stream_backend;
+   void *stream                    = NULL;
+   uint8_t *lines                  = (uint8_t*)malloc(line_size * 6);
+   uint8_t *rgba_line              = lines;
+   uint8_t *prev_encoded           = lines + line_size;
+   uint8_t *up_filtered            = lines + line_size * 2;
+   uint8_t *sub_filtered           = lines + line_size * 3;
+   uint8_t *avg_filtered           = lines + line_size * 4;
+   uint8_t *paeth_filtered         = lines + line_size * 5;
+
+   strip->ok                       = false;
+
+   if (!lines)
+      return;
+
+   /* Filters look at the row above, which may belong
+    * to the previous strip */
+   if (strip->first_row == 0)
+      memset(prev_encoded, 0, line_size);
+   else
+      rpng_encode_copy_line(prev_encoded, data - job->pitch, width, bpp);
+
+   for (h = 0; h < strip->num_rows;
+         h++, encode_target += line_size, data += job->pitch)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
+      uint8_t *tmp;
+
+      rpng_encode_copy_line(rgba_line, data, width, bpp);
 
       /* Try every filtering method, and choose the method
        * which has most entries as zero.
@@ -309,58 +339,174 @@ bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
          }
 
          *encode_target++ = filter;
-         memcpy(encode_target, chosen_filtered, width * bpp);
-
-         memcpy(prev_encoded, rgba_line, width * bpp);
+         memcpy(encode_target, chosen_filtered, line_size);
       }
+
+      tmp          = prev_encoded;
+      prev_encoded = rgba_line;
+      rgba_line    = tmp;
    }
 
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
+   free(lines);
+
+   strip->adler    = (uint32_t)adler32(1, encode_start, (uInt)in_size);
+   /* Stored blocks take 5 bytes per 64 KB at worst */
+   strip->out_size = in_size + (in_size >> 3) + 64;
+   if (!(strip->out = (uint8_t*)malloc(strip->out_size)))
+      return;
+
+   if (!(stream = stream_backend->stream_new()))
+      return;
+
+   stream_backend->define(stream, "window_bits", (uint32_t)-15);
+   stream_backend->define(stream, "sync_flush", 1);
+   stream_backend->set_in(stream, encode_start, (uint32_t)in_size);
+   stream_backend->set_out(stream, strip->out, (uint32_t)strip->out_size);
+
+   /* The last strip must also have written all of its output */
+   if (     stream_backend->trans(stream, last, &total_in, &total_out, &err)
+         && (total_in == in_size)
+         && (!last || err == TRANS_STREAM_ERROR_NONE))
+   {
+      strip->out_size = total_out;
+      strip->ok       = true;
+   }
+
+   stream_backend->stream_free(stream);
+}
+
+#ifdef HAVE_THREADS
+static void rpng_encode_strip_cb(void *arg, unsigned index)
+{
+   rpng_encode_strip((struct rpng_encode_job*)arg, index);
+}
+#endif
+
+bool rpng_save_image_stream(const uint8_t *data, intfstream_t* intf_s,
+      unsigned width, unsigned height, signed pitch, unsigned bpp)
+{
+   unsigned i;
+   struct rpng_encode_job job;
+   struct png_ihdr ihdr    = {0};
+   bool ret                = true;
+   unsigned num_threads    = 1;
+   unsigned strip_rows     = height;
+   size_t deflate_size     = 0;
+   uint8_t *encode_buf     = NULL;
+   uint8_t *deflate_buf    = NULL;
+   uint8_t *deflate_target = NULL;
+   uint32_t adler          = 1;
+
+   job.strips              = NULL;
+   job.num_strips          = 0;
+
+   if (!intf_s || !width || !height)
       GOTO_END_ERROR();
 
-   stream = stream_backend->stream_new();
+   if (intfstream_write(intf_s, png_magic, sizeof(png_magic)) != sizeof(png_magic))
+      GOTO_END_ERROR();
 
-   if (!stream)
+   ihdr.width = width;
+   ihdr.height = height;
+   ihdr.depth = 8;
+   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
+   if (!png_write_ihdr_string(intf_s, &ihdr))
       GOTO_END_ERROR();
 
-   stream_backend->set_in(
-         stream,
-         encode_buf,
-         (unsigned)encode_buf_size);
-   stream_backend->set_out(
-         stream,
-         deflate_buf + 8,
-         (unsigned)(encode_buf_size * 2));
+   encode_buf      = (uint8_t*)malloc((width * bpp + 1) * height);
+   if (!encode_buf)
+      GOTO_END_ERROR();
 
-   if (!stream_backend->trans(stream, true, &total_in, &total_out, NULL))
+#ifdef HAVE_THREADS
+   /* A few strips per thread, so that uneven strips
+    * still keep every thread busy */
+   num_threads = cpu_features_get_core_amount();
+   if (num_threads > 1)
+   {
+      strip_rows = (height + num_threads * 4 - 1) / (num_threads * 4);
+      if (strip_rows < RPNG_ENCODE_MIN_STRIP_ROWS)
+         strip_rows = RPNG_ENCODE_MIN_STRIP_ROWS;
+   }
+#endif
+
+   job.data           = data;
+   job.encode_buf     = encode_buf;
+   job.stream_backend = trans_stream_get_zlib_deflate_backend();
+   job.pitch          = pitch;
+   job.width          = width;
+   job.bpp            = bpp;
+   job.num_strips     = (height + strip_rows - 1) / strip_rows;
+   job.strips         = (struct rpng_encode_strip*)calloc(
+         job.num_strips, sizeof(*job.strips));
+   if (!job.stream_backend || !job.strips)
       GOTO_END_ERROR();
 
+   for (i = 0; i < job.num_strips; i++)
+   {
+      job.strips[i].first_row = i * strip_rows;
+      job.strips[i].num_rows  = (i == job.num_strips - 1)
+         ? height - i * strip_rows : strip_rows;
+   }
+
+#ifdef HAVE_THREADS
+   if (job.num_strips > 1)
+   {
+      tpool_t *pool = tpool_create(num_threads - 1);
+      if (pool)
+      {
+         tpool_run_batch(pool, rpng_encode_strip_cb, &job, job.num_strips);
+         tpool_destroy(pool);
+      }
+      else
+         for (i = 0; i < job.num_strips; i++)
+            rpng_encode_strip(&job, i);
+   }
+   else
+#endif
+      rpng_encode_strip(&job, 0);
+
+   for (i = 0; i < job.num_strips; i++)
+   {
+      struct rpng_encode_strip *strip = &job.strips[i];
+      if (!strip->ok)
+         GOTO_END_ERROR();
+      deflate_size += strip->out_size;
+      adler         = (uint32_t)adler32_combine(adler, strip->adler,
+            (z_off_t)(width * bpp + 1) * strip->num_rows);
+   }
+
+   /* Chunk header, zlib header, strips, Adler-32 */
+   deflate_size  += 2 + 4;
+   if (!(deflate_buf = (uint8_t*)malloc(8 + deflate_size)))
+      GOTO_END_ERROR();
+
+   dword_write_be(deflate_buf + 0, (uint32_t)deflate_size);
    memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0,        ((uint32_t)total_out));
-   if (!png_write_idat_string(intf_s, deflate_buf, ((size_t)total_out + 8)))
+   deflate_target    = deflate_buf + 8;
+   /* Deflate, 32K window, maximum compression */
+   *deflate_target++ = 0x78;
+   *deflate_target++ = 0xDA;
+   for (i = 0; i < job.num_strips; i++)
+   {
+      memcpy(deflate_target, job.strips[i].out, job.strips[i].out_size);
+      deflate_target += job.strips[i].out_size;
+   }
+   dword_write_be(deflate_target, adler);
+
+   if (!png_write_idat_string(intf_s, deflate_buf, 8 + deflate_size))
       GOTO_END_ERROR();
 
    if (!png_write_iend_string(intf_s))
       GOTO_END_ERROR();
 end:
-   free(encode_buf);
-   free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
-
-   if (stream_backend)
+   if (job.strips)
    {
-      if (stream)
-      {
-         if (stream_backend->stream_free)
-            stream_backend->stream_free(stream);
-      }
+      for (i = 0; i < job.num_strips; i++)
+         free(job.strips[i].out);
+      free(job.strips);
    }
+   free(encode_buf);
+   free(deflate_buf);
    return ret;
 }
 
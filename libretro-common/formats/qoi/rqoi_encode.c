@@ -0,0 +1,165 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rqoi_encode.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <streams/file_stream.h>
+#include <formats/rqoi.h>
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+
+#define QOI_HEADER_SIZE 14
+#define QOI_MAX_RUN     62
+
+static const uint8_t qoi_padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+static void qoi_write_32(uint8_t *buf, uint32_t val)
+{
+   buf[0] = (uint8_t)(val >> 24);
+   buf[1] = (uint8_t)(val >> 16);
+   buf[2] = (uint8_t)(val >>  8);
+   buf[3] = (uint8_t)(val >>  0);
+}
+
+uint8_t *rqoi_save_image_bgr24_string(const uint8_t *data,
+      unsigned width, unsigned height, signed pitch, uint64_t *bytes)
+{
+   unsigned x, y;
+   uint32_t index[64];
+   uint8_t *out, *buf;
+   unsigned run  = 0;
+   /* Opaque black, as the decoder assumes */
+   uint32_t prev = 0xff000000;
+   /* RGB ops are the largest, at 4 bytes per pixel */
+   size_t _len   = QOI_HEADER_SIZE + (size_t)width * height * 4
+      + sizeof(qoi_padding);
+
+   if (!data || !width || !height)
+      return NULL;
+   if (!(buf = (uint8_t*)malloc(_len)))
+      return NULL;
+
+   memset(index, 0, sizeof(index));
+
+   out    = buf;
+   memcpy(out, "qoif", 4);
+   qoi_write_32(out + 4, width);
+   qoi_write_32(out + 8, height);
+   out[12] = 3; /* RGB */
+   out[13] = 0; /* sRGB with linear alpha */
+   out    += QOI_HEADER_SIZE;
+
+   for (y = 0; y < height; y++, data += pitch)
+   {
+      const uint8_t *src = data;
+      for (x = 0; x < width; x++, src += 3)
+      {
+         uint8_t b   = src[0];
+         uint8_t g   = src[1];
+         uint8_t r   = src[2];
+         uint32_t px = 0xff000000 | (r << 16) | (g << 8) | b;
+         unsigned hash;
+
+         if (px == prev)
+         {
+            if (++run == QOI_MAX_RUN)
+            {
+               *out++ = QOI_OP_RUN | (run - 1);
+               run    = 0;
+            }
+            continue;
+         }
+
+         if (run > 0)
+         {
+            *out++ = QOI_OP_RUN | (run - 1);
+            run    = 0;
+         }
+
+         hash = (r * 3 + g * 5 + b * 7 + 255 * 11) & 63;
+         if (index[hash] == px)
+            *out++ = QOI_OP_INDEX | hash;
+         else
+         {
+            int8_t vr   = (int8_t)(r - (uint8_t)(prev >> 16));
+            int8_t vg   = (int8_t)(g - (uint8_t)(prev >>  8));
+            int8_t vb   = (int8_t)(b - (uint8_t)(prev >>  0));
+            int8_t vg_r = (int8_t)(vr - vg);
+            int8_t vg_b = (int8_t)(vb - vg);
+
+            index[hash] = px;
+
+            if (     vr > -3 && vr < 2
+                  && vg > -3 && vg < 2
+                  && vb > -3 && vb < 2)
+               *out++ = QOI_OP_DIFF
+                  | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2);
+            else if (   vg_r >  -9 && vg_r <  8
+                     && vg   > -33 && vg   < 32
+                     && vg_b >  -9 && vg_b <  8)
+            {
+               *out++ = QOI_OP_LUMA | (vg + 32);
+               *out++ = ((vg_r + 8) << 4) | (vg_b + 8);
+            }
+            else
+            {
+               *out++ = QOI_OP_RGB;
+               *out++ = r;
+               *out++ = g;
+               *out++ = b;
+            }
+         }
+
+         prev = px;
+      }
+   }
+
+   if (run > 0)
+      *out++ = QOI_OP_RUN | (run - 1);
+
+   memcpy(out, qoi_padding, sizeof(qoi_padding));
+   out   += sizeof(qoi_padding);
+
+   *bytes = (uint64_t)(out - buf);
+   return buf;
+}
+
+bool rqoi_save_image_bgr24(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   bool ret       = false;
+   uint64_t bytes = 0;
+   uint8_t *buf   = rqoi_save_image_bgr24_string(data,
+         width, height, (signed)pitch, &bytes);
+
+   if (!buf)
+      return false;
+
+   ret = filestream_write_file(path, buf, (int64_t)bytes);
+   free(buf);
+   return ret;
+}
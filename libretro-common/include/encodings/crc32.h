@@ -40,6 +40,21 @@ RETRO_BEGIN_DECLS
  */
 uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len);
 
+/**
+ * Combines the CRC32 checksums of two consecutive blocks of data.
+ *
+ * Lets a large buffer be hashed as independent chunks, for example
+ * on several threads, with the chunk checksums merged in order
+ * afterwards.
+ *
+ * @param crc1 The CRC32 checksum of the first block.
+ * @param crc2 The CRC32 checksum of the second block,
+ * computed with an initial value of 0.
+ * @param len2 The length of the second block, in bytes.
+ * @return The CRC32 checksum of both blocks concatenated.
+ */
+uint32_t encoding_crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
 RETRO_END_DECLS
 
 #endif
@@ -0,0 +1,148 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (file_hash_cache.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_FILE_HASH_CACHE_H
+#define __LIBRETRO_SDK_FILE_HASH_CACHE_H
+
+#include <retro_common_api.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <boolean.h>
+
+#include <rthreads/tpool.h>
+
+RETRO_BEGIN_DECLS
+
+/* Longest hex digest a cache can hold, e.g. SHA-256 */
+#define FILE_HASH_CACHE_MAX_HASH 64
+
+/**
+ * Remembers the hash of files by path, along with the
+ * size and modification time they had when hashed, so a
+ * file is only read again once either changes. The cache
+ * is stored as text, one 'hash size mtime path' line per
+ * file. Not thread safe; callers serialise access.
+ */
+typedef struct file_hash_cache file_hash_cache_t;
+
+/**
+ * Hashes a file.
+ *
+ * @param path file to hash
+ *
+ * @return Newly allocated hex digest, or NULL if the file
+ * cannot be read
+ */
+typedef char *(*file_hash_cache_hash_t)(const char *path);
+
+/**
+ * @param hash_len length of the hex digests to store, at
+ * most FILE_HASH_CACHE_MAX_HASH
+ *
+ * @return New empty cache, or NULL on failure
+ */
+file_hash_cache_t *file_hash_cache_new(size_t hash_len);
+
+/**
+ * Frees a cache. Does nothing if @cache is NULL.
+ *
+ * @param cache cache to free
+ */
+void file_hash_cache_free(file_hash_cache_t *cache);
+
+/**
+ * Adds the entries stored in a file to the cache. Lines
+ * starting with '#' and malformed lines are skipped.
+ *
+ * @param cache cache to fill
+ * @param path file written by file_hash_cache_save()
+ *
+ * @return false if @path cannot be opened
+ */
+bool file_hash_cache_load(file_hash_cache_t *cache, const char *path);
+
+/**
+ * Writes the entries that were looked up or inserted
+ * since the cache was loaded, so files that no longer
+ * exist drop out of it.
+ *
+ * @param cache cache to store
+ * @param path file to write
+ * @param header comment written as the first line, must
+ * start with '#'; may be NULL
+ *
+ * @return false if @path cannot be written
+ */
+bool file_hash_cache_save(file_hash_cache_t *cache, const char *path,
+      const char *header);
+
+/**
+ * @param cache cache to search
+ * @param path file to look up
+ * @param size current size of the file
+ * @param mtime current modification time of the file
+ *
+ * @return Hash of @path, or NULL if it is not cached or
+ * its size or modification time changed since
+ */
+const char *file_hash_cache_lookup(file_hash_cache_t *cache,
+      const char *path, int64_t size, int64_t mtime);
+
+/**
+ * Adds or replaces the entry of a file.
+ *
+ * @param cache cache to update
+ * @param path file that was hashed
+ * @param size size of the file when hashed
+ * @param mtime modification time of the file when hashed
+ * @param hash hex digest of the file
+ *
+ * @return false if @hash does not have the length the
+ * cache was created with
+ */
+bool file_hash_cache_insert(file_hash_cache_t *cache, const char *path,
+      int64_t size, int64_t mtime, const char *hash);
+
+/**
+ * Gets the hash of several files, reading only those the
+ * cache has no valid entry for. These are hashed in
+ * parallel on @pool and added to the cache.
+ *
+ * @param cache cache to use
+ * @param pool thread pool to hash on; the calling thread
+ * hashes alone if NULL
+ * @param hash_fn hash function
+ * @param paths files to hash
+ * @param hashes receives a newly allocated hash for each
+ * file, or NULL for files that cannot be read
+ * @param count number of files
+ *
+ * @return Number of files that had to be read
+ */
+size_t file_hash_cache_fill(file_hash_cache_t *cache, tpool_t *pool,
+      file_hash_cache_hash_t hash_fn, const char **paths, char **hashes,
+      size_t count);
+
+RETRO_END_DECLS
+
+#endif
@@ -0,0 +1,85 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (box_grid.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_BOX_GRID_H
+#define __LIBRETRO_SDK_BOX_GRID_H
+
+#include <retro_common_api.h>
+
+#include <boolean.h>
+#include <stddef.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * Uniform grid over a fixed set of axis-aligned boxes,
+ * answering "which boxes may contain this point" without
+ * testing every box.
+ */
+typedef struct box_grid box_grid_t;
+
+typedef struct box_grid_box
+{
+   float x_min;
+   float y_min;
+   float x_max;
+   float y_max;
+} box_grid_box_t;
+
+/**
+ * Builds a grid over @count boxes. Boxes with x_max < x_min
+ * are left out and never returned by box_grid_query().
+ *
+ * @param boxes boxes to index; not referenced after the call
+ * @param count number of boxes
+ *
+ * @return New grid, or NULL on allocation failure
+ */
+box_grid_t *box_grid_new(const box_grid_box_t *boxes, size_t count);
+
+/**
+ * Frees a grid. Does nothing if @grid is NULL.
+ *
+ * @param grid grid to free
+ */
+void box_grid_free(box_grid_t *grid);
+
+/**
+ * Returns the candidate boxes for a point: the indexes,
+ * in ascending order, of every box that contains (@x, @y),
+ * plus possibly some nearby boxes that don't. The caller
+ * still runs its exact hit test on each candidate.
+ *
+ * @param grid grid to query
+ * @param x point X coordinate
+ * @param y point Y coordinate
+ * @param size receives the number of candidates
+ *
+ * @return Candidate indexes, valid until the grid is freed;
+ * NULL when there are none
+ */
+const unsigned *box_grid_query(const box_grid_t *grid,
+      float x, float y, size_t *size);
+
+RETRO_END_DECLS
+
+#endif
@@ -0,0 +1,91 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (lru_map.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_LRU_MAP_H
+#define __LIBRETRO_SDK_LRU_MAP_H
+
+#include <retro_common_api.h>
+
+#include <stdint.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * Maps 32-bit keys to a fixed number of slots, 0 to
+ * capacity - 1, which the caller backs with its own
+ * storage (e.g. glyph cells in a texture atlas). Once
+ * every slot is taken, new keys reuse the slot of the
+ * least recently used key. Lookup, insertion and eviction
+ * all take constant time.
+ */
+typedef struct lru_map lru_map_t;
+
+/**
+ * @param capacity number of slots, at least 1
+ *
+ * @return New map, or NULL on allocation failure
+ */
+lru_map_t *lru_map_new(unsigned capacity);
+
+/**
+ * Frees a map. Does nothing if @map is NULL.
+ *
+ * @param map map to free
+ */
+void lru_map_free(lru_map_t *map);
+
+/**
+ * Looks up a key and makes it the most recently used.
+ *
+ * @param map map to search
+ * @param key key to look up
+ *
+ * @return Slot of @key, or -1 if it has none
+ */
+int lru_map_get(lru_map_t *map, uint32_t key);
+
+/**
+ * Gives a slot to a key that has none, as the most
+ * recently used. This is a free slot while there are any,
+ * otherwise the slot of the least recently used key, which
+ * loses it.
+ *
+ * @param map map to insert into
+ * @param key key to insert; must not be in the map
+ * @param evicted set to whether another key lost its
+ * slot; may be NULL
+ * @param evicted_key receives that key; may be NULL
+ *
+ * @return Slot of @key
+ */
+unsigned lru_map_put(lru_map_t *map, uint32_t key, bool *evicted,
+      uint32_t *evicted_key);
+
+/**
+ * @return Number of slots in use
+ */
+unsigned lru_map_size(const lru_map_t *map);
+
+RETRO_END_DECLS
+
+#endif
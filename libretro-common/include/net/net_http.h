@@ -102,8 +102,8 @@ bool net_http_error(struct http_t *state);
  * Leaf function.
  *
  * @return the response headers. The returned buffer is owned by the
- * caller of net_http_new; it is not freed by net_http_delete.
- * If the status is not 20x and accept_error is false, it returns NULL.
+ * caller of net_http_new; it is not freed by net_http_delete,
+ * so it must be taken and freed for failed requests too.
  **/
 struct string_list *net_http_headers(struct http_t *state);
 
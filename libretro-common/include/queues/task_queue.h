@@ -46,6 +46,38 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+/**
+ * Scheduling class of a task on the threaded task queue.
+ * Workers pick the ready task with the highest priority,
+ * so a long bulk job can't delay loads the user is waiting on.
+ * Tasks of the same priority take turns. A task that keeps
+ * being passed over gains priority, so lower classes still
+ * make progress while higher ones are always busy.
+ */
+enum task_priority
+{
+   /** Loads the user is waiting on, e.g. menu thumbnails. */
+   TASK_PRIORITY_INTERACTIVE = 0,
+   /** Save states, SRAM and screenshots. */
+   TASK_PRIORITY_SAVE_LOAD,
+   /** The default. */
+   TASK_PRIORITY_NORMAL,
+   /** Bulk work, e.g. database scans and downloads. */
+   TASK_PRIORITY_BACKGROUND
+};
+
+enum task_affinity
+{
+   /** The task may run on any worker. The default. */
+   TASK_AFFINITY_ANY = 0,
+   /**
+    * The task only runs on the first worker, so its handler
+    * never runs concurrently with another serial task.
+    * For handlers that share state without synchronization.
+    */
+   TASK_AFFINITY_SERIAL
+};
+
 enum task_style
 {
    TASK_STYLE_NONE,
@@ -74,6 +106,14 @@ typedef void (*retro_task_queue_msg_t)(retro_task_t *task,
       const char *msg,
       unsigned prio, unsigned duration, bool flush);
 
+/**
+ * Called after a task handler has run, with the time
+ * it started and finished at.
+ * @see task_queue_set_trace
+ */
+typedef void (*retro_task_trace_t)(retro_task_t *task,
+      retro_time_t start, retro_time_t end);
+
 /** @copydoc task_retriever_data::func */
 typedef bool (*retro_task_retriever_t)(retro_task_t *task, void *data);
 
@@ -250,6 +290,20 @@ struct retro_task
     */
    retro_task_t *next;
 
+   /**
+    * @private Set while a worker runs this task's handler.
+    * Do not touch this; it is managed by the task system.
+    */
+   bool busy;
+
+   /**
+    * @private Number of times a worker picked another task
+    * while this one was ready; raises its priority so that
+    * it can't starve.
+    * Do not touch this; it is managed by the task system.
+    */
+   unsigned skipped;
+
    /**
     * Indicates the current progress of the task.
     *
@@ -275,6 +329,14 @@ struct retro_task
    enum task_type type;
    enum task_style style;
 
+   /**
+    * Scheduling class and worker affinity of the task.
+    * Only used by the threaded task queue.
+    * Set by the caller before pushing the task.
+    */
+   enum task_priority priority;
+   enum task_affinity affinity;
+
    uint8_t flags;
 };
 
@@ -529,6 +591,24 @@ bool task_is_on_main_thread(void);
  */
 void task_queue_set_threaded(void);
 
+/**
+ * Sets a function to be called every time a task
+ * handler has run, e.g. to profile task work.
+ * Timing is only measured while one is set.
+ *
+ * @param trace The function to call, or \c NULL to disable.
+ */
+void task_queue_set_trace(retro_task_trace_t trace);
+
+/**
+ * Sets the number of worker threads of the threaded task queue.
+ * Takes effect the next time the threaded queue is initialized.
+ *
+ * @param count The number of workers, or 0 to pick one
+ * from the number of CPU cores (the default).
+ */
+void task_queue_set_workers(unsigned count);
+
 /**
  * Ensures that the task queue is not in threaded mode.
  *
@@ -655,11 +735,12 @@ void task_queue_deinit(void);
  * Must be called before any other task_queue_* function,
  * and must only be called from the main thread.
  *
- * @param threaded \c true if tasks should run on a separate thread,
+ * @param threaded \c true if tasks should run on worker threads,
  * \c false if they should remain on the calling thread.
- * All tasks run in sequence on a single thread.
- * If you want to scale a task to multiple threads,
- * you must do so within the task itself.
+ * Workers run different tasks concurrently, but a task's handler
+ * never runs on two threads at once.
+ * @see task_queue_set_workers
+ * @see task_affinity
  * @param msg_push The task system will call this function to output messages.
  * If \c NULL, no messages will be output.
  * @note Calling this function while the task system is already initialized
@@ -48,6 +48,15 @@ typedef struct tpool tpool_t;
  **/
 typedef void (*thread_func_t)(void *arg);
 
+/**
+ * (*tpool_batch_func_t):
+ * @arg           : Argument.
+ * @index         : Index of the item to process, in [0, count).
+ *
+ * Callback function that the pool will call once per batch item.
+ **/
+typedef void (*tpool_batch_func_t)(void *arg, unsigned index);
+
 /**
  * tpool_create:
  * @num           : Number of threads the pool should have.
@@ -91,6 +100,25 @@ bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg);
  */
 void tpool_wait(tpool_t *tp);
 
+/**
+ * tpool_run_batch:
+ * @tp         : Thread pool.
+ * @func       : Function the pool should call for every item.
+ * @arg        : Argument to pass to func.
+ * @count      : Number of items.
+ *
+ * Run func for every index in [0, count) and return once all of
+ * them have completed. Idle pool threads and the calling thread
+ * claim items from a shared counter, so many small items balance
+ * themselves across threads even when their cost is uneven.
+ *
+ * Only one batch runs on a pool at a time. If another thread
+ * already has a batch in flight, the items are processed on the
+ * calling thread alone.
+ **/
+void tpool_run_batch(tpool_t *tp, tpool_batch_func_t func,
+      void *arg, unsigned count);
+
 RETRO_END_DECLS
 
 #endif
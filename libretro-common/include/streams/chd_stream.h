@@ -25,6 +25,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <boolean.h>
 
 #include <retro_common_api.h>
 
@@ -43,6 +44,37 @@ chdstream_t *chdstream_open(const char *path, int32_t track);
 
 void chdstream_close(chdstream_t *stream);
 
+/**
+ * chdstream_set_cache:
+ * @stream    : CHD stream.
+ * @hunks     : Number of decompressed hunks to keep in memory.
+ * @readahead : Number of hunks to decode ahead of the read cursor
+ *              on a worker thread during sequential reads
+ *              (0 disables read-ahead). Ignored without HAVE_THREADS.
+ *
+ * Resizes the hunk cache of @stream, discarding its contents.
+ * @hunks is raised to at least @readahead + 2 when read-ahead
+ * is enabled.
+ *
+ * Returns: true on success, false on allocation failure.
+ **/
+bool chdstream_set_cache(chdstream_t *stream,
+      unsigned hunks, unsigned readahead);
+
+/**
+ * chdstream_get_crc:
+ * @stream    : CHD stream.
+ * @crc       : Output CRC32 of the entire track.
+ *
+ * Computes the CRC32 of the complete track, as read from
+ * offset 0. With HAVE_THREADS, hunks are decompressed in
+ * parallel through separate CHD handles. The read cursor
+ * of @stream is left unchanged.
+ *
+ * Returns: true on success, false on read error.
+ **/
+bool chdstream_get_crc(chdstream_t *stream, uint32_t *crc);
+
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes);
 
 int chdstream_getc(chdstream_t *stream);
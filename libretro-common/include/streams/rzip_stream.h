@@ -33,7 +33,7 @@
 RETRO_BEGIN_DECLS
 
 /* Rudimentary interface for streaming data to/from a
- * zlib-compressed chunk-based RZIP archive file.
+ * compressed chunk-based RZIP archive file.
  * 
  * This is somewhat less efficient than using regular
  * gzip code, but this is by design - the intention here
@@ -59,14 +59,22 @@ RETRO_BEGIN_DECLS
  *                                  - nominal (maximum) size of each uncompressed
  *                                    chunk, in bytes
  * <total uncompressed data size>:  8 bytes, little endian order
+ * <codec> (v2 only):               1 byte
+ *                                  - 0: zlib, 1: zstd
+ * <reserved> (v2 only):            3 bytes, zero
  * <size of next compressed chunk>: 4 bytes, little endian order
  *                                  - size on-disk of next compressed data
  *                                    chunk, in bytes
- * <next compressed chunk>:         n bytes of zlib compressed data
+ * <next compressed chunk>:         n bytes of compressed data
  * ...
  * <size of next compressed chunk> : repeated until end of file
  * <next compressed chunk>         :
  * 
+ * Version 1 files are always zlib compressed. New files
+ * are written as version 2, using zstd when available
+ * (HAVE_ZSTD). Since chunks are independent, they are
+ * compressed in parallel when HAVE_THREADS is defined.
+ * 
  */
 
 /* Prevent direct access to rzipstream_t members */
@@ -0,0 +1,195 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (box_grid.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <boolean.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <lists/box_grid.h>
+
+/* Cells per axis; a box spanning most of the area ends
+ * up in every cell, so finer grids only add memory */
+#define BOX_GRID_MAX_DIM 32
+
+struct box_grid
+{
+   /* Bounds of all boxes */
+   float x_min;
+   float y_min;
+   float x_max;
+   float y_max;
+   /* Cells per unit */
+   float x_scale;
+   float y_scale;
+   unsigned cols;
+   unsigned rows;
+   /* Cell c holds items[cells[c]] .. items[cells[c + 1] - 1] */
+   unsigned *cells;
+   unsigned *items;
+};
+
+#define BOX_GRID_EMPTY(box) (!((box)->x_max >= (box)->x_min && (box)->y_max >= (box)->y_min))
+
+/* Monotonic in 'v', so a point inside a box always maps
+ * to a cell between those of the box's edges */
+static unsigned box_grid_cell(float v, float min, float scale, unsigned n)
+{
+   float f = (v - min) * scale;
+   if (!(f < (float)n))
+      return n - 1;
+   return (unsigned)f;
+}
+
+box_grid_t *box_grid_new(const box_grid_box_t *boxes, size_t count)
+{
+   size_t i;
+   unsigned c;
+   size_t num_cells;
+   unsigned dim     = 1;
+   size_t num_items = 0;
+   size_t valid     = 0;
+   box_grid_t *grid = (box_grid_t*)calloc(1, sizeof(*grid));
+
+   if (!grid)
+      return NULL;
+
+   for (i = 0; i < count; i++)
+   {
+      const box_grid_box_t *box = &boxes[i];
+      if (BOX_GRID_EMPTY(box))
+         continue;
+      if (valid++ == 0)
+      {
+         grid->x_min = box->x_min;
+         grid->y_min = box->y_min;
+         grid->x_max = box->x_max;
+         grid->y_max = box->y_max;
+         continue;
+      }
+      if (box->x_min < grid->x_min)
+         grid->x_min = box->x_min;
+      if (box->y_min < grid->y_min)
+         grid->y_min = box->y_min;
+      if (box->x_max > grid->x_max)
+         grid->x_max = box->x_max;
+      if (box->y_max > grid->y_max)
+         grid->y_max = box->y_max;
+   }
+
+   /* Around one box per cell for evenly spread boxes */
+   while ((size_t)dim * dim < valid && dim < BOX_GRID_MAX_DIM)
+      dim++;
+
+   grid->cols    = dim;
+   grid->rows    = dim;
+   grid->x_scale = (grid->x_max > grid->x_min)
+      ? (float)dim / (grid->x_max - grid->x_min) : 0.0f;
+   grid->y_scale = (grid->y_max > grid->y_min)
+      ? (float)dim / (grid->y_max - grid->y_min) : 0.0f;
+   num_cells     = (size_t)dim * dim;
+
+   if (!(grid->cells = (unsigned*)calloc(num_cells + 1, sizeof(unsigned))))
+      goto error;
+
+   /* Count, then fill in box order so every cell lists
+    * its boxes in ascending order */
+   for (i = 0; i < count; i++)
+   {
+      unsigned x0, x1, y0, y1, x, y;
+      const box_grid_box_t *box = &boxes[i];
+      if (BOX_GRID_EMPTY(box))
+         continue;
+      x0 = box_grid_cell(box->x_min, grid->x_min, grid->x_scale, dim);
+      x1 = box_grid_cell(box->x_max, grid->x_min, grid->x_scale, dim);
+      y0 = box_grid_cell(box->y_min, grid->y_min, grid->y_scale, dim);
+      y1 = box_grid_cell(box->y_max, grid->y_min, grid->y_scale, dim);
+      for (y = y0; y <= y1; y++)
+         for (x = x0; x <= x1; x++)
+            grid->cells[y * dim + x + 1]++;
+      num_items += (size_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+   }
+
+   for (c = 0; c < num_cells; c++)
+      grid->cells[c + 1] += grid->cells[c];
+
+   if (num_items && !(grid->items = (unsigned*)
+            malloc(num_items * sizeof(unsigned))))
+      goto error;
+
+   for (i = 0; i < count; i++)
+   {
+      unsigned x0, x1, y0, y1, x, y;
+      const box_grid_box_t *box = &boxes[i];
+      if (BOX_GRID_EMPTY(box))
+         continue;
+      x0 = box_grid_cell(box->x_min, grid->x_min, grid->x_scale, dim);
+      x1 = box_grid_cell(box->x_max, grid->x_min, grid->x_scale, dim);
+      y0 = box_grid_cell(box->y_min, grid->y_min, grid->y_scale, dim);
+      y1 = box_grid_cell(box->y_max, grid->y_min, grid->y_scale, dim);
+      /* cells[c] is used as the write position and ends
+       * up at the start of cell c + 1 */
+      for (y = y0; y <= y1; y++)
+         for (x = x0; x <= x1; x++)
+            grid->items[grid->cells[y * dim + x]++] = (unsigned)i;
+   }
+
+   /* Shift the write positions back to cell starts */
+   for (c = (unsigned)num_cells; c > 0; c--)
+      grid->cells[c] = grid->cells[c - 1];
+   grid->cells[0] = 0;
+
+   return grid;
+
+error:
+   box_grid_free(grid);
+   return NULL;
+}
+
+void box_grid_free(box_grid_t *grid)
+{
+   if (!grid)
+      return;
+
+   free(grid->cells);
+   free(grid->items);
+   free(grid);
+}
+
+const unsigned *box_grid_query(const box_grid_t *grid,
+      float x, float y, size_t *size)
+{
+   unsigned c;
+
+   *size = 0;
+
+   if (     !grid->items
+         || !(x >= grid->x_min && x <= grid->x_max)
+         || !(y >= grid->y_min && y <= grid->y_max))
+      return NULL;
+
+   c     = box_grid_cell(y, grid->y_min, grid->y_scale, grid->rows)
+      * grid->cols
+      + box_grid_cell(x, grid->x_min, grid->x_scale, grid->cols);
+   *size = grid->cells[c + 1] - grid->cells[c];
+
+   return *size ? &grid->items[grid->cells[c]] : NULL;
+}
@@ -0,0 +1,202 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (lru_map.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <lists/lru_map.h>
+
+#define LRU_MAP_NONE 0xFFFFFFFFu
+
+struct lru_map
+{
+   /* Per slot: its key and its neighbours in use order */
+   uint32_t *keys;
+   unsigned *prev;
+   unsigned *next;
+   /* Open addressing with linear probing; slot + 1,
+    * 0 for empty buckets */
+   unsigned *buckets;
+   unsigned mask;
+   unsigned shift;
+   unsigned capacity;
+   unsigned count;
+   /* Most and least recently used slots */
+   unsigned head;
+   unsigned tail;
+};
+
+static unsigned lru_map_bucket(const lru_map_t *map, uint32_t key)
+{
+   /* Fibonacci hashing spreads sequential codepoints */
+   return (unsigned)((uint32_t)(key * 2654435769u) >> map->shift);
+}
+
+lru_map_t *lru_map_new(unsigned capacity)
+{
+   unsigned buckets = 2;
+   unsigned shift   = 31;
+   lru_map_t *map   = NULL;
+
+   if (!capacity || !(map = (lru_map_t*)calloc(1, sizeof(*map))))
+      return NULL;
+
+   /* At most half full keeps probe sequences short */
+   while (buckets < capacity * 2)
+   {
+      buckets <<= 1;
+      shift--;
+   }
+
+   map->keys     = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+   map->prev     = (unsigned*)malloc(capacity * sizeof(unsigned));
+   map->next     = (unsigned*)malloc(capacity * sizeof(unsigned));
+   map->buckets  = (unsigned*)calloc(buckets, sizeof(unsigned));
+   map->mask     = buckets - 1;
+   map->shift    = shift;
+   map->capacity = capacity;
+   map->head     = LRU_MAP_NONE;
+   map->tail     = LRU_MAP_NONE;
+
+   if (!map->keys || !map->prev || !map->next || !map->buckets)
+   {
+      lru_map_free(map);
+      return NULL;
+   }
+
+   return map;
+}
+
+void lru_map_free(lru_map_t *map)
+{
+   if (!map)
+      return;
+
+   free(map->keys);
+   free(map->prev);
+   free(map->next);
+   free(map->buckets);
+   free(map);
+}
+
+static void lru_map_unlink(lru_map_t *map, unsigned slot)
+{
+   if (map->prev[slot] != LRU_MAP_NONE)
+      map->next[map->prev[slot]] = map->next[slot];
+   else
+      map->head = map->next[slot];
+   if (map->next[slot] != LRU_MAP_NONE)
+      map->prev[map->next[slot]] = map->prev[slot];
+   else
+      map->tail = map->prev[slot];
+}
+
+static void lru_map_push_front(lru_map_t *map, unsigned slot)
+{
+   map->prev[slot] = LRU_MAP_NONE;
+   map->next[slot] = map->head;
+   if (map->head != LRU_MAP_NONE)
+      map->prev[map->head] = slot;
+   else
+      map->tail = slot;
+   map->head = slot;
+}
+
+static unsigned lru_map_find_bucket(const lru_map_t *map, uint32_t key)
+{
+   unsigned b = lru_map_bucket(map, key);
+   while (map->buckets[b] && map->keys[map->buckets[b] - 1] != key)
+      b = (b + 1) & map->mask;
+   return b;
+}
+
+/* Empties bucket 'b' and moves later entries of the probe
+ * sequence back, so no tombstones are needed */
+static void lru_map_remove_bucket(lru_map_t *map, unsigned b)
+{
+   unsigned next = b;
+
+   for (;;)
+   {
+      unsigned home;
+      next = (next + 1) & map->mask;
+      if (!map->buckets[next])
+         break;
+      home = lru_map_bucket(map, map->keys[map->buckets[next] - 1]);
+      /* Stays put if its home lies cyclically in (b, next] */
+      if (b <= next ? (b < home && home <= next) : (b < home || home <= next))
+         continue;
+      map->buckets[b] = map->buckets[next];
+      b               = next;
+   }
+
+   map->buckets[b] = 0;
+}
+
+int lru_map_get(lru_map_t *map, uint32_t key)
+{
+   unsigned slot;
+   unsigned b = lru_map_find_bucket(map, key);
+
+   if (!map->buckets[b])
+      return -1;
+
+   slot = map->buckets[b] - 1;
+   if (map->head != slot)
+   {
+      lru_map_unlink(map, slot);
+      lru_map_push_front(map, slot);
+   }
+   return (int)slot;
+}
+
+unsigned lru_map_put(lru_map_t *map, uint32_t key, bool *evicted,
+      uint32_t *evicted_key)
+{
+   unsigned slot;
+
+   if (evicted)
+      *evicted = false;
+
+   if (map->count < map->capacity)
+      slot = map->count++;
+   else
+   {
+      slot = map->tail;
+      lru_map_unlink(map, slot);
+      lru_map_remove_bucket(map,
+            lru_map_find_bucket(map, map->keys[slot]));
+      if (evicted)
+         *evicted = true;
+      if (evicted_key)
+         *evicted_key = map->keys[slot];
+   }
+
+   map->keys[slot] = key;
+   map->buckets[lru_map_find_bucket(map, key)] = slot + 1;
+   lru_map_push_front(map, slot);
+   return slot;
+}
+
+unsigned lru_map_size(const lru_map_t *map)
+{
+   return map->count;
+}
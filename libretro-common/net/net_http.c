@@ -1209,6 +1209,17 @@ static ssize_t net_http_receive_header(struct http_t *state, ssize_t len)
             }
             else
             {
+               /* These responses never carry a body, whatever
+                * the headers say; reading 'until close' would
+                * stall on a keep-alive connection */
+               if (     response->status == 204
+                     || response->status == 304
+                     || string_is_equal(state->request.method, "HEAD"))
+               {
+                  response->bodytype = T_LEN;
+                  response->len      = 0;
+               }
+
                response->part = P_BODY;
                if (response->bodytype == T_CHUNK)
                   response->part = P_BODY_CHUNKLEN;
@@ -1538,12 +1549,12 @@ int net_http_status(struct http_t *state)
  * Leaf function.
  *
  * @return the response headers. The returned buffer is owned by the
- * caller of net_http_new; it is not freed by net_http_delete().
- * If the status is not 20x and accept_err is false, it returns NULL.
+ * caller of net_http_new; it is not freed by net_http_delete(),
+ * so it must be taken and freed for failed requests too.
  **/
 struct string_list *net_http_headers(struct http_t *state)
 {
-   if (!state || !state->err)
+   if (!state)
       return NULL;
    return state->response.headers;
 }
@@ -69,15 +69,27 @@ static task_queue_t tasks_finished          = {NULL, NULL};
 
 static struct retro_task_impl *impl_current = NULL;
 static bool task_threaded_enable            = false;
+static retro_task_trace_t task_trace        = NULL;
 
 #ifdef HAVE_THREADS
+#define TASK_MAX_WORKERS        8
+/* Task properties are guarded by one of these, picked
+ * by task address, so that workers updating different
+ * tasks rarely contend */
+#define TASK_PROPERTY_LOCKS     16
+/* Times a ready task is passed over before it moves up
+ * one priority class */
+#define TASK_AGING_PICKS        8
+
 static uintptr_t main_thread_id             = 0;
 static slock_t *running_lock                = NULL;
 static slock_t *finished_lock               = NULL;
-static slock_t *property_lock               = NULL;
+static slock_t *property_locks[TASK_PROPERTY_LOCKS];
 static slock_t *queue_lock                  = NULL;
 static scond_t *worker_cond                 = NULL;
-static sthread_t *worker_thread             = NULL;
+static sthread_t *worker_threads[TASK_MAX_WORKERS];
+static unsigned worker_count                = 0;
+static unsigned worker_count_wanted         = 0;
 static bool worker_continue                 = true;
 /* use running_lock when touching it */
 #endif
@@ -103,13 +115,51 @@ static void task_queue_msg_push(retro_task_t *task,
       impl_current->msg_push(task, buf, prio, duration, flush);
 }
 
+static void task_queue_run_handler(retro_task_t *task)
+{
+   retro_task_trace_t trace = task_trace;
+
+   if (trace)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+      task->handler(task);
+      trace(task, start, cpu_features_get_time_usec());
+   }
+   else
+      task->handler(task);
+}
+
+#ifdef HAVE_THREADS
+static slock_t *task_property_lock(retro_task_t *task)
+{
+   return property_locks[((uintptr_t)task >> 4) % TASK_PROPERTY_LOCKS];
+}
+
+static void task_property_locks_new(void)
+{
+   unsigned i;
+   for (i = 0; i < TASK_PROPERTY_LOCKS; i++)
+      property_locks[i] = slock_new();
+}
+
+static void task_property_locks_free(void)
+{
+   unsigned i;
+   for (i = 0; i < TASK_PROPERTY_LOCKS; i++)
+   {
+      slock_free(property_locks[i]);
+      property_locks[i] = NULL;
+   }
+}
+#endif
+
 static void task_queue_push_progress(retro_task_t *task)
 {
 #ifdef HAVE_THREADS
    /* msg_push callback interacts directly with the task properties (particularly title).
     * make sure another thread doesn't modify them while rendering
     */
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
 
    if (task->title && (!((task->flags & RETRO_TASK_FLG_MUTE) > 0)))
@@ -136,7 +186,7 @@ static void task_queue_push_progress(retro_task_t *task)
    }
 
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 }
 
@@ -240,7 +290,7 @@ static void retro_task_regular_gather(void)
 
       if (!task->when || task->when < cpu_features_get_time_usec())
       {
-         task->handler(task);
+         task_queue_run_handler(task);
 
          task_queue_push_progress(task);
       }
@@ -390,7 +440,8 @@ static void retro_task_threaded_push_running(retro_task_t *task)
    slock_lock(running_lock);
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
-   scond_signal(worker_cond);
+   /* Not every worker may take the task */
+   scond_broadcast(worker_cond);
    slock_unlock(queue_lock);
    slock_unlock(running_lock);
 }
@@ -405,7 +456,7 @@ static void retro_task_threaded_cancel(void *task)
    {
       if (t == task)
       {
-        t->flags |= RETRO_TASK_FLG_CANCELLED;
+        task_set_flags(t, RETRO_TASK_FLG_CANCELLED, true);
         break;
       }
    }
@@ -454,7 +505,7 @@ static void retro_task_threaded_reset(void)
 
    slock_lock(running_lock);
    for (task = tasks_running.front; task; task = task->next)
-      task->flags |= RETRO_TASK_FLG_CANCELLED;
+      task_set_flags(task, RETRO_TASK_FLG_CANCELLED, true);
    slock_unlock(running_lock);
 }
 
@@ -488,10 +539,81 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
    slock_unlock(running_lock);
 }
 
+/* Picks the next task for worker 'index': the ready task
+ * with the highest priority, in queue order among equals so
+ * that they take turns. Every TASK_AGING_PICKS times a ready
+ * task is passed over, it moves up one priority class, so
+ * that busy high priority tasks can't starve it. The first
+ * worker also runs the serial tasks and prefers them among
+ * equals. If nothing is ready, '*delay' is set to the time
+ * until the next scheduled task, or 0 if there is none.
+ * 'running_lock' must be held. */
+static retro_task_t *threaded_worker_pick(unsigned index,
+      retro_time_t *delay)
+{
+   retro_task_t *task = NULL;
+   retro_task_t *best = NULL;
+   unsigned best_key  = 0;
+   retro_time_t now   = 0;
+
+   *delay             = 0;
+
+   for (task = tasks_running.front; task; task = task->next)
+   {
+      unsigned key;
+
+      if (task->busy)
+         continue;
+      if (task->affinity == TASK_AFFINITY_SERIAL && index != 0)
+         continue;
+
+      if (task->when)
+      {
+         /* allow half a millisecond for context switching */
+         retro_time_t wait;
+         if (!now)
+            now  = cpu_features_get_time_usec();
+         wait    = task->when - now - 500;
+         if (wait > 0)
+         {
+            if (!*delay || wait < *delay)
+               *delay = wait;
+            continue;
+         }
+      }
+
+      key = (unsigned)task->priority;
+      if (task->skipped / TASK_AGING_PICKS >= key)
+         key  = 0;
+      else
+         key -= task->skipped / TASK_AGING_PICKS;
+      key    *= 2;
+      if (index == 0 && task->affinity != TASK_AFFINITY_SERIAL)
+         key++;
+
+      /* Reset below for the task picked */
+      task->skipped++;
+
+      if (!best || key < best_key)
+      {
+         best     = task;
+         best_key = key;
+      }
+   }
+
+   if (best)
+      best->skipped = 0;
+
+   return best;
+}
+
 static void threaded_worker(void *userdata)
 {
+   unsigned index = (unsigned)(uintptr_t)userdata;
+
    for (;;)
    {
+      retro_time_t delay  = 0;
       retro_task_t *task  = NULL;
       bool       finished = false;
 
@@ -503,28 +625,20 @@ static void threaded_worker(void *userdata)
          break; /* should we keep running until all tasks finished? */
       }
 
-      /* Get first task to run */
-      if (!(task = tasks_running.front))
+      if (!(task = threaded_worker_pick(index, &delay)))
       {
-         scond_wait(worker_cond, running_lock);
-         slock_unlock(running_lock);
-         continue;
-      }
-
-      if (task->when)
-      {
-         retro_time_t now   = cpu_features_get_time_usec();
-         retro_time_t delay = task->when - now - 500; /* allow half a millisecond for context switching */
          if (delay > 0)
-         {
             scond_wait_timeout(worker_cond, running_lock, delay);
-            slock_unlock(running_lock);
-            continue;
-         }
+         else
+            scond_wait(worker_cond, running_lock);
+         slock_unlock(running_lock);
+         continue;
       }
 
+      task->busy = true;
       slock_unlock(running_lock);
-      task->handler(task);
+
+      task_queue_run_handler(task);
 #if defined(EMSCRIPTEN) || defined(_3DS)
       /* Workaround emscripten pthread bug where not parking the
          thread will prevent other important stuff from
@@ -533,38 +647,25 @@ static void threaded_worker(void *userdata)
       retro_sleep(1);
 #endif
 
-      slock_lock(property_lock);
-      finished = ((task->flags & RETRO_TASK_FLG_FINISHED) > 0) ? true : false;
-      slock_unlock(property_lock);
+      finished = ((task_get_flags(task) & RETRO_TASK_FLG_FINISHED) > 0)
+         ? true : false;
 
-      /* Update queue */
+      slock_lock(running_lock);
+      slock_lock(queue_lock);
+      task->busy = false;
+      task_queue_remove(&tasks_running, task);
+      /* Move the task to the back of the queue
+       * so that tasks of the same priority take turns */
       if (!finished)
-      {
-         /* Move the task to the back of the queue */
-         /* mimics retro_task_threaded_push_running,
-          * but also includes a task_queue_remove */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-
-         /* do nothing if only item in queue */
-         if (task->next)
-         {
-            task_queue_remove(&tasks_running, task);
-            task_queue_put(&tasks_running, task);
-            scond_signal(worker_cond);
-         }
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
-      }
-      else
-      {
-         /* Remove task from running queue */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-         task_queue_remove(&tasks_running, task);
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
+         task_queue_put(&tasks_running, task);
+      slock_unlock(queue_lock);
+      /* Other workers may be waiting for tasks this one
+       * skipped while it was busy */
+      scond_broadcast(worker_cond);
+      slock_unlock(running_lock);
 
+      if (finished)
+      {
          /* Add task to finished queue */
          slock_lock(finished_lock);
          task_queue_put(&tasks_finished, task);
@@ -575,39 +676,65 @@ static void threaded_worker(void *userdata)
 
 static void retro_task_threaded_init(void)
 {
+   unsigned i;
+
    running_lock    = slock_new();
    finished_lock   = slock_new();
-   property_lock   = slock_new();
    queue_lock      = slock_new();
    worker_cond     = scond_new();
+   task_property_locks_new();
 
    slock_lock(running_lock);
    worker_continue = true;
    slock_unlock(running_lock);
 
-   worker_thread   = sthread_create(threaded_worker, NULL);
+   if (!(worker_count = worker_count_wanted))
+   {
+#if defined(EMSCRIPTEN) || defined(_3DS)
+      worker_count = 1;
+#else
+      /* At least two, so that a task blocking on I/O
+       * doesn't hold up the others */
+      worker_count = cpu_features_get_core_amount();
+      if (worker_count < 2)
+         worker_count = 2;
+      else if (worker_count > 4)
+         worker_count = 4;
+#endif
+   }
+   if (worker_count > TASK_MAX_WORKERS)
+      worker_count = TASK_MAX_WORKERS;
+
+   for (i = 0; i < worker_count; i++)
+      worker_threads[i] = sthread_create(threaded_worker,
+            (void*)(uintptr_t)i);
 }
 
 static void retro_task_threaded_deinit(void)
 {
+   unsigned i;
+
    slock_lock(running_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
+   scond_broadcast(worker_cond);
    slock_unlock(running_lock);
 
-   sthread_join(worker_thread);
+   for (i = 0; i < worker_count; i++)
+   {
+      sthread_join(worker_threads[i]);
+      worker_threads[i] = NULL;
+   }
+   worker_count    = 0;
 
    scond_free(worker_cond);
    slock_free(running_lock);
    slock_free(finished_lock);
-   slock_free(property_lock);
    slock_free(queue_lock);
+   task_property_locks_free();
 
-   worker_thread   = NULL;
    worker_cond     = NULL;
    running_lock    = NULL;
    finished_lock   = NULL;
-   property_lock   = NULL;
    queue_lock      = NULL;
 }
 
@@ -627,6 +754,31 @@ static struct retro_task_impl impl_threaded = {
 
 #ifdef HAVE_GCD
 
+static dispatch_queue_t gcd_serial_queue    = NULL;
+
+/* Serial tasks share one serial queue; the others go to
+ * the global queue of the QoS class of their priority */
+static dispatch_queue_t gcd_task_queue(retro_task_t *task)
+{
+   if (task->affinity == TASK_AFFINITY_SERIAL)
+      return gcd_serial_queue;
+
+   switch (task->priority)
+   {
+      case TASK_PRIORITY_INTERACTIVE:
+         return dispatch_get_global_queue(QOS_CLASS_USER_INTERACTIVE, 0);
+      case TASK_PRIORITY_SAVE_LOAD:
+         return dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+      case TASK_PRIORITY_BACKGROUND:
+         return dispatch_get_global_queue(QOS_CLASS_UTILITY, 0);
+      case TASK_PRIORITY_NORMAL:
+      default:
+         break;
+   }
+
+   return dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0);
+}
+
 static void gcd_worker(retro_task_t *task)
 {
    bool       finished = false;
@@ -648,7 +800,7 @@ static void gcd_worker(retro_task_t *task)
       if (delay > 0)
       {
          dispatch_time_t after = dispatch_time(DISPATCH_TIME_NOW, delay);
-         dispatch_after(after, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+         dispatch_after(after, gcd_task_queue(task),
                         ^{ gcd_worker(task); });
          slock_unlock(running_lock);
          return;
@@ -657,14 +809,13 @@ static void gcd_worker(retro_task_t *task)
 
    slock_unlock(running_lock);
 
-   task->handler(task);
+   task_queue_run_handler(task);
 
-   slock_lock(property_lock);
-   finished = ((task->flags & RETRO_TASK_FLG_FINISHED) > 0) ? true : false;
-   slock_unlock(property_lock);
+   finished = ((task_get_flags(task) & RETRO_TASK_FLG_FINISHED) > 0)
+      ? true : false;
 
    if (!finished)
-      dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+      dispatch_async(gcd_task_queue(task),
                      ^{ gcd_worker(task); });
    else
    {
@@ -691,7 +842,7 @@ static void retro_task_gcd_push_running(retro_task_t *task)
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
    gcd_queue_count++;
-   dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+   dispatch_async(gcd_task_queue(task),
                   ^{ gcd_worker(task); });
    slock_unlock(queue_lock);
    slock_unlock(running_lock);
@@ -727,18 +878,20 @@ static void retro_task_gcd_init(void)
 {
    retro_task_t *task = NULL;
 
-   running_lock    = slock_new();
-   finished_lock   = slock_new();
-   property_lock   = slock_new();
-   queue_lock      = slock_new();
-   worker_cond     = scond_new();
+   running_lock     = slock_new();
+   finished_lock    = slock_new();
+   queue_lock       = slock_new();
+   worker_cond      = scond_new();
+   task_property_locks_new();
+   gcd_serial_queue = dispatch_queue_create("task_queue.serial",
+         DISPATCH_QUEUE_SERIAL);
 
    slock_lock(running_lock);
    worker_continue = true;
    for (task = tasks_running.front; task; task = task->next)
    {
       gcd_queue_count++;
-      dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+      dispatch_async(gcd_task_queue(task),
                      ^{ gcd_worker(task); });
    };
    slock_unlock(running_lock);
@@ -755,14 +908,15 @@ static void retro_task_gcd_deinit(void)
    scond_free(worker_cond);
    slock_free(running_lock);
    slock_free(finished_lock);
-   slock_free(property_lock);
    slock_free(queue_lock);
-
-   worker_cond     = NULL;
-   running_lock    = NULL;
-   finished_lock   = NULL;
-   property_lock   = NULL;
-   queue_lock      = NULL;
+   task_property_locks_free();
+   dispatch_release(gcd_serial_queue);
+
+   worker_cond      = NULL;
+   running_lock     = NULL;
+   finished_lock    = NULL;
+   queue_lock       = NULL;
+   gcd_serial_queue = NULL;
 }
 
 static struct retro_task_impl impl_gcd = {
@@ -817,6 +971,18 @@ void task_queue_set_threaded(void)
    task_threaded_enable = true;
 }
 
+void task_queue_set_workers(unsigned count)
+{
+#ifdef HAVE_THREADS
+   worker_count_wanted = count;
+#endif
+}
+
+void task_queue_set_trace(retro_task_trace_t trace)
+{
+   task_trace = trace;
+}
+
 void task_queue_unset_threaded(void)
 {
    task_threaded_enable = false;
@@ -946,57 +1112,57 @@ bool task_is_on_main_thread(void)
 void task_set_error(retro_task_t *task, char *err)
 {
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    task->error = err;
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 }
 
 void task_set_progress(retro_task_t *task, int8_t progress)
 {
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    task->progress = progress;
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 }
 
 void task_set_title(retro_task_t *task, char *title)
 {
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    task->title = title;
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 }
 
 void task_set_data(retro_task_t *task, void *data)
 {
 #ifdef HAVE_THREADS
-   slock_lock(running_lock);
+   slock_lock(task_property_lock(task));
 #endif
    task->task_data = data;
 #ifdef HAVE_THREADS
-   slock_unlock(running_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 }
 
 void task_free_title(retro_task_t *task)
 {
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    if (task->title)
       free(task->title);
    task->title = NULL;
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 }
 
@@ -1005,11 +1171,11 @@ void* task_get_data(retro_task_t *task)
    void *data = NULL;
 
 #ifdef HAVE_THREADS
-   slock_lock(running_lock);
+   slock_lock(task_property_lock(task));
 #endif
    data = task->task_data;
 #ifdef HAVE_THREADS
-   slock_unlock(running_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 
    return data;
@@ -1018,14 +1184,14 @@ void* task_get_data(retro_task_t *task)
 void task_set_flags(retro_task_t *task, uint8_t flags, bool set)
 {
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    if (set)
       task->flags |=  (flags);
    else
       task->flags &= ~(flags);
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 }
 
@@ -1033,11 +1199,11 @@ uint8_t task_get_flags(retro_task_t *task)
 {
    uint8_t _flags = 0;
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    _flags = task->flags;
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
    return _flags;
 }
@@ -1046,11 +1212,11 @@ char* task_get_error(retro_task_t *task)
 {
    char *s = NULL;
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    s = task->error;
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
    return s;
 }
@@ -1060,11 +1226,11 @@ int8_t task_get_progress(retro_task_t *task)
    int8_t progress = 0;
 
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    progress = task->progress;
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 
    return progress;
@@ -1075,11 +1241,11 @@ char* task_get_title(retro_task_t *task)
    char *title = NULL;
 
 #ifdef HAVE_THREADS
-   slock_lock(property_lock);
+   slock_lock(task_property_lock(task));
 #endif
    title = task->title;
 #ifdef HAVE_THREADS
-   slock_unlock(property_lock);
+   slock_unlock(task_property_lock(task));
 #endif
 
    return title;
@@ -1110,7 +1276,11 @@ retro_task_t *task_init(void)
    task->ident             = task_count++;
    task->frontend_userdata = NULL;
    task->next              = NULL;
+   task->busy              = false;
+   task->skipped           = 0;
    task->when              = 0;
+   task->priority          = TASK_PRIORITY_NORMAL;
+   task->affinity          = TASK_AFFINITY_ANY;
 
    return task;
 }
@@ -31,6 +31,18 @@
 #include <rthreads/rthreads.h>
 #include <rthreads/tpool.h>
 
+#if defined(_WIN32) && !defined(_XBOX)
+#include <windows.h>
+#elif defined(_XBOX)
+#include <xtl.h>
+#endif
+
+#if !defined(__GNUC__) && !defined(__clang__) && !defined(_WIN32)
+/* No atomics available; batch items are claimed
+ * under the work mutex instead. */
+#define TPOOL_BATCH_LOCKED
+#endif
+
 /* Work object which will sit in a queue
  * waiting for the pool to process it.
  *
@@ -43,6 +55,18 @@ struct tpool_work
 };
 typedef struct tpool_work tpool_work_t;
 
+/* Set of items run by tpool_run_batch. Lives on the
+ * stack of the thread that called tpool_run_batch. */
+struct tpool_batch
+{
+   tpool_batch_func_t func;      /* Function to be called for every item. */
+   void              *arg;       /* Data to be passed to func. */
+   unsigned           count;     /* Number of items. */
+   volatile unsigned  next;      /* Next item which has not been claimed yet. */
+   unsigned           active;    /* Pool threads currently inside the batch. */
+};
+typedef struct tpool_batch tpool_batch_t;
+
 struct tpool
 {
    tpool_work_t    *work_first;   /* First work item in the work queue. */
@@ -51,6 +75,8 @@ struct tpool
    scond_t         *work_cond;    /* Conditional to signal when there is work to process. */
    scond_t         *working_cond; /* Conditional to signal when there is no work processing.
                                        This will also signal when there are no threads running. */
+   scond_t         *batch_cond;   /* Conditional to signal when the last pool thread leaves a batch. */
+   tpool_batch_t   *batch;        /* Batch that pool threads may join, if any. */
    size_t           working_cnt;  /* The number of threads processing work (Not waiting for work). */
    size_t           thread_cnt;   /* Total number of threads within the pool. */
    bool             stop;         /* Marker to tell the work threads to exit. */
@@ -99,6 +125,46 @@ static tpool_work_t *tpool_work_get(tpool_t *tp)
    return work;
 }
 
+/* Claim the next unprocessed item of a batch.
+ * Returns false once every item has been claimed. */
+static bool tpool_batch_claim(tpool_batch_t *batch, unsigned *index)
+{
+   unsigned i;
+#if defined(__GNUC__) || defined(__clang__)
+   i = __sync_fetch_and_add(&batch->next, 1);
+#elif defined(_WIN32)
+   i = (unsigned)InterlockedIncrement((LONG volatile*)&batch->next) - 1;
+#else
+   i = batch->next++;
+#endif
+   if (i >= batch->count)
+      return false;
+   *index = i;
+   return true;
+}
+
+static void tpool_batch_process(tpool_t *tp, tpool_batch_t *batch)
+{
+   unsigned index;
+
+   for (;;)
+   {
+      bool claimed;
+#ifdef TPOOL_BATCH_LOCKED
+      if (tp)
+         slock_lock(tp->work_mutex);
+#endif
+      claimed = tpool_batch_claim(batch, &index);
+#ifdef TPOOL_BATCH_LOCKED
+      if (tp)
+         slock_unlock(tp->work_mutex);
+#endif
+      if (!claimed)
+         break;
+      batch->func(batch->arg, index);
+   }
+}
+
 static void tpool_worker(void *arg)
 {
    tpool_work_t *work = NULL;
@@ -113,9 +179,29 @@ static void tpool_worker(void *arg)
 
       /* If there is no work in the queue wait in the conditional until
        * there is work to take. */
-      if (!tp->work_first)
+      if (!tp->work_first && !tp->batch)
          scond_wait(tp->work_cond, tp->work_mutex);
 
+      /* Batches take priority over queued work, since
+       * someone is blocked waiting for them to finish. */
+      if (tp->batch)
+      {
+         tpool_batch_t *batch = tp->batch;
+         batch->active++;
+         slock_unlock(tp->work_mutex);
+
+         tpool_batch_process(tp, batch);
+
+         slock_lock(tp->work_mutex);
+         /* Everything is claimed, don't let anyone else join. */
+         if (tp->batch == batch)
+            tp->batch = NULL;
+         if (--batch->active == 0)
+            scond_signal(tp->batch_cond);
+         slock_unlock(tp->work_mutex);
+         continue;
+      }
+
       /* Try to pull work from the queue. */
       work = tpool_work_get(tp);
       tp->working_cnt++;
@@ -170,6 +256,7 @@ tpool_t *tpool_create(size_t num)
    tp->work_mutex   = slock_new();
    tp->work_cond    = scond_new();
    tp->working_cond = scond_new();
+   tp->batch_cond   = scond_new();
 
    tp->work_first   = NULL;
    tp->work_last    = NULL;
@@ -213,6 +300,7 @@ void tpool_destroy(tpool_t *tp)
    slock_free(tp->work_mutex);
    scond_free(tp->work_cond);
    scond_free(tp->working_cond);
+   scond_free(tp->batch_cond);
 
    free(tp);
 }
@@ -266,3 +354,45 @@ void tpool_wait(tpool_t *tp)
 
    slock_unlock(tp->work_mutex);
 }
+
+void tpool_run_batch(tpool_t *tp, tpool_batch_func_t func,
+      void *arg, unsigned count)
+{
+   tpool_batch_t batch;
+
+   if (!func || count == 0)
+      return;
+
+   batch.func   = func;
+   batch.arg    = arg;
+   batch.count  = count;
+   batch.next   = 0;
+   batch.active = 0;
+
+   if (!tp)
+   {
+      tpool_batch_process(tp, &batch);
+      return;
+   }
+
+   slock_lock(tp->work_mutex);
+   if (!tp->batch && !tp->stop)
+   {
+      tp->batch = &batch;
+      scond_broadcast(tp->work_cond);
+   }
+   slock_unlock(tp->work_mutex);
+
+   /* The calling thread works on the batch too
+    * instead of sleeping until the pool is done. */
+   tpool_batch_process(tp, &batch);
+
+   /* Every item has been claimed at this point; wait for
+    * the pool threads still running one to let go of it. */
+   slock_lock(tp->work_mutex);
+   if (tp->batch == &batch)
+      tp->batch = NULL;
+   while (batch.active)
+      scond_wait(tp->batch_cond, tp->work_mutex);
+   slock_unlock(tp->work_mutex);
+}
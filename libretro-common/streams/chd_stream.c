@@ -30,25 +30,85 @@
 #include <retro_endianness.h>
 #include <libchdr/chd.h>
 #include <string/stdstring.h>
+#include <encodings/crc32.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#include <features/features_cpu.h>
+#endif
 
 #define SECTOR_RAW_SIZE 2352
 #define SECTOR_SIZE 2048
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+/* Number of decompressed hunks kept in memory.
+ * Back-and-forth access patterns (e.g. ISO9660
+ * directory walks) then avoid decoding the same
+ * hunk repeatedly */
+#define CHDSTREAM_DEFAULT_CACHE_HUNKS 16
+/* Number of hunks decoded ahead of the read
+ * cursor on a worker thread once sequential
+ * access is detected */
+#define CHDSTREAM_DEFAULT_READAHEAD 4
+
+/* Upper bound on threads used by chdstream_get_crc() */
+#define CHDSTREAM_MAX_HASH_THREADS 8
+
+#ifdef HAVE_THREADS
+#define CHDSTREAM_LOCK(stream)   slock_lock((stream)->lock)
+#define CHDSTREAM_UNLOCK(stream) slock_unlock((stream)->lock)
+#else
+#define CHDSTREAM_LOCK(stream)
+#define CHDSTREAM_UNLOCK(stream)
+#endif
+
+typedef struct chdstream_hunk
+{
+   uint8_t *data;
+   /* Value of use_counter when last accessed */
+   uint32_t last_used;
+   /* Cached hunk number, or -1 if empty */
+   int32_t hunknum;
+   /* Hunk is being decoded (data not yet valid) */
+   bool pending;
+} chdstream_hunk_t;
+
 struct chdstream
 {
    chd_file *chd;
-   /* Loaded hunk */
-   uint8_t *hunkmem;
+   /* Decompressed hunk cache (LRU) */
+   chdstream_hunk_t *hunks;
+   char *path;
+#ifdef HAVE_THREADS
+   /* Read-ahead worker, decoding with its own
+    * CHD handle (libchdr handles are not thread
+    * safe). 'lock' protects the hunk cache */
+   chd_file *prefetch_chd;
+   sthread_t *prefetch_thread;
+   slock_t *lock;
+   scond_t *hunk_cond;
+   scond_t *prefetch_cond;
+   uint32_t prefetch_next;
+   uint32_t prefetch_end;
+   bool prefetch_quit;
+#endif
    /* Byte offset where track data starts (after pregap) */
    size_t track_start;
    /* Byte offset where track data ends */
    size_t track_end;
    /* Byte offset of read cursor */
    size_t offset;
-   /* Loaded hunk number */
+   /* Track number requested at open */
+   int32_t track;
+   /* Most recently accessed hunk number */
    int32_t hunknum;
+   /* Number of entries in hunk cache */
+   uint32_t num_hunks;
+   /* Number of hunks to decode ahead */
+   uint32_t readahead;
+   uint32_t use_counter;
    /* Size of frame taken from each hunk */
    uint32_t frame_size;
    /* Offset of data within frame */
@@ -218,7 +278,6 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
 {
    metadata_t meta;
    uint32_t pregap         = 0;
-   uint8_t *hunkmem        = NULL;
    const chd_header *hd    = NULL;
    chdstream_t *stream     = NULL;
    chd_file *chd           = NULL;
@@ -243,15 +302,36 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    stream->track_start     = 0;
    stream->track_end       = 0;
    stream->offset          = 0;
-   stream->hunkmem         = NULL;
+   stream->hunks           = NULL;
+   stream->path            = NULL;
+   stream->track           = track;
    stream->hunknum         = -1;
+   stream->num_hunks       = 0;
+   stream->readahead       = 0;
+   stream->use_counter     = 0;
+#ifdef HAVE_THREADS
+   stream->prefetch_chd    = NULL;
+   stream->prefetch_thread = NULL;
+   stream->hunk_cond       = NULL;
+   stream->prefetch_cond   = NULL;
+   stream->prefetch_next   = 0;
+   stream->prefetch_end    = 0;
+   stream->prefetch_quit   = false;
+
+   if (!(stream->lock = slock_new()))
+      goto error;
+#endif
 
    hd                      = chd_get_header(chd);
-   hunkmem                 = (uint8_t*)malloc(hd->hunkbytes);
-   if (!hunkmem)
+   stream->chd             = chd;
+   chd                     = NULL;
+
+   if (!(stream->path = strdup(path)))
       goto error;
 
-   stream->hunkmem         = hunkmem;
+   if (!chdstream_set_cache(stream, CHDSTREAM_DEFAULT_CACHE_HUNKS,
+         CHDSTREAM_DEFAULT_READAHEAD))
+      goto error;
 
    if (string_is_equal(meta.type, "MODE1_RAW"))
       stream->frame_size   = SECTOR_RAW_SIZE;
@@ -276,7 +356,6 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (meta.pgtype[0] != 'V')
       pregap               = meta.pregap;
 
-   stream->chd             = chd;
    stream->frames_per_hunk = hd->hunkbytes / hd->unitbytes;
    stream->track_frame     = meta.frame_offset;
    stream->track_start     = (size_t)pregap * stream->frame_size;
@@ -294,42 +373,308 @@ error:
    return NULL;
 }
 
+static void chdstream_free_hunks(chdstream_t *stream)
+{
+   uint32_t i;
+
+   if (!stream->hunks)
+      return;
+
+   for (i = 0; i < stream->num_hunks; i++)
+      if (stream->hunks[i].data)
+         free(stream->hunks[i].data);
+   free(stream->hunks);
+
+   stream->hunks     = NULL;
+   stream->num_hunks = 0;
+   stream->hunknum   = -1;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_stop_prefetch(chdstream_t *stream)
+{
+   if (stream->prefetch_thread)
+   {
+      slock_lock(stream->lock);
+      stream->prefetch_quit = true;
+      scond_signal(stream->prefetch_cond);
+      slock_unlock(stream->lock);
+
+      sthread_join(stream->prefetch_thread);
+      stream->prefetch_thread = NULL;
+      stream->prefetch_quit   = false;
+   }
+
+   if (stream->prefetch_chd)
+      chd_close(stream->prefetch_chd);
+   if (stream->prefetch_cond)
+      scond_free(stream->prefetch_cond);
+   if (stream->hunk_cond)
+      scond_free(stream->hunk_cond);
+
+   stream->prefetch_chd  = NULL;
+   stream->prefetch_cond = NULL;
+   stream->hunk_cond     = NULL;
+   stream->prefetch_next = 0;
+   stream->prefetch_end  = 0;
+}
+#endif
+
 void chdstream_close(chdstream_t *stream)
 {
    if (!stream)
       return;
 
-   if (stream->hunkmem)
-      free(stream->hunkmem);
+#ifdef HAVE_THREADS
+   chdstream_stop_prefetch(stream);
+   if (stream->lock)
+      slock_free(stream->lock);
+#endif
+   chdstream_free_hunks(stream);
+   if (stream->path)
+      free(stream->path);
    if (stream->chd)
       chd_close(stream->chd);
    free(stream);
 }
 
-static bool
-chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
+bool chdstream_set_cache(chdstream_t *stream,
+      unsigned hunks, unsigned readahead)
 {
-   uint16_t *array;
+   uint32_t i;
+   uint32_t hunkbytes;
 
-   if ((int)hunknum == stream->hunknum)
-      return true;
+   if (!stream)
+      return false;
+
+   /* The cache must hold the current hunk plus
+    * the complete read-ahead window */
+   if (hunks < 1)
+      hunks = 1;
+#ifdef HAVE_THREADS
+   if (readahead > 0 && hunks < readahead + 2)
+      hunks = readahead + 2;
+   chdstream_stop_prefetch(stream);
+#else
+   readahead = 0;
+#endif
+
+   chdstream_free_hunks(stream);
 
-   if (chd_read(stream->chd, hunknum, stream->hunkmem) != CHDERR_NONE)
+   hunkbytes = chd_get_header(stream->chd)->hunkbytes;
+
+   if (!(stream->hunks = (chdstream_hunk_t*)calloc(
+         hunks, sizeof(chdstream_hunk_t))))
+      return false;
+
+   stream->num_hunks = hunks;
+   stream->readahead = readahead;
+
+   for (i = 0; i < hunks; i++)
+   {
+      stream->hunks[i].hunknum = -1;
+      if (!(stream->hunks[i].data = (uint8_t*)malloc(hunkbytes)))
+      {
+         chdstream_free_hunks(stream);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool chdstream_decode_hunk(chdstream_t *stream,
+      chd_file *chd, uint32_t hunknum, uint8_t *data)
+{
+   if (chd_read(chd, hunknum, data) != CHDERR_NONE)
       return false;
 
    if (stream->swab)
    {
       uint32_t i;
-      uint32_t count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array          = (uint16_t*)stream->hunkmem;
+      uint32_t count  = chd_get_header(chd)->hunkbytes / 2;
+      uint16_t *array = (uint16_t*)data;
       for (i = 0; i < count; ++i)
          array[i] = SWAP16(array[i]);
    }
 
-   stream->hunknum = hunknum;
    return true;
 }
 
+/* Cache helpers: lock must be held */
+static chdstream_hunk_t *chdstream_cache_find(
+      chdstream_t *stream, uint32_t hunknum)
+{
+   uint32_t i;
+   for (i = 0; i < stream->num_hunks; i++)
+      if (stream->hunks[i].hunknum == (int32_t)hunknum)
+         return &stream->hunks[i];
+   return NULL;
+}
+
+/* Returns the least recently used entry that is
+ * not currently being decoded */
+static chdstream_hunk_t *chdstream_cache_victim(chdstream_t *stream)
+{
+   uint32_t i;
+   chdstream_hunk_t *victim = NULL;
+
+   for (i = 0; i < stream->num_hunks; i++)
+   {
+      chdstream_hunk_t *hunk = &stream->hunks[i];
+      if (hunk->pending)
+         continue;
+      if (hunk->hunknum < 0)
+         return hunk;
+      if (!victim || (stream->use_counter - hunk->last_used) >
+            (stream->use_counter - victim->last_used))
+         victim = hunk;
+   }
+
+   return victim;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_prefetch_thread(void *data)
+{
+   chdstream_t *stream = (chdstream_t*)data;
+
+   slock_lock(stream->lock);
+
+   while (!stream->prefetch_quit)
+   {
+      bool ok;
+      uint32_t hunknum;
+      chdstream_hunk_t *hunk = NULL;
+
+      if (stream->prefetch_next >= stream->prefetch_end)
+      {
+         scond_wait(stream->prefetch_cond, stream->lock);
+         continue;
+      }
+
+      hunknum = stream->prefetch_next++;
+
+      if (     chdstream_cache_find(stream, hunknum)
+            || !(hunk = chdstream_cache_victim(stream)))
+         continue;
+
+      hunk->hunknum   = (int32_t)hunknum;
+      hunk->pending   = true;
+      hunk->last_used = ++stream->use_counter;
+      slock_unlock(stream->lock);
+
+      ok = chdstream_decode_hunk(stream,
+            stream->prefetch_chd, hunknum, hunk->data);
+
+      slock_lock(stream->lock);
+      hunk->pending   = false;
+      if (!ok)
+         hunk->hunknum = -1;
+      scond_broadcast(stream->hunk_cond);
+   }
+
+   slock_unlock(stream->lock);
+}
+
+/* Queues the hunks following 'hunknum' for decoding
+ * on the read-ahead thread, starting it if required */
+static void chdstream_prefetch(chdstream_t *stream, uint32_t hunknum)
+{
+   uint32_t totalhunks = chd_get_header(stream->chd)->totalhunks;
+
+   if (!stream->prefetch_thread)
+   {
+      if (chd_open(stream->path, CHD_OPEN_READ, NULL,
+               &stream->prefetch_chd) != CHDERR_NONE
+            || !(stream->hunk_cond     = scond_new())
+            || !(stream->prefetch_cond = scond_new())
+            || !(stream->prefetch_thread = sthread_create(
+                  chdstream_prefetch_thread, stream)))
+      {
+         /* Fall back to synchronous decoding */
+         chdstream_stop_prefetch(stream);
+         stream->readahead = 0;
+         return;
+      }
+   }
+
+   slock_lock(stream->lock);
+   stream->prefetch_next = hunknum + 1;
+   stream->prefetch_end  = hunknum + 1 + stream->readahead;
+   if (stream->prefetch_end > totalhunks)
+      stream->prefetch_end = totalhunks;
+   scond_signal(stream->prefetch_cond);
+   slock_unlock(stream->lock);
+}
+#endif
+
+/* Copies 'len' bytes at 'offset' within decompressed
+ * hunk 'hunknum' to 'data', decoding the hunk if it
+ * is not already cached */
+static bool chdstream_read_hunk(chdstream_t *stream,
+      uint32_t hunknum, uint32_t offset, void *data, uint32_t len)
+{
+   bool ok                = true;
+   bool sequential        = (stream->hunknum >= 0)
+         && (hunknum == (uint32_t)stream->hunknum + 1);
+   chdstream_hunk_t *hunk = NULL;
+
+   CHDSTREAM_LOCK(stream);
+
+   for (;;)
+   {
+      if (!(hunk = chdstream_cache_find(stream, hunknum)))
+         break;
+      if (!hunk->pending)
+      {
+         hunk->last_used = ++stream->use_counter;
+         memcpy(data, hunk->data + offset, len);
+         break;
+      }
+#ifdef HAVE_THREADS
+      /* Being decoded by the read-ahead thread */
+      scond_wait(stream->hunk_cond, stream->lock);
+#endif
+   }
+
+   if (!hunk)
+   {
+      /* Cache miss: decode on this thread. The entry
+       * is marked as pending so that the read-ahead
+       * thread cannot evict it meanwhile */
+      if (!(hunk = chdstream_cache_victim(stream)))
+         ok = false;
+      else
+      {
+         hunk->hunknum = (int32_t)hunknum;
+         hunk->pending = true;
+         CHDSTREAM_UNLOCK(stream);
+
+         ok = chdstream_decode_hunk(stream, stream->chd,
+               hunknum, hunk->data);
+
+         CHDSTREAM_LOCK(stream);
+         hunk->pending   = false;
+         hunk->last_used = ++stream->use_counter;
+         if (ok)
+            memcpy(data, hunk->data + offset, len);
+         else
+            hunk->hunknum = -1;
+      }
+   }
+
+   CHDSTREAM_UNLOCK(stream);
+
+#ifdef HAVE_THREADS
+   if (ok && sequential && stream->readahead > 0)
+      chdstream_prefetch(stream, hunknum);
+#endif
+
+   stream->hunknum = (int32_t)hunknum;
+   return ok;
+}
+
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
 {
    size_t end;
@@ -361,12 +706,10 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
          uint32_t hunk_offset = (chd_frame % stream->frames_per_hunk)
             * hd->unitbytes;
 
-         if (!chdstream_load_hunk(stream, hunk))
+         if (!chdstream_read_hunk(stream, hunk,
+                  frame_offset + hunk_offset + stream->frame_offset,
+                  out + data_offset, amount))
             return -1;
-
-         memcpy(out + data_offset,
-                stream->hunkmem + frame_offset
-                + hunk_offset + stream->frame_offset, amount);
       }
 
       data_offset    += amount;
@@ -481,3 +824,166 @@ uint32_t chdstream_get_first_track_sector(chdstream_t* stream)
 
    return 0;
 }
+
+typedef struct chdstream_crc_range
+{
+   size_t start;
+   size_t len;
+   uint32_t crc;
+   bool ok;
+} chdstream_crc_range_t;
+
+typedef struct chdstream_crc_job
+{
+   const char *path;
+   chdstream_crc_range_t *ranges;
+   int32_t track;
+} chdstream_crc_job_t;
+
+/* Computes the CRC32 of 'len' bytes at 'start',
+ * reading through 'stream' */
+static bool chdstream_crc_range(chdstream_t *stream,
+      size_t start, size_t len, uint32_t *crc)
+{
+   uint8_t buffer[16384];
+   uint32_t accumulator = 0;
+
+   stream->offset       = start;
+
+   while (len > 0)
+   {
+      size_t   chunk    = (len < sizeof(buffer)) ? len : sizeof(buffer);
+      ssize_t  _len     = chdstream_read(stream, buffer, chunk);
+      if (_len <= 0)
+         return false;
+      accumulator       = encoding_crc32(accumulator, buffer, (size_t)_len);
+      len              -= (size_t)_len;
+   }
+
+   *crc = accumulator;
+   return true;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_crc_worker(void *data, unsigned index)
+{
+   chdstream_crc_job_t *job     = (chdstream_crc_job_t*)data;
+   chdstream_crc_range_t *range = &job->ranges[index];
+   /* Each range uses its own CHD handle, since
+    * libchdr handles cannot be shared between threads */
+   chdstream_t *stream          = chdstream_open(job->path, job->track);
+
+   if (!stream)
+      return;
+
+   /* Each range is read exactly once, from start to end */
+   chdstream_set_cache(stream, 1, 0);
+   range->ok = chdstream_crc_range(stream,
+         range->start, range->len, &range->crc);
+   chdstream_close(stream);
+}
+#endif
+
+bool chdstream_get_crc(chdstream_t *stream, uint32_t *crc)
+{
+   size_t offset;
+   bool ok              = false;
+
+   if (!stream || !crc)
+      return false;
+
+#ifdef HAVE_THREADS
+   {
+      unsigned i, n;
+      chdstream_crc_job_t job;
+      tpool_t *pool        = NULL;
+      unsigned num_ranges  = cpu_features_get_core_amount();
+      /* Track bytes stored in a single hunk; range bounds
+       * fall on hunk bounds so no hunk is decoded twice */
+      size_t hunk_size     = (size_t)stream->frames_per_hunk
+         * stream->frame_size;
+      /* Track offset of the first hunk bound: the track
+       * starts 'track_frame' frames into the CHD, after
+       * the pregap, which isn't stored */
+      size_t hunk_phase    = 0;
+      size_t range_size;
+
+      if (num_ranges > CHDSTREAM_MAX_HASH_THREADS)
+         num_ranges = CHDSTREAM_MAX_HASH_THREADS;
+      if (hunk_size == 0)
+         hunk_size  = stream->frame_size;
+      else
+         hunk_phase = stream->track_start
+            + (size_t)((stream->frames_per_hunk
+                  - stream->track_frame % stream->frames_per_hunk)
+               % stream->frames_per_hunk) * stream->frame_size;
+
+      range_size    = (stream->track_end + num_ranges - 1) / num_ranges;
+      range_size    = ((range_size + hunk_size - 1) / hunk_size) * hunk_size;
+      if (range_size == 0)
+         range_size = hunk_size;
+      num_ranges    = (unsigned)((stream->track_end + range_size - 1)
+            / range_size);
+
+      if (     num_ranges > 1
+            && (job.ranges = (chdstream_crc_range_t*)calloc(
+                  num_ranges, sizeof(*job.ranges))))
+      {
+         job.path  = stream->path;
+         job.track = stream->track;
+
+         /* Move each bound up to the next hunk bound,
+          * dropping ranges that end up empty */
+         for (i = 0, n = 0; i < num_ranges; i++)
+         {
+            size_t end = (size_t)(i + 1) * range_size;
+
+            if (end <= hunk_phase)
+               end = hunk_phase;
+            else
+               end = hunk_phase + ((end - hunk_phase + hunk_size - 1)
+                     / hunk_size) * hunk_size;
+            if (end > stream->track_end || i == num_ranges - 1)
+               end = stream->track_end;
+
+            job.ranges[n].start = n ? job.ranges[n - 1].start
+               + job.ranges[n - 1].len : 0;
+            if (end <= job.ranges[n].start)
+               continue;
+            job.ranges[n].len   = end - job.ranges[n].start;
+            n++;
+         }
+         num_ranges = n;
+
+         if (num_ranges > 1)
+         {
+            pool = tpool_create(num_ranges - 1);
+            tpool_run_batch(pool, chdstream_crc_worker, &job, num_ranges);
+            if (pool)
+               tpool_destroy(pool);
+
+            ok   = true;
+            *crc = 0;
+            for (i = 0; i < num_ranges && ok; i++)
+            {
+               ok   = job.ranges[i].ok;
+               *crc = encoding_crc32_combine(*crc,
+                     job.ranges[i].crc, job.ranges[i].len);
+            }
+         }
+
+         free(job.ranges);
+
+         if (ok)
+            return true;
+      }
+   }
+#endif
+
+   /* Serial fallback */
+   offset = stream->offset;
+   ok     = chdstream_crc_range(stream, 0, stream->track_end, crc);
+   stream->offset = offset;
+
+   return ok;
+}
@@ -667,6 +667,12 @@ bool intfstream_get_crc(intfstream_internal_t *intf, uint32_t *crc)
    if (!intf || !crc)
       return false;
 
+#ifdef HAVE_CHD
+   /* Hunks can be decompressed in parallel */
+   if (intf->type == INTFSTREAM_CHD)
+      return chdstream_get_crc(intf->chd.fp, crc);
+#endif
+
    /* Ensure we start at the beginning of the file */
    intfstream_rewind(intf);
 
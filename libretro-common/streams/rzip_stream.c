@@ -26,10 +26,24 @@
 #include <streams/file_stream.h>
 #include <streams/trans_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#include <features/features_cpu.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include <streams/rzip_stream.h>
 
-/* Current RZIP file format version */
-#define RZIP_VERSION 1
+/* Current RZIP file format version
+ * > v1: zlib compressed chunks
+ * > v2: adds a codec identifier to the file
+ *   header (zlib or zstd)
+ * zlib files are still written as v1, so that
+ * older readers can load them */
+#define RZIP_VERSION 2
 
 /* Compression level
  * > zlib default of 6 provides the best
@@ -37,13 +51,53 @@
  *   compression speed */
 #define RZIP_COMPRESSION_LEVEL 6
 
+/* zstd compression level
+ * > zstd default of 3 is both faster and
+ *   stronger than zlib level 6 */
+#define RZIP_ZSTD_COMPRESSION_LEVEL 3
+
 /* Default chunk size: 128kb */
 #define RZIP_DEFAULT_CHUNK_SIZE 131072
 
 /* Header sizes (in bytes) */
 #define RZIP_HEADER_SIZE 20
+#define RZIP_HEADER_SIZE_V2 24
 #define RZIP_CHUNK_HEADER_SIZE 4
 
+/* Chunks are independent, so when writing they
+ * are queued and compressed in parallel before
+ * being written to disk in order */
+#define RZIP_MAX_THREADS 8
+#define RZIP_CHUNKS_PER_THREAD 2
+
+enum rzip_codec
+{
+   RZIP_CODEC_ZLIB = 0,
+   RZIP_CODEC_ZSTD
+};
+
+#ifdef HAVE_ZSTD
+#define RZIP_DEFAULT_CODEC RZIP_CODEC_ZSTD
+#else
+#define RZIP_DEFAULT_CODEC RZIP_CODEC_ZLIB
+#endif
+
+/* Holds an uncompressed chunk awaiting
+ * compression, and its compressed output */
+typedef struct
+{
+   uint8_t *in_buf;
+   uint8_t *out_buf;
+   void *deflate_stream;
+#ifdef HAVE_ZSTD
+   ZSTD_CCtx *zstd_cctx;
+#endif
+   uint32_t in_size;
+   /* out_size: Compressed size, or 0 if
+    * compression failed */
+   uint32_t out_size;
+} rzip_chunk_t;
+
 /* Holds all metadata for an RZIP file stream */
 struct rzipstream
 {
@@ -53,9 +107,17 @@ struct rzipstream
    uint64_t virtual_ptr;
    RFILE* file;
    const struct trans_stream_backend *deflate_backend;
-   void *deflate_stream;
    const struct trans_stream_backend *inflate_backend;
    void *inflate_stream;
+#ifdef HAVE_ZSTD
+   ZSTD_DCtx *zstd_dctx;
+#endif
+#ifdef HAVE_THREADS
+   tpool_t *pool;
+#endif
+   /* chunks: Write queue; in_buf always points
+    * to the input buffer of the current chunk */
+   rzip_chunk_t *chunks;
    uint8_t *in_buf;
    uint8_t *out_buf;
    uint32_t in_buf_size;
@@ -64,6 +126,11 @@ struct rzipstream
    uint32_t out_buf_ptr;
    uint32_t out_buf_occupancy;
    uint32_t chunk_size;
+   uint32_t header_size;
+   unsigned num_chunks;
+   unsigned chunk_count;
+   unsigned num_threads;
+   uint8_t codec;
    bool is_compressed;
    bool is_writing;
 };
@@ -79,12 +146,12 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
 {
    unsigned i;
    int64_t length;
-   uint8_t header_bytes[RZIP_HEADER_SIZE];
+   uint8_t header_bytes[RZIP_HEADER_SIZE_V2];
 
    if (!stream)
       return false;
 
-   for (i = 0; i < RZIP_HEADER_SIZE; i++)
+   for (i = 0; i < RZIP_HEADER_SIZE_V2; i++)
       header_bytes[i] = 0;
 
    /* Attempt to read header bytes */
@@ -105,8 +172,10 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
        || (header_bytes[3] !=           73)  /* I */
        || (header_bytes[4] !=           80)  /* P */
        || (header_bytes[5] !=          118)  /* v */
-       || (header_bytes[6] != RZIP_VERSION)  /* file format version number */
-       || (header_bytes[7] !=           35)) /* # */
+       || (header_bytes[6] <             1)  /* file format version number */
+       || (header_bytes[6] >  RZIP_VERSION)
+       || (header_bytes[7] !=           35)  /* # */
+       || ((header_bytes[6] >= 2) && (length < RZIP_HEADER_SIZE_V2)))
    {
       /* Reset file to start */
       filestream_seek(stream->file, 0, SEEK_SET);
@@ -116,6 +185,34 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
       return true;
    }
 
+   /* v1 files are always zlib compressed; v2
+    * stores the codec after the v1 header fields */
+   if (header_bytes[6] >= 2)
+   {
+      stream->header_size = RZIP_HEADER_SIZE_V2;
+      stream->codec       = header_bytes[20];
+   }
+   else
+   {
+      stream->header_size = RZIP_HEADER_SIZE;
+      stream->codec       = RZIP_CODEC_ZLIB;
+   }
+
+   switch (stream->codec)
+   {
+      case RZIP_CODEC_ZLIB:
+#ifdef HAVE_ZSTD
+      case RZIP_CODEC_ZSTD:
+#endif
+         break;
+      default:
+         /* Unsupported codec */
+         return false;
+   }
+
+   /* Chunk data begins immediately after the header */
+   filestream_seek(stream->file, stream->header_size, SEEK_SET);
+
    /* Get uncompressed chunk size - next 4 bytes */
    if ((stream->chunk_size = (
                             (uint32_t)header_bytes[11] << 24)
@@ -142,17 +239,17 @@ static bool rzipstream_read_file_header(rzipstream_t *stream)
 
 /* Writes header information to RZIP file
  * > ID 'magic numbers' + uncompressed
- *   file/chunk sizes */
+ *   file/chunk sizes (+ codec for v2) */
 static bool rzipstream_write_file_header(rzipstream_t *stream)
 {
    unsigned i;
-   uint8_t header_bytes[RZIP_HEADER_SIZE];
+   uint8_t header_bytes[RZIP_HEADER_SIZE_V2];
 
    if (!stream)
       return false;
 
    /* Populate header array */
-   for (i = 0; i < RZIP_HEADER_SIZE; i++)
+   for (i = 0; i < RZIP_HEADER_SIZE_V2; i++)
       header_bytes[i] = 0;
 
    /* > 'Magic numbers' - first 8 bytes */
@@ -162,7 +259,8 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
    header_bytes[3]    =        73;    /* I */
    header_bytes[4]    =        80;    /* P */
    header_bytes[5]    =       118;    /* v */
-   header_bytes[6]    = RZIP_VERSION; /* file format version number */
+   header_bytes[6]    = (stream->codec == RZIP_CODEC_ZLIB)
+         ? 1 : RZIP_VERSION;          /* file format version number */
    header_bytes[7]    =        35;    /* # */
 
    /* > Uncompressed chunk size - next 4 bytes */
@@ -181,12 +279,16 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
    header_bytes[13]   = (stream->size >>  8) & 0xFF;
    header_bytes[12]   =  stream->size        & 0xFF;
 
+   /* > Codec - next byte (remaining 3 bytes reserved),
+    *   v2 only */
+   header_bytes[20]   = stream->codec;
+
    /* Reset file to start */
    filestream_seek(stream->file, 0, SEEK_SET);
 
    /* Write header bytes */
    return (filestream_write(stream->file,
-         header_bytes, sizeof(header_bytes)) == RZIP_HEADER_SIZE);
+         header_bytes, stream->header_size) == stream->header_size);
 }
 
 /* Stream Initialisation/De-initialisation */
@@ -204,11 +306,17 @@ static bool rzipstream_init_stream(
    /* Ensure stream has valid initial values */
    stream->size              = 0;
    stream->chunk_size        = RZIP_DEFAULT_CHUNK_SIZE;
+   stream->codec             = RZIP_DEFAULT_CODEC;
+   stream->header_size       = (stream->codec == RZIP_CODEC_ZLIB)
+         ? RZIP_HEADER_SIZE : RZIP_HEADER_SIZE_V2;
    stream->file              = NULL;
    stream->deflate_backend   = NULL;
-   stream->deflate_stream    = NULL;
    stream->inflate_backend   = NULL;
    stream->inflate_stream    = NULL;
+   stream->chunks            = NULL;
+   stream->num_chunks        = 0;
+   stream->chunk_count       = 0;
+   stream->num_threads       = 1;
    stream->in_buf            = NULL;
    stream->in_buf_size       = 0;
    stream->in_buf_ptr        = 0;
@@ -256,44 +364,76 @@ static bool rzipstream_init_stream(
    if (stream->is_writing)
    {
       /* Compression */
-      if (!(stream->deflate_backend = trans_stream_get_zlib_deflate_backend()))
-         return false;
-
-      if (!(stream->deflate_stream = stream->deflate_backend->stream_new()))
+      if (stream->codec == RZIP_CODEC_ZLIB)
+      {
+         /* Transform streams are created per chunk,
+          * since chunks may be compressed concurrently */
+         if (!(stream->deflate_backend = trans_stream_get_zlib_deflate_backend()))
+            return false;
+
+         /* Output buffers (one per chunk)
+          * > Account for minimum zlib overhead
+          *   of 11 bytes... */
+         stream->out_buf_size = stream->chunk_size * 2;
+         stream->out_buf_size =
+               (stream->out_buf_size < (stream->chunk_size + 11)) ?
+                     stream->out_buf_size + 11 :
+                     stream->out_buf_size;
+      }
+#ifdef HAVE_ZSTD
+      else
+         stream->out_buf_size = (uint32_t)ZSTD_compressBound(
+               stream->chunk_size);
+#endif
+
+#ifdef HAVE_THREADS
+      stream->num_threads = cpu_features_get_core_amount();
+      if (stream->num_threads > RZIP_MAX_THREADS)
+         stream->num_threads = RZIP_MAX_THREADS;
+      else if (stream->num_threads < 1)
+         stream->num_threads = 1;
+#endif
+      stream->num_chunks = (stream->num_threads > 1)
+            ? stream->num_threads * RZIP_CHUNKS_PER_THREAD
+            : 1;
+
+      if (!(stream->chunks = (rzip_chunk_t*)calloc(
+            stream->num_chunks, sizeof(rzip_chunk_t))))
          return false;
 
-      /* Set compression level */
-      if (!stream->deflate_backend->define(
-            stream->deflate_stream, "level", RZIP_COMPRESSION_LEVEL))
+      /* Input buffer: uncompressed data of the
+       * current chunk. Additional chunk buffers
+       * are allocated on demand */
+      stream->in_buf_size = stream->chunk_size;
+      if (!(stream->chunks[0].in_buf = (uint8_t*)malloc(stream->in_buf_size)))
          return false;
-
-      /* Buffers
-       * > Input: uncompressed
-       * > Output: compressed */
-      stream->in_buf_size  = stream->chunk_size;
-      stream->out_buf_size = stream->chunk_size * 2;
-      /* > Account for minimum zlib overhead
-       *   of 11 bytes... */
-      stream->out_buf_size =
-            (stream->out_buf_size < (stream->in_buf_size + 11)) ?
-                  stream->out_buf_size + 11 :
-                  stream->out_buf_size;
+      stream->in_buf      = stream->chunks[0].in_buf;
 
       /* Redundant safety check */
       if (   (stream->in_buf_size  == 0)
           || (stream->out_buf_size == 0))
          return false;
+
+      /* Output buffers are owned by the chunks */
+      return true;
    }
    /* When reading, don't need an inflate transform
     * stream (or buffers) if source file is uncompressed */
    else if (stream->is_compressed)
    {
       /* Decompression */
-      if (!(stream->inflate_backend = trans_stream_get_zlib_inflate_backend()))
-         return false;
+      if (stream->codec == RZIP_CODEC_ZLIB)
+      {
+         if (!(stream->inflate_backend = trans_stream_get_zlib_inflate_backend()))
+            return false;
 
-      if (!(stream->inflate_stream = stream->inflate_backend->stream_new()))
+         if (!(stream->inflate_stream = stream->inflate_backend->stream_new()))
+            return false;
+      }
+#ifdef HAVE_ZSTD
+      else if (!(stream->zstd_dctx = ZSTD_createDCtx()))
          return false;
+#endif
 
       /* Buffers
        * > Input: compressed
@@ -339,11 +479,43 @@ static int rzipstream_free_stream(rzipstream_t *stream)
    if (!stream)
       return -1;
 
-   /* Free transform streams */
-   if (stream->deflate_stream && stream->deflate_backend)
-      stream->deflate_backend->stream_free(stream->deflate_stream);
+   /* Free write queue
+    * > Input buffer is owned by the current chunk */
+   if (stream->chunks)
+   {
+      unsigned i;
+      for (i = 0; i < stream->num_chunks; i++)
+      {
+         rzip_chunk_t *chunk = &stream->chunks[i];
+         if (chunk->in_buf)
+            free(chunk->in_buf);
+         if (chunk->out_buf)
+            free(chunk->out_buf);
+         if (chunk->deflate_stream && stream->deflate_backend)
+            stream->deflate_backend->stream_free(chunk->deflate_stream);
+#ifdef HAVE_ZSTD
+         if (chunk->zstd_cctx)
+            ZSTD_freeCCtx(chunk->zstd_cctx);
+#endif
+      }
+      free(stream->chunks);
+      stream->chunks = NULL;
+      stream->in_buf = NULL;
+   }
+
+#ifdef HAVE_THREADS
+   if (stream->pool)
+      tpool_destroy(stream->pool);
+   stream->pool = NULL;
+#endif
 
-   stream->deflate_stream  = NULL;
+#ifdef HAVE_ZSTD
+   if (stream->zstd_dctx)
+      ZSTD_freeDCtx(stream->zstd_dctx);
+   stream->zstd_dctx = NULL;
+#endif
+
+   /* Free transform streams */
    stream->deflate_backend = NULL;
 
    if (stream->inflate_stream && stream->inflate_backend)
@@ -409,9 +581,15 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
    stream->virtual_ptr     = 0;
    stream->file            = NULL;
    stream->deflate_backend = NULL;
-   stream->deflate_stream  = NULL;
    stream->inflate_backend = NULL;
    stream->inflate_stream  = NULL;
+#ifdef HAVE_ZSTD
+   stream->zstd_dctx       = NULL;
+#endif
+#ifdef HAVE_THREADS
+   stream->pool            = NULL;
+#endif
+   stream->chunks          = NULL;
    stream->in_buf          = NULL;
    stream->in_buf_size     = 0;
    stream->in_buf_ptr      = 0;
@@ -444,8 +622,18 @@ static bool rzipstream_read_chunk(rzipstream_t *stream)
    uint32_t inflate_read;
    uint32_t inflate_written;
 
-   if (!stream || !stream->inflate_backend || !stream->inflate_stream)
+   if (!stream)
+      return false;
+
+   if (stream->codec == RZIP_CODEC_ZLIB)
+   {
+      if (!stream->inflate_backend || !stream->inflate_stream)
+         return false;
+   }
+#ifdef HAVE_ZSTD
+   else if (!stream->zstd_dctx)
       return false;
+#endif
 
    for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
       chunk_header_bytes[i] = 0;
@@ -487,6 +675,25 @@ static bool rzipstream_read_chunk(rzipstream_t *stream)
          compressed_chunk_size)
       return false;
 
+#ifdef HAVE_ZSTD
+   if (stream->codec == RZIP_CODEC_ZSTD)
+   {
+      size_t zstd_written = ZSTD_decompressDCtx(stream->zstd_dctx,
+            stream->out_buf, stream->out_buf_size,
+            stream->in_buf, compressed_chunk_size);
+
+      if (   ZSTD_isError(zstd_written)
+          || (zstd_written == 0)
+          || (zstd_written > stream->out_buf_size))
+         return false;
+
+      stream->out_buf_occupancy = (uint32_t)zstd_written;
+      stream->out_buf_ptr       = 0;
+
+      return true;
+   }
+#endif
+
    /* Decompress chunk data */
    stream->inflate_backend->set_in(
          stream->inflate_stream,
@@ -719,64 +926,159 @@ error:
 
 /* File Write */
 
-/* Compresses currently cached data and writes it
- * as the next RZIP file chunk */
-static bool rzipstream_write_chunk(rzipstream_t *stream)
+/* Compresses a single queued chunk
+ * > May be called concurrently for different
+ *   chunks of the same stream */
+static void rzipstream_compress_chunk(
+      rzipstream_t *stream, rzip_chunk_t *chunk)
+{
+   chunk->out_size = 0;
+
+   if (   !chunk->out_buf
+       && !(chunk->out_buf = (uint8_t*)malloc(stream->out_buf_size)))
+      return;
+
+#ifdef HAVE_ZSTD
+   if (stream->codec == RZIP_CODEC_ZSTD)
+   {
+      size_t zstd_written;
+
+      if (   !chunk->zstd_cctx
+          && !(chunk->zstd_cctx = ZSTD_createCCtx()))
+         return;
+
+      zstd_written = ZSTD_compressCCtx(chunk->zstd_cctx,
+            chunk->out_buf, stream->out_buf_size,
+            chunk->in_buf, chunk->in_size,
+            RZIP_ZSTD_COMPRESSION_LEVEL);
+
+      if (   !ZSTD_isError(zstd_written)
+          && (zstd_written > 0)
+          && (zstd_written <= stream->out_buf_size))
+         chunk->out_size = (uint32_t)zstd_written;
+   }
+   else
+#endif
+   {
+      uint32_t deflate_read;
+      uint32_t deflate_written;
+
+      if (!chunk->deflate_stream)
+      {
+         if (!(chunk->deflate_stream = stream->deflate_backend->stream_new()))
+            return;
+
+         /* Set compression level */
+         if (!stream->deflate_backend->define(
+               chunk->deflate_stream, "level", RZIP_COMPRESSION_LEVEL))
+            return;
+      }
+
+      stream->deflate_backend->set_in(
+            chunk->deflate_stream,
+            chunk->in_buf, chunk->in_size);
+
+      stream->deflate_backend->set_out(
+            chunk->deflate_stream,
+            chunk->out_buf, stream->out_buf_size);
+
+      /* Note: We have to set 'flush == true' here, otherwise we
+       * can't guarantee that the entire chunk will be written
+       * to the output buffer - this is inefficient, but not
+       * much we can do... */
+      if (!stream->deflate_backend->trans(
+            chunk->deflate_stream, true,
+            &deflate_read, &deflate_written, NULL))
+         return;
+
+      /* Error checking */
+      if (   (deflate_read    == chunk->in_size)
+          && (deflate_written  > 0)
+          && (deflate_written <= stream->out_buf_size))
+         chunk->out_size = deflate_written;
+   }
+}
+
+#ifdef HAVE_THREADS
+static void rzipstream_compress_chunk_cb(void *arg, unsigned index)
+{
+   rzipstream_t *stream = (rzipstream_t*)arg;
+   rzipstream_compress_chunk(stream, &stream->chunks[index]);
+}
+#endif
+
+/* Compresses all queued chunks and writes them
+ * to file, in order */
+static bool rzipstream_flush_chunks(rzipstream_t *stream)
 {
    unsigned i;
-   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
-   uint32_t deflate_read;
-   uint32_t deflate_written;
 
-   if (!stream || !stream->deflate_backend || !stream->deflate_stream)
-      return false;
+   if (stream->chunk_count == 0)
+      return true;
 
-   for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
-      chunk_header_bytes[i] = 0;
+#ifdef HAVE_THREADS
+   /* Worker threads are only started once a
+    * file spans more than one chunk */
+   if (     (stream->chunk_count > 1)
+         && (stream->num_threads > 1)
+         && (stream->pool
+            || (stream->pool = tpool_create(stream->num_threads - 1))))
+      tpool_run_batch(stream->pool, rzipstream_compress_chunk_cb,
+            stream, stream->chunk_count);
+   else
+#endif
+   {
+      for (i = 0; i < stream->chunk_count; i++)
+         rzipstream_compress_chunk(stream, &stream->chunks[i]);
+   }
 
-   /* Compress data currently held in input buffer */
-   stream->deflate_backend->set_in(
-         stream->deflate_stream,
-         stream->in_buf, stream->in_buf_ptr);
+   for (i = 0; i < stream->chunk_count; i++)
+   {
+      uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
+      rzip_chunk_t *chunk = &stream->chunks[i];
 
-   stream->deflate_backend->set_out(
-         stream->deflate_stream,
-         stream->out_buf, stream->out_buf_size);
+      if (chunk->out_size == 0)
+         return false;
 
-   /* Note: We have to set 'flush == true' here, otherwise we
-    * can't guarantee that the entire chunk will be written
-    * to the output buffer - this is inefficient, but not
-    * much we can do... */
-   if (!stream->deflate_backend->trans(
-         stream->deflate_stream, true,
-         &deflate_read, &deflate_written, NULL))
-      return false;
+      /* Write compressed chunk size to file */
+      chunk_header_bytes[3] = (chunk->out_size >> 24) & 0xFF;
+      chunk_header_bytes[2] = (chunk->out_size >> 16) & 0xFF;
+      chunk_header_bytes[1] = (chunk->out_size >>  8) & 0xFF;
+      chunk_header_bytes[0] =  chunk->out_size        & 0xFF;
 
-   /* Error checking */
-   if (deflate_read != stream->in_buf_ptr)
-      return false;
+      if (filestream_write(
+            stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
+            RZIP_CHUNK_HEADER_SIZE)
+         return false;
 
-   if (   (deflate_written == 0)
-       || (deflate_written > stream->out_buf_size))
-      return false;
+      /* Write compressed data to file */
+      if (filestream_write(
+            stream->file, chunk->out_buf, chunk->out_size) != chunk->out_size)
+         return false;
+   }
 
-   /* Write compressed chunk size to file */
-   chunk_header_bytes[3] = (deflate_written >> 24) & 0xFF;
-   chunk_header_bytes[2] = (deflate_written >> 16) & 0xFF;
-   chunk_header_bytes[1] = (deflate_written >>  8) & 0xFF;
-   chunk_header_bytes[0] =  deflate_written        & 0xFF;
+   stream->chunk_count = 0;
+   return true;
+}
 
-   if (filestream_write(
-         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
-         RZIP_CHUNK_HEADER_SIZE)
+/* Queues currently cached data as the next RZIP
+ * file chunk. Once the queue is full, all queued
+ * chunks are compressed and written to disk */
+static bool rzipstream_write_chunk(rzipstream_t *stream)
+{
+   if (!stream || !stream->chunks)
       return false;
 
-   /* Write compressed data to file */
-   if (filestream_write(
-         stream->file, stream->out_buf, deflate_written) != deflate_written)
+   stream->chunks[stream->chunk_count].in_size = stream->in_buf_ptr;
+   stream->chunk_count++;
+
+   if (     (stream->chunk_count >= stream->num_chunks)
+         && !rzipstream_flush_chunks(stream))
       return false;
 
-   /* Reset input buffer pointer */
+   /* Switch input buffer to next free chunk
+    * > Buffer is allocated on first use */
+   stream->in_buf     = stream->chunks[stream->chunk_count].in_buf;
    stream->in_buf_ptr = 0;
 
    return true;
@@ -803,6 +1105,13 @@ int64_t rzipstream_write(rzipstream_t *stream, const void *data, int64_t len)
          if (!rzipstream_write_chunk(stream))
             return -1;
 
+      if (!stream->in_buf)
+      {
+         if (!(stream->in_buf = (uint8_t*)malloc(stream->in_buf_size)))
+            return -1;
+         stream->chunks[stream->chunk_count].in_buf = stream->in_buf;
+      }
+
       /* Get amount of data to cache during this loop
        * > i.e. minimum of space remaining in input buffer
        *   and remaining 'write data' size */
@@ -940,10 +1249,14 @@ void rzipstream_rewind(rzipstream_t *stream)
    if (stream->is_writing)
    {
       /* Reset file position to first chunk location */
-      filestream_seek(stream->file, RZIP_HEADER_SIZE, SEEK_SET);
+      filestream_seek(stream->file, stream->header_size, SEEK_SET);
       if (filestream_error(stream->file))
          return;
 
+      /* Discard queued chunks */
+      stream->chunk_count = 0;
+      stream->in_buf      = stream->chunks[0].in_buf;
+
       /* Reset pointers */
       stream->virtual_ptr = 0;
       stream->in_buf_ptr  = 0;
@@ -969,7 +1282,7 @@ void rzipstream_rewind(rzipstream_t *stream)
           * from disk... */
 
          /* Reset file position to first chunk location */
-         filestream_seek(stream->file, RZIP_HEADER_SIZE, SEEK_SET);
+         filestream_seek(stream->file, stream->header_size, SEEK_SET);
          if (filestream_error(stream->file))
             return;
 
@@ -1051,6 +1364,7 @@ int rzipstream_close(rzipstream_t *stream)
    {
       if (    ((stream->in_buf_ptr > 0)
             && !rzipstream_write_chunk(stream))
+            || !rzipstream_flush_chunks(stream)
             || !rzipstream_write_file_header(stream))
       {
          /* Stream must be free()'d regardless */
@@ -33,6 +33,9 @@ struct zlib_trans_stream
    int window_bits;
    int level;
    bool inited;
+   /* Deflate: end non-flushing calls on a byte
+    * boundary, so that streams can be concatenated */
+   bool sync_flush;
 };
 
 static void *zlib_deflate_stream_new(void)
@@ -44,6 +47,7 @@ static void *zlib_deflate_stream_new(void)
    ret->inited      = false;
    ret->level       = 9;
    ret->window_bits = 15;
+   ret->sync_flush  = false;
 
    ret->z.next_in   = NULL;
    ret->z.avail_in  = 0;
@@ -125,6 +129,8 @@ static bool zlib_deflate_define(void *data, const char *prop, uint32_t val)
       z->level = (int) val;
    else if (string_is_equal(prop, "window_bits"))
       z->window_bits = (int) val;
+   else if (string_is_equal(prop, "sync_flush"))
+      z->sync_flush  = (val != 0);
    else
       return false;
 
@@ -209,7 +215,8 @@ static bool zlib_deflate_trans(
 
    pre_avail_in  = z->avail_in;
    pre_avail_out = z->avail_out;
-   zret          = deflate(z, flush ? Z_FINISH : Z_NO_FLUSH);
+   zret          = deflate(z, flush ? Z_FINISH
+         : (zt->sync_flush ? Z_SYNC_FLUSH : Z_NO_FLUSH));
 
    if (zret == Z_OK)
    {
@@ -0,0 +1,252 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_file_hash_cache.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utime.h>
+
+#include <file/file_hash_cache.h>
+#include <file/file_path.h>
+#include <rthreads/tpool.h>
+#include <streams/file_stream.h>
+
+#define SUITE_NAME "File Hash Cache"
+
+#define NUM_FILES 100
+/* FNV-1a as 8 hex digits */
+#define HASH_LEN 8
+
+static char *fnv_file(const char *path)
+{
+   int64_t i, len = 0;
+   void *buf      = NULL;
+   uint32_t h     = 0x811C9DC5u;
+   char *hash     = NULL;
+
+   if (!filestream_read_file(path, &buf, &len))
+      return NULL;
+   for (i = 0; i < len; i++)
+      h = (h ^ ((uint8_t*)buf)[i]) * 0x01000193u;
+   free(buf);
+
+   if ((hash = (char*)malloc(HASH_LEN + 1)))
+      snprintf(hash, HASH_LEN + 1, "%08x", (unsigned)h);
+   return hash;
+}
+
+static void write_file(const char *path, const char *data, time_t mtime)
+{
+   struct utimbuf times;
+   FILE *fd = fopen(path, "wb");
+
+   ck_assert_ptr_nonnull(fd);
+   fputs(data, fd);
+   fclose(fd);
+
+   /* Explicit times, so changes do not depend on the
+    * resolution of the filesystem clock */
+   times.actime  = mtime;
+   times.modtime = mtime;
+   ck_assert_int_eq(utime(path, &times), 0);
+}
+
+static const char *lookup_file(file_hash_cache_t *cache, const char *path)
+{
+   int64_t size, mtime;
+   ck_assert(path_get_size_mtime(path, &size, &mtime));
+   return file_hash_cache_lookup(cache, path, size, mtime);
+}
+
+START_TEST (test_file_hash_cache_round_trip)
+{
+   char a[512], b[512], store[512];
+   char *hash_a, *hash_b;
+   int64_t size, mtime;
+   file_hash_cache_t *cache = file_hash_cache_new(HASH_LEN);
+
+   ck_assert_ptr_nonnull(cache);
+   tmpnam(a);
+   tmpnam(b);
+   tmpnam(store);
+   write_file(a, "first file", 1000000);
+   write_file(b, "second file", 1000000);
+   hash_a = fnv_file(a);
+   hash_b = fnv_file(b);
+
+   /* Miss on an empty cache */
+   ck_assert_ptr_null(lookup_file(cache, a));
+
+   ck_assert(path_get_size_mtime(a, &size, &mtime));
+   ck_assert(file_hash_cache_insert(cache, a, size, mtime, hash_a));
+   ck_assert(path_get_size_mtime(b, &size, &mtime));
+   ck_assert(file_hash_cache_insert(cache, b, size, mtime, hash_b));
+   ck_assert(!file_hash_cache_insert(cache, b, size, mtime, "123"));
+   ck_assert_str_eq(lookup_file(cache, a), hash_a);
+
+   ck_assert(file_hash_cache_save(cache, store, "# test cache"));
+   file_hash_cache_free(cache);
+
+   ck_assert_ptr_nonnull(cache = file_hash_cache_new(HASH_LEN));
+   ck_assert(file_hash_cache_load(cache, store));
+   ck_assert_str_eq(lookup_file(cache, a), hash_a);
+   ck_assert_str_eq(lookup_file(cache, b), hash_b);
+
+   /* Same size, newer modification time */
+   write_file(a, "first file", 1000001);
+   ck_assert_ptr_null(lookup_file(cache, a));
+   /* Same modification time, different size */
+   write_file(b, "second file!", 1000000);
+   ck_assert_ptr_null(lookup_file(cache, b));
+
+   file_hash_cache_free(cache);
+   free(hash_a);
+   free(hash_b);
+   remove(a);
+   remove(b);
+   remove(store);
+}
+END_TEST
+
+/* Entries that were not used since loading are dropped */
+START_TEST (test_file_hash_cache_save_seen)
+{
+   char store[512];
+   file_hash_cache_t *cache = file_hash_cache_new(HASH_LEN);
+
+   ck_assert_ptr_nonnull(cache);
+   tmpnam(store);
+   write_file(store,
+         "# header\n"
+         "0000000a 1 2 /kept\n"
+         "0000000b 1 2 /dropped\n"
+         "0000000c 1 /no_mtime\n"
+         "0000d 1 2 /short_hash\n"
+         "0000000e x 2 /bad_size\n"
+         "0000000f 1 2 \n", 1000000);
+
+   ck_assert(file_hash_cache_load(cache, store));
+   ck_assert_str_eq(file_hash_cache_lookup(cache, "/kept", 1, 2), "0000000a");
+   ck_assert_ptr_null(file_hash_cache_lookup(cache, "/no_mtime", 1, 0));
+   ck_assert_ptr_null(file_hash_cache_lookup(cache, "/short_hash", 1, 2));
+   ck_assert_ptr_null(file_hash_cache_lookup(cache, "/bad_size", 0, 2));
+   ck_assert(file_hash_cache_save(cache, store, NULL));
+   file_hash_cache_free(cache);
+
+   ck_assert_ptr_nonnull(cache = file_hash_cache_new(HASH_LEN));
+   ck_assert(file_hash_cache_load(cache, store));
+   ck_assert_str_eq(file_hash_cache_lookup(cache, "/kept", 1, 2), "0000000a");
+   ck_assert_ptr_null(file_hash_cache_lookup(cache, "/dropped", 1, 2));
+   file_hash_cache_free(cache);
+
+   ck_assert(!file_hash_cache_load(NULL, store));
+   remove(store);
+   ck_assert_ptr_null(file_hash_cache_new(0));
+   ck_assert_ptr_null(file_hash_cache_new(FILE_HASH_CACHE_MAX_HASH + 1));
+}
+END_TEST
+
+START_TEST (test_file_hash_cache_fill)
+{
+   unsigned i;
+   char names[NUM_FILES][512];
+   const char *paths[NUM_FILES];
+   char *hashes[NUM_FILES];
+   tpool_t *pool            = tpool_create(4);
+   file_hash_cache_t *cache = file_hash_cache_new(HASH_LEN);
+
+   ck_assert_ptr_nonnull(pool);
+   ck_assert_ptr_nonnull(cache);
+   for (i = 0; i < NUM_FILES; i++)
+   {
+      char data[32];
+      tmpnam(names[i]);
+      snprintf(data, sizeof(data), "file %u", i);
+      write_file(names[i], data, 1000000);
+      paths[i] = names[i];
+   }
+
+   /* Everything is read and hashed as it would be serially */
+   ck_assert_uint_eq(file_hash_cache_fill(cache, pool, fnv_file,
+         paths, hashes, NUM_FILES), NUM_FILES);
+   for (i = 0; i < NUM_FILES; i++)
+   {
+      char *serial = fnv_file(paths[i]);
+      ck_assert_ptr_nonnull(hashes[i]);
+      ck_assert_str_eq(hashes[i], serial);
+      free(serial);
+      free(hashes[i]);
+   }
+
+   /* Nothing changed, so nothing is read */
+   ck_assert_uint_eq(file_hash_cache_fill(cache, pool, fnv_file,
+         paths, hashes, NUM_FILES), 0);
+   for (i = 0; i < NUM_FILES; i++)
+      free(hashes[i]);
+
+   /* Only the modified file is read; a missing file has
+    * no hash. Without a pool the caller hashes alone */
+   write_file(names[7], "modified", 1000000);
+   remove(names[9]);
+   ck_assert_uint_eq(file_hash_cache_fill(cache, NULL, fnv_file,
+         paths, hashes, NUM_FILES), 2);
+   ck_assert_ptr_null(hashes[9]);
+   {
+      char *serial = fnv_file(paths[7]);
+      ck_assert_str_eq(hashes[7], serial);
+      free(serial);
+   }
+   for (i = 0; i < NUM_FILES; i++)
+   {
+      free(hashes[i]);
+      remove(names[i]);
+   }
+
+   file_hash_cache_free(cache);
+   tpool_destroy(pool);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_file_hash_cache_round_trip);
+   tcase_add_test(tc_core, test_file_hash_cache_save_seen);
+   tcase_add_test(tc_core, test_file_hash_cache_fill);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+   int num_fail;
+   Suite *s = create_suite();
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+   num_fail = srunner_ntests_failed(sr);
+   srunner_free(sr);
+   return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,197 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (bench_rpng.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* rpng decode throughput benchmark.
+ *
+ * Decodes every PNG in a directory, such as a checkout of
+ * a libretro-thumbnails repository, several times and
+ * reports the time per image and the pixel rate. Without a
+ * directory, decodes generated thumbnail-sized images.
+ *
+ * Usage: bench_rpng [directory] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <file/file_path.h>
+#include <formats/image.h>
+#include <formats/rpng.h>
+#include <retro_dirent.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <time/rtime.h>
+#include <features/features_cpu.h>
+
+#include "../test_rand.h"
+
+#define BENCH_ITERATIONS  5
+#define BENCH_MAX_IMAGES  4096
+
+struct bench_image
+{
+   void *data;
+   int64_t len;
+};
+
+static bool bench_decode(const struct bench_image *img, uint64_t *pixels)
+{
+   int ret;
+   unsigned width  = 0;
+   unsigned height = 0;
+   void *out       = NULL;
+   rpng_t *rpng    = rpng_alloc();
+
+   if (!rpng)
+      return false;
+
+   rpng_set_buf_ptr(rpng, img->data, (size_t)img->len);
+   if (!rpng_start(rpng))
+   {
+      rpng_free(rpng);
+      return false;
+   }
+   while (rpng_iterate_image(rpng));
+
+   do
+   {
+      ret = rpng_process_image(rpng, &out, (size_t)img->len,
+            &width, &height);
+   } while (ret == IMAGE_PROCESS_NEXT);
+
+   rpng_free(rpng);
+   free(out);
+
+   if (ret != IMAGE_PROCESS_END)
+      return false;
+   *pixels += (uint64_t)width * height;
+   return true;
+}
+
+static unsigned bench_load_dir(const char *dir,
+      struct bench_image *images)
+{
+   unsigned count = 0;
+   struct RDIR *rdir = retro_opendir(dir);
+
+   if (!rdir)
+      return 0;
+
+   while (count < BENCH_MAX_IMAGES && retro_readdir(rdir))
+   {
+      char path[PATH_MAX_LENGTH];
+      const char *name = retro_dirent_get_name(rdir);
+
+      if (     retro_dirent_is_dir(rdir, NULL)
+            || !string_is_equal_noncase(path_get_extension(name), "png"))
+         continue;
+
+      fill_pathname_join_special(path, dir, name, sizeof(path));
+      if (filestream_read_file(path, &images[count].data,
+               &images[count].len))
+         count++;
+   }
+
+   retro_closedir(rdir);
+   return count;
+}
+
+/* Box art-like content: smooth areas, edges and noise */
+static unsigned bench_generate(struct bench_image *images)
+{
+   unsigned i, x, y;
+   uint32_t seed = 1;
+
+   for (i = 0; i < 64; i++)
+   {
+      char tmpfile[512];
+      unsigned width  = 512;
+      unsigned height = 360 + i * 4;
+      uint32_t *argb  = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+
+      if (!argb)
+         break;
+
+      for (y = 0; y < height; y++)
+         for (x = 0; x < width; x++)
+         {
+            test_rand(&seed);
+            argb[y * width + x] = 0xff000000
+               | (((x + i) * 255 / width) << 16)
+               | (((y ^ x) & 0x40) ? 0xa000 : 0x2000)
+               | ((y * 255 / height) ^ ((seed >> 28) & 7));
+         }
+
+      tmpnam(tmpfile);
+      if (     rpng_save_image_argb(tmpfile, argb, width, height,
+                  width * sizeof(uint32_t))
+            && filestream_read_file(tmpfile, &images[i].data,
+                  &images[i].len))
+         remove(tmpfile);
+      free(argb);
+   }
+
+   return i;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j, count;
+   retro_time_t start;
+   double total_ms         = 0.0;
+   uint64_t pixels         = 0;
+   struct bench_image *images = (struct bench_image*)calloc(
+         BENCH_MAX_IMAGES, sizeof(*images));
+
+   if (!images)
+      return EXIT_FAILURE;
+
+   count = (argc > 1) ? bench_load_dir(argv[1], images)
+      : bench_generate(images);
+   if (!count)
+   {
+      printf("No images to decode\n");
+      return EXIT_FAILURE;
+   }
+
+   start = cpu_features_get_time_usec();
+   for (j = 0; j < BENCH_ITERATIONS; j++)
+      for (i = 0; i < count; i++)
+         if (!bench_decode(&images[i], &pixels))
+         {
+            printf("Failed to decode image %u\n", i);
+            return EXIT_FAILURE;
+         }
+   total_ms = (cpu_features_get_time_usec() - start) / 1000.0;
+
+   printf("%u images: %.3f ms per image, %.1f Mpixels/s\n",
+         count,
+         total_ms / (count * BENCH_ITERATIONS),
+         (double)pixels / (total_ms * 1000.0));
+
+   for (i = 0; i < count; i++)
+      free(images[i].data);
+   free(images);
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_image_encode.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <formats/rpng.h>
+#include <formats/rqoi.h>
+
+#include "../test_rand.h"
+
+#define SUITE_NAME "image_encode"
+
+static uint32_t read_be32(const uint8_t *buf)
+{
+   return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16)
+        | ((uint32_t)buf[2] <<  8) |  (uint32_t)buf[3];
+}
+
+/* Bands of 16 rows: one colour (QOI runs), ramps with a
+ * little noise (QOI diffs) and noise (QOI literals), which
+ * also leave the PNG encoder different filters to pick */
+static uint8_t *make_bgr24(unsigned width, unsigned height)
+{
+   unsigned x, y;
+   uint32_t seed = 12345;
+   uint8_t *data = (uint8_t*)malloc(width * height * 3);
+   ck_assert(data != NULL);
+   for (y = 0; y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         uint8_t *px = data + (y * width + x) * 3;
+         test_rand(&seed);
+         if ((y / 16) % 3 == 0)
+         {
+            px[0] = 0x20;
+            px[1] = 0x40;
+            px[2] = 0x60;
+         }
+         else if ((y / 16) % 3 == 1)
+         {
+            px[0] = (uint8_t)(x + y);
+            px[1] = (uint8_t)(x * 2);
+            px[2] = (uint8_t)(y * 3 + ((seed >> 16) & 3));
+         }
+         else
+         {
+            px[0] = (uint8_t)(seed >> 8);
+            px[1] = (uint8_t)(seed >> 16);
+            px[2] = (uint8_t)(seed >> 24);
+         }
+      }
+   }
+   return data;
+}
+
+static uint8_t paeth(int a, int b, int c)
+{
+   int p  = a + b - c;
+   int pa = abs(p - a);
+   int pb = abs(p - b);
+   int pc = abs(p - c);
+   if (pa <= pb && pa <= pc)
+      return (uint8_t)a;
+   if (pb <= pc)
+      return (uint8_t)b;
+   return (uint8_t)c;
+}
+
+/* Decodes an 8-bit RGB PNG produced by rpng_encode back
+ * to BGR24 */
+static uint8_t *decode_png(const uint8_t *png, size_t png_size,
+      unsigned *width, unsigned *height)
+{
+   unsigned x, y;
+   uLongf raw_size;
+   size_t line_size;
+   uint8_t *raw, *out;
+   const uint8_t *idat = NULL;
+   uint32_t idat_size  = 0;
+   size_t pos          = 8;
+
+   ck_assert(png_size > 8 && memcmp(png + 1, "PNG", 3) == 0);
+   while (pos + 8 <= png_size)
+   {
+      uint32_t len = read_be32(png + pos);
+      if (memcmp(png + pos + 4, "IHDR", 4) == 0)
+      {
+         *width  = read_be32(png + pos + 8);
+         *height = read_be32(png + pos + 12);
+         ck_assert_int_eq(png[pos + 16], 8);
+         ck_assert_int_eq(png[pos + 17], 2);
+      }
+      else if (memcmp(png + pos + 4, "IDAT", 4) == 0)
+      {
+         idat      = png + pos + 8;
+         idat_size = len;
+      }
+      ck_assert_uint_eq(read_be32(png + pos + 8 + len),
+            crc32(0, png + pos + 4, len + 4));
+      pos += 12 + len;
+   }
+   ck_assert(idat != NULL);
+
+   line_size = *width * 3;
+   raw_size  = (line_size + 1) * *height;
+   raw       = (uint8_t*)malloc(raw_size);
+   out       = (uint8_t*)malloc(line_size * *height);
+   ck_assert(raw && out);
+   /* Also checks the Adler-32 */
+   ck_assert_int_eq(uncompress(raw, &raw_size, idat, idat_size), Z_OK);
+   ck_assert_uint_eq(raw_size, (line_size + 1) * *height);
+
+   for (y = 0; y < *height; y++)
+   {
+      uint8_t *line       = raw + y * (line_size + 1);
+      uint8_t filter      = *line++;
+      const uint8_t *prev = y ? raw + (y - 1) * (line_size + 1) + 1 : NULL;
+      for (x = 0; x < line_size; x++)
+      {
+         int a = x >= 3 ? line[x - 3] : 0;
+         int b = prev ? prev[x] : 0;
+         int c = (prev && x >= 3) ? prev[x - 3] : 0;
+         switch (filter)
+         {
+            case 1: line[x] += a; break;
+            case 2: line[x] += b; break;
+            case 3: line[x] += (a + b) >> 1; break;
+            case 4: line[x] += paeth(a, b, c); break;
+            default: break;
+         }
+      }
+      for (x = 0; x < *width; x++)
+      {
+         out[y * line_size + x * 3 + 0] = line[x * 3 + 2];
+         out[y * line_size + x * 3 + 1] = line[x * 3 + 1];
+         out[y * line_size + x * 3 + 2] = line[x * 3 + 0];
+      }
+   }
+
+   free(raw);
+   return out;
+}
+
+/* Decodes a 3-channel QOI image back to BGR24 */
+static uint8_t *decode_qoi(const uint8_t *qoi, size_t qoi_size,
+      unsigned *width, unsigned *height)
+{
+   size_t i, num_px;
+   uint8_t index[64][3];
+   uint8_t px[3]       = {0, 0, 0};
+   unsigned run        = 0;
+   size_t pos          = 14;
+   uint8_t *out;
+
+   ck_assert(qoi_size >= 22 && memcmp(qoi, "qoif", 4) == 0);
+   *width  = read_be32(qoi + 4);
+   *height = read_be32(qoi + 8);
+   ck_assert_int_eq(qoi[12], 3);
+   ck_assert(memcmp(qoi + qoi_size - 8, "\0\0\0\0\0\0\0\1", 8) == 0);
+
+   num_px = (size_t)*width * *height;
+   out    = (uint8_t*)malloc(num_px * 3);
+   ck_assert(out != NULL);
+   memset(index, 0, sizeof(index));
+
+   for (i = 0; i < num_px; i++)
+   {
+      if (run > 0)
+         run--;
+      else
+      {
+         uint8_t b1;
+         ck_assert(pos < qoi_size - 8);
+         b1 = qoi[pos++];
+         if (b1 == 0xfe)
+         {
+            px[0] = qoi[pos++];
+            px[1] = qoi[pos++];
+            px[2] = qoi[pos++];
+         }
+         else if ((b1 & 0xc0) == 0x00)
+            memcpy(px, index[b1], 3);
+         else if ((b1 & 0xc0) == 0x40)
+         {
+            px[0] += ((b1 >> 4) & 3) - 2;
+            px[1] += ((b1 >> 2) & 3) - 2;
+            px[2] += ( b1       & 3) - 2;
+         }
+         else if ((b1 & 0xc0) == 0x80)
+         {
+            uint8_t b2 = qoi[pos++];
+            int vg     = (b1 & 0x3f) - 32;
+            px[0]     += vg - 8 + ((b2 >> 4) & 0x0f);
+            px[1]     += vg;
+            px[2]     += vg - 8 +  (b2       & 0x0f);
+         }
+         else
+            run = b1 & 0x3f;
+         memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) & 63],
+               px, 3);
+      }
+      out[i * 3 + 0] = px[2];
+      out[i * 3 + 1] = px[1];
+      out[i * 3 + 2] = px[0];
+   }
+   ck_assert_uint_eq(pos, qoi_size - 8);
+
+   return out;
+}
+
+static void check_png(unsigned width, unsigned height)
+{
+   unsigned w, h;
+   uint64_t bytes = 0;
+   uint8_t *data  = make_bgr24(width, height);
+   uint8_t *png   = rpng_save_image_bgr24_string(data,
+         width, height, (signed)(width * 3), &bytes);
+   uint8_t *out;
+
+   ck_assert(png != NULL);
+   out = decode_png(png, (size_t)bytes, &w, &h);
+   ck_assert_uint_eq(w, width);
+   ck_assert_uint_eq(h, height);
+   ck_assert(memcmp(out, data, width * height * 3) == 0);
+
+   free(out);
+   free(png);
+   free(data);
+}
+
+static void check_qoi(unsigned width, unsigned height)
+{
+   unsigned w, h;
+   uint64_t bytes = 0;
+   uint8_t *data  = make_bgr24(width, height);
+   uint8_t *qoi   = rqoi_save_image_bgr24_string(data,
+         width, height, (signed)(width * 3), &bytes);
+   uint8_t *out;
+
+   ck_assert(qoi != NULL);
+   out = decode_qoi(qoi, (size_t)bytes, &w, &h);
+   ck_assert_uint_eq(w, width);
+   ck_assert_uint_eq(h, height);
+   ck_assert(memcmp(out, data, width * height * 3) == 0);
+
+   free(out);
+   free(qoi);
+   free(data);
+}
+
+START_TEST (test_png_small)
+{
+   check_png(1, 1);
+   check_png(17, 5);
+}
+END_TEST
+
+/* Tall enough to be split into several strips */
+START_TEST (test_png_strips)
+{
+   check_png(320, 240);
+   check_png(641, 479);
+}
+END_TEST
+
+START_TEST (test_qoi)
+{
+   check_qoi(1, 1);
+   check_qoi(320, 240);
+   check_qoi(641, 479);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_png_small);
+   tcase_add_test(tc_core, test_png_strips);
+   tcase_add_test(tc_core, test_qoi);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+   int num_fail;
+   Suite *s = create_suite();
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+   num_fail = srunner_ntests_failed(sr);
+   srunner_free(sr);
+   return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
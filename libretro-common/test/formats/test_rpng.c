@@ -0,0 +1,192 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_rpng.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <formats/image.h>
+#include <formats/rpng.h>
+#include <streams/file_stream.h>
+
+#include "../test_rand.h"
+
+#define SUITE_NAME "rpng"
+
+/* Bands of 8 rows, cycling through opaque flat colour,
+ * opaque ramps, noise under an alpha ramp, and an alpha
+ * ramp over faint noise, to decode RGB and RGBA rows
+ * under every filter type */
+static uint32_t make_pixel(unsigned x, unsigned y, uint32_t *seed)
+{
+   test_rand(seed);
+   switch ((y / 8) % 4)
+   {
+      case 0:
+         return 0xff204060;
+      case 1:
+         return 0xff000000 | ((x * 3) << 16) | ((x + y) << 8) | (y * 5);
+      case 2:
+         return (*seed >> 8) | ((uint32_t)(x * 7) << 24);
+      default:
+         break;
+   }
+   return (((x + y) & 0xff) << 24) | ((*seed >> 16) & 0x0f0f0f);
+}
+
+static uint32_t *decode(const void *png, size_t len,
+      unsigned *width, unsigned *height)
+{
+   int ret;
+   void *out   = NULL;
+   rpng_t *rpng = rpng_alloc();
+
+   ck_assert(rpng != NULL);
+   ck_assert(rpng_set_buf_ptr(rpng, (void*)png, len));
+   ck_assert(rpng_start(rpng));
+   while (rpng_iterate_image(rpng));
+   ck_assert(rpng_is_valid(rpng));
+
+   do
+   {
+      ret = rpng_process_image(rpng, &out, len, width, height);
+   } while (ret == IMAGE_PROCESS_NEXT);
+
+   ck_assert_int_eq(ret, IMAGE_PROCESS_END);
+   rpng_free(rpng);
+   return (uint32_t*)out;
+}
+
+static void check_rgb(unsigned width, unsigned height)
+{
+   unsigned x, y, w, h;
+   uint64_t bytes  = 0;
+   uint32_t seed   = 1;
+   uint8_t *bgr    = (uint8_t*)malloc(width * height * 3);
+   uint8_t *png;
+   uint32_t *out;
+
+   ck_assert(bgr != NULL);
+   for (y = 0; y < height; y++)
+      for (x = 0; x < width; x++)
+      {
+         uint32_t px = make_pixel(x, y, &seed);
+         uint8_t *p  = bgr + (y * width + x) * 3;
+         p[0]        = (uint8_t)(px >>  0);
+         p[1]        = (uint8_t)(px >>  8);
+         p[2]        = (uint8_t)(px >> 16);
+      }
+
+   png = rpng_save_image_bgr24_string(bgr, width, height,
+         (signed)(width * 3), &bytes);
+   ck_assert(png != NULL);
+
+   out = decode(png, (size_t)bytes, &w, &h);
+   ck_assert_int_eq(w, width);
+   ck_assert_int_eq(h, height);
+   for (y = 0; y < height; y++)
+      for (x = 0; x < width; x++)
+      {
+         const uint8_t *p = bgr + (y * width + x) * 3;
+         ck_assert_int_eq(out[y * width + x], 0xff000000
+               | (p[2] << 16) | (p[1] << 8) | p[0]);
+      }
+
+   free(out);
+   free(png);
+   free(bgr);
+}
+
+static void check_rgba(unsigned width, unsigned height)
+{
+   unsigned x, y, w, h;
+   char tmpfile[512];
+   int64_t len    = 0;
+   void *png      = NULL;
+   uint32_t seed  = 1;
+   uint32_t *argb = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+   uint32_t *out;
+
+   ck_assert(argb != NULL);
+   for (y = 0; y < height; y++)
+      for (x = 0; x < width; x++)
+         argb[y * width + x] = make_pixel(x, y, &seed);
+
+   tmpnam(tmpfile);
+   ck_assert(rpng_save_image_argb(tmpfile, argb, width, height,
+            width * sizeof(uint32_t)));
+   ck_assert(filestream_read_file(tmpfile, &png, &len));
+   remove(tmpfile);
+
+   out = decode(png, (size_t)len, &w, &h);
+   ck_assert_int_eq(w, width);
+   ck_assert_int_eq(h, height);
+   ck_assert(memcmp(out, argb, width * height * sizeof(uint32_t)) == 0);
+
+   free(out);
+   free(png);
+   free(argb);
+}
+
+/* Odd widths leave partial SIMD blocks at the end of
+ * every line */
+START_TEST (test_rpng_rgb)
+{
+   check_rgb(1, 1);
+   check_rgb(5, 3);
+   check_rgb(33, 40);
+   check_rgb(320, 240);
+}
+END_TEST
+
+START_TEST (test_rpng_rgba)
+{
+   check_rgba(1, 1);
+   check_rgba(5, 3);
+   check_rgba(33, 40);
+   check_rgba(320, 240);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_rpng_rgb);
+   tcase_add_test(tc_core, test_rpng_rgba);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+   int num_fail;
+   Suite *s = create_suite();
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+   num_fail = srunner_ntests_failed(sr);
+   srunner_free(sr);
+   return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,96 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (bench_crc32.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* CRC32 throughput benchmark.
+ *
+ * Hashes buffers of several sizes with encoding_crc32(), then
+ * hashes the largest one as independent chunks merged with
+ * encoding_crc32_combine(), the way a multi-threaded hasher
+ * would, and checks both agree.
+ *
+ * Usage: bench_crc32 [total MB per size, default 256] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <encodings/crc32.h>
+#include <time/rtime.h>
+#include <features/features_cpu.h>
+
+#define BENCH_MAX_SIZE   (16 * 1024 * 1024)
+#define BENCH_CHUNK_SIZE (1024 * 1024)
+
+static double bench_seconds(retro_time_t start)
+{
+   return (cpu_features_get_time_usec() - start) / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t sizes[] = { 64, 1024, 64 * 1024, BENCH_MAX_SIZE };
+   size_t i;
+   uint32_t crc, combined;
+   retro_time_t start;
+   double secs;
+   size_t total_mb = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : 256;
+   uint8_t *buf    = (uint8_t*)malloc(BENCH_MAX_SIZE);
+
+   if (!buf || !total_mb)
+      return EXIT_FAILURE;
+
+   for (i = 0; i < BENCH_MAX_SIZE; i++)
+      buf[i] = (uint8_t)(i * 2654435761u >> 24);
+
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      size_t j;
+      size_t iterations = (total_mb * 1024 * 1024) / sizes[i];
+
+      crc   = 0;
+      start = cpu_features_get_time_usec();
+      for (j = 0; j < iterations; j++)
+         crc = encoding_crc32(crc, buf, sizes[i]);
+      secs  = bench_seconds(start);
+
+      printf("%10u bytes: %9.1f MB/s (crc %08x)\n",
+            (unsigned)sizes[i],
+            (iterations * sizes[i]) / (1024.0 * 1024.0) / secs,
+            (unsigned)crc);
+   }
+
+   crc      = encoding_crc32(0, buf, BENCH_MAX_SIZE);
+   combined = 0;
+   start    = cpu_features_get_time_usec();
+   for (i = 0; i < BENCH_MAX_SIZE; i += BENCH_CHUNK_SIZE)
+      combined = encoding_crc32_combine(combined,
+            encoding_crc32(0, buf + i, BENCH_CHUNK_SIZE),
+            BENCH_CHUNK_SIZE);
+   secs     = bench_seconds(start);
+
+   printf("%10s chunks: %9.1f MB/s (crc %08x, %s)\n", "1 MB",
+         BENCH_MAX_SIZE / (1024.0 * 1024.0) / secs, (unsigned)combined,
+         (combined == crc) ? "matches" : "MISMATCH");
+
+   free(buf);
+   return (combined == crc) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
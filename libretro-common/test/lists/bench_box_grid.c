@@ -0,0 +1,237 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (bench_box_grid.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Overlay hit-testing benchmark.
+ *
+ * Builds synthetic overlays laid out like common ones (a
+ * gamepad, a full keyboard, a stacked arcade panel) and
+ * polls them with 1 and 10 touch points, testing every
+ * descriptor the way input_overlay_poll() used to and
+ * testing only box_grid_query() candidates. Both must
+ * report the same hits.
+ *
+ * Usage: bench_box_grid [polls per case, default 200000] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include <boolean.h>
+#include <lists/box_grid.h>
+#include <time/rtime.h>
+#include <features/features_cpu.h>
+
+#include "../test_rand.h"
+
+#define BENCH_MAX_DESCS   512
+#define BENCH_MAX_TOUCHES 10
+#define BENCH_NUM_POINTS  4096
+
+typedef struct
+{
+   float x, y;
+   float range_x, range_y;
+   bool radial;
+} bench_desc_t;
+
+typedef struct
+{
+   const char *name;
+   bench_desc_t descs[BENCH_MAX_DESCS];
+   box_grid_box_t boxes[BENCH_MAX_DESCS];
+   size_t size;
+} bench_overlay_t;
+
+static bench_overlay_t overlays[3];
+static float points[BENCH_NUM_POINTS][2];
+
+static void bench_add(bench_overlay_t *ol, float x, float y,
+      float range_x, float range_y, bool radial)
+{
+   bench_desc_t *desc = &ol->descs[ol->size];
+   box_grid_box_t *box = &ol->boxes[ol->size++];
+
+   desc->x       = x;
+   desc->y       = y;
+   desc->range_x = range_x;
+   desc->range_y = range_y;
+   desc->radial  = radial;
+   box->x_min    = x - range_x;
+   box->x_max    = x + range_x;
+   box->y_min    = y - range_y;
+   box->y_max    = y + range_y;
+}
+
+static void bench_build_overlays(void)
+{
+   unsigned i, j, layer;
+
+   /* Gamepad: d-pad, sticks, face and shoulder buttons */
+   overlays[0].name = "gamepad";
+   bench_add(&overlays[0], 0.15f, 0.70f, 0.12f, 0.12f, true);
+   bench_add(&overlays[0], 0.30f, 0.85f, 0.08f, 0.08f, true);
+   bench_add(&overlays[0], 0.70f, 0.85f, 0.08f, 0.08f, true);
+   for (i = 0; i < 4; i++)
+      bench_add(&overlays[0], 0.85f + 0.06f * ((i & 1) ? 1 : -1) * (i < 2),
+            0.70f + 0.06f * ((i & 1) ? 1 : -1) * (i >= 2), 0.04f, 0.04f, true);
+   for (i = 0; i < 4; i++)
+      bench_add(&overlays[0], i < 2 ? 0.1f : 0.9f, 0.1f + 0.08f * (i & 1),
+            0.08f, 0.03f, false);
+   for (i = 0; i < 6; i++)
+      bench_add(&overlays[0], 0.35f + 0.06f * i, 0.05f, 0.025f, 0.02f, false);
+
+   /* Keyboard: 5 rows of 22 keys */
+   overlays[1].name = "keyboard";
+   for (j = 0; j < 5; j++)
+      for (i = 0; i < 22; i++)
+         bench_add(&overlays[1], (i + 0.5f) / 22.0f,
+               0.5f + (j + 0.5f) / 10.0f, 0.02f, 0.045f, false);
+
+   /* Arcade panel: 3 overlapping layers of 50 buttons plus
+    * large areas spanning the whole panel */
+   overlays[2].name = "arcade";
+   for (layer = 0; layer < 3; layer++)
+      for (j = 0; j < 5; j++)
+         for (i = 0; i < 10; i++)
+            bench_add(&overlays[2], (i + 0.5f + layer * 0.3f) / 10.0f,
+                  (j + 0.5f + layer * 0.3f) / 5.0f, 0.04f, 0.08f,
+                  (i + j) & 1);
+   for (i = 0; i < 4; i++)
+      bench_add(&overlays[2], 0.25f + 0.5f * (i & 1), 0.25f + 0.5f * (i >> 1),
+            0.25f, 0.25f, false);
+}
+
+static bool bench_inside(const bench_desc_t *desc, float x, float y)
+{
+   if (desc->radial)
+   {
+      float x_dist = (x - desc->x) / desc->range_x;
+      float y_dist = (y - desc->y) / desc->range_y;
+      return x_dist * x_dist + y_dist * y_dist <= 1.0f;
+   }
+   return fabs(x - desc->x) <= desc->range_x
+       && fabs(y - desc->y) <= desc->range_y;
+}
+
+/* Returns a checksum of the hit indexes */
+static uint64_t bench_poll_linear(const bench_overlay_t *ol,
+      const float (*touch)[2], unsigned touches)
+{
+   unsigned t;
+   size_t i;
+   uint64_t sum = 0;
+
+   for (t = 0; t < touches; t++)
+      for (i = 0; i < ol->size; i++)
+         if (bench_inside(&ol->descs[i], touch[t][0], touch[t][1]))
+            sum += i + 1;
+   return sum;
+}
+
+static uint64_t bench_poll_grid(const bench_overlay_t *ol,
+      const box_grid_t *grid, const float (*touch)[2], unsigned touches)
+{
+   unsigned t;
+   size_t k, size;
+   uint64_t sum = 0;
+
+   for (t = 0; t < touches; t++)
+   {
+      const unsigned *items = box_grid_query(grid,
+            touch[t][0], touch[t][1], &size);
+      for (k = 0; k < size; k++)
+         if (bench_inside(&ol->descs[items[k]], touch[t][0], touch[t][1]))
+            sum += items[k] + 1;
+   }
+   return sum;
+}
+
+int main(int argc, char *argv[])
+{
+   static const unsigned touch_counts[] = { 1, BENCH_MAX_TOUCHES };
+   unsigned i, o, t;
+   uint32_t seed = 1;
+   bool ok       = true;
+   size_t polls  = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : 200000;
+
+   if (!polls)
+      return EXIT_FAILURE;
+
+   bench_build_overlays();
+
+   /* Touches land anywhere, a bit past the screen edges */
+   for (i = 0; i < BENCH_NUM_POINTS; i++)
+   {
+      points[i][0] = ((test_rand(&seed) >> 8) & 0xffff)
+            / 65535.0f * 1.1f - 0.05f;
+      points[i][1] = ((test_rand(&seed) >> 8) & 0xffff)
+            / 65535.0f * 1.1f - 0.05f;
+   }
+
+   for (o = 0; o < sizeof(overlays) / sizeof(overlays[0]); o++)
+   {
+      const bench_overlay_t *ol = &overlays[o];
+      box_grid_t *grid          = box_grid_new(ol->boxes, ol->size);
+
+      if (!grid)
+         return EXIT_FAILURE;
+
+      for (t = 0; t < sizeof(touch_counts) / sizeof(touch_counts[0]); t++)
+      {
+         size_t p;
+         retro_time_t start;
+         double linear_secs, grid_secs;
+         unsigned touches     = touch_counts[t];
+         uint64_t linear_sum  = 0;
+         uint64_t grid_sum    = 0;
+
+         start       = cpu_features_get_time_usec();
+         for (p = 0; p < polls; p++)
+            linear_sum += bench_poll_linear(ol,
+                  &points[(p * touches) % (BENCH_NUM_POINTS - touches)],
+                  touches);
+         linear_secs = (cpu_features_get_time_usec() - start) / 1000000.0;
+
+         start       = cpu_features_get_time_usec();
+         for (p = 0; p < polls; p++)
+            grid_sum   += bench_poll_grid(ol, grid,
+                  &points[(p * touches) % (BENCH_NUM_POINTS - touches)],
+                  touches);
+         grid_secs   = (cpu_features_get_time_usec() - start) / 1000000.0;
+
+         printf("%-8s %3u descs %2u touches: linear %10.0f polls/s, "
+               "grid %10.0f polls/s (%.1fx)%s\n",
+               ol->name, (unsigned)ol->size, touches,
+               polls / linear_secs, polls / grid_secs,
+               linear_secs / grid_secs,
+               (linear_sum == grid_sum) ? "" : " MISMATCH");
+
+         if (linear_sum != grid_sum)
+            ok = false;
+      }
+
+      box_grid_free(grid);
+   }
+
+   return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
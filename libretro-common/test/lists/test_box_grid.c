@@ -0,0 +1,192 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_box_grid.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+
+#include <lists/box_grid.h>
+
+#include "../test_rand.h"
+
+#define SUITE_NAME "Box Grid"
+
+#define NUM_BOXES 300
+
+static uint32_t rand_state = 12345;
+
+static float rand_float(void)
+{
+   return (float)((test_rand(&rand_state) >> 8) & 0xffff) / 65535.0f;
+}
+
+static bool box_contains(const box_grid_box_t *box, float x, float y)
+{
+   return x >= box->x_min && x <= box->x_max
+       && y >= box->y_min && y <= box->y_max;
+}
+
+/* Every box containing the point must be a candidate,
+ * and candidates must be strictly ascending */
+static void check_point(const box_grid_t *grid,
+      const box_grid_box_t *boxes, size_t count, float x, float y)
+{
+   size_t i, size, k = 0;
+   const unsigned *items = box_grid_query(grid, x, y, &size);
+
+   for (i = 1; i < size; i++)
+      ck_assert_uint_lt(items[i - 1], items[i]);
+
+   for (i = 0; i < count; i++)
+   {
+      if (!box_contains(&boxes[i], x, y))
+         continue;
+      while (k < size && items[k] < i)
+         k++;
+      ck_assert_msg(k < size && items[k] == i,
+            "box %u missing at (%f, %f)", (unsigned)i, x, y);
+   }
+}
+
+START_TEST (test_box_grid_empty)
+{
+   size_t size          = 1;
+   box_grid_box_t box   = { 1.0f, 1.0f, 0.0f, 0.0f };
+   box_grid_t *grid     = box_grid_new(NULL, 0);
+
+   ck_assert_ptr_nonnull(grid);
+   ck_assert_ptr_null(box_grid_query(grid, 0.0f, 0.0f, &size));
+   ck_assert_uint_eq(size, 0);
+   box_grid_free(grid);
+
+   /* Inverted boxes are left out */
+   grid = box_grid_new(&box, 1);
+   ck_assert_ptr_nonnull(grid);
+   ck_assert_ptr_null(box_grid_query(grid, 0.5f, 0.5f, &size));
+   ck_assert_uint_eq(size, 0);
+   box_grid_free(grid);
+
+   box_grid_free(NULL);
+}
+END_TEST
+
+START_TEST (test_box_grid_point_box)
+{
+   size_t size;
+   const unsigned *items;
+   box_grid_box_t boxes[2] = {
+      { 0.25f, 0.25f, 0.25f, 0.25f },
+      { 0.25f, 0.25f, 0.25f, 0.25f }
+   };
+   box_grid_t *grid = box_grid_new(boxes, 2);
+
+   ck_assert_ptr_nonnull(grid);
+   items = box_grid_query(grid, 0.25f, 0.25f, &size);
+   ck_assert_uint_eq(size, 2);
+   ck_assert_uint_eq(items[0], 0);
+   ck_assert_uint_eq(items[1], 1);
+   ck_assert_ptr_null(box_grid_query(grid, 0.26f, 0.25f, &size));
+   box_grid_free(grid);
+}
+END_TEST
+
+START_TEST (test_box_grid_outside)
+{
+   size_t size;
+   box_grid_box_t box = { 0.25f, 0.5f, 0.75f, 1.0f };
+   box_grid_t *grid   = box_grid_new(&box, 1);
+
+   ck_assert_ptr_nonnull(grid);
+   ck_assert_ptr_null(box_grid_query(grid, 0.2f, 0.75f, &size));
+   ck_assert_ptr_null(box_grid_query(grid, 0.8f, 0.75f, &size));
+   ck_assert_ptr_null(box_grid_query(grid, 0.5f, 0.4f, &size));
+   ck_assert_ptr_null(box_grid_query(grid, 0.5f, 1.1f, &size));
+   ck_assert_ptr_nonnull(box_grid_query(grid, 0.25f, 1.0f, &size));
+   ck_assert_uint_eq(size, 1);
+   box_grid_free(grid);
+}
+END_TEST
+
+START_TEST (test_box_grid_random)
+{
+   size_t i;
+   box_grid_t *grid;
+   box_grid_box_t boxes[NUM_BOXES];
+
+   for (i = 0; i < NUM_BOXES; i++)
+   {
+      float x = rand_float() * 1.2f - 0.1f;
+      float y = rand_float() * 1.2f - 0.1f;
+      /* Mostly small keys, some wide panels, some gaps */
+      float w = (i % 17) ? rand_float() * 0.08f : rand_float() * 0.8f;
+      float h = (i % 13) ? rand_float() * 0.08f : rand_float() * 0.8f;
+      boxes[i].x_min = x - w;
+      boxes[i].x_max = x + w;
+      boxes[i].y_min = y - h;
+      boxes[i].y_max = y + h;
+      if (i % 29 == 0)
+         boxes[i].x_max = boxes[i].x_min - 1.0f;
+   }
+
+   grid = box_grid_new(boxes, NUM_BOXES);
+   ck_assert_ptr_nonnull(grid);
+
+   for (i = 0; i < 20000; i++)
+      check_point(grid, boxes, NUM_BOXES,
+            rand_float() * 1.4f - 0.2f, rand_float() * 1.4f - 0.2f);
+
+   /* Edges and corners */
+   for (i = 0; i < NUM_BOXES; i++)
+   {
+      check_point(grid, boxes, NUM_BOXES, boxes[i].x_min, boxes[i].y_min);
+      check_point(grid, boxes, NUM_BOXES, boxes[i].x_max, boxes[i].y_max);
+      check_point(grid, boxes, NUM_BOXES, boxes[i].x_min, boxes[i].y_max);
+      check_point(grid, boxes, NUM_BOXES, boxes[i].x_max, boxes[i].y_min);
+   }
+
+   box_grid_free(grid);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_box_grid_empty);
+   tcase_add_test(tc_core, test_box_grid_point_box);
+   tcase_add_test(tc_core, test_box_grid_outside);
+   tcase_add_test(tc_core, test_box_grid_random);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+   int num_fail;
+   Suite *s = create_suite();
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+   num_fail = srunner_ntests_failed(sr);
+   srunner_free(sr);
+   return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
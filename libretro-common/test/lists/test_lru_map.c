@@ -0,0 +1,176 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_lru_map.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <lists/lru_map.h>
+
+#include "../test_rand.h"
+
+#define SUITE_NAME "LRU Map"
+
+#define CAPACITY 300
+#define KEY_RANGE 1000
+
+static uint32_t rand_state = 12345;
+
+static unsigned rand_key(void)
+{
+   return (test_rand(&rand_state) >> 8) % KEY_RANGE;
+}
+
+START_TEST (test_lru_map_basic)
+{
+   bool evicted;
+   uint32_t evicted_key;
+   lru_map_t *map = lru_map_new(2);
+
+   ck_assert_ptr_nonnull(map);
+   ck_assert_int_eq(lru_map_get(map, 7), -1);
+   ck_assert_uint_eq(lru_map_put(map, 7, &evicted, NULL), 0);
+   ck_assert(!evicted);
+   ck_assert_uint_eq(lru_map_put(map, 9, &evicted, NULL), 1);
+   ck_assert(!evicted);
+   ck_assert_uint_eq(lru_map_size(map), 2);
+
+   /* 7 becomes the most recently used, so 9 goes */
+   ck_assert_int_eq(lru_map_get(map, 7), 0);
+   ck_assert_uint_eq(lru_map_put(map, 11, &evicted, &evicted_key), 1);
+   ck_assert(evicted);
+   ck_assert_uint_eq(evicted_key, 9);
+   ck_assert_int_eq(lru_map_get(map, 9), -1);
+   ck_assert_int_eq(lru_map_get(map, 11), 1);
+   ck_assert_int_eq(lru_map_get(map, 7), 0);
+   ck_assert_uint_eq(lru_map_size(map), 2);
+
+   lru_map_free(map);
+   lru_map_free(NULL);
+   ck_assert_ptr_null(lru_map_new(0));
+}
+END_TEST
+
+/* Checks the map against a model that tracks the last use
+ * of every key */
+START_TEST (test_lru_map_random)
+{
+   unsigned i, k;
+   unsigned last_use[KEY_RANGE];
+   int slot_of[KEY_RANGE];
+   uint32_t key_of[CAPACITY];
+   lru_map_t *map = lru_map_new(CAPACITY);
+
+   ck_assert_ptr_nonnull(map);
+   memset(last_use, 0, sizeof(last_use));
+   for (k = 0; k < KEY_RANGE; k++)
+      slot_of[k] = -1;
+
+   for (i = 1; i <= 200000; i++)
+   {
+      unsigned key = rand_key();
+      int slot     = lru_map_get(map, key);
+
+      ck_assert_int_eq(slot, slot_of[key]);
+
+      if (slot < 0)
+      {
+         bool evicted;
+         uint32_t evicted_key = 0;
+         unsigned expected    = KEY_RANGE;
+
+         /* The least recently used key must go */
+         if (lru_map_size(map) == CAPACITY)
+            for (k = 0; k < KEY_RANGE; k++)
+               if (     slot_of[k] >= 0
+                     && (expected == KEY_RANGE
+                        || last_use[k] < last_use[expected]))
+                  expected = k;
+
+         slot = (int)lru_map_put(map, key, &evicted, &evicted_key);
+         ck_assert_int_lt(slot, CAPACITY);
+
+         if (expected != KEY_RANGE)
+         {
+            ck_assert(evicted);
+            ck_assert_uint_eq(evicted_key, expected);
+            ck_assert_int_eq(slot, slot_of[expected]);
+            slot_of[expected] = -1;
+         }
+         else
+            ck_assert(!evicted);
+
+         slot_of[key]  = slot;
+         key_of[slot]  = key;
+      }
+
+      ck_assert_uint_eq(key_of[slot], key);
+      last_use[key] = i;
+   }
+
+   lru_map_free(map);
+}
+END_TEST
+
+/* Keys that collide in the low bits, as codepoints of one
+ * script do */
+START_TEST (test_lru_map_clustered)
+{
+   unsigned i;
+   lru_map_t *map = lru_map_new(64);
+
+   ck_assert_ptr_nonnull(map);
+   for (i = 0; i < 4096; i++)
+   {
+      uint32_t key = 0x4E00 + (i % 96) * 256;
+      if (lru_map_get(map, key) < 0)
+         lru_map_put(map, key, NULL, NULL);
+      ck_assert_int_ge(lru_map_get(map, key), 0);
+   }
+   ck_assert_uint_eq(lru_map_size(map), 64);
+   lru_map_free(map);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_lru_map_basic);
+   tcase_add_test(tc_core, test_lru_map_random);
+   tcase_add_test(tc_core, test_lru_map_clustered);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+   int num_fail;
+   Suite *s = create_suite();
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+   num_fail = srunner_ntests_failed(sr);
+   srunner_free(sr);
+   return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,583 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_net_http.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <net/net_http.h>
+#include <lists/string_list.h>
+#include <rthreads/rthreads.h>
+#include <retro_timers.h>
+
+#define SUITE_NAME "net_http"
+
+#define TEST_ETAG "\"thumb-1\""
+#define TEST_BODY "PNGDATA"
+
+/* Minimal keep-alive HTTP/1.1 stand-in: serves TEST_BODY with
+ * an ETag, and answers a matching If-None-Match with a bodyless
+ * 304 while keeping the connection open */
+typedef struct
+{
+   int listen_fd;
+   int client_fd;
+   int port;
+   int accepts;
+   int requests;
+   int not_modified;
+} test_server_t;
+
+static void test_server_handle(test_server_t *server, int fd)
+{
+   char buf[4096];
+   size_t pos = 0;
+
+   for (;;)
+   {
+      char *end;
+      char reply[512];
+      ssize_t len = recv(fd, buf + pos, sizeof(buf) - 1 - pos, 0);
+
+      if (len <= 0)
+         return;
+
+      pos      += (size_t)len;
+      buf[pos]  = '\0';
+
+      /* Process every complete request in the buffer */
+      while ((end = strstr(buf, "\r\n\r\n")))
+      {
+         size_t req_len = (size_t)(end + 4 - buf);
+
+         *end = '\0';
+         server->requests++;
+
+         if (strstr(buf, "If-None-Match: " TEST_ETAG))
+         {
+            server->not_modified++;
+            /* Content-Length describes the unchanged
+             * representation here, not a body */
+            snprintf(reply, sizeof(reply),
+                  "HTTP/1.1 304 Not Modified\r\n"
+                  "ETag: " TEST_ETAG "\r\n"
+                  "Content-Length: %u\r\n"
+                  "\r\n",
+                  (unsigned)strlen(TEST_BODY));
+         }
+         else
+            snprintf(reply, sizeof(reply),
+                  "HTTP/1.1 200 OK\r\n"
+                  "ETag: " TEST_ETAG "\r\n"
+                  "Last-Modified: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+                  "Content-Length: %u\r\n"
+                  "\r\n"
+                  TEST_BODY,
+                  (unsigned)strlen(TEST_BODY));
+
+         send(fd, reply, strlen(reply), 0);
+
+         memmove(buf, buf + req_len, pos - req_len);
+         pos      -= req_len;
+         buf[pos]  = '\0';
+      }
+   }
+}
+
+static void test_server_thread(void *data)
+{
+   test_server_t *server = (test_server_t*)data;
+   int fd;
+
+   while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0)
+   {
+      server->accepts++;
+      server->client_fd = fd;
+      test_server_handle(server, fd);
+      close(fd);
+   }
+}
+
+static sthread_t *test_server_start(test_server_t *server)
+{
+   struct sockaddr_in addr;
+   socklen_t addr_len = sizeof(addr);
+
+   memset(server, 0, sizeof(*server));
+   server->client_fd    = -1;
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   addr.sin_port        = 0;
+
+   server->listen_fd    = socket(AF_INET, SOCK_STREAM, 0);
+   ck_assert(server->listen_fd >= 0);
+   ck_assert(bind(server->listen_fd,
+            (struct sockaddr*)&addr, sizeof(addr)) == 0);
+   ck_assert(listen(server->listen_fd, 4) == 0);
+   ck_assert(getsockname(server->listen_fd,
+            (struct sockaddr*)&addr, &addr_len) == 0);
+   server->port         = ntohs(addr.sin_port);
+
+   return sthread_create(test_server_thread, server);
+}
+
+static void test_server_stop(test_server_t *server, sthread_t *thread)
+{
+   /* The client side stays in the connection pool,
+    * so the server end is closed from here */
+   if (server->client_fd >= 0)
+      shutdown(server->client_fd, SHUT_RDWR);
+   shutdown(server->listen_fd, SHUT_RDWR);
+   close(server->listen_fd);
+   sthread_join(thread);
+}
+
+/* WebDAV stand-in, as used by cloud sync: stores PUT bodies
+ * in memory, serves them back on GET and removes them on
+ * DELETE. Every connection is handled on its own thread, so
+ * several transfers can be in flight at once. */
+#define TEST_DAV_MAX_FILES 8
+
+typedef struct
+{
+   char path[64];
+   char body[64];
+   bool used;
+} test_dav_file_t;
+
+typedef struct
+{
+   test_dav_file_t files[TEST_DAV_MAX_FILES];
+   sthread_t *threads[TEST_DAV_MAX_FILES];
+   int client_fds[TEST_DAV_MAX_FILES];
+   slock_t *lock;
+   int listen_fd;
+   int port;
+   int accepts;
+   int requests;
+} test_dav_server_t;
+
+typedef struct
+{
+   test_dav_server_t *server;
+   int fd;
+} test_dav_conn_t;
+
+static test_dav_file_t *test_dav_find(test_dav_server_t *server,
+      const char *path)
+{
+   int i;
+   for (i = 0; i < TEST_DAV_MAX_FILES; i++)
+      if (server->files[i].used && !strcmp(server->files[i].path, path))
+         return &server->files[i];
+   return NULL;
+}
+
+/* Handles one request, returns false on malformed input */
+static bool test_dav_reply(test_dav_server_t *server, int fd,
+      const char *method, const char *path,
+      const char *body, size_t body_len)
+{
+   char reply[256];
+   test_dav_file_t *file = NULL;
+
+   slock_lock(server->lock);
+   server->requests++;
+   file = test_dav_find(server, path);
+
+   if (!strcmp(method, "PUT"))
+   {
+      int i;
+      for (i = 0; !file && i < TEST_DAV_MAX_FILES; i++)
+         if (!server->files[i].used)
+            file = &server->files[i];
+      if (!file || body_len >= sizeof(file->body))
+      {
+         slock_unlock(server->lock);
+         return false;
+      }
+      file->used = true;
+      strncpy(file->path, path, sizeof(file->path) - 1);
+      memcpy(file->body, body, body_len);
+      file->body[body_len] = '\0';
+      snprintf(reply, sizeof(reply),
+            "HTTP/1.1 201 Created\r\nContent-Length: 0\r\n\r\n");
+   }
+   else if (!file)
+      snprintf(reply, sizeof(reply),
+            "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+   else if (!strcmp(method, "DELETE"))
+   {
+      file->used = false;
+      snprintf(reply, sizeof(reply),
+            "HTTP/1.1 204 No Content\r\n\r\n");
+   }
+   else
+      snprintf(reply, sizeof(reply),
+            "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n%s",
+            (unsigned)strlen(file->body), file->body);
+   slock_unlock(server->lock);
+
+   send(fd, reply, strlen(reply), 0);
+   return true;
+}
+
+static void test_dav_conn_thread(void *data)
+{
+   test_dav_conn_t *conn     = (test_dav_conn_t*)data;
+   test_dav_server_t *server = conn->server;
+   char buf[4096];
+   size_t pos = 0;
+
+   for (;;)
+   {
+      char *end;
+      ssize_t len = recv(conn->fd, buf + pos, sizeof(buf) - 1 - pos, 0);
+
+      if (len <= 0)
+         break;
+
+      pos      += (size_t)len;
+      buf[pos]  = '\0';
+
+      while ((end = strstr(buf, "\r\n\r\n")))
+      {
+         char method[16];
+         char path[64];
+         size_t body_len   = 0;
+         size_t header_len = (size_t)(end + 4 - buf);
+         const char *cl    = strstr(buf, "Content-Length: ");
+
+         if (cl && cl < end)
+            body_len = strtoul(cl + strlen("Content-Length: "), NULL, 10);
+         /* Wait for the rest of the body */
+         if (header_len + body_len > pos)
+            break;
+
+         if (     sscanf(buf, "%15s %63s", method, path) != 2
+               || !test_dav_reply(server, conn->fd, method, path,
+                  buf + header_len, body_len))
+            goto done;
+
+         memmove(buf, buf + header_len + body_len,
+               pos - header_len - body_len);
+         pos      -= header_len + body_len;
+         buf[pos]  = '\0';
+      }
+   }
+
+done:
+   /* The socket is closed by test_dav_stop() */
+   free(conn);
+}
+
+static void test_dav_accept_thread(void *data)
+{
+   test_dav_server_t *server = (test_dav_server_t*)data;
+   int fd;
+
+   while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0)
+   {
+      test_dav_conn_t *conn = NULL;
+
+      if (     server->accepts >= TEST_DAV_MAX_FILES
+            || !(conn = (test_dav_conn_t*)malloc(sizeof(*conn))))
+      {
+         close(fd);
+         continue;
+      }
+
+      conn->server = server;
+      conn->fd     = fd;
+      server->client_fds[server->accepts] = fd;
+      server->threads[server->accepts++]  =
+            sthread_create(test_dav_conn_thread, conn);
+   }
+}
+
+static sthread_t *test_dav_start(test_dav_server_t *server)
+{
+   struct sockaddr_in addr;
+   socklen_t addr_len = sizeof(addr);
+
+   memset(server, 0, sizeof(*server));
+   server->lock         = slock_new();
+   ck_assert(server->lock != NULL);
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   addr.sin_port        = 0;
+
+   server->listen_fd    = socket(AF_INET, SOCK_STREAM, 0);
+   ck_assert(server->listen_fd >= 0);
+   ck_assert(bind(server->listen_fd,
+            (struct sockaddr*)&addr, sizeof(addr)) == 0);
+   ck_assert(listen(server->listen_fd, TEST_DAV_MAX_FILES) == 0);
+   ck_assert(getsockname(server->listen_fd,
+            (struct sockaddr*)&addr, &addr_len) == 0);
+   server->port         = ntohs(addr.sin_port);
+
+   return sthread_create(test_dav_accept_thread, server);
+}
+
+static void test_dav_stop(test_dav_server_t *server, sthread_t *thread)
+{
+   int i;
+
+   shutdown(server->listen_fd, SHUT_RDWR);
+   close(server->listen_fd);
+   sthread_join(thread);
+
+   /* Pooled client connections are still open */
+   for (i = 0; i < server->accepts; i++)
+   {
+      shutdown(server->client_fds[i], SHUT_RDWR);
+      sthread_join(server->threads[i]);
+      close(server->client_fds[i]);
+   }
+
+   slock_free(server->lock);
+}
+
+/* Starts a request without waiting for it to complete */
+static struct http_t *start_request(int port, const char *method,
+      const char *path, const char *headers, const char *body)
+{
+   char url[128];
+   struct http_t *http             = NULL;
+   struct http_connection_t *conn  = NULL;
+
+   snprintf(url, sizeof(url), "http://127.0.0.1:%d%s", port, path);
+
+   conn = net_http_connection_new(url, method, NULL);
+   ck_assert(conn != NULL);
+   if (headers)
+      net_http_connection_set_headers(conn, headers);
+   if (body)
+      net_http_connection_set_content(conn,
+            "application/octet-stream", strlen(body), body);
+   ck_assert(net_http_connection_iterate(conn));
+   ck_assert(net_http_connection_done(conn));
+
+   http = net_http_new(conn);
+   ck_assert(http != NULL);
+   net_http_connection_free(conn);
+
+   return http;
+}
+
+/* Drives all requests until every one of them has
+ * completed, failing the test if that takes more
+ * than a few seconds */
+static void finish_requests(struct http_t **http, int count)
+{
+   int i, j;
+   bool done[TEST_DAV_MAX_FILES] = {false};
+
+   ck_assert(count <= TEST_DAV_MAX_FILES);
+
+   for (i = 0; i < 5000; i++)
+   {
+      int pending = 0;
+      for (j = 0; j < count; j++)
+      {
+         if (!done[j])
+            done[j] = net_http_update(http[j], NULL, NULL);
+         if (!done[j])
+            pending++;
+      }
+      if (!pending)
+         return;
+      retro_sleep(1);
+   }
+
+   ck_abort_msg("HTTP request timed out");
+}
+
+/* Runs a GET request to completion */
+static struct http_t *run_request(int port, const char *headers)
+{
+   struct http_t *http = start_request(port, "GET",
+         "/thumb.png", headers, NULL);
+   finish_requests(&http, 1);
+   return http;
+}
+
+/* Response headers and body are handed over to the
+ * caller, so they are not released by net_http_delete() */
+static void free_request(struct http_t *http)
+{
+   size_t len;
+   uint8_t *data = net_http_data(http, &len, true);
+   string_list_free(net_http_headers(http));
+   if (data)
+      free(data);
+   net_http_delete(http);
+}
+
+static bool has_header(struct http_t *http, const char *header)
+{
+   size_t i;
+   struct string_list *headers = net_http_headers(http);
+   for (i = 0; i < headers->size; i++)
+      if (!strcmp(headers->elems[i].data, header))
+         return true;
+   return false;
+}
+
+START_TEST (test_net_http_conditional_keepalive)
+{
+   test_server_t server;
+   size_t len          = 0;
+   uint8_t *data       = NULL;
+   struct http_t *http = NULL;
+   sthread_t *thread   = test_server_start(&server);
+
+   ck_assert(thread != NULL);
+
+   /* Initial download */
+   http = run_request(server.port, NULL);
+   ck_assert_int_eq(net_http_status(http), 200);
+   data = net_http_data(http, &len, false);
+   ck_assert_int_eq(len, strlen(TEST_BODY));
+   ck_assert(memcmp(data, TEST_BODY, len) == 0);
+   ck_assert(has_header(http, "ETag: " TEST_ETAG));
+   free_request(http);
+
+   /* Revalidation: a bodyless 304 must complete
+    * without the server closing the connection */
+   http = run_request(server.port, "If-None-Match: " TEST_ETAG "\r\n");
+   ck_assert_int_eq(net_http_status(http), 304);
+   ck_assert(!net_http_data(http, &len, false));
+   free_request(http);
+
+   /* Subsequent request after a 304 must still be parsed
+    * correctly on the same connection */
+   http = run_request(server.port, NULL);
+   ck_assert_int_eq(net_http_status(http), 200);
+   data = net_http_data(http, &len, false);
+   ck_assert_int_eq(len, strlen(TEST_BODY));
+   ck_assert(memcmp(data, TEST_BODY, len) == 0);
+   free_request(http);
+
+   test_server_stop(&server, thread);
+
+   ck_assert_int_eq(server.requests, 3);
+   ck_assert_int_eq(server.not_modified, 1);
+   /* All requests went through one pooled connection */
+   ck_assert_int_eq(server.accepts, 1);
+}
+END_TEST
+
+/* Cloud sync keeps several WebDAV transfers in flight; each
+ * must get its own connection, and those connections must be
+ * reused afterwards */
+START_TEST (test_net_http_webdav_concurrent)
+{
+   int i;
+   test_dav_server_t server;
+   char path[TEST_DAV_MAX_FILES / 2][32];
+   char body[TEST_DAV_MAX_FILES / 2][32];
+   struct http_t *http[TEST_DAV_MAX_FILES / 2];
+   const int count     = TEST_DAV_MAX_FILES / 2;
+   sthread_t *thread   = test_dav_start(&server);
+
+   ck_assert(thread != NULL);
+
+   /* Upload all files at once */
+   for (i = 0; i < count; i++)
+   {
+      snprintf(path[i], sizeof(path[i]), "/saves/game%d.srm", i);
+      snprintf(body[i], sizeof(body[i]), "SAVE%d", i);
+      http[i] = start_request(server.port, "PUT", path[i], NULL, body[i]);
+   }
+   finish_requests(http, count);
+   for (i = 0; i < count; i++)
+   {
+      ck_assert_int_eq(net_http_status(http[i]), 201);
+      free_request(http[i]);
+   }
+   ck_assert_int_eq(server.accepts, count);
+
+   /* Download them again, also all at once */
+   for (i = 0; i < count; i++)
+      http[i] = start_request(server.port, "GET", path[i], NULL, NULL);
+   finish_requests(http, count);
+   for (i = 0; i < count; i++)
+   {
+      size_t len    = 0;
+      uint8_t *data = net_http_data(http[i], &len, false);
+      ck_assert_int_eq(net_http_status(http[i]), 200);
+      ck_assert_int_eq(len, strlen(body[i]));
+      ck_assert(memcmp(data, body[i], len) == 0);
+      free_request(http[i]);
+   }
+
+   /* Delete one; a bodyless 204 must not stall the connection */
+   http[0] = start_request(server.port, "DELETE", path[0], NULL, NULL);
+   finish_requests(http, 1);
+   ck_assert_int_eq(net_http_status(http[0]), 204);
+   free_request(http[0]);
+
+   http[0] = start_request(server.port, "GET", path[0], NULL, NULL);
+   finish_requests(http, 1);
+   ck_assert_int_eq(net_http_status(http[0]), 404);
+   free_request(http[0]);
+
+   test_dav_stop(&server, thread);
+
+   ck_assert_int_eq(server.requests, count * 2 + 2);
+   /* No connections beyond the ones opened for the uploads */
+   ck_assert_int_eq(server.accepts, count);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_net_http_conditional_keepalive);
+   tcase_add_test(tc_core, test_net_http_webdav_concurrent);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+   int num_fail;
+   Suite *s = create_suite();
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+   num_fail = srunner_ntests_failed(sr);
+   srunner_free(sr);
+   return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
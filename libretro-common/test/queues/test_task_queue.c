@@ -0,0 +1,208 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_task_queue.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include <queues/task_queue.h>
+#include <rthreads/rthreads.h>
+#include <retro_timers.h>
+
+#define SUITE_NAME "Task Queue"
+
+struct test_task_state
+{
+   unsigned steps;
+   unsigned runs;
+   bool overlap;
+   bool active;
+};
+
+static slock_t *test_lock;
+static unsigned serial_active;
+static unsigned serial_overlaps;
+static unsigned tasks_done;
+static unsigned background_steps_at_interactive;
+static unsigned tasks_done_at_background;
+
+static void test_task_handler(retro_task_t *task)
+{
+   struct test_task_state *state = (struct test_task_state*)task->state;
+   bool serial                   = task->affinity == TASK_AFFINITY_SERIAL;
+   bool finished                 = false;
+
+   slock_lock(test_lock);
+   if (state->active)
+      state->overlap = true;
+   state->active     = true;
+   if (serial && serial_active++)
+      serial_overlaps++;
+   slock_unlock(test_lock);
+
+   retro_sleep(1);
+
+   slock_lock(test_lock);
+   state->active     = false;
+   if (serial)
+      serial_active--;
+   finished          = ++state->runs >= state->steps;
+   slock_unlock(test_lock);
+
+   if (finished)
+      task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void test_task_callback(retro_task_t *task,
+      void *task_data, void *user_data, const char *error)
+{
+   struct test_task_state *state = (struct test_task_state*)task->state;
+
+   ck_assert(!state->overlap);
+   ck_assert_uint_eq(state->runs, state->steps);
+
+   if (task->priority == TASK_PRIORITY_INTERACTIVE && user_data)
+   {
+      slock_lock(test_lock);
+      background_steps_at_interactive =
+         ((struct test_task_state*)user_data)->runs;
+      slock_unlock(test_lock);
+   }
+   else if (task->priority == TASK_PRIORITY_BACKGROUND)
+      tasks_done_at_background = tasks_done;
+
+   tasks_done++;
+   free(state);
+}
+
+static retro_task_t *test_task_push(unsigned steps,
+      enum task_priority priority, enum task_affinity affinity,
+      void *user_data)
+{
+   retro_task_t *task            = task_init();
+   struct test_task_state *state = (struct test_task_state*)
+      calloc(1, sizeof(*state));
+
+   state->steps    = steps;
+   task->state     = state;
+   task->handler   = test_task_handler;
+   task->callback  = test_task_callback;
+   task->user_data = user_data;
+   task->priority  = priority;
+   task->affinity  = affinity;
+   ck_assert(task_queue_push(task));
+   return task;
+}
+
+static bool test_tasks_pending(void *data)
+{
+   return tasks_done < *(unsigned*)data;
+}
+
+static void test_setup(unsigned workers)
+{
+   test_lock                       = slock_new();
+   serial_active                   = 0;
+   serial_overlaps                 = 0;
+   tasks_done                      = 0;
+   background_steps_at_interactive = 0;
+   tasks_done_at_background        = 0;
+   task_queue_set_workers(workers);
+   task_queue_init(true, NULL);
+}
+
+static void test_teardown(unsigned count)
+{
+   task_queue_wait(test_tasks_pending, &count);
+   task_queue_check();
+   task_queue_deinit();
+   slock_free(test_lock);
+   ck_assert_uint_eq(tasks_done, count);
+}
+
+START_TEST (test_task_queue_serial_affinity)
+{
+   unsigned i;
+
+   test_setup(4);
+   for (i = 0; i < 8; i++)
+      test_task_push(5, TASK_PRIORITY_NORMAL,
+            (i & 1) ? TASK_AFFINITY_SERIAL : TASK_AFFINITY_ANY, NULL);
+   test_teardown(8);
+
+   ck_assert_uint_eq(serial_overlaps, 0);
+}
+END_TEST
+
+START_TEST (test_task_queue_priority)
+{
+   retro_task_t *background;
+
+   /* With one worker, the interactive task must run
+    * before the bulk task is done */
+   test_setup(1);
+   background = test_task_push(50, TASK_PRIORITY_BACKGROUND,
+         TASK_AFFINITY_ANY, NULL);
+   test_task_push(1, TASK_PRIORITY_INTERACTIVE, TASK_AFFINITY_ANY,
+         background->state);
+   test_teardown(2);
+
+   ck_assert(background_steps_at_interactive < 50);
+}
+END_TEST
+
+START_TEST (test_task_queue_aging)
+{
+   /* Interactive tasks keep both workers busy; the bulk
+    * task must still get its turn before they are done */
+   test_setup(2);
+   test_task_push(200, TASK_PRIORITY_INTERACTIVE, TASK_AFFINITY_ANY, NULL);
+   test_task_push(200, TASK_PRIORITY_INTERACTIVE, TASK_AFFINITY_ANY, NULL);
+   test_task_push(3, TASK_PRIORITY_BACKGROUND, TASK_AFFINITY_ANY, NULL);
+   test_teardown(3);
+
+   ck_assert_uint_eq(tasks_done_at_background, 0);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_task_queue_serial_affinity);
+   tcase_add_test(tc_core, test_task_queue_priority);
+   tcase_add_test(tc_core, test_task_queue_aging);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+   int num_fail;
+   Suite *s = create_suite();
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+   num_fail = srunner_ntests_failed(sr);
+   srunner_free(sr);
+   return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,115 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (bench_rzip_stream.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* RZIP write/read throughput benchmark.
+ *
+ * Writes a savestate-sized buffer with rzipstream_write_file()
+ * and reads it back with rzipstream_read_file(), reporting
+ * wall time and compression ratio.
+ *
+ * Usage: bench_rzip_stream [size in MB, default 32] [output path] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <streams/file_stream.h>
+#include <streams/rzip_stream.h>
+#include <time/rtime.h>
+#include <features/features_cpu.h>
+
+#include "../test_rand.h"
+
+#define BENCH_ITERATIONS 5
+
+static double bench_ms(retro_time_t start)
+{
+   return (cpu_features_get_time_usec() - start) / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   retro_time_t start;
+   double write_ms     = 0.0;
+   double read_ms      = 0.0;
+   int64_t out_len     = 0;
+   int64_t file_size   = 0;
+   void *out           = NULL;
+   RFILE *file         = NULL;
+   size_t size_mb      = (argc > 1) ? (size_t)strtoul(argv[1], NULL, 10) : 32;
+   const char *path    = (argc > 2) ? argv[2] : "bench_rzip_stream.rzip";
+   size_t len          = size_mb * 1024 * 1024;
+   uint8_t *buf        = (uint8_t*)malloc(len);
+   uint32_t seed       = 1;
+
+   if (!buf || !len)
+      return EXIT_FAILURE;
+
+   /* Roughly emulate emulator memory: runs of
+    * structured data mixed with noise */
+   for (i = 0; i < len; i++)
+   {
+      test_rand(&seed);
+      buf[i] = ((i >> 12) & 1)
+            ? (uint8_t)(seed >> 24)
+            : (uint8_t)((i >> 3) & 0x3F);
+   }
+
+   for (i = 0; i < BENCH_ITERATIONS; i++)
+   {
+      start     = cpu_features_get_time_usec();
+      if (!rzipstream_write_file(path, buf, (int64_t)len))
+         return EXIT_FAILURE;
+      write_ms += bench_ms(start);
+
+      start     = cpu_features_get_time_usec();
+      if (!rzipstream_read_file(path, &out, &out_len))
+         return EXIT_FAILURE;
+      read_ms  += bench_ms(start);
+
+      if (out_len != (int64_t)len || memcmp(out, buf, len))
+      {
+         printf("Data MISMATCH\n");
+         return EXIT_FAILURE;
+      }
+      free(out);
+   }
+
+   if ((file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      file_size = filestream_get_size(file);
+      filestream_close(file);
+   }
+   remove(path);
+
+   printf("%u MB: write %.1f ms, read %.1f ms, ratio %.3f\n",
+         (unsigned)size_mb,
+         write_ms / BENCH_ITERATIONS,
+         read_ms  / BENCH_ITERATIONS,
+         (double)file_size / (double)len);
+
+   free(buf);
+   return EXIT_SUCCESS;
+}
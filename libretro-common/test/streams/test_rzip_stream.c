@@ -0,0 +1,234 @@
+/* Copyright  (C) 2010-2026 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_rzip_stream.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#include <streams/file_stream.h>
+#include <streams/rzip_stream.h>
+
+#include "../test_rand.h"
+
+#define SUITE_NAME "rzip_stream"
+
+/* Must match RZIP_DEFAULT_CHUNK_SIZE */
+#define CHUNK_SIZE 131072
+
+/* Compressible, but not trivially so */
+static uint8_t *make_data(size_t len)
+{
+   size_t i;
+   uint32_t seed = 12345;
+   uint8_t *data = (uint8_t*)malloc(len);
+   ck_assert(data != NULL);
+   for (i = 0; i < len; i++)
+   {
+      data[i] = (uint8_t)((i & 0xFF) ^ ((test_rand(&seed) >> 16) & 0x0F));
+   }
+   return data;
+}
+
+static void check_roundtrip(size_t len)
+{
+   char tmpfile[512];
+   void *out      = NULL;
+   int64_t outlen = 0;
+   uint8_t *data  = make_data(len);
+   rzipstream_t *stream;
+#ifndef HAVE_ZSTD
+   uint8_t magic[8];
+   FILE *fd;
+#endif
+
+   tmpnam(tmpfile);
+   ck_assert(rzipstream_write_file(tmpfile, data, (int64_t)len));
+
+#ifndef HAVE_ZSTD
+   /* zlib files keep the v1 header, so older readers
+    * can still load them */
+   fd = fopen(tmpfile, "rb");
+   ck_assert(fd != NULL);
+   ck_assert_uint_eq(fread(magic, 1, sizeof(magic), fd), sizeof(magic));
+   fclose(fd);
+   ck_assert_uint_eq(magic[6], 1);
+#endif
+
+   stream = rzipstream_open(tmpfile, RETRO_VFS_FILE_ACCESS_READ);
+   ck_assert(stream != NULL);
+   ck_assert(rzipstream_is_compressed(stream));
+   ck_assert_int_eq(rzipstream_get_size(stream), (int64_t)len);
+   rzipstream_close(stream);
+
+   ck_assert(rzipstream_read_file(tmpfile, &out, &outlen));
+   ck_assert_int_eq(outlen, (int64_t)len);
+   ck_assert(memcmp(out, data, len) == 0);
+
+   free(out);
+   free(data);
+   remove(tmpfile);
+}
+
+START_TEST (test_rzip_roundtrip_small)
+{
+   check_roundtrip(1000);
+   check_roundtrip(CHUNK_SIZE);
+}
+END_TEST
+
+START_TEST (test_rzip_roundtrip_multi_chunk)
+{
+   /* Spans several batches of queued chunks,
+    * with a partial final chunk */
+   check_roundtrip(CHUNK_SIZE * 37 + 1234);
+}
+END_TEST
+
+START_TEST (test_rzip_streamed_writes)
+{
+   size_t i;
+   char tmpfile[512];
+   void *out      = NULL;
+   int64_t outlen = 0;
+   size_t len     = CHUNK_SIZE * 5 + 77;
+   uint8_t *data  = make_data(len);
+   rzipstream_t *stream;
+
+   tmpnam(tmpfile);
+   stream = rzipstream_open(tmpfile, RETRO_VFS_FILE_ACCESS_WRITE);
+   ck_assert(stream != NULL);
+   /* Odd-sized writes straddle chunk boundaries */
+   for (i = 0; i < len; i += 1000)
+      ck_assert_int_eq(rzipstream_write(stream, data + i,
+               (len - i < 1000) ? len - i : 1000),
+            (len - i < 1000) ? len - i : 1000);
+   ck_assert_int_eq(rzipstream_close(stream), 0);
+
+   ck_assert(rzipstream_read_file(tmpfile, &out, &outlen));
+   ck_assert_int_eq(outlen, (int64_t)len);
+   ck_assert(memcmp(out, data, len) == 0);
+
+   free(out);
+   free(data);
+   remove(tmpfile);
+}
+END_TEST
+
+START_TEST (test_rzip_read_v1)
+{
+   size_t i;
+   char tmpfile[512];
+   void *out      = NULL;
+   int64_t outlen = 0;
+   size_t len     = CHUNK_SIZE * 2 + 500;
+   uint8_t *data  = make_data(len);
+   uint8_t header[20] = { '#', 'R', 'Z', 'I', 'P', 'v', 1, '#' };
+   uLongf comp_len;
+   uint8_t *comp  = (uint8_t*)malloc(compressBound(CHUNK_SIZE));
+   FILE *fd;
+
+   /* Write a version 1 (zlib) file by hand */
+   for (i = 0; i < 4; i++)
+      header[8 + i]  = (CHUNK_SIZE >> (i * 8)) & 0xFF;
+   for (i = 0; i < 8; i++)
+      header[12 + i] = ((uint64_t)len >> (i * 8)) & 0xFF;
+
+   tmpnam(tmpfile);
+   fd = fopen(tmpfile, "wb");
+   ck_assert(fd != NULL);
+   fwrite(header, 1, sizeof(header), fd);
+   for (i = 0; i < len; i += CHUNK_SIZE)
+   {
+      uint8_t chunk_header[4];
+      uLong chunk_len = (len - i < CHUNK_SIZE) ? len - i : CHUNK_SIZE;
+      comp_len        = compressBound(CHUNK_SIZE);
+      ck_assert(compress2(comp, &comp_len, data + i, chunk_len, 6) == Z_OK);
+      chunk_header[0] =  comp_len        & 0xFF;
+      chunk_header[1] = (comp_len >>  8) & 0xFF;
+      chunk_header[2] = (comp_len >> 16) & 0xFF;
+      chunk_header[3] = (comp_len >> 24) & 0xFF;
+      fwrite(chunk_header, 1, sizeof(chunk_header), fd);
+      fwrite(comp, 1, comp_len, fd);
+   }
+   fclose(fd);
+
+   ck_assert(rzipstream_read_file(tmpfile, &out, &outlen));
+   ck_assert_int_eq(outlen, (int64_t)len);
+   ck_assert(memcmp(out, data, len) == 0);
+
+   free(out);
+   free(comp);
+   free(data);
+   remove(tmpfile);
+}
+END_TEST
+
+START_TEST (test_rzip_read_uncompressed)
+{
+   char tmpfile[512];
+   void *out      = NULL;
+   int64_t outlen = 0;
+   FILE *fd;
+
+   tmpnam(tmpfile);
+   fd = fopen(tmpfile, "wb");
+   ck_assert(fd != NULL);
+   fwrite("plain", 1, 5, fd);
+   fclose(fd);
+
+   ck_assert(rzipstream_read_file(tmpfile, &out, &outlen));
+   ck_assert_int_eq(outlen, 5);
+   ck_assert(memcmp(out, "plain", 5) == 0);
+
+   free(out);
+   remove(tmpfile);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_rzip_roundtrip_small);
+   tcase_add_test(tc_core, test_rzip_roundtrip_multi_chunk);
+   tcase_add_test(tc_core, test_rzip_streamed_writes);
+   tcase_add_test(tc_core, test_rzip_read_v1);
+   tcase_add_test(tc_core, test_rzip_read_uncompressed);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+   int num_fail;
+   Suite *s = create_suite();
+   SRunner *sr = srunner_create(s);
+   srunner_run_all(sr, CK_NORMAL);
+   num_fail = srunner_ntests_failed(sr);
+   srunner_free(sr);
+   return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -71,6 +71,58 @@ START_TEST (test_crc32)
 }
 END_TEST
 
+/* Bit-at-a-time reference, independent of the table
+ * and SIMD paths taken by encoding_crc32() */
+static uint32_t crc32_reference(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   crc = ~crc;
+   while (len--)
+   {
+      int k;
+      crc ^= *buf++;
+      for (k = 0; k < 8; k++)
+         crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+   }
+   return ~crc;
+}
+
+START_TEST (test_crc32_large)
+{
+   size_t i, len, ofs;
+   uint8_t *buf = (uint8_t*)malloc(8192);
+   ck_assert(buf != NULL);
+   for (i = 0; i < 8192; i++)
+      buf[i] = (uint8_t)(i * 131 + (i >> 7));
+
+   /* Cover every tail length and misalignment around
+    * the block sizes of the accelerated paths */
+   for (len = 0; len < 1100; len++)
+      for (ofs = 0; ofs < 8; ofs++)
+         ck_assert_uint_eq(encoding_crc32(0x12345678, buf + ofs, len),
+               crc32_reference(0x12345678, buf + ofs, len));
+
+   ck_assert_uint_eq(encoding_crc32(0, buf, 8192),
+         crc32_reference(0, buf, 8192));
+   free(buf);
+}
+END_TEST
+
+START_TEST (test_crc32_combine)
+{
+   size_t split;
+   char buf[] = "The quick brown fox jumps over the lazy dog";
+   size_t len = strlen(buf);
+
+   for (split = 0; split <= len; split++)
+   {
+      uint32_t crc1 = encoding_crc32(0, (uint8_t*)buf, split);
+      uint32_t crc2 = encoding_crc32(0, (uint8_t*)buf + split, len - split);
+      ck_assert_uint_eq(encoding_crc32_combine(crc1, crc2, len - split),
+            0x414fa339);
+   }
+}
+END_TEST
+
 #define CRC32_BUFFER_SIZE 1048576
 #define CRC32_MAX_MB 64
 
@@ -141,6 +193,8 @@ Suite *create_suite(void)
    TCase *tc_core = tcase_create("Core");
    tcase_add_test(tc_core, test_md5);
    tcase_add_test(tc_core, test_crc32);
+   tcase_add_test(tc_core, test_crc32_large);
+   tcase_add_test(tc_core, test_crc32_combine);
    tcase_add_test(tc_core, test_crc32_file);
    suite_add_tcase(s, tc_core);
 
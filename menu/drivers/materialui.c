@@ -12286,5 +12286,6 @@ menu_ctx_driver_t menu_ctx_mui = {
    materialui_update_savestate_thumbnail_image,
    materialui_pointer_down,
    materialui_pointer_up,
-   materialui_menu_entry_action
+   materialui_menu_entry_action,
+   NULL  /* is_animating */
 };
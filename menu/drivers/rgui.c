@@ -28,6 +28,7 @@
 #include <compat/strl.h>
 #include <compat/posix_string.h>
 #include <encodings/utf.h>
+#include <features/features_cpu.h>
 #include <file/config_file.h>
 #include <file/file_path.h>
 #include <formats/image.h>
@@ -53,6 +54,7 @@
 #include "../../file_path_special.h"
 #include "../../input/input_osk.h"
 #include "../../tasks/tasks_internal.h"
+#include "../../verbosity.h"
 
 #include "../../gfx/drivers_font_renderer/bitmap.h"
 #ifdef HAVE_LANGEXTRA
@@ -130,6 +132,8 @@
 #define RGUI_SYMBOL_WIDTH_STRIDE  (RGUI_SYMBOL_WIDTH + 1)
 #define RGUI_SYMBOL_HEIGHT_STRIDE (RGUI_SYMBOL_HEIGHT + 1)
 
+#define RGUI_DRAW_CMD_SYMBOL      ((size_t)-1)
+
 /* Defines all possible entry value types
  * > Note: These are not necessarily 'values',
  *   but they correspond to the object drawn in
@@ -248,6 +252,42 @@ typedef struct
    unsigned height;
 } frame_buf_t;
 
+/* A recorded rgui_blit_line()/rgui_blit_symbol() call */
+typedef struct
+{
+   size_t text;         /* Offset into text pool, or
+                         * RGUI_DRAW_CMD_SYMBOL */
+   uint32_t hash;
+   int x;
+   int y;
+   unsigned row_start;  /* Scanlines touched, shadow included */
+   unsigned row_end;
+   unsigned symbol;     /* enum rgui_symbol_type */
+   uint16_t color;
+   uint16_t shadow_color;
+} rgui_draw_cmd_t;
+
+/* Text of the menu list is recorded instead of drawn,
+ * then replayed only over the scanlines whose content
+ * differs from the previous frame. Every other scanline
+ * already holds the right pixels. */
+typedef struct
+{
+   rgui_draw_cmd_t *cmds;
+   char *text;
+   /* Per scanline signature of what the framebuffer
+    * holds; 0 means unknown */
+   uint32_t *row_sigs;
+   uint32_t *new_row_sigs;
+   uint8_t *row_dirty;
+   size_t num_cmds;
+   size_t cmds_size;
+   size_t text_len;
+   size_t text_size;
+   unsigned num_rows;
+   bool recording;
+} rgui_draw_list_t;
+
 enum rgui_flags
 {
    RGUI_FLAG_BG_MODIFIED               = (1 << 0),
@@ -281,6 +321,7 @@ enum rgui_flags
 typedef struct
 {
    retro_time_t thumbnail_load_trigger_time; /* uint64_t */
+   retro_time_t render_time_us;              /* uint64_t */
 
    struct
    {
@@ -301,6 +342,8 @@ typedef struct
    frame_buf_t background_buf;
    frame_buf_t upscale_buf;
 
+   rgui_draw_list_t draw_list;
+
    thumbnail_t fs_thumbnail;
    thumbnail_t mini_thumbnail;
    thumbnail_t mini_left_thumbnail;
@@ -325,6 +368,10 @@ typedef struct
    unsigned menu_aspect_ratio;
    unsigned menu_aspect_ratio_lock;
    unsigned language;
+   /* Render statistics, logged when the menu closes */
+   unsigned render_frames;
+   unsigned render_rows;
+   unsigned render_rows_total;
 
    rgui_term_layout_t term_layout;
 
@@ -1781,6 +1828,7 @@ static void rgui_color_rect(
       uint16_t color)
 {
    unsigned x_index, y_index;
+   uint16_t *src    = NULL;
    unsigned x_start = (x <= fb_width)  ? x : fb_width;
    unsigned y_start = (y <= fb_height) ? y : fb_height;
    unsigned x_end   = x + width;
@@ -1791,12 +1839,19 @@ static void rgui_color_rect(
    if (y_end > fb_height)
       y_end         = fb_height;
 
-   for (y_index = y_start; y_index < y_end; y_index++)
-   {
-      uint16_t *data_ptr = data + (y_index * fb_width);
-      for (x_index = x_start; x_index < x_end; x_index++)
-         *(data_ptr + x_index) = color;
-   }
+   if ((x_start >= x_end) || (y_start >= y_end))
+      return;
+
+   /* Fill the first line, then copy it to the others
+    * (memcpy() is vectorised on every platform we
+    * care about) */
+   src = data + (y_start * fb_width);
+   for (x_index = x_start; x_index < x_end; x_index++)
+      *(src + x_index) = color;
+
+   for (y_index = y_start + 1; y_index < y_end; y_index++)
+      memcpy(data + (y_index * fb_width) + x_start, src + x_start,
+            (x_end - x_start) * sizeof(uint16_t));
 }
 
 static void rgui_render_border(
@@ -2264,6 +2319,9 @@ static void rgui_render_particle_effect(
       rgui_render_border(rgui, frame_buf_data, fb_width, fb_height);
 }
 
+/* Forward declaration */
+static void rgui_draw_list_invalidate(rgui_t *rgui);
+
 static void rgui_process_wallpaper(
       rgui_t *rgui,
       struct texture_image *image)
@@ -2307,6 +2365,7 @@ static void rgui_process_wallpaper(
    }
 
    /* Tell menu that a display update is required */
+   rgui_draw_list_invalidate(rgui);
    rgui->flags         |= RGUI_FLAG_FORCE_REDRAW
                         | RGUI_FLAG_SHOW_WALLPAPER;
 }
@@ -2687,14 +2746,8 @@ static void rgui_render_background(
 
    /* If screensaver is active, 'zero out' framebuffer */
    if (rgui->flags & RGUI_FLAG_SHOW_SCREENSAVER)
-   {
-      size_t i;
-      uint16_t ss_bg_color    = rgui->colors.ss_bg_color;
-      uint16_t *frame_buf_ptr = frame_buf->data;
-
-      for (i = 0; i < frame_buf->width * frame_buf->height; i++)
-         *(frame_buf_ptr++) = ss_bg_color;
-   }
+      rgui_color_rect(frame_buf->data, fb_width, fb_height,
+            0, 0, fb_width, fb_height, rgui->colors.ss_bg_color);
    /* Otherwise copy background to framebuffer */
    else if (background_buf->data)
       memcpy(frame_buf->data, background_buf->data,
@@ -4443,6 +4496,418 @@ static void rgui_set_blit_functions(
  * rgui_blit_line/rgui_blit_symbol() END
  * ============================== */
 
+/* ==============================
+ * Incremental rendering START
+ * ============================== */
+
+/* Real blit functions, while rgui_blit_line/rgui_blit_symbol
+ * point to the recording functions below */
+static void (*rgui_blit_line_direct)(
+      rgui_t *rgui,
+      unsigned fb_width,
+      int x,
+      int y,
+      const char *message,
+      uint16_t color,
+      uint16_t shadow_color) = NULL;
+
+static void (*rgui_blit_symbol_direct)(
+      rgui_t *rgui,
+      unsigned fb_width,
+      int x,
+      int y,
+      enum rgui_symbol_type symbol,
+      uint16_t color,
+      uint16_t shadow_color) = NULL;
+
+/* FNV-1a */
+static uint32_t rgui_draw_hash(uint32_t hash, const void *data, size_t len)
+{
+   const uint8_t *p = (const uint8_t*)data;
+
+   while (len--)
+   {
+      hash ^= *p++;
+      hash *= 0x01000193;
+   }
+
+   return hash;
+}
+
+/* Marks scanlines [y, y + height) as unknown, so they are
+ * redrawn next time; must be called whenever something
+ * other than rgui_draw_list_end() changes them */
+static void rgui_draw_list_invalidate_rows(rgui_t *rgui,
+      unsigned y, unsigned height)
+{
+   rgui_draw_list_t *draw_list = &rgui->draw_list;
+   unsigned y_end              = y + height;
+
+   if (!draw_list->row_sigs)
+      return;
+
+   if (y_end > draw_list->num_rows || y_end < y)
+      y_end = draw_list->num_rows;
+
+   if (y < y_end)
+      memset(draw_list->row_sigs + y, 0, (y_end - y) * sizeof(uint32_t));
+}
+
+static void rgui_draw_list_invalidate(rgui_t *rgui)
+{
+   rgui_draw_list_invalidate_rows(rgui, 0, rgui->draw_list.num_rows);
+}
+
+static void rgui_draw_list_free(rgui_t *rgui)
+{
+   rgui_draw_list_t *draw_list = &rgui->draw_list;
+
+   free(draw_list->cmds);
+   free(draw_list->text);
+   free(draw_list->row_sigs);
+   free(draw_list->new_row_sigs);
+   free(draw_list->row_dirty);
+
+   memset(draw_list, 0, sizeof(*draw_list));
+}
+
+static rgui_draw_cmd_t *rgui_draw_list_add(rgui_t *rgui,
+      int x, int y, uint16_t color, uint16_t shadow_color)
+{
+   rgui_draw_cmd_t *cmd;
+   rgui_draw_list_t *draw_list = &rgui->draw_list;
+   /* Every glyph and symbol fits in this height, plus
+    * one line of drop shadow */
+   int height                  = (int)MAX(rgui->font_height,
+         RGUI_SYMBOL_HEIGHT) + 1;
+   int num_rows                = (int)draw_list->num_rows;
+
+   if (draw_list->num_cmds == draw_list->cmds_size)
+   {
+      size_t new_size          = draw_list->cmds_size
+            ? draw_list->cmds_size * 2 : 64;
+      rgui_draw_cmd_t *cmds    = (rgui_draw_cmd_t*)realloc(
+            draw_list->cmds, new_size * sizeof(*cmds));
+
+      if (!cmds)
+         return NULL;
+
+      draw_list->cmds          = cmds;
+      draw_list->cmds_size     = new_size;
+   }
+
+   cmd               = &draw_list->cmds[draw_list->num_cmds];
+   cmd->x            = x;
+   cmd->y            = y;
+   cmd->color        = color;
+   cmd->shadow_color = shadow_color;
+   cmd->symbol       = 0;
+   cmd->text         = RGUI_DRAW_CMD_SYMBOL;
+   cmd->row_start    = (unsigned)((y < 0) ? 0 : MIN(y, num_rows));
+   cmd->row_end      = (unsigned)((y + height < 0)
+         ? 0 : MIN(y + height, num_rows));
+   cmd->hash         = rgui_draw_hash(0x811c9dc5, &x, sizeof(x));
+   cmd->hash         = rgui_draw_hash(cmd->hash, &y, sizeof(y));
+   cmd->hash         = rgui_draw_hash(cmd->hash, &color, sizeof(color));
+   cmd->hash         = rgui_draw_hash(cmd->hash, &shadow_color,
+         sizeof(shadow_color));
+
+   return cmd;
+}
+
+/* Called if recording fails: draw everything recorded so
+ * far in full, then draw the rest of the frame directly */
+static void rgui_draw_list_abort(rgui_t *rgui, unsigned fb_width,
+      unsigned fb_height, size_t fb_pitch);
+
+static void rgui_blit_line_record(
+      rgui_t *rgui,
+      unsigned fb_width,
+      int x,
+      int y,
+      const char *message,
+      uint16_t color,
+      uint16_t shadow_color)
+{
+   rgui_draw_cmd_t *cmd;
+   rgui_draw_list_t *draw_list = &rgui->draw_list;
+   size_t len                  = strlen(message);
+
+   if (len == 0)
+      return;
+
+   if (draw_list->text_len + len + 1 > draw_list->text_size)
+   {
+      size_t new_size = MAX(draw_list->text_size * 2,
+            draw_list->text_len + len + 1);
+      char *text      = (char*)realloc(draw_list->text, new_size);
+
+      if (!text)
+         goto error;
+
+      draw_list->text      = text;
+      draw_list->text_size = new_size;
+   }
+
+   if (!(cmd = rgui_draw_list_add(rgui, x, y, color, shadow_color)))
+      goto error;
+
+   memcpy(draw_list->text + draw_list->text_len, message, len + 1);
+   cmd->text            = draw_list->text_len;
+   cmd->hash            = rgui_draw_hash(cmd->hash, message, len);
+   draw_list->text_len += len + 1;
+   draw_list->num_cmds++;
+   return;
+
+error:
+   rgui_draw_list_abort(rgui, fb_width, draw_list->num_rows,
+         fb_width * sizeof(uint16_t));
+   rgui_blit_line(rgui, fb_width, x, y, message, color, shadow_color);
+}
+
+static void rgui_blit_symbol_record(
+      rgui_t *rgui,
+      unsigned fb_width,
+      int x,
+      int y,
+      enum rgui_symbol_type symbol,
+      uint16_t color,
+      uint16_t shadow_color)
+{
+   unsigned symbol_id   = (unsigned)symbol;
+   rgui_draw_cmd_t *cmd = rgui_draw_list_add(rgui, x, y,
+         color, shadow_color);
+
+   if (!cmd)
+   {
+      rgui_draw_list_abort(rgui, fb_width, rgui->draw_list.num_rows,
+            fb_width * sizeof(uint16_t));
+      rgui_blit_symbol(rgui, fb_width, x, y, symbol, color, shadow_color);
+      return;
+   }
+
+   cmd->symbol = symbol_id;
+   cmd->hash   = rgui_draw_hash(cmd->hash, &symbol_id, sizeof(symbol_id));
+   rgui->draw_list.num_cmds++;
+}
+
+/* Starts recording rgui_blit_line()/rgui_blit_symbol()
+ * calls. Nothing else may draw until rgui_draw_list_end().
+ * Returns false if the frame has to be drawn in full */
+static bool rgui_draw_list_begin(rgui_t *rgui, unsigned fb_height)
+{
+   rgui_draw_list_t *draw_list = &rgui->draw_list;
+
+   if (draw_list->num_rows != fb_height)
+   {
+      free(draw_list->row_sigs);
+      free(draw_list->new_row_sigs);
+      free(draw_list->row_dirty);
+
+      /* Zeroed signatures: every row starts out unknown */
+      draw_list->row_sigs     = (uint32_t*)calloc(fb_height, sizeof(uint32_t));
+      draw_list->new_row_sigs = (uint32_t*)malloc(fb_height * sizeof(uint32_t));
+      draw_list->row_dirty    = (uint8_t*)malloc(fb_height);
+      draw_list->num_rows     = fb_height;
+
+      if (     !draw_list->row_sigs
+            || !draw_list->new_row_sigs
+            || !draw_list->row_dirty)
+      {
+         rgui_draw_list_free(rgui);
+         return false;
+      }
+   }
+
+   draw_list->num_cmds     = 0;
+   draw_list->text_len     = 0;
+   draw_list->recording    = true;
+
+   rgui_blit_line_direct   = rgui_blit_line;
+   rgui_blit_symbol_direct = rgui_blit_symbol;
+   rgui_blit_line          = rgui_blit_line_record;
+   rgui_blit_symbol        = rgui_blit_symbol_record;
+   return true;
+}
+
+static void rgui_draw_list_replay(rgui_t *rgui, unsigned fb_width,
+      const uint8_t *row_dirty)
+{
+   size_t i;
+   rgui_draw_list_t *draw_list = &rgui->draw_list;
+
+   for (i = 0; i < draw_list->num_cmds; i++)
+   {
+      rgui_draw_cmd_t *cmd = &draw_list->cmds[i];
+
+      if (     (cmd->row_start >= cmd->row_end)
+            || (row_dirty && !row_dirty[cmd->row_start]))
+         continue;
+
+      if (cmd->text == RGUI_DRAW_CMD_SYMBOL)
+         rgui_blit_symbol(rgui, fb_width, cmd->x, cmd->y,
+               (enum rgui_symbol_type)cmd->symbol,
+               cmd->color, cmd->shadow_color);
+      else
+         rgui_blit_line(rgui, fb_width, cmd->x, cmd->y,
+               draw_list->text + cmd->text,
+               cmd->color, cmd->shadow_color);
+   }
+}
+
+static void rgui_draw_list_stop(rgui_t *rgui)
+{
+   rgui->draw_list.recording = false;
+   rgui_blit_line            = rgui_blit_line_direct;
+   rgui_blit_symbol          = rgui_blit_symbol_direct;
+}
+
+static void rgui_draw_list_abort(rgui_t *rgui, unsigned fb_width,
+      unsigned fb_height, size_t fb_pitch)
+{
+   rgui_draw_list_stop(rgui);
+   rgui_draw_list_invalidate(rgui);
+   rgui_render_background(rgui, fb_width, fb_height, fb_pitch);
+   rgui_draw_list_replay(rgui, fb_width, NULL);
+   rgui->render_rows += fb_height;
+}
+
+/* Stops recording and brings the framebuffer up to date:
+ * scanlines whose signature changed are restored from the
+ * background and every command touching them is replayed
+ * in order. A replayed command may spill into clean rows,
+ * so those rows are pulled in too, until no command
+ * straddles a clean and a dirty row. */
+static void rgui_draw_list_end(rgui_t *rgui, unsigned fb_width,
+      unsigned fb_height, size_t fb_pitch)
+{
+   size_t i;
+   unsigned y;
+   bool changed;
+   rgui_draw_list_t *draw_list = &rgui->draw_list;
+   frame_buf_t *frame_buf      = &rgui->frame_buf;
+   frame_buf_t *background_buf = &rgui->background_buf;
+   uint32_t *row_sigs          = draw_list->new_row_sigs;
+   uint8_t *row_dirty          = draw_list->row_dirty;
+
+   if (!draw_list->recording)
+      return;
+
+   rgui_draw_list_stop(rgui);
+
+   for (y = 0; y < fb_height; y++)
+      row_sigs[y] = 0x811c9dc5;
+
+   for (i = 0; i < draw_list->num_cmds; i++)
+   {
+      rgui_draw_cmd_t *cmd = &draw_list->cmds[i];
+
+      for (y = cmd->row_start; y < cmd->row_end; y++)
+         row_sigs[y] = (row_sigs[y] ^ cmd->hash) * 0x01000193;
+   }
+
+   for (y = 0; y < fb_height; y++)
+   {
+      /* Keep 0 free for 'unknown' */
+      if (!row_sigs[y])
+         row_sigs[y] = 1;
+      row_dirty[y] = (row_sigs[y] != draw_list->row_sigs[y]);
+   }
+
+   do
+   {
+      changed = false;
+
+      for (i = 0; i < draw_list->num_cmds; i++)
+      {
+         rgui_draw_cmd_t *cmd = &draw_list->cmds[i];
+         bool any_dirty       = false;
+         bool all_dirty       = true;
+
+         for (y = cmd->row_start; y < cmd->row_end; y++)
+         {
+            if (row_dirty[y])
+               any_dirty = true;
+            else
+               all_dirty = false;
+         }
+
+         if (any_dirty && !all_dirty)
+         {
+            for (y = cmd->row_start; y < cmd->row_end; y++)
+               row_dirty[y] = 1;
+            changed = true;
+         }
+      }
+   } while (changed);
+
+   /* Restore background of each run of dirty rows */
+   if (     background_buf->data
+         && (fb_width == frame_buf->width)
+         && (fb_height == frame_buf->height)
+         && (fb_pitch == frame_buf->width << 1))
+   {
+      for (y = 0; y < fb_height; )
+      {
+         unsigned y_end;
+
+         if (!row_dirty[y])
+         {
+            y++;
+            continue;
+         }
+
+         for (y_end = y + 1; y_end < fb_height && row_dirty[y_end]; y_end++);
+
+         memcpy(frame_buf->data      + y * fb_width,
+                background_buf->data + y * fb_width,
+                (size_t)(y_end - y) * fb_width * sizeof(uint16_t));
+
+         rgui->render_rows += y_end - y;
+         y                  = y_end;
+      }
+   }
+
+   rgui_draw_list_replay(rgui, fb_width, row_dirty);
+
+   draw_list->new_row_sigs = draw_list->row_sigs;
+   draw_list->row_sigs     = row_sigs;
+}
+
+static void rgui_render_stats_update(rgui_t *rgui,
+      retro_time_t start, unsigned fb_height)
+{
+   retro_time_t end         = cpu_features_get_time_usec();
+
+   rgui->render_time_us    += end - start;
+   rgui->render_rows_total += fb_height;
+   rgui->render_frames++;
+
+   rarch_trace_record("rgui_render", start, end);
+}
+
+static void rgui_render_stats_log(rgui_t *rgui)
+{
+   if (!rgui->render_frames)
+      return;
+
+   RARCH_LOG("[RGUI] Rendered %u frames, %u us per frame, %.1f%% of rows redrawn.\n",
+         rgui->render_frames,
+         (unsigned)(rgui->render_time_us / rgui->render_frames),
+         rgui->render_rows_total
+               ? (100.0f * rgui->render_rows) / rgui->render_rows_total
+               : 0.0f);
+
+   rgui->render_time_us    = 0;
+   rgui->render_frames     = 0;
+   rgui->render_rows       = 0;
+   rgui->render_rows_total = 0;
+}
+
+/* ==============================
+ * Incremental rendering END
+ * ============================== */
+
 static void rgui_set_message(void *data, const char *message)
 {
    rgui_t           *rgui = (rgui_t*)data;
@@ -5001,7 +5466,9 @@ static void rgui_render(void *data, unsigned width, unsigned height,
    gfx_animation_ctx_ticker_t ticker;
    size_t i, end, fb_pitch, old_start, new_start;
    gfx_animation_ctx_ticker_smooth_t ticker_smooth;
+   retro_time_t render_start;
    static bool display_kb         = false;
+   bool incremental               = false;
    int bottom                     = 0;
    unsigned ticker_x_offset       = 0;
    size_t entries_end             = 0;
@@ -5082,10 +5549,11 @@ static void rgui_render(void *data, unsigned width, unsigned height,
          return;
    }
 
-   display_kb = current_display_cb;
-   fb_width   = p_disp->framebuf_width;
-   fb_height  = p_disp->framebuf_height;
-   fb_pitch   = p_disp->framebuf_pitch;
+   display_kb   = current_display_cb;
+   fb_width     = p_disp->framebuf_width;
+   fb_height    = p_disp->framebuf_height;
+   fb_pitch     = p_disp->framebuf_pitch;
+   render_start = cpu_features_get_time_usec();
 
    /* If the framebuffer changed size, or the background config has
     * changed, recache the background buffer */
@@ -5109,6 +5577,8 @@ static void rgui_render(void *data, unsigned width, unsigned height,
       if (!(rgui->flags & RGUI_FLAG_SHOW_WALLPAPER))
          rgui_cache_background(rgui, fb_width, fb_height, fb_pitch);
 
+      rgui_draw_list_invalidate(rgui);
+
       /* Reinitialise particle effect, if required */
       if (      fb_size_changed
             && (rgui->particle_effect != RGUI_PARTICLE_EFFECT_NONE))
@@ -5176,8 +5646,22 @@ static void rgui_render(void *data, unsigned width, unsigned height,
    if (entries_end <= rgui->term_layout.height)
       menu_st->entries.begin = 0;
 
-   /* Render background */
-   rgui_render_background(rgui, fb_width, fb_height, fb_pitch);
+   /* The menu list is drawn incrementally (only text
+    * changes from one frame to the next); everything
+    * else repaints the whole framebuffer */
+   if (     !(rgui->flags & RGUI_FLAG_SHOW_SCREENSAVER)
+         && (rgui->particle_effect == RGUI_PARTICLE_EFFECT_NONE)
+         && !current_display_cb
+         && !show_fs_thumbnail)
+      incremental = rgui_draw_list_begin(rgui, fb_height);
+
+   if (!incremental)
+   {
+      /* Render background */
+      rgui_render_background(rgui, fb_width, fb_height, fb_pitch);
+      rgui_draw_list_invalidate(rgui);
+      rgui->render_rows += fb_height;
+   }
 
    /* Render particle effect, if required */
    if (rgui->particle_effect != RGUI_PARTICLE_EFFECT_NONE)
@@ -5189,7 +5673,10 @@ static void rgui_render(void *data, unsigned width, unsigned height,
    /* If screensaver is active, skip drawing of
     * text/thumbnails */
    if (rgui->flags & RGUI_FLAG_SHOW_SCREENSAVER)
+   {
+      rgui_render_stats_update(rgui, render_start, fb_height);
       return;
+   }
 
    /* We use a single ticker for all text animations,
     * with the following configuration: */
@@ -5726,35 +6213,6 @@ static void rgui_render(void *data, unsigned width, unsigned height,
                   entry_color, rgui->colors.shadow_color);
       }
 
-      /* Draw mini thumbnails, if required */
-      if (show_savestate_thumbnail)
-      {
-         thumbnail_t *thumbnail_savestate = &rgui->mini_left_thumbnail;
-         if (show_savestate_thumbnail && thumbnail_savestate)
-            rgui_render_mini_thumbnail(rgui, thumbnail_savestate,
-                  rgui->frame_buf.data,
-                  (rgui_swap_thumbnails) ? GFX_THUMBNAIL_RIGHT : GFX_THUMBNAIL_LEFT,
-                  fb_width, fb_height, fb_pitch,
-                  rgui_swap_thumbnails, thumbnail_background);
-      }
-      else if (show_mini_thumbnails)
-      {
-         thumbnail_t *thumbnail1        = &rgui->mini_thumbnail;
-         thumbnail_t *thumbnail2        = &rgui->mini_left_thumbnail;
-         if (show_thumbnail && thumbnail1)
-            rgui_render_mini_thumbnail(rgui, thumbnail1,
-                  rgui->frame_buf.data,
-                  GFX_THUMBNAIL_RIGHT,
-                  fb_width, fb_height, fb_pitch,
-                  rgui_swap_thumbnails, thumbnail_background);
-         if (show_left_thumbnail && thumbnail2)
-            rgui_render_mini_thumbnail(rgui, thumbnail2,
-                  rgui->frame_buf.data,
-                  GFX_THUMBNAIL_LEFT,
-                  fb_width, fb_height, fb_pitch,
-                  rgui_swap_thumbnails, thumbnail_background);
-      }
-
       /* Print menu sublabel/core name (if required) */
       if (menu_show_sublabels && !string_is_empty(rgui->menu_sublabel))
       {
@@ -5827,6 +6285,45 @@ static void rgui_render(void *data, unsigned width, unsigned height,
                rgui->colors.hover_color,
                rgui->colors.shadow_color);
       }
+
+      rgui_draw_list_end(rgui, fb_width, fb_height, fb_pitch);
+
+      /* Draw mini thumbnails, if required */
+      if (show_savestate_thumbnail)
+      {
+         thumbnail_t *thumbnail_savestate = &rgui->mini_left_thumbnail;
+         if (show_savestate_thumbnail && thumbnail_savestate)
+            rgui_render_mini_thumbnail(rgui, thumbnail_savestate,
+                  rgui->frame_buf.data,
+                  (rgui_swap_thumbnails) ? GFX_THUMBNAIL_RIGHT : GFX_THUMBNAIL_LEFT,
+                  fb_width, fb_height, fb_pitch,
+                  rgui_swap_thumbnails, thumbnail_background);
+      }
+      else if (show_mini_thumbnails)
+      {
+         thumbnail_t *thumbnail1        = &rgui->mini_thumbnail;
+         thumbnail_t *thumbnail2        = &rgui->mini_left_thumbnail;
+         if (show_thumbnail && thumbnail1)
+            rgui_render_mini_thumbnail(rgui, thumbnail1,
+                  rgui->frame_buf.data,
+                  GFX_THUMBNAIL_RIGHT,
+                  fb_width, fb_height, fb_pitch,
+                  rgui_swap_thumbnails, thumbnail_background);
+         if (show_left_thumbnail && thumbnail2)
+            rgui_render_mini_thumbnail(rgui, thumbnail2,
+                  rgui->frame_buf.data,
+                  GFX_THUMBNAIL_LEFT,
+                  fb_width, fb_height, fb_pitch,
+                  rgui_swap_thumbnails, thumbnail_background);
+      }
+
+      /* Thumbnails are drawn directly on top of the text,
+       * so their area can't be trusted next frame */
+      if (     (show_savestate_thumbnail || show_mini_thumbnails)
+            && (   rgui->mini_thumbnail.is_valid
+                || rgui->mini_left_thumbnail.is_valid))
+         rgui_draw_list_invalidate_rows(rgui, rgui->term_layout.start_y,
+               rgui->term_layout.height * rgui->font_height_stride);
    }
 
    if (!string_is_empty(rgui->msgbox))
@@ -5839,6 +6336,7 @@ static void rgui_render(void *data, unsigned width, unsigned height,
             (rgui->flags & RGUI_FLAG_BG_THICKNESS) ? true : false);
 
       rgui_render_messagebox(rgui, rgui->msgbox, fb_width, fb_height);
+      rgui_draw_list_invalidate(rgui);
       rgui->msgbox[0]    = '\0';
       rgui->flags       |=  RGUI_FLAG_FORCE_REDRAW;
    }
@@ -5855,8 +6353,12 @@ static void rgui_render(void *data, unsigned width, unsigned height,
                rgui->pointer.x, rgui->pointer.y - 5, 1, 11, rgui->colors.normal_color);
          rgui_color_rect(rgui->frame_buf.data, fb_width, fb_height,
                rgui->pointer.x - 5, rgui->pointer.y, 11, 1, rgui->colors.normal_color);
+         rgui_draw_list_invalidate_rows(rgui,
+               (rgui->pointer.y > 5) ? rgui->pointer.y - 5 : 0, 11);
       }
    }
+
+   rgui_render_stats_update(rgui, render_start, fb_height);
 }
 
 static void rgui_framebuffer_free(frame_buf_t *framebuffer)
@@ -6091,6 +6593,7 @@ static bool rgui_set_aspect_ratio(
 
    rgui_framebuffer_free(&rgui->frame_buf);
    rgui_framebuffer_free(&rgui->background_buf);
+   rgui_draw_list_invalidate(rgui);
    rgui_thumbnail_free(&rgui->fs_thumbnail);
    rgui_thumbnail_free(&rgui->mini_thumbnail);
    rgui_thumbnail_free(&rgui->mini_left_thumbnail);
@@ -6647,10 +7150,12 @@ static void rgui_free(void *data)
 #endif
 
    rgui_fonts_free(rgui);
+   rgui_render_stats_log(rgui);
 
    rgui_framebuffer_free(&rgui->frame_buf);
    rgui_framebuffer_free(&rgui->background_buf);
    rgui_framebuffer_free(&rgui->upscale_buf);
+   rgui_draw_list_free(rgui);
 
    rgui_thumbnail_free(&rgui->fs_thumbnail);
    rgui_thumbnail_free(&rgui->mini_thumbnail);
@@ -7705,6 +8210,7 @@ static void rgui_frame(void *data, video_frame_info_t *video_info)
             settings->bools.menu_rgui_shadows,
             settings->bools.menu_rgui_extended_ascii);
 
+      rgui_draw_list_invalidate(rgui);
       rgui->flags                |=  RGUI_FLAG_FORCE_REDRAW;
       if (settings->bools.menu_rgui_extended_ascii)
          rgui->flags             |=  RGUI_FLAG_EXTENDED_ASCII_ENABLE;
@@ -7905,6 +8411,9 @@ static void rgui_toggle(void *userdata, bool menu_on)
    if (!rgui || !settings)
       return;
 
+   if (!menu_on)
+      rgui_render_stats_log(rgui);
+
    /* Have to reset this, otherwise savestate
     * thumbnail won't update after selecting
     * 'save state' option */
@@ -8262,6 +8771,20 @@ static int rgui_menu_entry_action(
    return generic_menu_entry_action(userdata, entry, i, new_action);
 }
 
+static bool rgui_is_animating(void *data)
+{
+   rgui_t *rgui = (rgui_t*)data;
+
+   if (!rgui)
+      return false;
+
+   /* A framebuffer redrawn by rgui_render() is only
+    * uploaded by rgui_set_texture() after this frame */
+   return (rgui->particle_effect != RGUI_PARTICLE_EFFECT_NONE)
+       || (rgui->flags & RGUI_FLAG_FORCE_REDRAW)
+       || (disp_get_ptr()->flags & GFX_DISP_FLAG_FB_DIRTY);
+}
+
 menu_ctx_driver_t menu_ctx_rgui = {
    rgui_set_texture,
    rgui_set_message,
@@ -8304,5 +8827,6 @@ menu_ctx_driver_t menu_ctx_rgui = {
    rgui_update_savestate_thumbnail_image,
    NULL,                               /* pointer_down */
    rgui_pointer_up,
-   rgui_menu_entry_action
+   rgui_menu_entry_action,
+   rgui_is_animating
 };
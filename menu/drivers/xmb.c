@@ -9809,6 +9809,17 @@ static int xmb_pointer_up(void *userdata,
    return 0;
 }
 
+static bool xmb_is_animating(void *data)
+{
+#ifdef HAVE_SHADERPIPELINE
+   /* Ribbon and snow backgrounds move every frame */
+   return config_get_ptr()->uints.menu_xmb_shader_pipeline
+      > XMB_SHADER_PIPELINE_WALLPAPER;
+#else
+   return false;
+#endif
+}
+
 menu_ctx_driver_t menu_ctx_xmb = {
    NULL,
    xmb_messagebox,
@@ -9853,5 +9864,6 @@ menu_ctx_driver_t menu_ctx_xmb = {
    xmb_update_savestate_thumbnail_image,
    NULL, /* pointer_down */
    xmb_pointer_up,
-   xmb_menu_entry_action
+   xmb_menu_entry_action,
+   xmb_is_animating
 };
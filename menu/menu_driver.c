@@ -67,6 +67,10 @@
 #endif
 
 #include "../gfx/gfx_animation.h"
+#include "../gfx/gfx_thumbnail.h"
+#ifdef HAVE_GFX_WIDGETS
+#include "../gfx/gfx_widgets.h"
+#endif
 #include "../input/input_driver.h"
 #include "../input/input_remapping.h"
 #include "../performance_counters.h"
@@ -100,6 +104,15 @@ void libnx_apply_overclock(void);
 /* Accelerated navigation buttons */
 #define NAVIGATION_BUTTONS 9
 
+/* Frames still drawn after the last visual change. Covers
+ * menu textures that set_texture() uploads a frame late,
+ * tweens started by input, and swapchains a few images
+ * deep */
+#define MENU_IDLE_LAG_FRAMES 4
+/* A static menu is still redrawn this often (in us), for
+ * status icons that drivers poll while drawing */
+#define MENU_IDLE_REDRAW_INTERVAL 1000000
+
 struct key_desc key_descriptors[RARCH_MAX_KEYS] =
 {
    {RETROK_FIRST,         "Unmapped"},
@@ -319,7 +332,8 @@ static menu_ctx_driver_t menu_ctx_null = {
   NULL,  /* update_savestate_thumbnail_image */
   NULL,  /* pointer_down */
   NULL,  /* pointer_up   */
-  NULL   /* entry_action */
+  NULL,  /* entry_action */
+  NULL   /* is_animating */
 };
 
 /* Menu drivers */
@@ -4467,7 +4481,11 @@ void menu_driver_frame(bool menu_is_alive, video_frame_info_t *video_info)
 {
    struct menu_state    *menu_st = &menu_driver_state;
    if (menu_is_alive && menu_st->driver_ctx->frame)
+   {
+      retro_time_t trace_start   = rarch_trace_begin();
       menu_st->driver_ctx->frame(menu_st->userdata, video_info);
+      rarch_trace_end("menu_render", trace_start);
+   }
 }
 
 /* Teardown function for the menu driver. */
@@ -6532,6 +6550,12 @@ void retroarch_menu_running(void)
    }
    menu_st->input_last_time_us = cpu_features_get_time_usec();
 
+   menu_st->idle_lag_frames     = MENU_IDLE_LAG_FRAMES;
+   menu_st->idle_frames_drawn   = 0;
+   menu_st->idle_frames_skipped = 0;
+   menu_st->idle_stats_time_us  = menu_st->input_last_time_us;
+   menu_st->idle_stats_clock    = clock();
+
 #ifdef HAVE_OVERLAY
    if (input_overlay_hide_in_menu)
       command_event(CMD_EVENT_OVERLAY_UNLOAD, NULL);
@@ -6579,6 +6603,21 @@ void retroarch_menu_running_finished(bool quit)
    /* Prevent stray input */
    menu_st->input_driver_flushing_input = 2;
 
+   /* Report how much of the menu session was spent
+    * idle, with the process CPU time it used */
+   if (menu_st->idle_frames_drawn + menu_st->idle_frames_skipped > 0)
+   {
+      retro_time_t wall_us = cpu_features_get_time_usec()
+         - menu_st->idle_stats_time_us;
+      double cpu_us        = (double)(clock() - menu_st->idle_stats_clock)
+         * 1000000.0 / CLOCKS_PER_SEC;
+
+      RARCH_LOG("[Menu] Drew %u frames, skipped %u static frames, CPU %.1f%%.\n",
+            menu_st->idle_frames_drawn,
+            menu_st->idle_frames_skipped,
+            (wall_us > 0) ? cpu_us * 100.0 / (double)wall_us : 0.0);
+   }
+
    if (!quit)
    {
 #ifdef HAVE_AUDIOMIXER
@@ -8012,6 +8051,70 @@ bool menu_driver_iterate(
             current_time) != -1);
 }
 
+bool menu_driver_is_static_frame(
+      struct menu_state *menu_st,
+      settings_t *settings,
+      bool anim_active,
+      bool input_active,
+      retro_time_t current_time)
+{
+   runloop_state_t *runloop_st                 = runloop_state_get_ptr();
+   video_driver_state_t *video_st              = video_state_get_ptr();
+#ifdef HAVE_GFX_WIDGETS
+   dispgfx_widget_t *p_dispwidget              = dispwidget_get_ptr();
+#endif
+   const menu_input_pointer_hw_state_t *ptr_hw = &menu_st->input_pointer_hw_state;
+   menu_input_pointer_hw_state_t *ptr_last     = &menu_st->idle_pointer_hw_state;
+   bool changed                                =
+            anim_active
+         || input_active
+         || (ptr_hw->x     != ptr_last->x)
+         || (ptr_hw->y     != ptr_last->y)
+         || (ptr_hw->flags != ptr_last->flags)
+         || (menu_st->input_state.pointer.y_accel != 0.0f)
+         || (video_st->width  != menu_st->idle_width)
+         || (video_st->height != menu_st->idle_height)
+         || (menu_st->flags & MENU_ST_FLAG_ENTRIES_NEED_REFRESH)
+         /* Text typed on a keyboard never shows up as an action */
+         || (menu_st->flags & MENU_ST_FLAG_INP_DLG_KB_DISPLAY)
+         || (     (menu_st->flags & MENU_ST_FLAG_SCREENSAVER_ACTIVE)
+               && (settings->uints.menu_screensaver_animation
+                  != MENU_SCREENSAVER_BLANK))
+         || (menu_st->driver_ctx->is_animating
+               && menu_st->driver_ctx->is_animating(menu_st->userdata))
+         || gfx_thumbnail_is_loading()
+#ifdef HAVE_GFX_WIDGETS
+         /* Task progress is not animated */
+         || (p_dispwidget->active && p_dispwidget->current_msgs_size > 0)
+#endif
+         /* OSD text is counted down per presented frame */
+         || (runloop_st->msg_queue_size  > 0)
+         || (runloop_st->msg_queue_delay > 0)
+         || settings->bools.video_fps_show
+         || settings->bools.video_statistics_show
+         || settings->bools.video_framecount_show
+         || settings->bools.video_memory_show;
+
+   *ptr_last            = *ptr_hw;
+   menu_st->idle_width  = video_st->width;
+   menu_st->idle_height = video_st->height;
+
+   if (changed)
+      menu_st->idle_lag_frames = MENU_IDLE_LAG_FRAMES;
+   else if (menu_st->idle_lag_frames > 0)
+      menu_st->idle_lag_frames--;
+   else if (current_time - menu_st->idle_redraw_time_us
+         < MENU_IDLE_REDRAW_INTERVAL)
+   {
+      menu_st->idle_frames_skipped++;
+      return true;
+   }
+
+   menu_st->idle_redraw_time_us = current_time;
+   menu_st->idle_frames_drawn++;
+   return false;
+}
+
 bool menu_input_dialog_start_search(void)
 {
    input_driver_state_t *input_st          = input_state_get_ptr();
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
 #include <boolean.h>
 #include <retro_common_api.h>
@@ -403,6 +404,11 @@ typedef struct menu_ctx_driver
    /* This will be invoked whenever a menu entry action
     * (menu_entry_action()) is performed */
    int (*entry_action)(void *userdata, menu_entry_t *entry, size_t i, enum menu_action action);
+   /* Optional: returns true while the driver draws
+    * something that changes every frame without running
+    * animations (e.g. shader backgrounds, particles), so
+    * that menu_driver_is_static_frame() never skips it */
+   bool (*is_animating)(void *data);
 } menu_ctx_driver_t;
 
 typedef struct
@@ -477,6 +483,11 @@ struct menu_state
    retro_time_t action_start_time;
    retro_time_t action_press_time;
 
+   /* Idle frame elision, see menu_driver_is_static_frame() */
+   retro_time_t idle_redraw_time_us;
+   retro_time_t idle_stats_time_us;
+   clock_t idle_stats_clock;
+
    struct menu_bind_state input_binds;     /* uint64_t alignment */
 
    gfx_thumbnail_path_data_t *thumbnail_path_data;
@@ -510,12 +521,18 @@ struct menu_state
    unsigned input_driver_flushing_input;
    menu_dialog_t dialog_st;
    enum menu_action prev_action;
+   unsigned idle_lag_frames;
+   unsigned idle_width;
+   unsigned idle_height;
+   unsigned idle_frames_drawn;
+   unsigned idle_frames_skipped;
 #ifdef HAVE_RUNAHEAD
    unsigned int runahead_mode;
 #endif
 
    /* int16_t alignment */
    menu_input_pointer_hw_state_t input_pointer_hw_state;
+   menu_input_pointer_hw_state_t idle_pointer_hw_state;
 
    uint16_t flags;
 #ifdef HAVE_OVERLAY
@@ -730,6 +747,25 @@ bool menu_driver_iterate(
       enum menu_action action,
       retro_time_t current_time);
 
+/**
+ * menu_driver_is_static_frame:
+ * @anim_active  : whether animations or tickers were
+ *                 active before the driver's render()
+ * @input_active : whether any input changed this frame
+ *
+ * Checks whether the menu would draw exactly what was last
+ * presented. Drawing resumes for a few frames after any
+ * change, and at least once per second for status icons.
+ *
+ * Returns: true if the frame can be skipped.
+ **/
+bool menu_driver_is_static_frame(
+      struct menu_state *menu_st,
+      settings_t *settings,
+      bool anim_active,
+      bool input_active,
+      retro_time_t current_time);
+
 void menu_display_common_image_upload(void *data,
       void *user_data, unsigned type);
 
@@ -0,0 +1,516 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+#include <compat/strl.h>
+#include <queues/task_queue.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "performance_counters.h"
+#include "verbosity.h"
+
+/* Events kept per thread; must be a power of two.
+ * At 24 bytes per event this is ~400 KB per traced
+ * thread. */
+#define TRACE_RING_SIZE   16384
+#define TRACE_MAX_THREADS 32
+/* Distinct span names a benchmark keeps samples for */
+#define BENCH_MAX_METRICS 16
+
+/* Orders the event stores before the head update
+ * that publishes them */
+#if defined(_MSC_VER)
+#define TRACE_BARRIER() MemoryBarrier()
+#elif defined(__GNUC__) || defined(__clang__)
+#define TRACE_BARRIER() __sync_synchronize()
+#else
+#define TRACE_BARRIER()
+#endif
+
+typedef struct
+{
+   const char   *name;
+   retro_time_t  start;
+   retro_time_t  dur;
+} rarch_trace_event_t;
+
+/* Single producer ring: only the owning thread writes
+ * events, the exporter reads them without locking */
+typedef struct
+{
+   rarch_trace_event_t events[TRACE_RING_SIZE];
+   uintptr_t           tid;
+   /* Total number of events ever written */
+   volatile unsigned   head;
+} rarch_trace_ring_t;
+
+/* Every sample of one span name, for percentiles */
+typedef struct
+{
+   const char   *name;
+   retro_time_t *samples;
+   size_t        count;
+   size_t        capacity;
+   retro_time_t  first_start;
+   retro_time_t  last_start;
+} rarch_bench_metric_t;
+
+typedef struct
+{
+   rarch_bench_metric_t metrics[BENCH_MAX_METRICS];
+   char                *path;
+   uintptr_t            tid;
+   unsigned             num_metrics;
+   bool                 active;
+} rarch_bench_state_t;
+
+typedef struct
+{
+   rarch_trace_ring_t *rings[TRACE_MAX_THREADS];
+   rarch_bench_state_t bench;
+#ifdef HAVE_THREADS
+   slock_t            *lock;
+#endif
+   char               *path;
+   retro_time_t        epoch;
+   volatile unsigned   num_rings;
+   /* Spans are timed at all: set while recording
+    * or benchmarking */
+   volatile bool       enabled;
+   volatile bool       recording;
+} rarch_trace_state_t;
+
+static rarch_trace_state_t rarch_trace_st = {{0}};
+
+static uintptr_t rarch_trace_thread_id(void)
+{
+#ifdef HAVE_THREADS
+   return sthread_get_current_thread_id();
+#else
+   return 1;
+#endif
+}
+
+/* Rings are never removed while tracing may be active,
+ * so they can be looked up without taking the lock */
+static rarch_trace_ring_t *rarch_trace_get_ring(void)
+{
+   unsigned i;
+   rarch_trace_ring_t *ring = NULL;
+   uintptr_t tid            = rarch_trace_thread_id();
+   unsigned num_rings       = rarch_trace_st.num_rings;
+
+   for (i = 0; i < num_rings; i++)
+      if (rarch_trace_st.rings[i]->tid == tid)
+         return rarch_trace_st.rings[i];
+
+#ifdef HAVE_THREADS
+   slock_lock(rarch_trace_st.lock);
+#endif
+   /* Only this thread can register its own ring, so the
+    * rings added meanwhile belong to other threads */
+   if (     (num_rings = rarch_trace_st.num_rings) < TRACE_MAX_THREADS
+         && (ring = (rarch_trace_ring_t*)calloc(1, sizeof(*ring))))
+   {
+      ring->tid                         = tid;
+      rarch_trace_st.rings[num_rings]   = ring;
+      TRACE_BARRIER();
+      rarch_trace_st.num_rings          = num_rings + 1;
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(rarch_trace_st.lock);
+#endif
+
+   return ring;
+}
+
+/* Only spans of the thread that started the benchmark
+ * are kept, so the sample arrays need no locking */
+static void rarch_bench_record(rarch_bench_state_t *bench,
+      const char *name, retro_time_t start, retro_time_t end)
+{
+   unsigned i;
+   rarch_bench_metric_t *metric = NULL;
+
+   if (rarch_trace_thread_id() != bench->tid)
+      return;
+
+   for (i = 0; i < bench->num_metrics; i++)
+   {
+      if (     bench->metrics[i].name == name
+            || string_is_equal(bench->metrics[i].name, name))
+      {
+         metric = &bench->metrics[i];
+         break;
+      }
+   }
+
+   if (!metric)
+   {
+      if (bench->num_metrics >= BENCH_MAX_METRICS)
+         return;
+      metric              = &bench->metrics[bench->num_metrics++];
+      metric->name        = name;
+      metric->first_start = start;
+   }
+
+   if (metric->count == metric->capacity)
+   {
+      size_t capacity       = metric->capacity ? metric->capacity * 2 : 1024;
+      retro_time_t *samples = (retro_time_t*)realloc(metric->samples,
+            capacity * sizeof(*samples));
+      if (!samples)
+         return;
+      metric->samples       = samples;
+      metric->capacity      = capacity;
+   }
+
+   metric->samples[metric->count++] = end - start;
+   metric->last_start               = start;
+}
+
+void rarch_trace_record(const char *name,
+      retro_time_t start, retro_time_t end)
+{
+   unsigned head;
+   rarch_trace_event_t *event = NULL;
+   rarch_trace_ring_t  *ring  = NULL;
+
+   if (!start || !rarch_trace_st.enabled)
+      return;
+
+   if (rarch_trace_st.bench.active)
+      rarch_bench_record(&rarch_trace_st.bench, name, start, end);
+
+   if (!rarch_trace_st.recording)
+      return;
+
+   if (!(ring = rarch_trace_get_ring()))
+      return;
+
+   head         = ring->head;
+   event        = &ring->events[head & (TRACE_RING_SIZE - 1)];
+   event->name  = name;
+   event->start = start;
+   event->dur   = end - start;
+   TRACE_BARRIER();
+   ring->head   = head + 1;
+}
+
+void rarch_trace_end(const char *name, retro_time_t start)
+{
+   if (start && rarch_trace_st.enabled)
+      rarch_trace_record(name, start, cpu_features_get_time_usec());
+}
+
+retro_time_t rarch_trace_begin(void)
+{
+   return rarch_trace_st.enabled ? cpu_features_get_time_usec() : 0;
+}
+
+static void rarch_trace_task_cb(retro_task_t *task,
+      retro_time_t start, retro_time_t end)
+{
+   rarch_trace_record("task", start, end);
+}
+
+bool rarch_trace_is_enabled(void)
+{
+   return rarch_trace_st.recording;
+}
+
+void rarch_trace_start(const char *path)
+{
+#ifdef HAVE_THREADS
+   if (!rarch_trace_st.lock && !(rarch_trace_st.lock = slock_new()))
+      return;
+#endif
+
+   if (!string_is_empty(path))
+   {
+      if (rarch_trace_st.path)
+         free(rarch_trace_st.path);
+      rarch_trace_st.path = strdup(path);
+   }
+
+   if (!rarch_trace_st.epoch)
+      rarch_trace_st.epoch = cpu_features_get_time_usec();
+
+   rarch_trace_st.recording = true;
+   rarch_trace_st.enabled   = true;
+   task_queue_set_trace(rarch_trace_task_cb);
+   RARCH_LOG("[Trace] Recording started.\n");
+}
+
+void rarch_trace_stop(void)
+{
+   if (!rarch_trace_st.recording)
+      return;
+   rarch_trace_st.recording = false;
+   rarch_trace_st.enabled   = rarch_trace_st.bench.active;
+   task_queue_set_trace(NULL);
+   RARCH_LOG("[Trace] Recording stopped.\n");
+}
+
+/* Writes the events of one ring still present in the
+ * buffer. The owning thread keeps recording meanwhile,
+ * so events that may have been overwritten during the
+ * copy are dropped. Returns the number of events written. */
+static unsigned rarch_trace_export_ring(RFILE *file,
+      const rarch_trace_ring_t *ring,
+      rarch_trace_event_t *events, bool *first_event)
+{
+   unsigned i, first, last, end, valid;
+
+   last  = ring->head;
+   TRACE_BARRIER();
+   first = (last > TRACE_RING_SIZE) ? last - TRACE_RING_SIZE : 0;
+
+   for (i = first; i != last; i++)
+      events[i - first] = ring->events[i & (TRACE_RING_SIZE - 1)];
+
+   /* Slots reused by the owning thread during the copy
+    * may hold newer events than the ones we expected */
+   TRACE_BARRIER();
+   end   = ring->head;
+   valid = (end - first > TRACE_RING_SIZE) ? end - TRACE_RING_SIZE : first;
+   if (valid - first > last - first)
+      return 0;
+
+   for (i = valid; i != last; i++)
+   {
+      const rarch_trace_event_t *event = &events[i - first];
+      filestream_printf(file,
+            "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+            "\"tid\":%u,\"ts\":%" PRId64 ",\"dur\":%" PRId64 "}",
+            *first_event ? "" : ",",
+            event->name,
+            (unsigned)(ring->tid & 0xFFFFFFFF),
+            (int64_t)(event->start - rarch_trace_st.epoch),
+            (int64_t)event->dur);
+      *first_event = false;
+   }
+
+   return last - valid;
+}
+
+bool rarch_trace_export(const char *path)
+{
+   unsigned i, num_rings;
+   unsigned num_events        = 0;
+   bool first_event           = true;
+   RFILE *file                = NULL;
+   rarch_trace_event_t *events = NULL;
+
+   if (string_is_empty(path))
+      path = rarch_trace_st.path;
+   if (string_is_empty(path))
+      return false;
+
+   if (!(events = (rarch_trace_event_t*)malloc(
+               TRACE_RING_SIZE * sizeof(*events))))
+      return false;
+
+   if (!(file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_ERR("[Trace] Failed to write \"%s\".\n", path);
+      free(events);
+      return false;
+   }
+
+   filestream_printf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+   num_rings = rarch_trace_st.num_rings;
+   TRACE_BARRIER();
+   for (i = 0; i < num_rings; i++)
+      num_events += rarch_trace_export_ring(file,
+            rarch_trace_st.rings[i], events, &first_event);
+
+   filestream_printf(file, "\n]}\n");
+   filestream_close(file);
+   free(events);
+
+   RARCH_LOG("[Trace] Wrote %u events from %u threads to \"%s\".\n",
+         num_events, num_rings, path);
+   return true;
+}
+
+void rarch_benchmark_start(const char *path)
+{
+   rarch_bench_state_t *bench = &rarch_trace_st.bench;
+
+   if (string_is_empty(path))
+      return;
+
+   if (bench->path)
+      free(bench->path);
+   bench->path            = strdup(path);
+   bench->tid             = rarch_trace_thread_id();
+   bench->active          = true;
+   rarch_trace_st.enabled = true;
+}
+
+bool rarch_benchmark_is_enabled(void)
+{
+   return rarch_trace_st.bench.active;
+}
+
+static int rarch_bench_compare(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+   return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static retro_time_t rarch_bench_percentile(
+      const rarch_bench_metric_t *metric, unsigned percent)
+{
+   size_t rank = (metric->count * percent + 99) / 100;
+   return metric->samples[rank ? rank - 1 : 0];
+}
+
+static const rarch_bench_metric_t *rarch_bench_find(
+      const rarch_bench_state_t *bench, const char *name)
+{
+   unsigned i;
+   for (i = 0; i < bench->num_metrics; i++)
+      if (string_is_equal(bench->metrics[i].name, name))
+         return &bench->metrics[i];
+   return NULL;
+}
+
+bool rarch_benchmark_report(void)
+{
+   unsigned i;
+   bool first_metric                   = true;
+   size_t frames                       = 0;
+   retro_time_t wall_time              = 0;
+   double fps                          = 0.0;
+   RFILE *file                         = NULL;
+   rarch_bench_state_t *bench          = &rarch_trace_st.bench;
+   const rarch_bench_metric_t *frame   = NULL;
+
+   if (!bench->active)
+      return false;
+
+   /* Frames are counted as presented frames, since run-ahead
+    * and preemptive frames call retro_run() several times
+    * per frame */
+   if (     !(frame = rarch_bench_find(bench, "video_frame"))
+         && !(frame = rarch_bench_find(bench, "core_run")))
+   {
+      RARCH_ERR("[Benchmark] No frames were run.\n");
+      return false;
+   }
+
+   frames    = frame->count;
+   wall_time = frame->last_start - frame->first_start;
+   if (frames > 1 && wall_time > 0)
+      fps    = (double)(frames - 1) * 1000000.0 / (double)wall_time;
+
+   if (!(file = filestream_open(bench->path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_ERR("[Benchmark] Failed to write \"%s\".\n", bench->path);
+      return false;
+   }
+
+   filestream_printf(file,
+         "{\n  \"frames\": %u,\n  \"wall_time_us\": %" PRId64 ",\n"
+         "  \"fps\": %.3f,\n  \"spans\": {",
+         (unsigned)frames, (int64_t)wall_time, fps);
+
+   for (i = 0; i < bench->num_metrics; i++)
+   {
+      size_t j;
+      int64_t total                = 0;
+      rarch_bench_metric_t *metric = &bench->metrics[i];
+
+      if (!metric->count)
+         continue;
+
+      qsort(metric->samples, metric->count, sizeof(*metric->samples),
+            rarch_bench_compare);
+      for (j = 0; j < metric->count; j++)
+         total += metric->samples[j];
+
+      filestream_printf(file,
+            "%s\n    \"%s\": {\"count\": %u, \"total_us\": %" PRId64 ", "
+            "\"mean_us\": %.2f, \"p50_us\": %" PRId64 ", "
+            "\"p90_us\": %" PRId64 ", \"p99_us\": %" PRId64 ", "
+            "\"max_us\": %" PRId64 "}",
+            first_metric ? "" : ",",
+            metric->name,
+            (unsigned)metric->count,
+            total,
+            (double)total / (double)metric->count,
+            (int64_t)rarch_bench_percentile(metric, 50),
+            (int64_t)rarch_bench_percentile(metric, 90),
+            (int64_t)rarch_bench_percentile(metric, 99),
+            (int64_t)metric->samples[metric->count - 1]);
+      first_metric = false;
+   }
+
+   filestream_printf(file, "\n  }\n}\n");
+   filestream_close(file);
+
+   RARCH_LOG("[Benchmark] %u frames at %.2f FPS, written to \"%s\".\n",
+         (unsigned)frames, fps, bench->path);
+   return true;
+}
+
+void rarch_trace_deinit(void)
+{
+   unsigned i;
+
+   if (rarch_trace_st.recording && rarch_trace_st.path)
+      rarch_trace_export(NULL);
+   rarch_benchmark_report();
+   rarch_trace_st.enabled   = false;
+   rarch_trace_st.recording = false;
+   task_queue_set_trace(NULL);
+
+   for (i = 0; i < rarch_trace_st.bench.num_metrics; i++)
+      free(rarch_trace_st.bench.metrics[i].samples);
+   if (rarch_trace_st.bench.path)
+      free(rarch_trace_st.bench.path);
+
+   for (i = 0; i < rarch_trace_st.num_rings; i++)
+      free(rarch_trace_st.rings[i]);
+#ifdef HAVE_THREADS
+   if (rarch_trace_st.lock)
+      slock_free(rarch_trace_st.lock);
+#endif
+   if (rarch_trace_st.path)
+      free(rarch_trace_st.path);
+
+   memset(&rarch_trace_st, 0, sizeof(rarch_trace_st));
+}
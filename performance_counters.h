@@ -81,6 +81,67 @@ unsigned retro_get_perf_count_libretro(void);
 
 void rarch_perf_register(struct retro_perf_counter *perf);
 
+/* Trace spans
+ *
+ * Unlike the counters above, spans record every single
+ * occurrence along with the thread it ran on, so a session
+ * can be inspected on a timeline. Events go to per-thread
+ * ring buffers without locking; only the most recent ones
+ * per thread are kept. The result is exported as Chrome
+ * trace JSON, which chrome://tracing and Perfetto open.
+ *
+ * Typical use:
+ *    retro_time_t trace_start = rarch_trace_begin();
+ *    ...
+ *    rarch_trace_end("name", trace_start);
+ *
+ * 'name' must be a string literal; only the pointer is
+ * stored. Both calls are nearly free while tracing is off.
+ */
+
+/* Returns the current time if tracing is enabled,
+ * otherwise 0 */
+retro_time_t rarch_trace_begin(void);
+
+/* Records a span that started at 'start', as returned
+ * by rarch_trace_begin(), and ends now */
+void rarch_trace_end(const char *name, retro_time_t start);
+
+/* Records a span with known start and end times */
+void rarch_trace_record(const char *name,
+      retro_time_t start, retro_time_t end);
+
+bool rarch_trace_is_enabled(void);
+
+/* Enables tracing. If 'path' is set, it becomes the
+ * default export path, and the trace is written there
+ * on exit. */
+void rarch_trace_start(const char *path);
+
+void rarch_trace_stop(void);
+
+/* Writes the recorded events to 'path', or to the path
+ * given to rarch_trace_start() if NULL.
+ * Tracing may continue while exporting. */
+bool rarch_trace_export(const char *path);
+
+/* Keeps every span recorded on the calling thread, so
+ * per-span percentiles can be reported once the run ends.
+ * Works independently of rarch_trace_start(). */
+void rarch_benchmark_start(const char *path);
+
+bool rarch_benchmark_is_enabled(void);
+
+/* Writes frame count, FPS and count/total/mean/p50/p90/
+ * p99/max per span name to the benchmark path as JSON */
+bool rarch_benchmark_report(void);
+
+/* Exports to the default path if tracing is enabled,
+ * writes the benchmark report if benchmarking,
+ * and frees all buffers. No thread may record spans
+ * any more by the time this is called. */
+void rarch_trace_deinit(void);
+
 RETRO_END_DECLS
 
 #endif
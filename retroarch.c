@@ -184,7 +184,11 @@
 #include "driver.h"
 #include "msg_hash.h"
 #include "paths.h"
+#include "performance_counters.h"
 #include "file_path_special.h"
+#ifdef HAVE_SHM_EXPORT
+#include "shm_export.h"
+#endif
 #include "ui/ui_companion_driver.h"
 #include "verbosity.h"
 
@@ -294,6 +298,10 @@ enum
    RA_OPT_MAX_FRAMES,
    RA_OPT_MAX_FRAMES_SCREENSHOT,
    RA_OPT_MAX_FRAMES_SCREENSHOT_PATH,
+   RA_OPT_TRACE,
+   RA_OPT_BENCHMARK,
+   RA_OPT_SHM_EXPORT,
+   RA_OPT_SHM_EXPORT_MEMORY,
    RA_OPT_SET_SHADER,
    RA_OPT_DATABASE_SCAN,
    RA_OPT_ACCESSIBILITY,
@@ -5872,6 +5880,8 @@ void main_exit(void *args)
    retroarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
    global_free(p_rarch);
    task_queue_deinit();
+   task_image_decode_deinit();
+   rarch_trace_deinit();
 
    ui_companion_driver_deinit();
    retroarch_config_deinit();
@@ -6648,8 +6658,35 @@ static void retroarch_print_help(const char *arg0)
          "Detach program from the running console. Not relevant for all platforms.\n"
          "      --max-frames=NUMBER        "
          "Runs for the specified number of frames, then exits.\n"
+         "      --trace=FILE               "
+         "Records timing spans and writes them to FILE as Chrome trace JSON on exit.\n"
+         , sizeof(buf) - _len);
+   _len += strlcpy(buf + _len,
+         "      --benchmark=FILE           "
+         "Runs unthrottled on the null video and audio drivers, then writes FPS and\n"
+         "                                 "
+         "per-frame timing percentiles to FILE as JSON. Runs 3600 frames unless\n"
+         "                                 "
+         "--max-frames is given.\n"
          , sizeof(buf) - _len);
 
+#ifdef HAVE_SHM_EXPORT
+   /* Flush to stay within the buffer */
+   printf("%s", buf);
+   buf[0] = '\0';
+   _len   = 0;
+   _len  += strlcpy(buf + _len,
+         "      --shm-export=NAME          "
+         "Publishes video frames, audio and core memory to the POSIX shared\n"
+         "                                 "
+         "memory object NAME (e.g. /retroarch) for local tools.\n"
+         "      --shm-export-memory=LIST   "
+         "Memory regions to publish: comma-separated sram, rtc, system_ram,\n"
+         "                                 "
+         "video_ram. Defaults to system_ram.\n"
+         , sizeof(buf) - _len);
+#endif
+
 #ifdef HAVE_PATCH
    _len += strlcpy(buf + _len,
          "  -U, --ups=FILE                 "
@@ -6910,6 +6947,11 @@ static bool retroarch_parse_input_and_config(
    bool                 cli_active = false;
    bool               cli_core_set = false;
    bool            cli_content_set = false;
+   bool                  benchmark = false;
+#ifdef HAVE_SHM_EXPORT
+   const char       *shm_export_name = NULL;
+   unsigned       shm_export_regions = 1 << RETRO_MEMORY_SYSTEM_RAM;
+#endif
    recording_state_t *rec_st       = recording_state_get_ptr();
    video_driver_state_t *video_st  = video_state_get_ptr();
    runloop_state_t     *runloop_st = runloop_state_get_ptr();
@@ -6974,6 +7016,12 @@ static bool retroarch_parse_input_and_config(
       { "max-frames",         1, NULL, RA_OPT_MAX_FRAMES },
       { "max-frames-ss",      0, NULL, RA_OPT_MAX_FRAMES_SCREENSHOT },
       { "max-frames-ss-path", 1, NULL, RA_OPT_MAX_FRAMES_SCREENSHOT_PATH },
+      { "trace",              1, NULL, RA_OPT_TRACE },
+      { "benchmark",          1, NULL, RA_OPT_BENCHMARK },
+#ifdef HAVE_SHM_EXPORT
+      { "shm-export",         1, NULL, RA_OPT_SHM_EXPORT },
+      { "shm-export-memory",  1, NULL, RA_OPT_SHM_EXPORT_MEMORY },
+#endif
       { "eof-exit",           0, NULL, RA_OPT_EOF_EXIT },
       { "version",            0, NULL, 'V' /* RA_OPT_VERSION */ },
       { "log-file",           1, NULL, RA_OPT_LOG_FILE },
@@ -7518,6 +7566,52 @@ static bool retroarch_parse_input_and_config(
 #endif
                break;
 
+            case RA_OPT_TRACE:
+               rarch_trace_start(optarg);
+               break;
+
+            case RA_OPT_BENCHMARK:
+               {
+                  settings_t *settings = config_get_ptr();
+
+                  /* Measure the core and frontend alone: no
+                   * presentation, no pacing, and keep these
+                   * overrides out of the saved config */
+                  configuration_set_string(settings,
+                        settings->arrays.video_driver, "null");
+                  configuration_set_string(settings,
+                        settings->arrays.audio_driver, "null");
+                  configuration_set_bool(settings,
+                        settings->bools.video_vsync, false);
+                  configuration_set_bool(settings,
+                        settings->bools.video_threaded, false);
+                  configuration_set_bool(settings,
+                        settings->bools.audio_sync, false);
+                  configuration_set_bool(settings,
+                        settings->bools.vrr_runloop_enable, false);
+                  configuration_set_bool(settings,
+                        settings->bools.config_save_on_exit, false);
+
+                  rarch_benchmark_start(optarg);
+                  benchmark = true;
+               }
+               break;
+
+#ifdef HAVE_SHM_EXPORT
+            case RA_OPT_SHM_EXPORT:
+               shm_export_name = optarg;
+               break;
+
+            case RA_OPT_SHM_EXPORT_MEMORY:
+               if (!(shm_export_regions = shm_export_parse_regions(optarg)))
+               {
+                  RARCH_ERR("Invalid --shm-export-memory list: \"%s\".\n",
+                        optarg);
+                  retroarch_fail(1, "retroarch_parse_input()");
+               }
+               break;
+#endif
+
             case RA_OPT_SUBSYSTEM:
                strlcpy(runloop_st->subsystem_path, optarg,
                      sizeof(runloop_st->subsystem_path));
@@ -7618,6 +7712,14 @@ static bool retroarch_parse_input_and_config(
          PACKAGE_VERSION, retroarch_git_version);
 #endif
 
+   if (benchmark && !runloop_st->max_frames)
+      runloop_st->max_frames = 3600;
+
+#ifdef HAVE_SHM_EXPORT
+   if (shm_export_name)
+      shm_export_set_target(shm_export_name, shm_export_regions);
+#endif
+
    if (explicit_menu)
    {
       if (optind < argc)
@@ -342,6 +342,9 @@ typedef struct content_state
 
    content_file_override_t *content_override_list;
    content_file_list_t *content_list;
+   /* Background CRC32 calculation of the
+    * first content file, if pending */
+   struct content_crc_hasher *crc_hasher;
 
    int pending_subsystem_rom_num;
    int pending_subsystem_id;
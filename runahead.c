@@ -318,10 +318,10 @@ static bool write_file_with_random_name(char **temp_dll_path,
    return okay;
 }
 
-
-static char *copy_core_to_temp_file(
+char *runahead_copy_core_to_temp_file(
       const char *core_path,
-      const char *dir_libretro)
+      const char *dir_libretro,
+      const char *prefix)
 {
    char tmp_path[PATH_MAX_LENGTH];
    bool  failed                = false;
@@ -355,6 +355,10 @@ static char *copy_core_to_temp_file(
 
    strcat_alloc(&tmp_dll_path, tmp_path);
    strcat_alloc(&tmp_dll_path, PATH_DEFAULT_SLASH());
+   /* Each copy needs a distinct name, or the dynamic
+    * loader hands back the library already loaded */
+   if (prefix)
+      strcat_alloc(&tmp_dll_path, prefix);
    strcat_alloc(&tmp_dll_path, core_base_name);
 
    if (!filestream_write_file(tmp_dll_path, dll_file_data, dll_file_size))
@@ -430,8 +434,8 @@ static bool secondary_core_create(runloop_state_t *runloop_st,
    if (runloop_st->secondary_library_path)
       free(runloop_st->secondary_library_path);
    runloop_st->secondary_library_path = NULL;
-   runloop_st->secondary_library_path = copy_core_to_temp_file(
-		   path_get(RARCH_PATH_CORE), path_directory_libretro);
+   runloop_st->secondary_library_path = runahead_copy_core_to_temp_file(
+		   path_get(RARCH_PATH_CORE), path_directory_libretro, NULL);
 
    if (!runloop_st->secondary_library_path)
       return false;
@@ -88,6 +88,17 @@ void runahead_set_load_content_info(
 
 void runahead_secondary_core_destroy(void *data);
 
+#if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
+/* Copies the core library to a temporary file, so it
+ * can be loaded again with its own set of globals.
+ * 'prefix' may be NULL; it tells apart several copies
+ * of the same core. Returns an allocated path. */
+char *runahead_copy_core_to_temp_file(
+      const char *core_path,
+      const char *dir_libretro,
+      const char *prefix);
+#endif
+
 bool preempt_init(void *data);
 void preempt_deinit(void *data);
 
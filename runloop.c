@@ -139,6 +139,14 @@
 #include "runahead.h"
 #endif
 
+#ifdef HAVE_ENV_HOST
+#include "env_host.h"
+#endif
+
+#ifdef HAVE_SHM_EXPORT
+#include "shm_export.h"
+#endif
+
 #ifdef HAVE_MENU
 #include "menu/menu_cbs.h"
 #include "menu/menu_driver.h"
@@ -3981,6 +3989,7 @@ static void uninit_libretro_symbols(
     * reset 'analog input requested' flags */
    memset(&input_st->analog_requested, 0,
          sizeof(input_st->analog_requested));
+   input_st->poll_serial++;
 
    /* Performance counters no longer valid. */
    runloop_st->perf_ptr_libretro  = 0;
@@ -4034,6 +4043,10 @@ static bool core_unload_game(void)
 
    video_st->frame_cache_data     = NULL;
 
+#ifdef HAVE_GAME_AI
+   game_ai_unload();
+#endif
+
    if ((runloop_st->current_core.flags & RETRO_CORE_FLAG_GAME_LOADED))
    {
       RARCH_LOG("[Core] Unloading game...\n");
@@ -4135,6 +4148,15 @@ void runloop_event_deinit_core(void)
    runloop_state_t *runloop_st = &runloop_state;
    settings_t        *settings = config_get_ptr();
 
+#ifdef HAVE_ENV_HOST
+   /* Instances share the content of the primary core */
+   env_host_deinit();
+#endif
+#ifdef HAVE_SHM_EXPORT
+   /* Sized for this core; recreated for the next one */
+   shm_export_deinit();
+#endif
+
    core_unload_game();
 
    video_st->frame_cache_data  = NULL;
@@ -6114,8 +6136,12 @@ static enum runloop_state_enum runloop_check_state(
       static enum menu_action
          old_action                 = MENU_ACTION_CANCEL;
       bool focused                  = false;
+      bool menu_is_static           = false;
       input_bits_t trigger_input    = current_bits;
       unsigned screensaver_timeout  = settings->uints.menu_screensaver_timeout;
+      /* Sampled before the menu driver's render(),
+       * which clears it */
+      bool anim_active              = ANIM_IS_ACTIVE(anim_get_ptr());
 
       /* Get current time */
       menu_st->current_time_us      = current_time;
@@ -6365,7 +6391,19 @@ static enum runloop_state_enum runloop_check_state(
                if (display_menu_libretro(runloop_st, input_st,
                         settings->floats.slowmotion_ratio,
                         libretro_running, current_time))
-                  video_driver_cached_frame();
+               {
+                  bool input_active = (action != MENU_ACTION_NOOP)
+                     || bits_any_different(current_bits.data,
+                           old_input.data, ARRAY_SIZE(current_bits.data));
+
+                  /* Nothing changed since the last presented
+                   * frame: skip drawing and presenting it */
+                  menu_is_static    = menu_driver_is_static_frame(
+                        menu_st, settings,
+                        anim_active, input_active, current_time);
+                  if (!menu_is_static)
+                     video_driver_cached_frame();
+               }
 
             if (menu->driver_ctx->set_texture)
                menu->driver_ctx->set_texture(menu->userdata);
@@ -6380,7 +6418,11 @@ static enum runloop_state_enum runloop_check_state(
       old_input                 = current_bits;
       old_action                = action;
 
-      if (!focused || (runloop_st->flags & RUNLOOP_FLAG_IDLE))
+      /* Nothing throttles a skipped frame, so sleep
+       * instead of spinning */
+      if (     !focused
+            || (runloop_st->flags & RUNLOOP_FLAG_IDLE)
+            || menu_is_static)
          return RUNLOOP_STATE_POLLED_AND_SLEEP;
    }
    else
@@ -7197,6 +7239,50 @@ end:
 
 
 
+#ifdef HAVE_BSV_MOVIE
+/* Longest stretch of headless frames per iteration, so the
+ * frontend keeps presenting and polling while seeking */
+#define RUNLOOP_REPLAY_SEEK_BUDGET_USEC 100000
+
+/* Runs replay frames with audio and video suspended until
+ * the frame before the seek target, which the regular
+ * iteration runs and presents */
+static void runloop_replay_seek(input_driver_state_t *input_st)
+{
+   audio_driver_state_t *audio_st = audio_state_get_ptr();
+   video_driver_state_t *video_st = video_state_get_ptr();
+   bsv_movie_t *handle            = input_st->bsv_movie_state_handle;
+   bool video_active              = (video_st->flags & VIDEO_FLAG_ACTIVE) ? true : false;
+   retro_time_t deadline          = cpu_features_get_time_usec()
+      + RUNLOOP_REPLAY_SEEK_BUDGET_USEC;
+
+   audio_st->flags |=  AUDIO_FLAG_SUSPENDED;
+   video_st->flags &= ~VIDEO_FLAG_ACTIVE;
+
+   while (     handle->frame_counter < handle->seek_frame
+         && !(input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_END))
+   {
+      bsv_movie_next_frame(input_st);
+      core_run();
+      bsv_movie_finish_rewind(input_st);
+      if (cpu_features_get_time_usec() >= deadline)
+         break;
+   }
+
+   if (video_active)
+      video_st->flags |=  VIDEO_FLAG_ACTIVE;
+   audio_st->flags    &= ~AUDIO_FLAG_SUSPENDED;
+
+   if (     handle->frame_counter >= handle->seek_frame
+         || (input_st->bsv_movie_state.flags & BSV_FLAG_MOVIE_END))
+   {
+      handle->seeking = false;
+      RARCH_LOG("[Replay] Reached frame %llu.\n",
+            (unsigned long long)handle->frame_counter);
+   }
+}
+#endif
+
 /**
  * runloop_iterate:
  *
@@ -7394,6 +7480,10 @@ int runloop_iterate(void)
 #endif
 
 #ifdef HAVE_BSV_MOVIE
+   if (     input_st->bsv_movie_state_handle
+         && input_st->bsv_movie_state_handle->seeking
+         && !input_st->bsv_movie_state_next_handle)
+      runloop_replay_seek(input_st);
    bsv_movie_next_frame(input_st);
 #endif
 
@@ -7424,13 +7514,21 @@ int runloop_iterate(void)
 #endif
 
       if (want_runahead)
+      {
+         retro_time_t trace_start = rarch_trace_begin();
          runahead_run(
                runloop_st,
                run_ahead_num_frames,
                run_ahead_hide_warnings,
                run_ahead_secondary_instance);
+         rarch_trace_end("runahead", trace_start);
+      }
       else if (runloop_st->preempt_data)
+      {
+         retro_time_t trace_start = rarch_trace_begin();
          preempt_run(runloop_st->preempt_data, runloop_st);
+         rarch_trace_end("runahead", trace_start);
+      }
       else
 #endif
          core_run();
@@ -7901,6 +7999,7 @@ bool core_set_controller_port_device(retro_ctx_controller_info_t *pad)
     * of 'input_state()' */
    memset(&input_st->analog_requested, 0,
          sizeof(input_st->analog_requested));
+   input_st->poll_serial++;
 
 #if defined(HAVE_RUNAHEAD)
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
@@ -8014,24 +8113,33 @@ bool core_unserialize_special(retro_ctx_serialize_info_t *info)
 
 bool core_serialize(retro_ctx_serialize_info_t *info)
 {
+   bool ret;
+   retro_time_t trace_start;
    runloop_state_t *runloop_st  = &runloop_state;
-   if (!info || !runloop_st->current_core.retro_serialize(info->data, info->size))
+   if (!info)
       return false;
-   return true;
+   trace_start                  = rarch_trace_begin();
+   ret                          = runloop_st->current_core.retro_serialize(
+         info->data, info->size);
+   rarch_trace_end("serialize", trace_start);
+   return ret;
 }
 
 bool core_serialize_special(retro_ctx_serialize_info_t *info)
 {
    bool ret;
+   retro_time_t trace_start;
    runloop_state_t *runloop_st = &runloop_state;
 
    if (!info)
       return false;
 
+   trace_start        = rarch_trace_begin();
    runloop_st->flags |=  RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE;
    ret                = runloop_st->current_core.retro_serialize(
                         info->data, info->size);
    runloop_st->flags &= ~RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE;
+   rarch_trace_end("serialize", trace_start);
 
    return ret;
 }
@@ -8098,7 +8206,11 @@ void core_run(void)
    else if (late_polling)
       current_core->flags &= ~RETRO_CORE_FLAG_INPUT_POLLED;
 
-   current_core->retro_run();
+   {
+      retro_time_t trace_start = rarch_trace_begin();
+      current_core->retro_run();
+      rarch_trace_end("core_run", trace_start);
+   }
 
 #ifdef HAVE_GAME_AI
    {
@@ -0,0 +1,333 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2023 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <compat/strl.h>
+#include <lists/string_list.h>
+#include <string/stdstring.h>
+
+#include "gfx/video_driver.h"
+#include "runloop.h"
+#include "shm_export.h"
+#include "verbosity.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SHM_EXPORT_BARRIER() __sync_synchronize()
+#else
+#define SHM_EXPORT_BARRIER()
+#endif
+
+#define SHM_EXPORT_ALIGN(x) (((x) + 63) & ~(size_t)63)
+
+typedef struct
+{
+   char name[256];
+   shm_export_header_t *header;
+   int16_t *audio;
+   size_t size;
+   size_t audio_frames;
+   uint64_t published;
+   unsigned regions;
+   uint32_t region_capacity[SHM_EXPORT_MAX_REGIONS];
+   uint32_t region_type[SHM_EXPORT_MAX_REGIONS];
+   unsigned num_regions;
+   /* Creation failed for this content, don't retry
+    * every frame */
+   bool failed;
+} shm_export_state_t;
+
+static shm_export_state_t shm_export_st;
+
+static const char *shm_export_region_names[] = {
+   "sram",       /* RETRO_MEMORY_SAVE_RAM   */
+   "rtc",        /* RETRO_MEMORY_RTC        */
+   "system_ram", /* RETRO_MEMORY_SYSTEM_RAM */
+   "video_ram"   /* RETRO_MEMORY_VIDEO_RAM  */
+};
+
+unsigned shm_export_parse_regions(const char *list)
+{
+   size_t i;
+   unsigned regions          = 0;
+   struct string_list *names = string_split(list, ",");
+
+   if (!names)
+      return 0;
+
+   for (i = 0; i < names->size; i++)
+   {
+      unsigned type;
+      for (type = 0; type < ARRAY_SIZE(shm_export_region_names); type++)
+         if (string_is_equal(names->elems[i].data,
+                  shm_export_region_names[type]))
+            break;
+      if (type == ARRAY_SIZE(shm_export_region_names))
+      {
+         regions = 0;
+         break;
+      }
+      regions |= 1 << type;
+   }
+
+   string_list_free(names);
+   return regions;
+}
+
+void shm_export_set_target(const char *name, unsigned regions)
+{
+   shm_export_deinit();
+   strlcpy(shm_export_st.name, name, sizeof(shm_export_st.name));
+   shm_export_st.regions = regions;
+}
+
+static uint8_t *shm_export_slot_ptr(shm_export_state_t *shm, unsigned i)
+{
+   shm_export_header_t *header = shm->header;
+   return (uint8_t*)header + header->header_size
+      + (size_t)i * header->slot_size;
+}
+
+/* Sizes the object for the largest frame the core may
+ * output and the memory regions it has right now */
+static bool shm_export_create(shm_export_state_t *shm)
+{
+   int fd;
+   unsigned type;
+   size_t video_capacity, audio_capacity, slot_size;
+   size_t memory_capacity            = 0;
+   shm_export_header_t *header       = NULL;
+   runloop_state_t *runloop_st       = runloop_state_get_ptr();
+   video_driver_state_t *video_st    = video_state_get_ptr();
+   const struct retro_system_av_info
+      *av_info                       = &video_st->av_info;
+   double fps                        = av_info->timing.fps > 0.0
+      ? av_info->timing.fps : 60.0;
+
+   shm->num_regions = 0;
+   for (type = 0; type < ARRAY_SIZE(shm_export_region_names); type++)
+   {
+      size_t size;
+      if (!(shm->regions & (1 << type)))
+         continue;
+      if (!runloop_st->current_core.retro_get_memory_size)
+         break;
+      size = runloop_st->current_core.retro_get_memory_size(type);
+      shm->region_type[shm->num_regions]     = type;
+      shm->region_capacity[shm->num_regions] = (uint32_t)size;
+      shm->num_regions++;
+      memory_capacity += size;
+   }
+
+   video_capacity = (size_t)av_info->geometry.max_width
+      * av_info->geometry.max_height * sizeof(uint32_t);
+   /* Twice the audio of one frame at the core's rate */
+   audio_capacity = (size_t)(av_info->timing.sample_rate / fps) * 2 + 64;
+   slot_size      = SHM_EXPORT_ALIGN(sizeof(shm_export_slot_t)
+         + video_capacity + audio_capacity * 2 * sizeof(int16_t)
+         + memory_capacity);
+   shm->size      = SHM_EXPORT_ALIGN(sizeof(shm_export_header_t))
+      + SHM_EXPORT_SLOTS * slot_size;
+
+   if (!(shm->audio = (int16_t*)malloc(audio_capacity * 2 * sizeof(int16_t))))
+      return false;
+
+   if ((fd = shm_open(shm->name, O_CREAT | O_RDWR, 0600)) < 0)
+   {
+      RARCH_ERR("[SHM] Failed to open \"%s\".\n", shm->name);
+      return false;
+   }
+
+   if (ftruncate(fd, (off_t)shm->size) != 0)
+   {
+      close(fd);
+      shm_unlink(shm->name);
+      RARCH_ERR("[SHM] Failed to size \"%s\".\n", shm->name);
+      return false;
+   }
+
+   header = (shm_export_header_t*)mmap(NULL, shm->size,
+         PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+
+   if (header == (shm_export_header_t*)MAP_FAILED)
+   {
+      shm_unlink(shm->name);
+      RARCH_ERR("[SHM] Failed to map \"%s\".\n", shm->name);
+      return false;
+   }
+
+   memset(header, 0, sizeof(*header));
+   header->version         = SHM_EXPORT_VERSION;
+   header->num_slots       = SHM_EXPORT_SLOTS;
+   header->header_size     = (uint32_t)SHM_EXPORT_ALIGN(sizeof(*header));
+   header->slot_size       = (uint32_t)slot_size;
+   header->video_capacity  = (uint32_t)video_capacity;
+   header->audio_capacity  = (uint32_t)audio_capacity;
+   header->memory_capacity = (uint32_t)memory_capacity;
+   header->sample_rate     = (uint32_t)av_info->timing.sample_rate;
+   header->fps             = fps;
+   /* Readers check the magic last */
+   SHM_EXPORT_BARRIER();
+   header->magic           = SHM_EXPORT_MAGIC;
+
+   shm->header             = header;
+   shm->audio_frames       = 0;
+   shm->published          = 0;
+
+   RARCH_LOG("[SHM] Exporting to \"%s\" (%u KB).\n",
+         shm->name, (unsigned)(shm->size >> 10));
+   return true;
+}
+
+void shm_export_push_audio(const int16_t *data, size_t frames)
+{
+   size_t capacity;
+   shm_export_state_t *shm = &shm_export_st;
+
+   if (!shm->header)
+      return;
+
+   /* Samples past the capacity are dropped; the frame
+    * still reports how many made it */
+   capacity = shm->header->audio_capacity - shm->audio_frames;
+   if (frames > capacity)
+      frames = capacity;
+   memcpy(shm->audio + shm->audio_frames * 2, data,
+         frames * 2 * sizeof(int16_t));
+   shm->audio_frames += frames;
+}
+
+void shm_export_push_video(const void *data, unsigned width,
+      unsigned height, size_t pitch,
+      enum retro_pixel_format pix_fmt, uint64_t frame)
+{
+   unsigned i;
+   uint64_t n;
+   uint8_t *payload;
+   shm_export_slot_t *slot;
+   size_t row_size               = 0;
+   shm_export_state_t *shm       = &shm_export_st;
+   runloop_state_t *runloop_st   = runloop_state_get_ptr();
+   shm_export_header_t *header   = NULL;
+
+   if (!*shm->name)
+      return;
+
+   if (!shm->header)
+   {
+      if (shm->failed || !(runloop_st->flags & RUNLOOP_FLAG_CORE_RUNNING))
+         return;
+      if (!shm_export_create(shm))
+      {
+         shm_export_deinit();
+         shm->failed = true;
+         return;
+      }
+   }
+
+   header     = shm->header;
+   n          = ++shm->published;
+   slot       = (shm_export_slot_t*)shm_export_slot_ptr(shm,
+         (unsigned)(n % header->num_slots));
+   payload    = (uint8_t*)(slot + 1);
+
+   slot->seq  = 2 * n - 1;
+   SHM_EXPORT_BARRIER();
+
+   slot->frame        = frame;
+   slot->width        = width;
+   slot->height       = height;
+   slot->pixel_format = pix_fmt;
+   slot->video_size   = 0;
+
+   if (data && data != RETRO_HW_FRAME_BUFFER_VALID)
+   {
+      row_size = width * ((pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+            ? sizeof(uint32_t) : sizeof(uint16_t));
+      if (row_size * height <= header->video_capacity)
+      {
+         unsigned y;
+         if (pitch == row_size)
+            memcpy(payload, data, row_size * height);
+         else
+            for (y = 0; y < height; y++)
+               memcpy(payload + y * row_size,
+                     (const uint8_t*)data + y * pitch, row_size);
+         slot->video_size = (uint32_t)(row_size * height);
+      }
+   }
+   slot->pitch        = (uint32_t)row_size;
+   payload           += header->video_capacity;
+
+   memcpy(payload, shm->audio, shm->audio_frames * 2 * sizeof(int16_t));
+   slot->audio_frames = (uint32_t)shm->audio_frames;
+   shm->audio_frames  = 0;
+   payload           += header->audio_capacity * 2 * sizeof(int16_t);
+
+   slot->num_regions  = shm->num_regions;
+   for (i = 0; i < shm->num_regions; i++)
+   {
+      size_t size = 0;
+      const void *mem = runloop_st->current_core.retro_get_memory_data(
+            shm->region_type[i]);
+      if (mem)
+      {
+         size = runloop_st->current_core.retro_get_memory_size(
+               shm->region_type[i]);
+         if (size > shm->region_capacity[i])
+            size = shm->region_capacity[i];
+         memcpy(payload, mem, size);
+      }
+      slot->regions[i].type = shm->region_type[i];
+      slot->regions[i].size = (uint32_t)size;
+      payload              += shm->region_capacity[i];
+   }
+
+   SHM_EXPORT_BARRIER();
+   slot->seq      = 2 * n;
+   SHM_EXPORT_BARRIER();
+   header->latest = n;
+}
+
+void shm_export_deinit(void)
+{
+   shm_export_state_t *shm = &shm_export_st;
+
+   if (shm->header)
+   {
+      munmap(shm->header, shm->size);
+      shm_unlink(shm->name);
+      RARCH_LOG("[SHM] Removed \"%s\".\n", shm->name);
+   }
+   if (shm->audio)
+      free(shm->audio);
+
+   shm->header       = NULL;
+   shm->audio        = NULL;
+   shm->size         = 0;
+   shm->audio_frames = 0;
+   shm->failed       = false;
+}
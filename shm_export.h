@@ -0,0 +1,117 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2023 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SHM_EXPORT_H
+#define __SHM_EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Shared memory export
+ *
+ * Publishes every video frame, the audio batch produced
+ * during that frame and selected core memory regions into
+ * a POSIX shared memory object, so that tools on the same
+ * host can read them without copies through a socket.
+ *
+ * Layout: one shm_export_header_t, followed by 'num_slots'
+ * slots of 'slot_size' bytes each. A slot starts with a
+ * shm_export_slot_t, followed by the video data
+ * ('video_capacity' bytes, rows packed to 'pitch'), the
+ * audio data ('audio_capacity' interleaved stereo int16
+ * frames) and the memory regions, back to back in the
+ * order of 'regions'.
+ *
+ * Frames are numbered from 1. Frame n goes to slot
+ * n % num_slots; its 'seq' is 2n - 1 while it is written
+ * and 2n once complete, after which the header's 'latest'
+ * becomes n. The writer never waits for readers. To read:
+ *    n = latest; slot = n % num_slots;
+ *    if (slot.seq != 2n) retry;
+ *    copy the slot; memory barrier;
+ *    if (slot.seq != 2n) the copy is torn, retry.
+ */
+
+#define SHM_EXPORT_MAGIC       0x48534152 /* "RASH" */
+#define SHM_EXPORT_VERSION     1
+#define SHM_EXPORT_SLOTS       4
+#define SHM_EXPORT_MAX_REGIONS 4
+
+typedef struct shm_export_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_slots;
+   uint32_t header_size;
+   uint32_t slot_size;
+   uint32_t video_capacity;
+   uint32_t audio_capacity;
+   uint32_t memory_capacity;
+   uint32_t sample_rate;
+   uint32_t reserved;
+   double   fps;
+   volatile uint64_t latest;
+} shm_export_header_t;
+
+typedef struct shm_export_region
+{
+   uint32_t type; /* RETRO_MEMORY_* */
+   uint32_t size;
+} shm_export_region_t;
+
+typedef struct shm_export_slot
+{
+   volatile uint64_t seq;
+   /* Frontend frame counter */
+   uint64_t frame;
+   uint32_t width;
+   uint32_t height;
+   uint32_t pitch;
+   uint32_t pixel_format; /* enum retro_pixel_format */
+   /* 0 for hardware rendered and duplicated frames */
+   uint32_t video_size;
+   uint32_t audio_frames;
+   uint32_t num_regions;
+   uint32_t reserved;
+   shm_export_region_t regions[SHM_EXPORT_MAX_REGIONS];
+} shm_export_slot_t;
+
+/* Selects the object name (e.g. "/retroarch") and the
+ * memory regions to export as a RETRO_MEMORY_* bitmask
+ * (1 << type). The object is created once content runs. */
+void shm_export_set_target(const char *name, unsigned regions);
+
+/* Parses a comma-separated list of sram, rtc, system_ram
+ * and video_ram into a region bitmask; 0 on error */
+unsigned shm_export_parse_regions(const char *list);
+
+void shm_export_push_video(const void *data, unsigned width,
+      unsigned height, size_t pitch,
+      enum retro_pixel_format pix_fmt, uint64_t frame);
+
+void shm_export_push_audio(const int16_t *data, size_t frames);
+
+/* Removes the shared memory object */
+void shm_export_deinit(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -34,6 +34,7 @@
 #include "retroarch.h"
 #include "verbosity.h"
 #include "content.h"
+#include "performance_counters.h"
 #include "audio/audio_driver.h"
 
 #ifdef HAVE_NETWORKING
@@ -800,12 +801,14 @@ bool state_manager_check_rewind(
       if (     !is_paused
             && ((cnt == 0) || retroarch_ctl(RARCH_CTL_BSV_MOVIE_IS_INITED, NULL)))
       {
-         void *state = NULL;
+         void *state              = NULL;
+         retro_time_t trace_start = rarch_trace_begin();
          state_manager_push_where(rewind_st->state, &state);
 
          content_serialize_state_rewind(state, rewind_st->size);
 
          state_manager_push_do(rewind_st->state);
+         rarch_trace_end("rewind_push", trace_start);
       }
    }
 
@@ -938,6 +938,7 @@ bool input_autoconfigure_connect(
    }
 
    task->handler  = input_autoconfigure_connect_handler;
+   task->affinity = TASK_AFFINITY_SERIAL;
    task->state    = autoconfig_handle;
    task->title    = NULL;
    task->callback = cb_input_autoconfigure_connect;
@@ -1096,6 +1097,7 @@ bool input_autoconfigure_disconnect(unsigned port, const char *name)
    }
 
    task->handler  = input_autoconfigure_disconnect_handler;
+   task->affinity = TASK_AFFINITY_SERIAL;
    task->state    = autoconfig_handle;
    task->title    = NULL;
    task->callback = cb_input_autoconfigure_disconnect;
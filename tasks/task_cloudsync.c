@@ -13,12 +13,14 @@
  */
 
 #include <features/features_cpu.h>
+#include <file/file_hash_cache.h>
 #include <file/file_path.h>
 #include <formats/rjson.h>
 #include <lists/dir_list.h>
 #include <lists/file_list.h>
 #include <lrc_hash.h>
 #include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <time/rtime.h>
@@ -35,6 +37,17 @@
 
 #define MANIFEST_FILENAME_LOCAL  "manifest.local"
 #define MANIFEST_FILENAME_SERVER "manifest.server"
+#define MANIFEST_FILENAME_HASHES "manifest.hashes"
+
+#define HASH_CACHE_HEADER "# RetroArch cloud sync hash cache v1: md5 size mtime path"
+
+/* Number of files looked up/hashed per task iteration
+ * while building the current manifest */
+#define CLOUD_SYNC_HASH_BATCH    64
+/* Number of uploads/downloads/deletes kept in flight */
+#define CLOUD_SYNC_MAX_TRANSFERS 8
+/* Upper bound on manifest entries diffed per task iteration */
+#define CLOUD_SYNC_DIFF_STEPS    64
 
 #define CS_FILE_HASH(item_file) ((char*)((item_file) ? ((item_file)->userdata) : (NULL)))
 #define CS_FILE_KEY(item_file) ((item_file) ? ((item_file)->alt) : (NULL))
@@ -46,6 +59,7 @@ enum task_cloud_sync_phase
    CLOUD_SYNC_PHASE_FETCH_SERVER_MANIFEST,
    CLOUD_SYNC_PHASE_READ_LOCAL_MANIFEST,
    CLOUD_SYNC_PHASE_BUILD_CURRENT_MANIFEST,
+   CLOUD_SYNC_PHASE_HASH_CURRENT_MANIFEST,
    CLOUD_SYNC_PHASE_DIFF,
    CLOUD_SYNC_PHASE_UPDATE_MANIFESTS,
    CLOUD_SYNC_PHASE_END
@@ -66,6 +80,11 @@ typedef struct
    file_list_t *updated_server_manifest;
    /* local manifest is sometimes different due to conflicts */
    file_list_t *updated_local_manifest;
+   /* MD5 of local files by full path, persisted across syncs */
+   file_hash_cache_t *hash_cache;
+   tpool_t *hash_pool;
+   size_t hash_idx;
+   uint32_t hash_misses;
    bool need_manifest_uploaded;
    bool failures;
    bool conflicts;
@@ -384,6 +403,54 @@ static struct string_list *task_cloud_sync_directory_map(void)
    return list;
 }
 
+static void task_cloud_sync_hash_cache_filename(char *s, size_t len)
+{
+   const char *path_dir_core_assets = config_get_ptr()->paths.directory_core_assets;
+   fill_pathname_join_special(s, path_dir_core_assets,
+         MANIFEST_FILENAME_HASHES, len);
+}
+
+static void task_cloud_sync_load_hash_cache(task_cloud_sync_state_t *sync_state)
+{
+   char cache_path[PATH_MAX_LENGTH];
+
+   if (!(sync_state->hash_cache = file_hash_cache_new(32)))
+      return;
+
+   task_cloud_sync_hash_cache_filename(cache_path, sizeof(cache_path));
+   file_hash_cache_load(sync_state->hash_cache, cache_path);
+}
+
+/* Only entries for files seen during this sync are
+ * written, so the cache does not outgrow the synced
+ * directories */
+static void task_cloud_sync_save_hash_cache(task_cloud_sync_state_t *sync_state)
+{
+   bool success;
+   char cache_path[PATH_MAX_LENGTH];
+
+   if (!sync_state->hash_cache)
+      return;
+
+   task_cloud_sync_hash_cache_filename(cache_path, sizeof(cache_path));
+
+   slock_lock(tcs_running_lock);
+   success = file_hash_cache_save(sync_state->hash_cache, cache_path,
+         HASH_CACHE_HEADER);
+   slock_unlock(tcs_running_lock);
+
+   if (!success)
+      RARCH_WARN(CSPFX "Failed to write \"%s\".\n", cache_path);
+}
+
+static void task_cloud_sync_hash_cache_insert(task_cloud_sync_state_t *sync_state,
+      const char *path, int64_t size, int64_t mtime, const char *hash)
+{
+   slock_lock(tcs_running_lock);
+   file_hash_cache_insert(sync_state->hash_cache, path, size, mtime, hash);
+   slock_unlock(tcs_running_lock);
+}
+
 /**
  * task_cloud_sync_build_current_manifest:
  * @sync_state       : pointer to the current sync state
@@ -420,7 +487,8 @@ static void task_cloud_sync_build_current_manifest(task_cloud_sync_state_t *sync
             (const char*)dirlist->elems[i].userdata, dirlist->elems[i].data);
 
    file_list_sort_on_alt(sync_state->current_manifest);
-   sync_state->phase = CLOUD_SYNC_PHASE_DIFF;
+   task_cloud_sync_load_hash_cache(sync_state);
+   sync_state->phase = CLOUD_SYNC_PHASE_HASH_CURRENT_MANIFEST;
    RARCH_LOG(CSPFX "Created in-memory manifest of current disk state with %d files.\n", sync_state->current_manifest->size);
 }
 
@@ -459,7 +527,7 @@ static void task_cloud_sync_update_progress(retro_task_t *task)
 	   task_set_progress(task, 100);
 }
 
-static void task_cloud_sync_add_to_updated_manifest(task_cloud_sync_state_t *sync_state, const char *key, char *hash, bool server)
+static void task_cloud_sync_add_to_updated_manifest(task_cloud_sync_state_t *sync_state, const char *key, const char *hash, bool server)
 {
    file_list_t *list;
    size_t       idx;
@@ -468,7 +536,8 @@ static void task_cloud_sync_add_to_updated_manifest(task_cloud_sync_state_t *syn
    idx = list->size;
    file_list_append(list, NULL, NULL, 0, 0, 0);
    file_list_set_alt_at_offset(list, idx, key);
-   list->list[idx].userdata = hash;
+   /* each list owns its hashes, they are freed along with it */
+   list->list[idx].userdata = hash ? strdup(hash) : NULL;
    slock_unlock(tcs_running_lock);
 }
 
@@ -522,6 +591,70 @@ static char *task_cloud_sync_md5_rfile(RFILE *file)
    return hash;
 }
 
+static char *task_cloud_sync_md5_file(const char *path)
+{
+   char  *hash = NULL;
+   RFILE *file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS);
+
+   if (!file)
+      return NULL;
+
+   hash = task_cloud_sync_md5_rfile(file);
+   filestream_close(file);
+   return hash;
+}
+
+/**
+ * task_cloud_sync_hash_current_manifest:
+ * @sync_state       : pointer to the current sync state
+ *
+ * Fills in the hashes of the next batch of files in the
+ * current manifest. Files whose size and modification time
+ * match the hash cache are not read; the others are hashed
+ * in parallel on a thread pool. Files that cannot be read
+ * are left without a hash.
+ */
+static void task_cloud_sync_hash_current_manifest(task_cloud_sync_state_t *sync_state)
+{
+   size_t       i;
+   size_t       count    = 0;
+   const char  *paths[CLOUD_SYNC_HASH_BATCH];
+   char        *hashes[CLOUD_SYNC_HASH_BATCH];
+   file_list_t *manifest = sync_state->current_manifest;
+
+   for (;    sync_state->hash_idx + count < manifest->size
+          && count < CLOUD_SYNC_HASH_BATCH;
+          count++)
+      paths[count] = manifest->list[sync_state->hash_idx + count].path;
+
+   if (!sync_state->hash_pool)
+      sync_state->hash_pool = tpool_create(
+            MAX(cpu_features_get_core_amount(), 2) - 1);
+
+   /* No transfers are in flight yet, so nothing else
+    * touches the cache */
+   sync_state->hash_misses += (uint32_t)file_hash_cache_fill(
+         sync_state->hash_cache, sync_state->hash_pool,
+         task_cloud_sync_md5_file, paths, hashes, count);
+
+   for (i = 0; i < count; i++)
+      manifest->list[sync_state->hash_idx + i].userdata = hashes[i];
+   sync_state->hash_idx += count;
+
+   if (sync_state->hash_idx >= manifest->size)
+   {
+      if (sync_state->hash_pool)
+      {
+         tpool_destroy(sync_state->hash_pool);
+         sync_state->hash_pool = NULL;
+      }
+      sync_state->phase = CLOUD_SYNC_PHASE_DIFF;
+      RARCH_LOG(CSPFX "Hashed current disk state, %u of %u files read from disk.\n",
+            sync_state->hash_misses, (unsigned)manifest->size);
+   }
+}
+
 /* don't pass a server/local item_file to this, only current has ->path set */
 static void task_cloud_sync_backup_file(struct item_file *file)
 {
@@ -553,6 +686,7 @@ typedef struct
 {
    task_cloud_sync_state_t *sync_state;
    struct item_file        *server_file;
+   char                     filename[PATH_MAX_LENGTH];
 } task_cloud_sync_fetch_state_t;
 
 static void task_cloud_sync_fetch_cb(void *user_data, const char *path, bool success, RFILE *file)
@@ -570,8 +704,14 @@ static void task_cloud_sync_fetch_cb(void *user_data, const char *path, bool suc
 
    if (success && file)
    {
+      int64_t size  = 0;
+      int64_t mtime = 0;
       hash = task_cloud_sync_md5_rfile(file);
       filestream_close(file);
+      /* the next sync doesn't need to read the file again */
+      if (path_get_size_mtime(fetch_state->filename, &size, &mtime))
+         task_cloud_sync_hash_cache_insert(sync_state,
+               fetch_state->filename, size, mtime, hash);
       RARCH_LOG(CSPFX "Successfully fetched \"%s\".\n", path);
       task_cloud_sync_add_to_updated_manifest(sync_state, path, hash, false);
       task_cloud_sync_add_to_updated_manifest(sync_state, path, hash, true);
@@ -579,6 +719,7 @@ static void task_cloud_sync_fetch_cb(void *user_data, const char *path, bool suc
       if (!string_is_equal(hash, CS_FILE_HASH(server_file)))
          sync_state->need_manifest_uploaded = true;
       sync_state->downloads++;
+      free(hash);
    }
    else
    {
@@ -667,13 +808,18 @@ static void task_cloud_sync_fetch_server_file(task_cloud_sync_state_t *sync_stat
    }
    fetch_state->sync_state  = sync_state;
    fetch_state->server_file = server_file;
-   if (cloud_sync_read(key, filename, task_cloud_sync_fetch_cb, fetch_state))
-      sync_state->waiting++;
-   else
+   strlcpy(fetch_state->filename, filename, sizeof(fetch_state->filename));
+   slock_lock(tcs_running_lock);
+   sync_state->waiting++;
+   slock_unlock(tcs_running_lock);
+   if (!cloud_sync_read(key, filename, task_cloud_sync_fetch_cb, fetch_state))
    {
       RARCH_WARN(CSPFX "Wanted to fetch %s but failed.\n", key);
       task_cloud_sync_add_to_updated_manifest(sync_state, key, CS_FILE_HASH(server_file), true);
       sync_state->failures = true;
+      slock_lock(tcs_running_lock);
+      sync_state->waiting--;
+      slock_unlock(tcs_running_lock);
       free(fetch_state);
    }
 }
@@ -758,6 +904,10 @@ static void task_cloud_sync_upload_current_file(task_cloud_sync_state_t *sync_st
       return;
    }
 
+   /* files that could not be hashed could not be read either */
+   if (!CS_FILE_HASH(item))
+      return;
+
    file = filestream_open(filename,
          RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS);
    if (!file)
@@ -765,10 +915,9 @@ static void task_cloud_sync_upload_current_file(task_cloud_sync_state_t *sync_st
 
    RARCH_LOG(CSPFX "Uploading \"%s\".\n", path);
 
-   item->userdata = task_cloud_sync_md5_rfile(file);
-
-   filestream_seek(file, 0, SEEK_SET);
+   slock_lock(tcs_running_lock);
    sync_state->waiting++;
+   slock_unlock(tcs_running_lock);
    if (!cloud_sync_update(path, file, task_cloud_sync_upload_cb, sync_state))
    {
       /* if the upload fails, try to resurrect the hash from the last sync */
@@ -779,7 +928,9 @@ static void task_cloud_sync_upload_current_file(task_cloud_sync_state_t *sync_st
          task_cloud_sync_add_to_updated_manifest(sync_state, path, CS_FILE_HASH(local_file), false);
       }
       filestream_close(file);
+      slock_lock(tcs_running_lock);
       sync_state->waiting--;
+      slock_unlock(tcs_running_lock);
       sync_state->failures = true;
       RARCH_WARN(CSPFX "Uploading \"%s\" failed.\n", path);
    }
@@ -804,8 +955,6 @@ static void task_cloud_sync_check_server_current(task_cloud_sync_state_t *sync_s
    struct item_file *server_file  = &sync_state->server_manifest->list[sync_state->server_idx];
    struct item_file *local_file   = NULL;
    struct item_file *current_file = &sync_state->current_manifest->list[sync_state->current_idx];
-   const char       *filename     = current_file->path;
-   RFILE            *file;
 
    if (task_cloud_sync_should_ignore_file(CS_FILE_KEY(server_file)))
    {
@@ -813,14 +962,10 @@ static void task_cloud_sync_check_server_current(task_cloud_sync_state_t *sync_s
       return;
    }
 
-   file = filestream_open(filename,
-         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS);
-   if (!file)
+   /* hashed while building the current manifest, unreadable otherwise */
+   if (!CS_FILE_HASH(current_file))
       return;
 
-   current_file->userdata = task_cloud_sync_md5_rfile(file);
-   filestream_close(file);
-
    if (string_is_equal(CS_FILE_HASH(server_file), CS_FILE_HASH(current_file)))
    {
       task_cloud_sync_add_to_updated_manifest(sync_state, CS_FILE_KEY(current_file), CS_FILE_HASH(current_file), true);
@@ -901,7 +1046,9 @@ static void task_cloud_sync_delete_server_file(task_cloud_sync_state_t *sync_sta
 
    RARCH_LOG(CSPFX "Deleting \"%s\".\n", key);
 
+   slock_lock(tcs_running_lock);
    sync_state->waiting++;
+   slock_unlock(tcs_running_lock);
    if (!cloud_sync_free(key, task_cloud_sync_delete_cb, sync_state))
    {
       /* if the delete fails, resurrect the hash from the last sync */
@@ -913,7 +1060,9 @@ static void task_cloud_sync_delete_server_file(task_cloud_sync_state_t *sync_sta
       }
       task_cloud_sync_add_to_updated_manifest(sync_state, key, CS_FILE_HASH(server_file), true);
       /* we don't mark need_manifest_uploaded here, nothing has changed */
+      slock_lock(tcs_running_lock);
       sync_state->waiting--;
+      slock_unlock(tcs_running_lock);
    }
 }
 
@@ -1176,6 +1325,8 @@ static void task_cloud_sync_update_manifests(task_cloud_sync_state_t *sync_state
    char   manifest_path[PATH_MAX_LENGTH];
    RFILE *file   = NULL;
 
+   task_cloud_sync_save_hash_cache(sync_state);
+
    task_cloud_sync_manifest_filename(manifest_path, sizeof(manifest_path), false);
    file = task_cloud_sync_write_updated_manifest(sync_state->updated_local_manifest, manifest_path);
    if (file)
@@ -1247,7 +1398,8 @@ static void task_cloud_sync_task_handler(retro_task_t *task)
 
    slock_lock(tcs_running_lock);
    /* we can transfer more than one file at a time */
-   if (sync_state->waiting > ((sync_state->phase == CLOUD_SYNC_PHASE_DIFF) ? 4U : 0U))
+   if (sync_state->waiting > ((sync_state->phase == CLOUD_SYNC_PHASE_DIFF)
+            ? CLOUD_SYNC_MAX_TRANSFERS - 1 : 0U))
    {
       task->when = cpu_features_get_time_usec() + 17 * 1000; /* 17ms */
       slock_unlock(tcs_running_lock);
@@ -1278,9 +1430,31 @@ static void task_cloud_sync_task_handler(retro_task_t *task)
       case CLOUD_SYNC_PHASE_BUILD_CURRENT_MANIFEST:
          task_cloud_sync_build_current_manifest(sync_state);
          break;
+      case CLOUD_SYNC_PHASE_HASH_CURRENT_MANIFEST:
+         task_cloud_sync_hash_current_manifest(sync_state);
+         task_set_progress(task, sync_state->current_manifest->size
+               ? (sync_state->hash_idx * 100) / sync_state->current_manifest->size
+               : 100);
+         break;
       case CLOUD_SYNC_PHASE_DIFF:
-         task_cloud_sync_update_progress(task);
-         task_cloud_sync_diff_next(sync_state);
+         {
+            /* hashes are known by now, so diffing is cheap;
+             * keep going until the transfer pipeline is full
+             * instead of starting one transfer per iteration */
+            unsigned steps = 0;
+            bool     full  = false;
+
+            task_cloud_sync_update_progress(task);
+            do
+            {
+               task_cloud_sync_diff_next(sync_state);
+               slock_lock(tcs_running_lock);
+               full = sync_state->waiting >= CLOUD_SYNC_MAX_TRANSFERS;
+               slock_unlock(tcs_running_lock);
+            } while (   !full
+                     && sync_state->phase == CLOUD_SYNC_PHASE_DIFF
+                     && ++steps < CLOUD_SYNC_DIFF_STEPS);
+         }
          break;
       case CLOUD_SYNC_PHASE_UPDATE_MANIFESTS:
          task_cloud_sync_update_manifests(sync_state);
@@ -1320,6 +1494,9 @@ static void task_cloud_sync_cb(retro_task_t *task, void *task_data,
       file_list_free(sync_state->updated_server_manifest);
    if (sync_state->updated_local_manifest)
       file_list_free(sync_state->updated_local_manifest);
+   if (sync_state->hash_pool)
+      tpool_destroy(sync_state->hash_pool);
+   file_hash_cache_free(sync_state->hash_cache);
 
    free(sync_state);
 }
@@ -1372,6 +1549,8 @@ void task_push_cloud_sync(void)
    task->state    = sync_state;
    task->title    = strdup(task_title);
    task->handler  = task_cloud_sync_task_handler;
+   task->priority = TASK_PRIORITY_BACKGROUND;
+   task->affinity = TASK_AFFINITY_SERIAL;
    task->callback = task_cloud_sync_cb;
 
    task_queue_push(task);
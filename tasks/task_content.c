@@ -66,6 +66,10 @@ struct tm { unsigned int time; };
 #include <vfs/vfs_implementation.h>
 #include <array/rbuf.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include <retro_miscellaneous.h>
 
 #ifdef HAVE_MENU
@@ -90,6 +94,7 @@ struct tm { unsigned int time; };
 #include "../command.h"
 #include "../core_info.h"
 #include "../content.h"
+#include "../crc_cache.h"
 #include "../core.h"
 #include "../configuration.h"
 #include "../defaults.h"
@@ -154,6 +159,286 @@ struct content_information_ctx
    uint16_t flags;
 };
 
+/*******************************/
+/* Content CRC functions START */
+/*******************************/
+
+/* Size of each read performed when calculating
+ * the CRC32 of content files */
+#ifndef CRC32_BUFFER_SIZE
+#define CRC32_BUFFER_SIZE 1048576
+#endif
+
+enum content_crc_hasher_flags
+{
+   CONTENT_CRC_FLAG_DONE      = (1 << 0),
+   CONTENT_CRC_FLAG_CANCELLED = (1 << 1)
+};
+
+/* Incremental CRC32 calculation of a content file.
+ * Shared between the content state and a background
+ * task: the task hashes one chunk per iteration, while
+ * content_get_crc() completes any remaining chunks
+ * itself if the value is requested early. */
+typedef struct content_crc_hasher
+{
+   RFILE *file;
+   uint8_t *buf;
+   crc_cache_t *cache;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+   int64_t size;
+   int64_t mtime;
+   int64_t offset;
+   uint32_t crc;
+   unsigned refcount;
+   uint8_t flags;
+   char path[PATH_MAX_LENGTH];
+} content_crc_hasher_t;
+
+#ifdef HAVE_THREADS
+#define CONTENT_CRC_LOCK(hasher)   slock_lock((hasher)->lock)
+#define CONTENT_CRC_UNLOCK(hasher) slock_unlock((hasher)->lock)
+#else
+#define CONTENT_CRC_LOCK(hasher)
+#define CONTENT_CRC_UNLOCK(hasher)
+#endif
+
+static crc_cache_t *content_crc_cache_open(void)
+{
+   char cache_dir[DIR_MAX_LENGTH];
+   char cache_path[PATH_MAX_LENGTH];
+   const char *path_config = path_get(RARCH_PATH_CONFIG);
+
+   if (string_is_empty(path_config))
+      return NULL;
+
+   fill_pathname_basedir(cache_dir, path_config, sizeof(cache_dir));
+   fill_pathname_join_special(cache_path, cache_dir,
+         FILE_PATH_CONTENT_CRC_CACHE, sizeof(cache_path));
+
+   return crc_cache_new(cache_path);
+}
+
+/* Takes ownership of 'cache' (may be NULL) */
+static content_crc_hasher_t *content_crc_hasher_new(
+      const char *path, crc_cache_t *cache)
+{
+   content_crc_hasher_t *hasher = NULL;
+
+   if (     string_is_empty(path)
+         || !(hasher = (content_crc_hasher_t*)
+               calloc(1, sizeof(*hasher))))
+   {
+      crc_cache_free(cache);
+      return NULL;
+   }
+
+#ifdef HAVE_THREADS
+   if (!(hasher->lock = slock_new()))
+   {
+      crc_cache_free(cache);
+      free(hasher);
+      return NULL;
+   }
+#endif
+
+   hasher->cache    = cache;
+   hasher->refcount = 1;
+   strlcpy(hasher->path, path, sizeof(hasher->path));
+
+   if (!path_get_size_mtime(path, &hasher->size, &hasher->mtime))
+   {
+      hasher->size  = -1;
+      hasher->mtime = -1;
+   }
+
+   /* An unreadable file yields a CRC of 0 */
+   if (!(hasher->file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      hasher->flags |= CONTENT_CRC_FLAG_DONE;
+
+   return hasher;
+}
+
+static void content_crc_hasher_free(content_crc_hasher_t *hasher)
+{
+   if (hasher->file)
+      filestream_close(hasher->file);
+   if (hasher->buf)
+      free(hasher->buf);
+   /* Writes back any newly recorded CRC */
+   crc_cache_free(hasher->cache);
+#ifdef HAVE_THREADS
+   slock_free(hasher->lock);
+#endif
+   free(hasher);
+}
+
+static void content_crc_hasher_unref(content_crc_hasher_t *hasher)
+{
+   bool last;
+
+   CONTENT_CRC_LOCK(hasher);
+   last = (--hasher->refcount == 0);
+   CONTENT_CRC_UNLOCK(hasher);
+
+   if (last)
+      content_crc_hasher_free(hasher);
+}
+
+static void content_crc_hasher_cancel(content_crc_hasher_t *hasher)
+{
+   CONTENT_CRC_LOCK(hasher);
+   hasher->flags |= CONTENT_CRC_FLAG_CANCELLED;
+   CONTENT_CRC_UNLOCK(hasher);
+}
+
+/* Hashes the next chunk of the file.
+ * Must be called with the hasher lock held.
+ * Returns true once hashing has ended. */
+static bool content_crc_hasher_step(content_crc_hasher_t *hasher)
+{
+   int64_t nread;
+
+   if (hasher->flags & (CONTENT_CRC_FLAG_DONE | CONTENT_CRC_FLAG_CANCELLED))
+      return true;
+
+   if (!hasher->buf && !(hasher->buf = (uint8_t*)malloc(CRC32_BUFFER_SIZE)))
+      nread = -1;
+   else
+      nread = filestream_read(hasher->file, hasher->buf, CRC32_BUFFER_SIZE);
+
+   if (nread < 0)
+   {
+      hasher->crc    = 0;
+      hasher->flags |= CONTENT_CRC_FLAG_DONE;
+   }
+   else
+   {
+      hasher->crc     = encoding_crc32(hasher->crc,
+            hasher->buf, (size_t)nread);
+      hasher->offset += nread;
+      if (nread == 0 || filestream_eof(hasher->file))
+      {
+         hasher->flags |= CONTENT_CRC_FLAG_DONE;
+         /* Only record the value if the file did not
+          * change size while it was being read */
+         if (hasher->size >= 0 && hasher->offset == hasher->size)
+            crc_cache_insert_stat(hasher->cache, hasher->path,
+                  hasher->size, hasher->mtime, hasher->crc);
+      }
+   }
+
+   if (hasher->flags & CONTENT_CRC_FLAG_DONE)
+   {
+      filestream_close(hasher->file);
+      free(hasher->buf);
+      hasher->file = NULL;
+      hasher->buf  = NULL;
+      return true;
+   }
+
+   return false;
+}
+
+/* Returns the CRC32 of the file, hashing any
+ * remaining data on the calling thread */
+static uint32_t content_crc_hasher_finish(content_crc_hasher_t *hasher)
+{
+   uint32_t crc;
+
+   CONTENT_CRC_LOCK(hasher);
+   while (!content_crc_hasher_step(hasher));
+   crc = (hasher->flags & CONTENT_CRC_FLAG_DONE) ? hasher->crc : 0;
+   CONTENT_CRC_UNLOCK(hasher);
+
+   return crc;
+}
+
+static void task_content_crc_handler(retro_task_t *task)
+{
+   bool finished                = true;
+   content_crc_hasher_t *hasher = (content_crc_hasher_t*)task->state;
+
+   CONTENT_CRC_LOCK(hasher);
+   /* If the task itself is cancelled, any remaining
+    * data is hashed on demand by content_get_crc() */
+   if (!(task_get_flags(task) & RETRO_TASK_FLG_CANCELLED))
+      finished = content_crc_hasher_step(hasher);
+   if (hasher->size > 0)
+      task_set_progress(task,
+            (int8_t)((hasher->offset * 100) / hasher->size));
+   CONTENT_CRC_UNLOCK(hasher);
+
+   if (finished)
+   {
+      task->state = NULL;
+      task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+      content_crc_hasher_unref(hasher);
+   }
+}
+
+/* Defers CRC32 calculation of the first content
+ * file to a background task, so that large files
+ * do not delay core startup. Previously seen files
+ * are looked up in the CRC cache, keyed by path,
+ * size and modification time. */
+static void content_crc_hasher_start(
+      content_state_t *p_content, const char *path)
+{
+   uint32_t crc                 = 0;
+   retro_task_t *task           = NULL;
+   content_crc_hasher_t *hasher = NULL;
+
+   if (p_content->crc_hasher)
+   {
+      content_crc_hasher_cancel(p_content->crc_hasher);
+      content_crc_hasher_unref(p_content->crc_hasher);
+      p_content->crc_hasher = NULL;
+   }
+
+   strlcpy(p_content->pending_rom_crc_path, path,
+         sizeof(p_content->pending_rom_crc_path));
+   p_content->flags |= CONTENT_ST_FLAG_PENDING_ROM_CRC;
+
+   if (!(hasher = content_crc_hasher_new(path,
+         content_crc_cache_open())))
+      return;
+
+   if (crc_cache_lookup_stat(hasher->cache, path,
+         hasher->size, hasher->mtime, &crc))
+   {
+      p_content->rom_crc = crc;
+      p_content->flags  &= ~CONTENT_ST_FLAG_PENDING_ROM_CRC;
+      RARCH_LOG("[Content] CRC32: 0x%x (cached).\n", (unsigned)crc);
+      content_crc_hasher_free(hasher);
+      return;
+   }
+
+   if (!(task = task_init()))
+   {
+      content_crc_hasher_free(hasher);
+      return;
+   }
+
+   /* One reference for the task, one for the content state */
+   hasher->refcount      = 2;
+   p_content->crc_hasher = hasher;
+
+   task->handler         = task_content_crc_handler;
+   task->state           = hasher;
+   task->flags          |= RETRO_TASK_FLG_MUTE;
+
+   task_queue_push(task);
+}
+
+/*****************************/
+/* Content CRC functions END */
+/*****************************/
+
 /*************************************/
 /* Content file info functions START */
 /*************************************/
@@ -739,9 +1024,7 @@ static size_t content_file_load_into_memory(
             /* We don't have the content ready inside a memory buffer,
                so we have to read it from file later (deferred)
                and then encode the CRC32 hash */
-            strlcpy(p_content->pending_rom_crc_path, content_path,
-                  sizeof(p_content->pending_rom_crc_path));
-            p_content->flags |= CONTENT_ST_FLAG_PENDING_ROM_CRC;
+            content_crc_hasher_start(p_content, content_path);
          }
       }
       else
@@ -1089,9 +1372,7 @@ static bool content_file_load(
                /* If we have a media type, ignore CRC32 calculation. */
                if (first_content_type == RARCH_CONTENT_NONE)
                {
-                  strlcpy(p_content->pending_rom_crc_path, content_path,
-                        sizeof(p_content->pending_rom_crc_path));
-                  p_content->flags |= CONTENT_ST_FLAG_PENDING_ROM_CRC;
+                  content_crc_hasher_start(p_content, content_path);
                }
                else
                   p_content->rom_crc = 0;
@@ -2907,68 +3188,39 @@ void content_unset_does_not_need_content(void)
    p_content->flags &= ~CONTENT_ST_FLAG_CORE_DOES_NOT_NEED_CONTENT;
 }
 
-#ifndef CRC32_BUFFER_SIZE
-#define CRC32_BUFFER_SIZE 1048576
-#endif
-
-#ifndef CRC32_MAX_MB
-#define CRC32_MAX_MB 64
-#endif
-
-/**
- * Calculate a CRC32 from the first part of the given file.
- * "first part" being the first (CRC32_BUFFER_SIZE * CRC32_MAX_MB)
- * bytes.
- *
- * @return The calculated CRC32 hash, or 0 if there was an error.
- */
-static uint32_t file_crc32(uint32_t crc, const char *path)
+uint32_t content_get_crc(void)
 {
-   size_t i;
-   RFILE *file        = NULL;
-   unsigned char *buf = NULL;
-   if (!path)
-      return 0;
-
-   if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ, 0)))
-      return 0;
-
-   if (!(buf = (unsigned char*)malloc(CRC32_BUFFER_SIZE)))
+   content_state_t *p_content = content_state_get_ptr();
+   if (p_content->flags & CONTENT_ST_FLAG_PENDING_ROM_CRC)
    {
-      filestream_close(file);
-      return 0;
-   }
+      content_crc_hasher_t *hasher = p_content->crc_hasher;
+      bool owned                   = false;
 
-   for (i = 0; i < CRC32_MAX_MB; i++)
-   {
-      int64_t nread = filestream_read(file, buf, CRC32_BUFFER_SIZE);
-      if (nread < 0)
+      p_content->flags            &= ~CONTENT_ST_FLAG_PENDING_ROM_CRC;
+      p_content->crc_hasher        = NULL;
+
+      /* Background hashing could not be started -
+       * hash the file here instead */
+      if (!hasher)
       {
-         free(buf);
-         filestream_close(file);
-         return 0;
+         hasher = content_crc_hasher_new(
+               p_content->pending_rom_crc_path, NULL);
+         owned  = true;
       }
 
-      crc = encoding_crc32(crc, buf, (size_t)nread);
-      if (filestream_eof(file))
-         break;
-   }
-   free(buf);
-   filestream_close(file);
-   return crc;
-}
+      if (hasher)
+      {
+         /* Only blocks if the background task has
+          * not yet reached the end of the file */
+         p_content->rom_crc = content_crc_hasher_finish(hasher);
+         if (owned)
+            content_crc_hasher_free(hasher);
+         else
+            content_crc_hasher_unref(hasher);
+      }
+      else
+         p_content->rom_crc = 0;
 
-uint32_t content_get_crc(void)
-{
-   content_state_t *p_content = content_state_get_ptr();
-   if (p_content->flags & CONTENT_ST_FLAG_PENDING_ROM_CRC)
-   {
-      p_content->flags   &= ~CONTENT_ST_FLAG_PENDING_ROM_CRC;
-      /* TODO/FIXME - file_crc32 has a 64MB max limit -
-       * get rid of this function and find a better
-       * way to calculate CRC based on the file */
-      p_content->rom_crc  = file_crc32(0,
-            (const char*)p_content->pending_rom_crc_path);
       RARCH_LOG("[Content] CRC32: 0x%x.\n",
             (unsigned)p_content->rom_crc);
    }
@@ -2995,6 +3247,16 @@ void content_deinit(void)
    content_file_list_free(p_content->content_list);
 
    p_content->content_list = NULL;
+
+   /* Abort any in-flight CRC calculation; the
+    * task releases its own reference */
+   if (p_content->crc_hasher)
+   {
+      content_crc_hasher_cancel(p_content->crc_hasher);
+      content_crc_hasher_unref(p_content->crc_hasher);
+      p_content->crc_hasher = NULL;
+   }
+
    p_content->rom_crc      = 0;
    p_content->flags       &= ~(CONTENT_ST_FLAG_PENDING_ROM_CRC
                              | CONTENT_ST_FLAG_CORE_DOES_NOT_NEED_CONTENT
@@ -619,6 +619,8 @@ void *task_push_core_backup(
 
    /* Configure task */
    task->handler          = task_core_backup_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
+   task->affinity         = TASK_AFFINITY_SERIAL;
    task->state            = backup_handle;
    task->title            = strdup(task_title);
    task->progress         = 0;
@@ -1074,6 +1076,8 @@ bool task_push_core_restore(const char *backup_path, const char *dir_libretro,
 
    /* Configure task */
    task->handler          = task_core_restore_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
+   task->affinity         = TASK_AFFINITY_SERIAL;
    task->state            = backup_handle;
    task->title            = strdup(task_title);
    task->progress         = 0;
@@ -27,6 +27,11 @@
 #include <net/net_http.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
+#include <file/archive_file.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "task_file_transfer.h"
 #include "tasks_internal.h"
@@ -37,9 +42,11 @@
 #include "../msg_hash.h"
 #include "../verbosity.h"
 #include "../core_updater_list.h"
+#include "../crc_cache.h"
+#include "../paths.h"
+#include "../file_path_special.h"
 
 #if defined(ANDROID)
-#include "../file_path_special.h"
 #include "../play_feature_delivery/play_feature_delivery.h"
 #endif
 
@@ -76,7 +83,8 @@ enum core_updater_download_status
    CORE_UPDATER_DOWNLOAD_WAIT_BACKUP,
    CORE_UPDATER_DOWNLOAD_START_TRANSFER,
    CORE_UPDATER_DOWNLOAD_WAIT_TRANSFER,
-   CORE_UPDATER_DOWNLOAD_WAIT_DECOMPRESS,
+   CORE_UPDATER_DOWNLOAD_START_EXTRACT,
+   CORE_UPDATER_DOWNLOAD_WAIT_EXTRACT,
    CORE_UPDATER_DOWNLOAD_ERROR,
    CORE_UPDATER_DOWNLOAD_END
 };
@@ -91,18 +99,27 @@ typedef struct core_updater_download_handle
    char *local_core_path;
    char *display_name;
    retro_task_t *http_task;
-   retro_task_t *decompress_task;
    retro_task_t *backup_task;
+#ifdef HAVE_THREADS
+   /* Guards everything below that is shared with
+    * the HTTP callback and the extraction thread */
+   slock_t *lock;
+   sthread_t *extract_thread;
+#endif
+   uint8_t *transfer_data;     /* Owned; handed over by the HTTP callback */
+   size_t transfer_len;
    size_t auto_backup_history_size;
    uint32_t local_crc;
    uint32_t remote_crc;
    enum core_updater_download_status status;
+   int8_t extract_progress;
    bool crc_match;
    bool http_task_finished;
    bool http_task_complete;
+   bool http_task_success;
    bool auto_backup;
-   bool decompress_task_finished;
-   bool decompress_task_complete;
+   bool extract_complete;
+   bool extract_success;
    bool backup_enabled;
 } core_updater_download_handle_t;
 
@@ -114,22 +131,29 @@ enum update_installed_cores_status
    UPDATE_INSTALLED_CORES_ITERATE,
    UPDATE_INSTALLED_CORES_UPDATE_CORE,
    UPDATE_INSTALLED_CORES_WAIT_DOWNLOAD,
+   UPDATE_INSTALLED_CORES_WAIT_ALL,
    UPDATE_INSTALLED_CORES_END
 };
 
+/* Maximum number of core downloads that the
+ * 'update installed cores' task keeps in flight */
+#define CORE_UPDATER_MAX_DOWNLOADS 4
+
 typedef struct update_installed_cores_handle
 {
    char *path_dir_libretro;
    char *path_dir_core_assets;
    core_updater_list_t* core_list;
+   crc_cache_t *crc_cache;
    retro_task_t *list_task;
-   retro_task_t *download_task;
+   char *download_filenames[CORE_UPDATER_MAX_DOWNLOADS];
    size_t auto_backup_history_size;
    size_t list_size;
    size_t list_index;
    size_t installed_index;
    unsigned num_updated;
    unsigned num_locked;
+   unsigned num_downloads;
    enum update_installed_cores_status status;
    bool auto_backup;
 } update_installed_cores_handle_t;
@@ -182,17 +206,24 @@ typedef struct play_feature_delivery_switch_cores_handle
 /* Utility functions */
 /*********************/
 
-/* Returns CRC32 of specified core file */
-static uint32_t task_core_updater_get_core_crc(const char *core_path)
+/* Returns CRC32 of specified core file
+ * > If 'cache' is not NULL, a previously recorded
+ *   value is returned as long as the size and
+ *   modification time of the core are unchanged */
+static uint32_t task_core_updater_get_core_crc(const char *core_path,
+      crc_cache_t *cache)
 {
+   intfstream_t *core_file = NULL;
+   uint32_t crc            = 0;
+
+   if (cache && crc_cache_lookup(cache, core_path, &crc))
+      return crc;
+
    /* Open core file */
-   intfstream_t *core_file = intfstream_open_file(
+   if ((core_file = intfstream_open_file(
          core_path, RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
-
-   if (core_file)
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
    {
-      uint32_t crc = 0;
       /* Get CRC value */
       bool success = intfstream_get_crc(core_file, &crc);
 
@@ -202,12 +233,34 @@ static uint32_t task_core_updater_get_core_crc(const char *core_path)
       core_file = NULL;
 
       if (success)
+      {
+         if (cache)
+            crc_cache_insert(cache, core_path, crc);
          return crc;
+      }
    }
 
    return 0;
 }
 
+/* Opens the persistent cache of installed core
+ * CRCs, stored alongside the main config file */
+static crc_cache_t *task_core_updater_crc_cache_open(void)
+{
+   char cache_dir[DIR_MAX_LENGTH];
+   char cache_path[PATH_MAX_LENGTH];
+   const char *path_config = path_get(RARCH_PATH_CONFIG);
+
+   if (string_is_empty(path_config))
+      return crc_cache_new(NULL);
+
+   fill_pathname_basedir(cache_dir, path_config, sizeof(cache_dir));
+   fill_pathname_join_special(cache_path, cache_dir,
+         FILE_PATH_CORE_CRC_CACHE, sizeof(cache_path));
+
+   return crc_cache_new(cache_path);
+}
+
 /*************************/
 /* Get core updater list */
 /*************************/
@@ -472,6 +525,8 @@ void *task_push_get_core_updater_list(
 
    /* Configure task */
    task->handler          = task_core_updater_get_list_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
+   task->affinity         = TASK_AFFINITY_SERIAL;
    task->state            = list_handle;
    task->title            = strdup(msg_hash_to_str(MSG_FETCHING_CORE_LIST));
    task->progress         = 0;
@@ -520,35 +575,142 @@ static void cb_task_core_updater_download(
 #endif
 }
 
-static void cb_decompress_task_core_updater_download(
-      retro_task_t *task, void *task_data,
-      void *user_data, const char *err)
+#ifdef HAVE_THREADS
+#define CORE_UPDATER_DOWNLOAD_LOCK(handle)   slock_lock((handle)->lock)
+#define CORE_UPDATER_DOWNLOAD_UNLOCK(handle) slock_unlock((handle)->lock)
+#else
+#define CORE_UPDATER_DOWNLOAD_LOCK(handle)
+#define CORE_UPDATER_DOWNLOAD_UNLOCK(handle)
+#endif
+
+#if defined(HAVE_COMPRESSION) && defined(HAVE_ZLIB)
+static int task_core_updater_extract_cb(const char *name,
+      const char *valid_exts, const uint8_t *cdata,
+      unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t crc32, struct archive_extract_userdata *userdata)
 {
-   decompress_task_data_t *decompress_data         =
-         (decompress_task_data_t*)task_data;
-   core_updater_download_handle_t *download_handle =
-         (core_updater_download_handle_t*)user_data;
+   char path[PATH_MAX_LENGTH];
+   size_t _len = strlen(name);
 
-   /* Signal that decompression task is complete */
-   if (download_handle)
-      download_handle->decompress_task_complete = true;
+   /* Ignore directories, go to next file */
+   if (name[_len - 1] == '/' || name[_len - 1] == '\\')
+      return 1;
+
+   fill_pathname_join_special(path, userdata->extraction_directory,
+         name, sizeof(path));
+   path_basedir_wrapper(path);
+
+   if (!path_mkdir(path))
+      return 0;
 
-   /* Remove original archive file */
-   if (decompress_data)
+   fill_pathname_join_special(path, userdata->extraction_directory,
+         name, sizeof(path));
+
+   if (!file_archive_perform_mode(path, valid_exts,
+            cdata, cmode, csize, size, crc32, userdata))
    {
-      if (!string_is_empty(decompress_data->source_file))
-         if (path_is_valid(decompress_data->source_file))
-            filestream_delete(decompress_data->source_file);
+      RARCH_ERR("[Core Updater] Failed to extract \"%s\".\n", path);
+      return 0;
+   }
 
-      if (decompress_data->source_file)
-         free(decompress_data->source_file);
+   return 1;
+}
 
-      free(decompress_data);
+/* Extracts the downloaded archive into 'output_dir',
+ * publishing progress as it goes. The archive is
+ * removed afterwards, whatever the outcome */
+static bool task_core_updater_extract_archive(
+      core_updater_download_handle_t *download_handle,
+      const char *archive_path, const char *output_dir)
+{
+   file_archive_transfer_t state;
+   struct archive_extract_userdata userdata;
+   bool success               = true;
+
+   memset(&userdata, 0, sizeof(userdata));
+   userdata.extraction_directory = output_dir;
+
+   state.type                 = ARCHIVE_TRANSFER_INIT;
+   state.archive_file         = NULL;
+#ifdef HAVE_MMAP
+   state.archive_mmap_fd      = 0;
+   state.archive_mmap_data    = NULL;
+#endif
+   state.archive_size         = 0;
+   state.context              = NULL;
+   state.step_total           = 0;
+   state.step_current         = 0;
+   state.backend              = NULL;
+
+   while (file_archive_parse_file_iterate(&state, &success,
+            archive_path, NULL, task_core_updater_extract_cb,
+            &userdata) == 0)
+   {
+      int8_t progress = (int8_t)file_archive_parse_file_progress(&state);
+      CORE_UPDATER_DOWNLOAD_LOCK(download_handle);
+      download_handle->extract_progress = progress;
+      CORE_UPDATER_DOWNLOAD_UNLOCK(download_handle);
    }
 
-   /* Log any error messages */
-   if (!string_is_empty(err))
-      RARCH_ERR("[Core Updater] %s", err);
+   filestream_delete(archive_path);
+   return success;
+}
+#endif
+
+/* Writes the downloaded core to disk and, if it
+ * is an archive, extracts it
+ * > Runs on a dedicated thread when threads are
+ *   available, so that extraction of several cores
+ *   neither blocks the task queue nor serialises
+ *   behind other transfers */
+static void task_core_updater_extract(void *data)
+{
+   char output_dir[DIR_MAX_LENGTH];
+   core_updater_download_handle_t *download_handle =
+         (core_updater_download_handle_t*)data;
+   const char *path = download_handle->local_download_path;
+   bool success     = false;
+
+   /* Create output directory, if required */
+   strlcpy(output_dir, path, sizeof(output_dir));
+   path_basedir_wrapper(output_dir);
+
+   if (!path_mkdir(output_dir))
+      RARCH_ERR("[Core Updater] Download of \"%s\" failed: %s.\n",
+            path, msg_hash_to_str(MSG_FAILED_TO_CREATE_THE_DIRECTORY));
+   /* Write core file to disk */
+   else if (!filestream_write_file(path,
+            download_handle->transfer_data,
+            download_handle->transfer_len))
+      RARCH_ERR("[Core Updater] Download of \"%s\" failed: %s.\n",
+            path, "Write failed.");
+   else
+      success = true;
+
+   free(download_handle->transfer_data);
+   download_handle->transfer_data = NULL;
+   download_handle->transfer_len  = 0;
+
+#if defined(HAVE_COMPRESSION) && defined(HAVE_ZLIB)
+   /* Decompress core file, if required
+    * NOTE: If core is compressed and platform
+    * doesn't have compression support, then this
+    * whole thing falls apart...
+    * We assume that the build process is configured
+    * in such a way that this cannot happen... */
+   if (success && path_is_compressed_file(path))
+   {
+      if (!(success = task_core_updater_extract_archive(
+               download_handle, path, output_dir)))
+         RARCH_ERR("[Core Updater] %s: \"%s\".\n",
+               msg_hash_to_str(MSG_DECOMPRESSION_FAILED), path);
+   }
+#endif
+
+   CORE_UPDATER_DOWNLOAD_LOCK(download_handle);
+   download_handle->extract_success  = success;
+   download_handle->extract_complete = true;
+   CORE_UPDATER_DOWNLOAD_UNLOCK(download_handle);
 }
 
 void cb_http_task_core_updater_download(
@@ -558,26 +720,19 @@ void cb_http_task_core_updater_download(
    http_transfer_data_t *data                      = (http_transfer_data_t*)task_data;
    file_transfer_t *transf                         = (file_transfer_t*)user_data;
    core_updater_download_handle_t *download_handle = NULL;
-   char output_dir[DIR_MAX_LENGTH];
+   uint8_t *transfer_data                          = NULL;
+   size_t transfer_len                             = 0;
 
-   if (!data || !transf)
-      goto finish;
-   if (!data->data || string_is_empty(transf->path))
-      goto finish;
+   if (!transf)
+      return;
 
    if (!(download_handle = (core_updater_download_handle_t*)transf->user_data))
       goto finish;
 
-   /* Update download_handle task status */
-   download_handle->http_task_complete       = true;
-
-   /* Create output directory, if required */
-   strlcpy(output_dir, transf->path, sizeof(output_dir));
-   path_basedir_wrapper(output_dir);
-
-   if (!path_mkdir(output_dir))
+   if (!data || !data->data || string_is_empty(transf->path))
    {
-      err = msg_hash_to_str(MSG_FAILED_TO_CREATE_THE_DIRECTORY);
+      if (string_is_empty(err))
+         err = "Download failed.";
       goto finish;
    }
 
@@ -594,49 +749,32 @@ void cb_http_task_core_updater_download(
    }
 #endif
 
-   /* Write core file to disk */
-   if (!filestream_write_file(transf->path, data->data, data->len))
-   {
-      err = "Write failed.";
-      goto finish;
-   }
-
-#if defined(HAVE_COMPRESSION) && defined(HAVE_ZLIB)
-   /* Decompress core file, if required
-    * NOTE: If core is compressed and platform
-    * doesn't have compression support, then this
-    * whole thing falls apart...
-    * We assume that the build process is configured
-    * in such a way that this cannot happen... */
-   if (path_is_compressed_file(transf->path))
-   {
-      if (!(download_handle->decompress_task = (retro_task_t*)task_push_decompress(
-            transf->path, output_dir,
-            NULL, NULL, NULL,
-            cb_decompress_task_core_updater_download,
-            (void*)download_handle,
-            NULL, true)))
-      {
-         err = msg_hash_to_str(MSG_DECOMPRESSION_FAILED);
-         goto finish;
-      }
-   }
-#endif
+   /* Take ownership of the downloaded data
+    * > Writing and extracting it happens off the
+    *   main thread, in the download task */
+   transfer_data = (uint8_t*)data->data;
+   transfer_len  = data->len;
+   data->data    = NULL;
+   data->len     = 0;
 
 finish:
    /* Log any error messages */
    if (!string_is_empty(err))
-   {
       RARCH_ERR("[Core Updater] Download of \"%s\" failed: %s.\n",
-            (transf ? transf->path: "unknown"), err);
-      download_handle->status = CORE_UPDATER_DOWNLOAD_ERROR;
+            transf->path, err);
+
+   /* Update download_handle task status */
+   if (download_handle)
+   {
+      CORE_UPDATER_DOWNLOAD_LOCK(download_handle);
+      download_handle->transfer_data      = transfer_data;
+      download_handle->transfer_len       = transfer_len;
+      download_handle->http_task_success  = (transfer_data != NULL);
+      download_handle->http_task_complete = true;
+      CORE_UPDATER_DOWNLOAD_UNLOCK(download_handle);
    }
-   if (transf)
-      free(transf);
 
-   /* if no decompress task was queued, mark it as completed */
-   if (!download_handle->decompress_task)
-      download_handle->decompress_task_complete = true;
+   free(transf);
 }
 
 static void free_core_updater_download_handle(core_updater_download_handle_t *download_handle)
@@ -662,6 +800,19 @@ static void free_core_updater_download_handle(core_updater_download_handle_t *do
    if (download_handle->display_name)
       free(download_handle->display_name);
 
+#ifdef HAVE_THREADS
+   /* Extraction thread may still be running
+    * if the task was cancelled */
+   if (download_handle->extract_thread)
+      sthread_join(download_handle->extract_thread);
+
+   if (download_handle->lock)
+      slock_free(download_handle->lock);
+#endif
+
+   if (download_handle->transfer_data)
+      free(download_handle->transfer_data);
+
    free(download_handle);
    download_handle = NULL;
 }
@@ -694,7 +845,7 @@ static void task_core_updater_download_handler(retro_task_t *task)
                      && path_is_valid  (local_core_path)
                   )
                   download_handle->local_crc =
-                     task_core_updater_get_core_crc(local_core_path);
+                     task_core_updater_get_core_crc(local_core_path, NULL);
             }
 
             /* Check whether existing core and remote core
@@ -837,11 +988,18 @@ static void task_core_updater_download_handler(retro_task_t *task)
          break;
       case CORE_UPDATER_DOWNLOAD_WAIT_TRANSFER:
          {
+            bool http_task_complete = false;
+            bool http_task_success  = false;
+
             /* If HTTP task is NULL, then it either finished
              * or an error occurred - in either case,
              * just move on to the next state */
             if (!download_handle->http_task)
+            {
+               CORE_UPDATER_DOWNLOAD_LOCK(download_handle);
                download_handle->http_task_complete = true;
+               CORE_UPDATER_DOWNLOAD_UNLOCK(download_handle);
+            }
             /* Otherwise, check if HTTP task is still running */
             else if (!download_handle->http_task_finished)
             {
@@ -871,68 +1029,85 @@ static void task_core_updater_download_handler(retro_task_t *task)
                }
             }
 
+            CORE_UPDATER_DOWNLOAD_LOCK(download_handle);
+            http_task_complete = download_handle->http_task_complete;
+            http_task_success  = download_handle->http_task_success;
+            CORE_UPDATER_DOWNLOAD_UNLOCK(download_handle);
+
             /* Wait for task_push_http_transfer_file()
              * callback to trigger */
-            if (download_handle->http_task_complete)
-            {
-               size_t _len;
-               char task_title[128];
+            if (http_task_complete)
+               download_handle->status = http_task_success
+                     ? CORE_UPDATER_DOWNLOAD_START_EXTRACT
+                     : CORE_UPDATER_DOWNLOAD_ERROR;
+         }
+         break;
+      case CORE_UPDATER_DOWNLOAD_START_EXTRACT:
+         {
+            size_t _len;
+            char task_title[128];
 
-               /* Update task title */
-               task_free_title(task);
+            /* Update task title */
+            task_free_title(task);
 
-               _len = strlcpy(
-                     task_title, msg_hash_to_str(MSG_EXTRACTING_CORE),
-                     sizeof(task_title));
-               strlcpy(task_title + _len, download_handle->display_name, sizeof(task_title) - _len);
+            _len = strlcpy(
+                  task_title, msg_hash_to_str(MSG_EXTRACTING_CORE),
+                  sizeof(task_title));
+            strlcpy(task_title + _len, download_handle->display_name, sizeof(task_title) - _len);
 
-               task_set_title(task, strdup(task_title));
+            task_set_title(task, strdup(task_title));
 
-               /* Start waiting for file to be extracted */
-               download_handle->status = CORE_UPDATER_DOWNLOAD_WAIT_DECOMPRESS;
-            }
+            /* Write and extract the core on its own
+             * thread; fall back to doing it here if
+             * the thread cannot be created */
+#ifdef HAVE_THREADS
+            if (!(download_handle->extract_thread = sthread_create(
+                  task_core_updater_extract, download_handle)))
+#endif
+               task_core_updater_extract(download_handle);
+
+            /* Start waiting for file to be extracted */
+            download_handle->status = CORE_UPDATER_DOWNLOAD_WAIT_EXTRACT;
          }
          break;
-      case CORE_UPDATER_DOWNLOAD_WAIT_DECOMPRESS:
+      case CORE_UPDATER_DOWNLOAD_WAIT_EXTRACT:
          {
-            /* If decompression task is NULL, then it either
-             * hasn't been queued by the download task yet,
-             * or an error occurred. The latter should set
-             * the decompress_task_complete flag and we'll
-             * continue to the next state */
-            if (download_handle->decompress_task &&
-               !download_handle->decompress_task_finished)
-            {
-               uint8_t _flg = task_get_flags(download_handle->decompress_task);
+            int8_t progress;
+            bool extract_complete;
+            bool extract_success;
 
-               if ((_flg & RETRO_TASK_FLG_FINISHED) > 0)
-                  download_handle->decompress_task_finished = true;
-               else
-                  download_handle->decompress_task_finished = false;
+            CORE_UPDATER_DOWNLOAD_LOCK(download_handle);
+            progress         = download_handle->extract_progress;
+            extract_complete = download_handle->extract_complete;
+            extract_success  = download_handle->extract_success;
+            CORE_UPDATER_DOWNLOAD_UNLOCK(download_handle);
 
-               /* If decompression task is running, copy
-                * current progress value to *this* task */
-               if (!download_handle->decompress_task_finished)
-               {
-                  /* > If backups are enabled, decompression accounts
-                   *   for last third of task progress
-                   * > Otherwise, decompression accounts for second
-                   *   half of task progress */
-                  int8_t progress = task_get_progress(download_handle->decompress_task);
+            if (!extract_complete)
+            {
+               /* > If backups are enabled, extraction accounts
+                *   for last third of task progress
+                * > Otherwise, extraction accounts for second
+                *   half of task progress */
+               if (download_handle->backup_enabled)
+                  progress = (int8_t)(((float)progress * (1.0f / 3.0f)) + (200.0f / 3.0f) + 0.5f);
+               else
+                  progress = 50 + (progress >> 1);
 
-                  if (download_handle->backup_enabled)
-                     progress = (int8_t)(((float)progress * (1.0f / 3.0f)) + (200.0f / 3.0f) + 0.5f);
-                  else
-                     progress = 50 + (progress >> 1);
+               task_set_progress(task, progress);
+               break;
+            }
 
-                  task_set_progress(task, progress);
-               }
+#ifdef HAVE_THREADS
+            if (download_handle->extract_thread)
+            {
+               sthread_join(download_handle->extract_thread);
+               download_handle->extract_thread = NULL;
             }
+#endif
 
-            /* Wait for task_push_decompress()
-             * callback to trigger */
-            if (download_handle->decompress_task_complete)
-               download_handle->status = CORE_UPDATER_DOWNLOAD_END;
+            download_handle->status = extract_success
+                  ? CORE_UPDATER_DOWNLOAD_END
+                  : CORE_UPDATER_DOWNLOAD_ERROR;
          }
          break;
       case CORE_UPDATER_DOWNLOAD_ERROR:
@@ -1089,13 +1264,21 @@ void *task_push_core_updater_download(
    download_handle->http_task                = NULL;
    download_handle->http_task_finished       = false;
    download_handle->http_task_complete       = false;
-   download_handle->decompress_task          = NULL;
-   download_handle->decompress_task_finished = false;
-   download_handle->decompress_task_complete = false;
+   download_handle->http_task_success        = false;
+   download_handle->transfer_data            = NULL;
+   download_handle->transfer_len             = 0;
+   download_handle->extract_progress         = 0;
+   download_handle->extract_complete         = false;
+   download_handle->extract_success          = false;
    download_handle->backup_enabled           = false;
    download_handle->backup_task              = NULL;
    download_handle->status                   = CORE_UPDATER_DOWNLOAD_BEGIN;
 
+#ifdef HAVE_THREADS
+   if (!(download_handle->lock = slock_new()))
+      goto error;
+#endif
+
    /* Concurrent downloads of the same file are not allowed */
    find_data.func     = task_core_updater_download_finder;
    find_data.userdata = (void*)download_handle->remote_filename;
@@ -1115,6 +1298,8 @@ void *task_push_core_updater_download(
          sizeof(task_title) - _len);
 
    task->handler          = task_core_updater_download_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
+   task->affinity         = TASK_AFFINITY_SERIAL;
    task->state            = download_handle;
    task->title            = strdup(task_title);
    task->progress         = 0;
@@ -1153,18 +1338,58 @@ error:
 static void free_update_installed_cores_handle(
       update_installed_cores_handle_t *update_installed_handle)
 {
+   size_t i;
+
    if (update_installed_handle->path_dir_libretro)
       free(update_installed_handle->path_dir_libretro);
 
    if (update_installed_handle->path_dir_core_assets)
       free(update_installed_handle->path_dir_core_assets);
 
+   for (i = 0; i < CORE_UPDATER_MAX_DOWNLOADS; i++)
+      if (update_installed_handle->download_filenames[i])
+         free(update_installed_handle->download_filenames[i]);
+
+   /* Writes out any newly recorded core CRCs */
+   crc_cache_free(update_installed_handle->crc_cache);
+
    core_updater_list_free(update_installed_handle->core_list);
 
    free(update_installed_handle);
    update_installed_handle = NULL;
 }
 
+/* Forgets core downloads that are no longer in the
+ * task queue. Returns the number still in flight */
+static unsigned task_update_installed_cores_poll_downloads(
+      update_installed_cores_handle_t *update_installed_handle)
+{
+   size_t i;
+
+   for (i = 0; i < CORE_UPDATER_MAX_DOWNLOADS; i++)
+   {
+      task_finder_data_t find_data;
+      char *filename = update_installed_handle->download_filenames[i];
+
+      if (!filename)
+         continue;
+
+      /* Download tasks are looked up by name, since
+       * a finished task may already have been freed */
+      find_data.func     = task_core_updater_download_finder;
+      find_data.userdata = (void*)filename;
+
+      if (!task_queue_find(&find_data))
+      {
+         free(filename);
+         update_installed_handle->download_filenames[i] = NULL;
+         update_installed_handle->num_downloads--;
+      }
+   }
+
+   return update_installed_handle->num_downloads;
+}
+
 static void task_update_installed_cores_handler(retro_task_t *task)
 {
    uint8_t flg;
@@ -1239,7 +1464,7 @@ static void task_update_installed_cores_handler(retro_task_t *task)
              * of the list */
             if (update_installed_handle->list_index >= update_installed_handle->list_size)
             {
-               update_installed_handle->status = UPDATE_INSTALLED_CORES_END;
+               update_installed_handle->status = UPDATE_INSTALLED_CORES_WAIT_ALL;
                break;
             }
 
@@ -1327,7 +1552,7 @@ static void task_update_installed_cores_handler(retro_task_t *task)
                      && path_is_valid  (local_core_path)
                   )
                   local_crc = task_core_updater_get_core_crc(
-                        local_core_path);
+                        local_core_path, update_installed_handle->crc_cache);
             }
 
             /* Check whether existing core and remote core
@@ -1342,25 +1567,37 @@ static void task_update_installed_cores_handler(retro_task_t *task)
             }
 
             /* Existing core is not the most recent version
-             * > Request download */
-            update_installed_handle->download_task = (retro_task_t*)
-                  task_push_core_updater_download(
+             * > Request download
+             * > Downloads run concurrently; the task is
+             *   only tracked here, and we return to the
+             *   UPDATE_INSTALLED_CORES_ITERATE state
+             *   unless all download slots are in use */
+            if (!task_push_core_updater_download(
                         update_installed_handle->core_list,
                         list_entry->remote_filename,
                         local_crc, true,
                         update_installed_handle->auto_backup,
                         update_installed_handle->auto_backup_history_size,
                         update_installed_handle->path_dir_libretro,
-                        update_installed_handle->path_dir_core_assets);
-
-            /* Again, if an error occurred, just return to
-             * UPDATE_INSTALLED_CORES_ITERATE state */
-            if (!update_installed_handle->download_task)
+                        update_installed_handle->path_dir_core_assets))
                update_installed_handle->status = UPDATE_INSTALLED_CORES_ITERATE;
             else
             {
+               size_t i;
                size_t _len;
                char task_title[128];
+
+               for (i = 0; i < CORE_UPDATER_MAX_DOWNLOADS; i++)
+               {
+                  if (!update_installed_handle->download_filenames[i])
+                  {
+                     update_installed_handle->download_filenames[i] =
+                           strdup(list_entry->remote_filename);
+                     update_installed_handle->num_downloads++;
+                     break;
+                  }
+               }
+
                /* Update task title */
                task_free_title(task);
 
@@ -1375,38 +1612,27 @@ static void task_update_installed_cores_handler(retro_task_t *task)
                /* Increment 'updated cores' counter */
                update_installed_handle->num_updated++;
 
-               /* Wait for download to complete */
-               update_installed_handle->status = UPDATE_INSTALLED_CORES_WAIT_DOWNLOAD;
+               /* Wait for a free download slot, if required */
+               update_installed_handle->status =
+                     (update_installed_handle->num_downloads >= CORE_UPDATER_MAX_DOWNLOADS)
+                     ? UPDATE_INSTALLED_CORES_WAIT_DOWNLOAD
+                     : UPDATE_INSTALLED_CORES_ITERATE;
             }
          }
          break;
       case UPDATE_INSTALLED_CORES_WAIT_DOWNLOAD:
-         {
-            bool download_complete = false;
-
-            /* > If task is running, check 'is finished'
-             *   status
-             * > If task is NULL, then it is finished
-             *   by definition */
-            if (update_installed_handle->download_task)
-            {
-               uint8_t _flg      = task_get_flags(update_installed_handle->download_task);
-               if ((_flg & RETRO_TASK_FLG_FINISHED) > 0)
-                  download_complete = true;
-               else
-                  download_complete = false;
-            }
-            else
-               download_complete = true;
-
-            /* If download is complete, return to
-             * UPDATE_INSTALLED_CORES_ITERATE state */
-            if (download_complete)
-            {
-               update_installed_handle->download_task = NULL;
-               update_installed_handle->status        = UPDATE_INSTALLED_CORES_ITERATE;
-            }
-         }
+         /* Once a download slot is free, return to
+          * UPDATE_INSTALLED_CORES_ITERATE state */
+         if (task_update_installed_cores_poll_downloads(
+               update_installed_handle) < CORE_UPDATER_MAX_DOWNLOADS)
+            update_installed_handle->status = UPDATE_INSTALLED_CORES_ITERATE;
+         break;
+      case UPDATE_INSTALLED_CORES_WAIT_ALL:
+         /* All installed cores have been checked
+          * > Wait for any remaining downloads */
+         if (task_update_installed_cores_poll_downloads(
+               update_installed_handle) == 0)
+            update_installed_handle->status = UPDATE_INSTALLED_CORES_END;
          break;
       case UPDATE_INSTALLED_CORES_END:
          {
@@ -1511,13 +1737,14 @@ void task_push_update_installed_cores(
    update_installed_handle->path_dir_core_assets     = string_is_empty(path_dir_core_assets) ?
          NULL : strdup(path_dir_core_assets);
    update_installed_handle->core_list                = core_updater_list_init();
+   update_installed_handle->crc_cache                = task_core_updater_crc_cache_open();
    update_installed_handle->list_task                = NULL;
-   update_installed_handle->download_task            = NULL;
    update_installed_handle->list_size                = 0;
    update_installed_handle->list_index               = 0;
    update_installed_handle->installed_index          = 0;
    update_installed_handle->num_updated              = 0;
    update_installed_handle->num_locked               = 0;
+   update_installed_handle->num_downloads            = 0;
    update_installed_handle->status                   = UPDATE_INSTALLED_CORES_BEGIN;
 
    if (!update_installed_handle->core_list)
@@ -1536,6 +1763,8 @@ void task_push_update_installed_cores(
 
    /* Configure task */
    task->handler          = task_update_installed_cores_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
+   task->affinity         = TASK_AFFINITY_SERIAL;
    task->state            = update_installed_handle;
    task->title            = strdup(msg_hash_to_str(MSG_FETCHING_CORE_LIST));
    task->progress         = 0;
@@ -1859,6 +2088,8 @@ void *task_push_play_feature_delivery_core_install(
          sizeof(task_title) - _len);
 
    task->handler          = task_play_feature_delivery_core_install_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
+   task->affinity         = TASK_AFFINITY_SERIAL;
    task->state            = pfd_install_handle;
    task->title            = strdup(task_title);
    task->progress         = 0;
@@ -2229,6 +2460,8 @@ void task_push_play_feature_delivery_switch_installed_cores(
 
    /* Configure task */
    task->handler          = task_play_feature_delivery_switch_cores_handler;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
+   task->affinity         = TASK_AFFINITY_SERIAL;
    task->state            = pfd_switch_cores_handle;
    task->title            = strdup(msg_hash_to_str(MSG_SCANNING_CORES));
    task->progress         = 0;
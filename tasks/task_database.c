@@ -1455,6 +1455,8 @@ bool task_push_dbscan(
       goto error;
 
    t->handler                              = task_database_handler;
+   t->priority                             = TASK_PRIORITY_BACKGROUND;
+   t->affinity                             = TASK_AFFINITY_SERIAL;
    t->state                                = db;
    t->callback                             = cb;
    t->title                                = strdup(msg_hash_to_str(
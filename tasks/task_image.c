@@ -23,6 +23,10 @@
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 #include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
 
 #include "task_file_transfer.h"
 #include "tasks_internal.h"
@@ -35,14 +39,17 @@ enum image_status_enum
    IMAGE_STATUS_TRANSFER,
    IMAGE_STATUS_TRANSFER_PARSE,
    IMAGE_STATUS_PROCESS_TRANSFER,
-   IMAGE_STATUS_PROCESS_TRANSFER_PARSE
+   IMAGE_STATUS_PROCESS_TRANSFER_PARSE,
+   /* Decoding in one go on the decode pool */
+   IMAGE_STATUS_DECODE
 };
 
 enum image_flags_enum
 {
    IMAGE_FLAG_IS_BLOCKING                = (1 << 0),
    IMAGE_FLAG_IS_BLOCKING_ON_PROCESSING  = (1 << 1),
-   IMAGE_FLAG_IS_FINISHED                = (1 << 2)
+   IMAGE_FLAG_IS_FINISHED                = (1 << 2),
+   IMAGE_FLAG_USE_DECODE_POOL            = (1 << 3)
 };
 
 struct nbio_image_handle
@@ -52,6 +59,8 @@ struct nbio_image_handle
    struct texture_image ti; /* ptr alignment */
    size_t size;
    int processing_final_state;
+   int decode_result;
+   bool decoding;
    unsigned frame_duration;
    unsigned upscale_threshold;
    enum image_type_enum type;
@@ -59,6 +68,16 @@ struct nbio_image_handle
    uint8_t flags;
 };
 
+#ifdef HAVE_THREADS
+/* Thumbnails are decoded here rather than a slice per
+ * frame on the task thread, so that several decode at
+ * once. 'image_decode_lock' guards 'decoding'; the rest
+ * of the handle belongs to the pool while it is set. */
+static tpool_t *image_decode_pool = NULL;
+static slock_t *image_decode_lock = NULL;
+static scond_t *image_decode_cond = NULL;
+#endif
+
 static int cb_image_upload_generic(void *data, size_t len)
 {
    unsigned r_shift, g_shift, b_shift, a_shift;
@@ -160,6 +179,66 @@ static int task_image_iterate_process_transfer(struct nbio_image_handle *image)
    return -1;
 }
 
+#ifdef HAVE_THREADS
+static void task_image_decode_worker(void *data)
+{
+   int retval;
+   unsigned width                  = 0;
+   unsigned height                 = 0;
+   nbio_handle_t *nbio             = (nbio_handle_t*)data;
+   struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+
+   while (image_transfer_iterate(image->handle, image->type));
+
+   do
+   {
+      retval = task_image_process(image, &width, &height);
+   } while (retval == IMAGE_PROCESS_NEXT);
+
+   image->processing_final_state = retval;
+   retval                        = cb_image_upload_generic(nbio, 0);
+
+   slock_lock(image_decode_lock);
+   image->decode_result          = retval;
+   image->decoding               = false;
+   scond_broadcast(image_decode_cond);
+   slock_unlock(image_decode_lock);
+}
+
+/* The pool keeps its size until task_image_decode_deinit() */
+static bool task_image_decode_init(unsigned threads)
+{
+   if (image_decode_pool)
+      return true;
+
+   image_decode_lock = slock_new();
+   image_decode_cond = scond_new();
+   image_decode_pool = tpool_create(threads);
+
+   if (image_decode_lock && image_decode_cond && image_decode_pool)
+      return true;
+
+   task_image_decode_deinit();
+   return false;
+}
+
+void task_image_decode_deinit(void)
+{
+   /* Waits for pending decodes */
+   if (image_decode_pool)
+      tpool_destroy(image_decode_pool);
+   if (image_decode_cond)
+      scond_free(image_decode_cond);
+   if (image_decode_lock)
+      slock_free(image_decode_lock);
+   image_decode_pool = NULL;
+   image_decode_cond = NULL;
+   image_decode_lock = NULL;
+}
+#else
+void task_image_decode_deinit(void) { }
+#endif
+
 static void task_image_cleanup(nbio_handle_t *nbio)
 {
    struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
@@ -187,6 +266,18 @@ static void task_image_load_free(retro_task_t *task)
 
    if (nbio)
    {
+#ifdef HAVE_THREADS
+      struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+
+      /* A cancelled task can still be decoding */
+      if (image && (image->flags & IMAGE_FLAG_USE_DECODE_POOL))
+      {
+         slock_lock(image_decode_lock);
+         while (image->decoding)
+            scond_wait(image_decode_cond, image_decode_lock);
+         slock_unlock(image_decode_lock);
+      }
+#endif
       task_image_cleanup(nbio);
       free(nbio);
    }
@@ -304,6 +395,16 @@ bool task_image_load_handler(retro_task_t *task)
                image->status = IMAGE_STATUS_PROCESS_TRANSFER;
             break;
          case IMAGE_STATUS_TRANSFER:
+#ifdef HAVE_THREADS
+            if (image->flags & IMAGE_FLAG_USE_DECODE_POOL)
+            {
+               image->decoding = true;
+               image->status   = IMAGE_STATUS_DECODE;
+               tpool_add_work(image_decode_pool,
+                     task_image_decode_worker, nbio);
+               return true;
+            }
+#endif
             if (     !(image->flags & IMAGE_FLAG_IS_BLOCKING)
                   && !(image->flags & IMAGE_FLAG_IS_FINISHED))
             {
@@ -326,8 +427,26 @@ bool task_image_load_handler(retro_task_t *task)
                if (image->cb(nbio, _len) == -1)
                   return false;
             }
-            if (!(image->flags & IMAGE_FLAG_IS_FINISHED))
-               break;
+            break;
+         case IMAGE_STATUS_DECODE:
+#ifdef HAVE_THREADS
+            {
+               bool decoding;
+               slock_lock(image_decode_lock);
+               /* Don't spin the task thread meanwhile */
+               if (image->decoding && !task_is_on_main_thread())
+                  scond_wait_timeout(image_decode_cond,
+                        image_decode_lock, 1000);
+               decoding = image->decoding;
+               slock_unlock(image_decode_lock);
+
+               if (decoding)
+                  return true;
+               if (image->decode_result == -1)
+                  return false;
+            }
+#endif
+            break;
       }
    }
 
@@ -431,6 +550,9 @@ bool task_push_image_load(const char *fullpath,
    image->type                       = image_texture_get_type(fullpath);
    image->status                     = IMAGE_STATUS_WAIT;
    image->processing_final_state     = 0;
+   image->decode_result              = 0;
+   image->decoding                   = false;
+   image->flags                      = 0;
    image->frame_duration             = 0;
    image->size                       = 0;
    image->upscale_threshold          = upscale_threshold;
@@ -461,10 +583,24 @@ bool task_push_image_load(const char *fullpath,
          break;
    }
 
+#ifdef HAVE_THREADS
+   {
+      settings_t *settings = config_get_ptr();
+      unsigned threads     = settings ? settings->uints.image_decode_threads : 0;
+
+      /* BMP and TGA decode too fast to be worth it */
+      if (     threads
+            && (image->type == IMAGE_TYPE_PNG || image->type == IMAGE_TYPE_JPEG)
+            && task_image_decode_init(threads))
+         image->flags |= IMAGE_FLAG_USE_DECODE_POOL;
+   }
+#endif
+
    nbio->data          = (struct nbio_image_handle*)image;
 
    t->state           = nbio;
    t->handler         = task_file_load_handler;
+   t->priority        = TASK_PRIORITY_INTERACTIVE;
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
@@ -608,6 +608,8 @@ bool task_push_manual_content_scan(
 
    /* > Configure task */
    task->handler                 = task_manual_content_scan_handler;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
+   task->affinity                = TASK_AFFINITY_SERIAL;
    task->state                   = manual_scan;
    task->title                   = strdup(task_title);
    task->progress                = 0;
@@ -55,6 +55,19 @@
 #define REPLAY_FORMAT_VERSION 1
 #define REPLAY_MAGIC       0x42535632
 
+/* Checkpoint index kept next to the replay: a header of
+ * REPLAY_INDEX_HEADER_LEN uint32s (magic, version, replay
+ * identifier and replay size as int64s, entry count as a
+ * uint64), then one REPLAY_INDEX_ENTRY_SIZE entry per
+ * checkpoint (frame, record position, data position as
+ * 64-bit values, then token and encoding bytes). All
+ * little-endian. */
+#define REPLAY_INDEX_MAGIC       0x42535649
+#define REPLAY_INDEX_VERSION     1
+#define REPLAY_INDEX_HEADER_LEN  8
+#define REPLAY_INDEX_ENTRY_SIZE  32
+#define REPLAY_INDEX_EXTENSION   ".idx"
+
 /* Forward declaration */
 bool content_load_state_in_progress(void* data);
 
@@ -207,8 +220,132 @@ static bool bsv_movie_init_record(
    return true;
 }
 
+/* Saves the checkpoint index so playback can seek without
+ * scanning the replay first */
+static void bsv_movie_save_index(bsv_movie_t *handle)
+{
+   size_t i;
+   int64_t val;
+   intfstream_t *file;
+   uint32_t header[REPLAY_INDEX_HEADER_LEN];
+
+   if (!handle->checkpoint_count || !*handle->index_path)
+      return;
+
+   if (!(file = intfstream_open_file(handle->index_path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_WARN("[Replay] Could not write replay index: \"%s\".\n",
+            handle->index_path);
+      return;
+   }
+
+   header[0] = swap_if_big32(REPLAY_INDEX_MAGIC);
+   header[1] = swap_if_big32(REPLAY_INDEX_VERSION);
+   val       = swap_if_big64(handle->identifier);
+   memcpy(header + 2, &val, sizeof(val));
+   val       = swap_if_big64(intfstream_get_size(handle->file));
+   memcpy(header + 4, &val, sizeof(val));
+   val       = swap_if_big64((int64_t)handle->checkpoint_count);
+   memcpy(header + 6, &val, sizeof(val));
+   intfstream_write(file, header, sizeof(header));
+
+   for (i = 0; i < handle->checkpoint_count; i++)
+   {
+      uint8_t entry[REPLAY_INDEX_ENTRY_SIZE] = {0};
+      const bsv_checkpoint_t *checkpoint     = &handle->checkpoints[i];
+      val       = swap_if_big64((int64_t)checkpoint->frame);
+      memcpy(entry, &val, sizeof(val));
+      val       = swap_if_big64(checkpoint->record_pos);
+      memcpy(entry + 8, &val, sizeof(val));
+      val       = swap_if_big64(checkpoint->data_pos);
+      memcpy(entry + 16, &val, sizeof(val));
+      entry[24] = checkpoint->token;
+      entry[25] = checkpoint->encoding;
+      intfstream_write(file, entry, sizeof(entry));
+   }
+
+   intfstream_close(file);
+   free(file);
+}
+
+/* Loads the saved checkpoint index if it belongs to this
+ * very replay */
+static bool bsv_movie_load_index(bsv_movie_t *handle)
+{
+   size_t i;
+   int64_t val;
+   uint64_t count;
+   uint32_t header[REPLAY_INDEX_HEADER_LEN];
+   bsv_checkpoint_t *checkpoints = NULL;
+   bool ret                      = false;
+   intfstream_t *file            = intfstream_open_file(handle->index_path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   if (intfstream_read(file, header, sizeof(header)) != sizeof(header))
+      goto end;
+   if (     swap_if_big32(header[0]) != REPLAY_INDEX_MAGIC
+         || swap_if_big32(header[1]) != REPLAY_INDEX_VERSION)
+      goto end;
+   memcpy(&val, header + 2, sizeof(val));
+   if (swap_if_big64(val) != handle->identifier)
+      goto end;
+   memcpy(&val, header + 4, sizeof(val));
+   if (swap_if_big64(val) != intfstream_get_size(handle->file))
+      goto end;
+   memcpy(&val, header + 6, sizeof(val));
+   count = (uint64_t)swap_if_big64(val);
+   if (     !count
+         || count > (uint64_t)(intfstream_get_size(file) - sizeof(header))
+            / REPLAY_INDEX_ENTRY_SIZE)
+      goto end;
+
+   if (!(checkpoints = (bsv_checkpoint_t*)malloc(
+               (size_t)count * sizeof(*checkpoints))))
+      goto end;
+
+   for (i = 0; i < count; i++)
+   {
+      uint8_t entry[REPLAY_INDEX_ENTRY_SIZE];
+      if (intfstream_read(file, entry, sizeof(entry)) != sizeof(entry))
+         goto end;
+      memcpy(&val, entry, sizeof(val));
+      checkpoints[i].frame      = (uint64_t)swap_if_big64(val);
+      memcpy(&val, entry + 8, sizeof(val));
+      checkpoints[i].record_pos = swap_if_big64(val);
+      memcpy(&val, entry + 16, sizeof(val));
+      checkpoints[i].data_pos   = swap_if_big64(val);
+      checkpoints[i].token      = entry[24];
+      checkpoints[i].encoding   = entry[25];
+   }
+
+   free(handle->checkpoints);
+   handle->checkpoints      = checkpoints;
+   handle->checkpoint_count = (size_t)count;
+   handle->checkpoint_cap   = (size_t)count;
+   checkpoints              = NULL;
+   ret                      = true;
+
+end:
+   free(checkpoints);
+   intfstream_close(file);
+   free(file);
+   return ret;
+}
+
 void bsv_movie_free(bsv_movie_t *handle)
 {
+   if (handle->file && !handle->playback)
+   {
+      bsv_movie_flush_checkpoint(handle);
+      bsv_movie_save_index(handle);
+   }
+   bsv_movie_free_checkpoints(handle);
    intfstream_close(handle->file);
    free(handle->file);
 
@@ -225,6 +362,10 @@ static bsv_movie_t *bsv_movie_init_internal(const char *path, enum rarch_movie_t
    if (!handle)
       return NULL;
 
+   strlcpy(handle->index_path, path, sizeof(handle->index_path));
+   strlcat(handle->index_path, REPLAY_INDEX_EXTENSION,
+         sizeof(handle->index_path));
+
    if (type == RARCH_MOVIE_PLAYBACK)
    {
       if (!bsv_movie_init_playback(handle, path))
@@ -243,6 +384,13 @@ static bsv_movie_t *bsv_movie_init_internal(const char *path, enum rarch_movie_t
    handle->frame_pos[0]    = handle->min_file_pos;
    handle->frame_mask      = (1 << 20) - 1;
 
+   /* Index the checkpoints for seeking and delta decoding,
+    * and keep the index for next time */
+   if (     type == RARCH_MOVIE_PLAYBACK
+         && !bsv_movie_load_index(handle)
+         && bsv_movie_scan_checkpoints(handle))
+      bsv_movie_save_index(handle);
+
    return handle;
 
 error:
@@ -431,6 +579,8 @@ bool movie_start_playback(input_driver_state_t *input_st, char *path)
      task->type                    = TASK_TYPE_NONE;
      task->state                   = state;
      task->handler                 = task_moviectl_playback_handler;
+     task->priority                = TASK_PRIORITY_SAVE_LOAD;
+     task->affinity                = TASK_AFFINITY_SERIAL;
      task->callback                = moviectl_start_playback_cb;
      task->title                   = strdup(msg_hash_to_str(MSG_STARTING_MOVIE_PLAYBACK));
 
@@ -465,6 +615,8 @@ bool movie_start_record(input_driver_state_t *input_st, char*path)
       task->type                 = TASK_TYPE_NONE;
       task->state                = state;
       task->handler              = task_moviectl_record_handler;
+      task->priority             = TASK_PRIORITY_SAVE_LOAD;
+      task->affinity             = TASK_AFFINITY_SERIAL;
       task->callback             = moviectl_start_record_cb;
 
       task->title                = strdup(msg);
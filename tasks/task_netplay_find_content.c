@@ -854,6 +854,7 @@ bool task_push_netplay_crc_scan(uint32_t crc, const char *content,
    scan_state.running = true;
 
    task->handler   = task_netplay_crc_scan_handler;
+   task->affinity  = TASK_AFFINITY_SERIAL;
    task->callback  = task_netplay_crc_scan_callback;
    task->cleanup   = task_netplay_crc_scan_cleanup;
    task->task_data = data;
@@ -943,6 +944,7 @@ bool task_push_netplay_content_reload(const char *hostname)
    scan_state.running = true;
 
    task->handler   = task_netplay_crc_scan_handler;
+   task->affinity  = TASK_AFFINITY_SERIAL;
    task->callback  = task_netplay_crc_scan_callback;
    task->cleanup   = task_netplay_crc_scan_cleanup;
    task->task_data = data;
@@ -20,11 +20,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 
 #include <string/stdstring.h>
 #include <file/file_path.h>
+#include <lists/string_list.h>
 #include <net/net_http.h>
 #include <streams/file_stream.h>
+#include <array/rhmap.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "tasks_internal.h"
 #include "task_file_transfer.h"
@@ -44,6 +51,20 @@
 #endif
 #endif
 
+/* Maximum number of thumbnail downloads in flight
+ * per task. Requests to the same server share the
+ * keep-alive connections pooled by net_http */
+#define PL_THUMB_MAX_DOWNLOADS 4
+
+/* Thumbnails reported as missing by the server are
+ * not requested again for this long (seconds) */
+#define PL_THUMB_MANIFEST_MISSING_TTL (7 * 24 * 60 * 60)
+/* Existing thumbnails are revalidated with a
+ * conditional request after this long (seconds) */
+#define PL_THUMB_MANIFEST_REVALIDATE_TTL (30 * 24 * 60 * 60)
+
+#define PL_THUMB_MANIFEST_HEADER "# RetroArch thumbnail manifest v1: status checked etag last-modified path"
+
 enum pl_thumb_status
 {
    PL_THUMB_BEGIN = 0,
@@ -57,23 +78,41 @@ enum pl_thumb_flags
    PL_THUMB_FLAG_OVERWRITE          = (1 << 0),
    PL_THUMB_FLAG_RIGHT_THUMB_EXISTS = (1 << 1),
    PL_THUMB_FLAG_LEFT_THUMB_EXISTS  = (1 << 2),
-   PL_THUMB_FLAG_HTTP_TASK_COMPLETE = (1 << 3)
+   PL_THUMB_FLAG_MANIFEST_MODIFIED  = (1 << 3)
 };
 
+/* Result of the last request for a thumbnail,
+ * used to make repeated playlist downloads incremental */
+typedef struct pl_thumb_manifest_entry
+{
+   int64_t checked; /* time() of last server response */
+   int status;      /* HTTP status of last server response */
+   char etag[80];
+   char last_modified[40];
+} pl_thumb_manifest_entry_t;
+
 typedef struct pl_thumb_handle
 {
    char *system;
    char *playlist_path;
    char *dir_thumbnails;
+   char *manifest_path;
    playlist_t *playlist;
    gfx_thumbnail_path_data_t *thumbnail_path_data;
-   retro_task_t *http_task;
+   /* rhmap, keyed by path relative to dir_thumbnails */
+   pl_thumb_manifest_entry_t *manifest;
+#ifdef HAVE_THREADS
+   /* Protects 'manifest', 'flags' and 'in_flight',
+    * which are updated by http task callbacks */
+   slock_t *lock;
+#endif
 
    playlist_config_t playlist_config; /* size_t alignment */
 
    size_t list_size;
    size_t list_index;
    unsigned type_idx;
+   unsigned in_flight;
 
    enum pl_thumb_status status;
    enum playlist_thumbnail_name_flags name_flags;
@@ -87,6 +126,14 @@ typedef struct pl_entry_id
    size_t idx;
 } pl_entry_id_t;
 
+#ifdef HAVE_THREADS
+#define PL_THUMB_LOCK(pl_thumb)   slock_lock((pl_thumb)->lock)
+#define PL_THUMB_UNLOCK(pl_thumb) slock_unlock((pl_thumb)->lock)
+#else
+#define PL_THUMB_LOCK(pl_thumb)
+#define PL_THUMB_UNLOCK(pl_thumb)
+#endif
+
 /*********************/
 /* Utility Functions */
 /*********************/
@@ -254,6 +301,271 @@ static bool task_pl_thumbnail_get_thumbnail_paths(
    return !string_is_empty(s);
 }
 
+static unsigned pl_thumb_get_in_flight(pl_thumb_handle_t *pl_thumb)
+{
+   unsigned in_flight;
+   PL_THUMB_LOCK(pl_thumb);
+   in_flight = pl_thumb->in_flight;
+   PL_THUMB_UNLOCK(pl_thumb);
+   return in_flight;
+}
+
+/*********************/
+/* Download Manifest */
+/*********************/
+
+/* Returns the manifest key of a local thumbnail
+ * path, i.e. the path relative to dir_thumbnails */
+static const char *pl_thumb_manifest_key(
+      const pl_thumb_handle_t *pl_thumb, const char *path)
+{
+   size_t _len = strlen(pl_thumb->dir_thumbnails);
+
+   if (strncmp(path, pl_thumb->dir_thumbnails, _len))
+      return path;
+   if (_len > 0 && PATH_CHAR_IS_SLASH(pl_thumb->dir_thumbnails[_len - 1]))
+      return path + _len;
+   if (PATH_CHAR_IS_SLASH(path[_len]))
+      return path + _len + 1;
+   return path;
+}
+
+/* Parses a single 'status checked etag last-modified path'
+ * line (tab separated). Returns false if the line is malformed */
+static bool pl_thumb_manifest_parse_line(char *line,
+      pl_thumb_manifest_entry_t *entry, char **entry_key)
+{
+   char *tok = line;
+   char *end = NULL;
+
+   entry->status  = (int)strtol(tok, &end, 10);
+   if (end == tok || *end != '\t')
+      return false;
+   tok            = end + 1;
+
+   entry->checked = (int64_t)strtoll(tok, &end, 10);
+   if (end == tok || *end != '\t')
+      return false;
+   tok            = end + 1;
+
+   if (!(end = strchr(tok, '\t')))
+      return false;
+   *end           = '\0';
+   strlcpy(entry->etag, tok, sizeof(entry->etag));
+   tok            = end + 1;
+
+   if (!(end = strchr(tok, '\t')))
+      return false;
+   *end           = '\0';
+   strlcpy(entry->last_modified, tok, sizeof(entry->last_modified));
+   tok            = end + 1;
+
+   if (string_is_empty(tok))
+      return false;
+
+   *entry_key     = tok;
+   return true;
+}
+
+static void pl_thumb_manifest_load(pl_thumb_handle_t *pl_thumb)
+{
+   char *line  = NULL;
+   RFILE *file = NULL;
+
+   if (!pl_thumb->manifest_path || !(file = filestream_open(
+         pl_thumb->manifest_path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return;
+
+   while (     !filestream_eof(file)
+         && (line = filestream_getline(file)))
+   {
+      pl_thumb_manifest_entry_t entry;
+      char *entry_key = NULL;
+
+      if (     *line != '#'
+            && pl_thumb_manifest_parse_line(line, &entry, &entry_key))
+         RHMAP_SET_STR(pl_thumb->manifest, entry_key, entry);
+
+      free(line);
+   }
+
+   filestream_close(file);
+}
+
+static void pl_thumb_manifest_save(pl_thumb_handle_t *pl_thumb)
+{
+   size_t i, cap;
+   RFILE *file = NULL;
+
+   if (     !pl_thumb->manifest_path
+         || !(pl_thumb->flags & PL_THUMB_FLAG_MANIFEST_MODIFIED))
+      return;
+
+   if (!(file = filestream_open(pl_thumb->manifest_path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_WARN("[Thumbnail] Failed to write \"%s\".\n",
+            pl_thumb->manifest_path);
+      return;
+   }
+
+   filestream_printf(file, "%s\n", PL_THUMB_MANIFEST_HEADER);
+
+   for (i = 0, cap = RHMAP_CAP(pl_thumb->manifest); i != cap; i++)
+   {
+      const pl_thumb_manifest_entry_t *entry = NULL;
+      if (!RHMAP_KEY(pl_thumb->manifest, i))
+         continue;
+      entry = &pl_thumb->manifest[i];
+      filestream_printf(file, "%d\t%" PRIu64 "\t%s\t%s\t%s\n",
+            entry->status,
+            (uint64_t)entry->checked,
+            entry->etag,
+            entry->last_modified,
+            RHMAP_KEY_STR(pl_thumb->manifest, i));
+   }
+
+   filestream_close(file);
+   pl_thumb->flags &= ~PL_THUMB_FLAG_MANIFEST_MODIFIED;
+}
+
+/* Decides whether the thumbnail at 'path' has to be
+ * requested from the server, writing conditional request
+ * headers to 's' when an existing file is revalidated.
+ * Returns false if the request can be skipped */
+static bool pl_thumb_manifest_check(pl_thumb_handle_t *pl_thumb,
+      const char *path, bool exists, char *s, size_t len)
+{
+   ptrdiff_t idx;
+   bool overwrite;
+   bool download                          = false;
+   int64_t now                            = (int64_t)time(NULL);
+   const pl_thumb_manifest_entry_t *entry = NULL;
+
+   s[0] = '\0';
+
+   PL_THUMB_LOCK(pl_thumb);
+
+   overwrite = (pl_thumb->flags & PL_THUMB_FLAG_OVERWRITE) > 0;
+
+   if ((idx = RHMAP_IDX_STR(pl_thumb->manifest,
+         pl_thumb_manifest_key(pl_thumb, path))) >= 0)
+      entry = &pl_thumb->manifest[idx];
+
+   if (exists)
+   {
+      /* Thumbnails that were not downloaded by this
+       * task (or have no validators) are only ever
+       * replaced when overwriting */
+      if (     !entry
+            || entry->status != 200
+            || (    string_is_empty(entry->etag)
+                 && string_is_empty(entry->last_modified)))
+         download = overwrite;
+      else if (overwrite
+            || (now - entry->checked) >= PL_THUMB_MANIFEST_REVALIDATE_TTL)
+      {
+         size_t _len = 0;
+         if (!string_is_empty(entry->etag))
+            _len += snprintf(s + _len, len - _len,
+                  "If-None-Match: %s\r\n", entry->etag);
+         if (!string_is_empty(entry->last_modified) && _len < len)
+            _len += snprintf(s + _len, len - _len,
+                  "If-Modified-Since: %s\r\n", entry->last_modified);
+         download = true;
+      }
+   }
+   else
+      download = overwrite
+            || !entry
+            || entry->status != 404
+            || (now - entry->checked) >= PL_THUMB_MANIFEST_MISSING_TTL;
+
+   PL_THUMB_UNLOCK(pl_thumb);
+
+   return download;
+}
+
+/* Copies the value of response header 'name'
+ * (e.g. "ETag:") to 's', if present and if it fits */
+static void pl_thumb_get_header(const struct string_list *headers,
+      const char *name, char *s, size_t len)
+{
+   size_t i;
+   size_t name_len = strlen(name);
+
+   s[0] = '\0';
+
+   if (!headers)
+      return;
+
+   for (i = 0; i < headers->size; i++)
+   {
+      const char *value = headers->elems[i].data;
+      if (!string_starts_with_case_insensitive(value, name))
+         continue;
+      value += name_len;
+      while (*value == ' ')
+         value++;
+      if (strlcpy(s, value, len) >= len)
+         s[0] = '\0';
+      return;
+   }
+}
+
+/* Records the outcome of a thumbnail request.
+ * Must be called with the handle lock held */
+static void pl_thumb_manifest_update(pl_thumb_handle_t *pl_thumb,
+      const char *path, int status, const struct string_list *headers)
+{
+   pl_thumb_manifest_entry_t entry;
+   const char *key = NULL;
+
+   /* Entry downloads do not keep a manifest */
+   if (!pl_thumb->manifest_path)
+      return;
+
+   key             = pl_thumb_manifest_key(pl_thumb, path);
+   entry.status    = status;
+   entry.checked   = (int64_t)time(NULL);
+
+   if (status == 404)
+   {
+      entry.etag[0]          = '\0';
+      entry.last_modified[0] = '\0';
+   }
+   else
+   {
+      pl_thumb_get_header(headers, "ETag:",
+            entry.etag, sizeof(entry.etag));
+      pl_thumb_get_header(headers, "Last-Modified:",
+            entry.last_modified, sizeof(entry.last_modified));
+
+      /* A 304 confirms the recorded validators */
+      if (status == 304)
+      {
+         ptrdiff_t idx = RHMAP_IDX_STR(pl_thumb->manifest, key);
+         if (idx >= 0)
+         {
+            if (string_is_empty(entry.etag))
+               strlcpy(entry.etag, pl_thumb->manifest[idx].etag,
+                     sizeof(entry.etag));
+            if (string_is_empty(entry.last_modified))
+               strlcpy(entry.last_modified,
+                     pl_thumb->manifest[idx].last_modified,
+                     sizeof(entry.last_modified));
+         }
+         entry.status = 200;
+      }
+   }
+
+   RHMAP_SET_STR(pl_thumb->manifest, key, entry);
+   pl_thumb->flags |= PL_THUMB_FLAG_MANIFEST_MODIFIED;
+}
+
 /* Thumbnail download http task callback function
  * > Writes thumbnail file to disk */
 void cb_http_task_download_pl_thumbnail(
@@ -264,25 +576,30 @@ void cb_http_task_download_pl_thumbnail(
    http_transfer_data_t *data  = (http_transfer_data_t*)task_data;
    file_transfer_t *transf     = (file_transfer_t*)user_data;
    pl_thumb_handle_t *pl_thumb = NULL;
+   /* Outcome to record in the manifest (0: none) */
+   int manifest_status         = 0;
 
-   /* Update pl_thumb task status
-    * > Do this first, to minimise the risk of hanging
-    *   the parent task in the event of an http error */
    if (!transf)
       goto finish;
 
-   if (!(pl_thumb = (pl_thumb_handle_t*)transf->user_data))
-      goto finish;
+   pl_thumb = (pl_thumb_handle_t*)transf->user_data;
 
-   pl_thumb->flags |= PL_THUMB_FLAG_HTTP_TASK_COMPLETE;
+   /* Sanity checks... */
+   if (!data || string_is_empty(transf->path))
+      goto finish;
 
-   /* Remaining sanity checks... */
-   if (!data || !data->data || string_is_empty(transf->path))
+   /* Existing file is still current */
+   if (data->status == 304)
+   {
+      manifest_status = 304;
       goto finish;
+   }
 
    /* Skip if data can't be good */
-   if (data->status != 200)
+   if (data->status != 200 || !data->data)
    {
+      if (data->status == 404 || data->status == 410)
+         manifest_status = 404;
       err = "File not found.";
       goto finish;
    }
@@ -304,9 +621,25 @@ void cb_http_task_download_pl_thumbnail(
       goto finish;
    }
 
+   manifest_status = 200;
+
 finish:
 
-   if (!string_is_empty(err))
+   /* Release the parent task's reference last; the
+    * handle may be freed as soon as the lock is dropped */
+   if (pl_thumb)
+   {
+      PL_THUMB_LOCK(pl_thumb);
+      if (manifest_status)
+         pl_thumb_manifest_update(pl_thumb, transf->path,
+               manifest_status, data->headers);
+      pl_thumb->in_flight--;
+      PL_THUMB_UNLOCK(pl_thumb);
+   }
+
+   if (manifest_status == 304)
+      RARCH_LOG("[Thumbnail] \"%s\" is up to date.\n", transf->path);
+   else if (!string_is_empty(err))
       RARCH_ERR("[Thumbnail] Download \"%s\" failed: %s\n",
             (transf ? transf->path : "unknown"), err);
    else
@@ -323,42 +656,48 @@ static void download_pl_thumbnail(pl_thumb_handle_t *pl_thumb)
 {
    char path[PATH_MAX_LENGTH];
    char url[2048];
+   char headers[256];
+   file_transfer_t *transf = NULL;
 
    path[0] = '\0';
    url[0]  = '\0';
 
    /* Check if paths are valid */
-   if (task_pl_thumbnail_get_thumbnail_paths(pl_thumb,
+   if (!task_pl_thumbnail_get_thumbnail_paths(pl_thumb,
             path, sizeof(path),
             url,  sizeof(url)))
+      return;
+
+   /* Only download missing (or outdated) thumbnails */
+   if (!pl_thumb_manifest_check(pl_thumb, path,
+            path_is_valid(path), headers, sizeof(headers)))
+      return;
+
+   if (!(transf = (file_transfer_t*)malloc(sizeof(file_transfer_t))))
+      return; /* If this happens then everything is broken anyway... */
+
+   /* Initialise file transfer */
+   transf->enum_idx             = MSG_UNKNOWN;
+   transf->user_data            = (void*)pl_thumb;
+   strlcpy(transf->path, path, sizeof(transf->path));
+
+   /* The callback may run on another thread as soon
+    * as the transfer is queued */
+   PL_THUMB_LOCK(pl_thumb);
+   pl_thumb->in_flight++;
+   PL_THUMB_UNLOCK(pl_thumb);
+
+   /* Note: We don't actually care if this fails since that
+    * just means the file is missing from the server, so it's
+    * not something we can handle here... */
+   if (!task_push_http_transfer_with_headers(url, true, NULL,
+            string_is_empty(headers) ? NULL : headers,
+            cb_http_task_download_pl_thumbnail, transf))
    {
-      /* Only download missing thumbnails */
-      if (     !path_is_valid(path)
-            || (pl_thumb->flags & PL_THUMB_FLAG_OVERWRITE))
-      {
-         file_transfer_t *transf = (file_transfer_t*)malloc(sizeof(file_transfer_t));
-         if (!transf)
-            return; /* If this happens then everything is broken anyway... */
-
-         /* Initialise http task status */
-         pl_thumb->flags             &= ~PL_THUMB_FLAG_HTTP_TASK_COMPLETE;
-
-         transf->enum_idx             = MSG_UNKNOWN;
-         transf->path[0]              = '\0';
-         /* Initialise file transfer */
-         transf->user_data            = (void*)pl_thumb;
-         strlcpy(transf->path, path, sizeof(transf->path));
-
-         /* Note: We don't actually care if this fails since that
-          * just means the file is missing from the server, so it's
-          * not something we can handle here... */
-
-         /* ...if it does fail, however, we can immediately
-          * signal that the task is 'complete' */
-         if (!(pl_thumb->http_task = (retro_task_t*)task_push_http_transfer_file(
-               url, true, NULL, cb_http_task_download_pl_thumbnail, transf)))
-            pl_thumb->flags             |= PL_THUMB_FLAG_HTTP_TASK_COMPLETE;
-      }
+      PL_THUMB_LOCK(pl_thumb);
+      pl_thumb->in_flight--;
+      PL_THUMB_UNLOCK(pl_thumb);
+      free(transf);
    }
 }
 
@@ -382,6 +721,12 @@ static void free_pl_thumb_handle(pl_thumb_handle_t *pl_thumb)
       pl_thumb->dir_thumbnails = NULL;
    }
 
+   if (pl_thumb->manifest_path)
+   {
+      free(pl_thumb->manifest_path);
+      pl_thumb->manifest_path = NULL;
+   }
+
    if (pl_thumb->playlist)
    {
       playlist_free(pl_thumb->playlist);
@@ -394,6 +739,16 @@ static void free_pl_thumb_handle(pl_thumb_handle_t *pl_thumb)
       pl_thumb->thumbnail_path_data = NULL;
    }
 
+   RHMAP_FREE(pl_thumb->manifest);
+
+#ifdef HAVE_THREADS
+   if (pl_thumb->lock)
+   {
+      slock_free(pl_thumb->lock);
+      pl_thumb->lock = NULL;
+   }
+#endif
+
    free(pl_thumb);
    pl_thumb = NULL;
 }
@@ -443,6 +798,9 @@ static void task_pl_thumbnail_download_handler(retro_task_t *task)
                   pl_thumb->system, pl_thumb->playlist))
             goto task_finished;
 
+         /* Results of previous runs */
+         pl_thumb_manifest_load(pl_thumb);
+
          /* All good - can start iterating */
          pl_thumb->status = PL_THUMB_ITERATE_ENTRY;
          break;
@@ -475,21 +833,10 @@ static void task_pl_thumbnail_download_handler(retro_task_t *task)
          }
          break;
       case PL_THUMB_ITERATE_TYPE:
-         /* Ensure that we only enqueue one transfer
-          * at a time... */
-
-         /* > If HTTP task is NULL, then it either finished
-          *   or an error occurred - in either case,
-          *   current task is 'complete' */
-         if (!pl_thumb->http_task)
-            pl_thumb->flags             |= PL_THUMB_FLAG_HTTP_TASK_COMPLETE;
-         /* > Wait for task_push_http_transfer_file()
-          *   callback to trigger */
-         else if (!(pl_thumb->flags & PL_THUMB_FLAG_HTTP_TASK_COMPLETE))
+         /* Limit the number of concurrent transfers */
+         if (pl_thumb_get_in_flight(pl_thumb) >= PL_THUMB_MAX_DOWNLOADS)
             break;
 
-         pl_thumb->http_task = NULL;
-
          /* Check whether all thumbnail types have been processed */
          /* TODO/FIXME - turn 3 into 4 when we re-enable Named_Logos for fetching */
          if (pl_thumb->type_idx > 3)
@@ -534,10 +881,16 @@ static void task_pl_thumbnail_download_handler(retro_task_t *task)
    return;
 
 task_finished:
+   /* Pending http task callbacks reference the handle */
+   if (pl_thumb && pl_thumb_get_in_flight(pl_thumb) > 0)
+      return;
    if (task)
       task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
    if (pl_thumb)
+   {
+      pl_thumb_manifest_save(pl_thumb);
       free_pl_thumb_handle(pl_thumb);
+   }
 }
 
 static bool task_pl_thumbnail_finder(retro_task_t *task, void *user_data)
@@ -557,6 +910,8 @@ bool task_push_pl_thumbnail_download(
       const char *dir_thumbnails)
 {
    task_finder_data_t find_data;
+   char manifest_name[NAME_MAX_LENGTH];
+   char manifest_path[PATH_MAX_LENGTH];
    const char *playlist_file     = NULL;
    retro_task_t *task            = task_init();
    pl_thumb_handle_t *pl_thumb   = (pl_thumb_handle_t*)calloc(1, sizeof(pl_thumb_handle_t));
@@ -596,16 +951,32 @@ bool task_push_pl_thumbnail_download(
    if (task_queue_find(&find_data))
       goto error;
 
+#ifdef HAVE_THREADS
+   if (!(pl_thumb->lock = slock_new()))
+      goto error;
+#endif
+
    /* Configure handle */
    if (!playlist_config_copy(playlist_config, &pl_thumb->playlist_config))
       goto error;
 
+   /* Manifest is stored next to the thumbnail
+    * directories, named after the playlist */
+   strlcpy(manifest_name, playlist_file, sizeof(manifest_name));
+   path_remove_extension(manifest_name);
+   strlcat(manifest_name, FILE_PATH_THUMBNAIL_MANIFEST_EXTENSION,
+         sizeof(manifest_name));
+   fill_pathname_join_special(manifest_path, dir_thumbnails,
+         manifest_name, sizeof(manifest_path));
+
    pl_thumb->system              = strdup(system);
    pl_thumb->playlist_path       = NULL;
    pl_thumb->dir_thumbnails      = strdup(dir_thumbnails);
+   pl_thumb->manifest_path       = strdup(manifest_path);
    pl_thumb->playlist            = NULL;
    pl_thumb->thumbnail_path_data = NULL;
-   pl_thumb->http_task           = NULL;
+   pl_thumb->manifest            = NULL;
+   pl_thumb->in_flight           = 0;
    pl_thumb->list_size           = 0;
    pl_thumb->list_index          = 0;
    pl_thumb->type_idx            = 1;
@@ -613,6 +984,8 @@ bool task_push_pl_thumbnail_download(
 
    /* Configure task */
    task->handler                 = task_pl_thumbnail_download_handler;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
+   task->affinity                = TASK_AFFINITY_SERIAL;
    task->state                   = pl_thumb;
    task->title                   = strdup(system);
    task->progress                = 0;
@@ -631,6 +1004,10 @@ error:
 
    if (pl_thumb)
    {
+#ifdef HAVE_THREADS
+      if (pl_thumb->lock)
+         slock_free(pl_thumb->lock);
+#endif
       free(pl_thumb);
       pl_thumb = NULL;
    }
@@ -790,21 +1167,10 @@ static void task_pl_entry_thumbnail_download_handler(retro_task_t *task)
          break;
       case PL_THUMB_ITERATE_TYPE:
          {
-            /* Ensure that we only enqueue one transfer
-             * at a time... */
-
-            /* > If HTTP task is NULL, then it either finished
-             *   or an error occurred - in either case,
-             *   current task is 'complete' */
-            if (!pl_thumb->http_task)
-               pl_thumb->flags |= PL_THUMB_FLAG_HTTP_TASK_COMPLETE;
-            /* > Wait for task_push_http_transfer_file()
-             *   callback to trigger */
-            else if (!(pl_thumb->flags & PL_THUMB_FLAG_HTTP_TASK_COMPLETE))
+            /* Limit the number of concurrent transfers */
+            if (pl_thumb_get_in_flight(pl_thumb) >= PL_THUMB_MAX_DOWNLOADS)
                break;
 
-            pl_thumb->http_task = NULL;
-
             /* Check whether all thumbnail types have been processed */
             if (pl_thumb->type_idx > 3)
             {
@@ -832,6 +1198,10 @@ static void task_pl_entry_thumbnail_download_handler(retro_task_t *task)
    return;
 
 task_finished:
+   /* Pending http task callbacks reference the handle
+    * (and the menu refresh needs the downloaded files) */
+   if (pl_thumb && pl_thumb_get_in_flight(pl_thumb) > 0)
+      return;
    if (task)
       task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
 }
@@ -909,6 +1279,11 @@ bool task_push_pl_entry_thumbnail_download(
    free(entry_id);
    entry_id = NULL;
 
+#ifdef HAVE_THREADS
+   if (!(pl_thumb->lock = slock_new()))
+      goto error;
+#endif
+
    /* Initialise thumbnail path data
     * > Have to do this here rather than in the
     *   task handler to avoid thread race conditions */
@@ -949,8 +1324,10 @@ bool task_push_pl_entry_thumbnail_download(
    pl_thumb->playlist_path       = playlist_path;
    pl_thumb->dir_thumbnails      = strdup(dir_thumbnails);
    pl_thumb->playlist            = NULL;
+   pl_thumb->manifest_path       = NULL;
    pl_thumb->thumbnail_path_data = thumbnail_path_data;
-   pl_thumb->http_task           = NULL;
+   pl_thumb->manifest            = NULL;
+   pl_thumb->in_flight           = 0;
    pl_thumb->list_size           = playlist_size(playlist);
    pl_thumb->list_index          = idx;
    pl_thumb->type_idx            = 1;
@@ -962,6 +1339,8 @@ bool task_push_pl_entry_thumbnail_download(
 
    /* Configure task */
    task->handler                 = task_pl_entry_thumbnail_download_handler;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
+   task->affinity                = TASK_AFFINITY_SERIAL;
    task->state                   = pl_thumb;
    task->title                   = strdup(system);
    task->progress                = 0;
@@ -987,6 +1366,10 @@ error:
 
    if (pl_thumb)
    {
+#ifdef HAVE_THREADS
+      if (pl_thumb->lock)
+         slock_free(pl_thumb->lock);
+#endif
       free(pl_thumb);
       pl_thumb = NULL;
    }
@@ -324,6 +324,8 @@ bool task_push_pl_manager_reset_cores(const playlist_config_t *playlist_config)
    strlcpy(task_title + _len, playlist_name, sizeof(task_title) - _len);
 
    task->handler                 = task_pl_manager_reset_cores_handler;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
+   task->affinity                = TASK_AFFINITY_SERIAL;
    task->state                   = pl_manager;
    task->title                   = strdup(task_title);
    task->progress                = 0;
@@ -772,6 +774,8 @@ bool task_push_pl_manager_clean_playlist(
    strlcpy(task_title + _len, playlist_name, sizeof(task_title) - _len);
 
    task->handler                 = task_pl_manager_clean_playlist_handler;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
+   task->affinity                = TASK_AFFINITY_SERIAL;
    task->state                   = pl_manager;
    task->title                   = strdup(task_title);
    task->progress                = 0;
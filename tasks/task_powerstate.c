@@ -87,6 +87,7 @@ void task_push_get_powerstate(void)
    task->type     = TASK_TYPE_NONE;
    task->state    = state;
    task->handler  = task_powerstate_handler;
+   task->affinity = TASK_AFFINITY_SERIAL;
    task->callback = task_powerstate_cb;
    task->flags   |= RETRO_TASK_FLG_MUTE;
 
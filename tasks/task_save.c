@@ -641,6 +641,8 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t len)
       task->type            = TASK_TYPE_BLOCKING;
       task->state           = state;
       task->handler         = task_save_handler;
+      task->priority        = TASK_PRIORITY_SAVE_LOAD;
+      task->affinity        = TASK_AFFINITY_SERIAL;
       task->callback        = undo_save_state_cb;
       task->title           = strdup(msg_hash_to_str(MSG_UNDOING_SAVE_STATE));
 
@@ -1195,6 +1197,8 @@ static void task_push_save_state(const char *path, void *data, size_t len, bool
    task->type                    = TASK_TYPE_BLOCKING;
    task->state                   = state;
    task->handler                 = task_save_handler;
+   task->priority                = TASK_PRIORITY_SAVE_LOAD;
+   task->affinity                = TASK_AFFINITY_SERIAL;
    task->callback                = save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_SAVING_STATE));
 
@@ -1305,6 +1309,8 @@ static void task_push_load_and_save_state(const char *path, void *data,
    task->state                   = state;
    task->type                    = TASK_TYPE_BLOCKING;
    task->handler                 = task_load_handler;
+   task->priority                = TASK_PRIORITY_SAVE_LOAD;
+   task->affinity                = TASK_AFFINITY_SERIAL;
    task->callback                = content_load_and_save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 
@@ -1591,6 +1597,8 @@ bool content_load_state(const char *path,
    task->type                   = TASK_TYPE_BLOCKING;
    task->state                  = state;
    task->handler                = task_load_handler;
+   task->priority               = TASK_PRIORITY_SAVE_LOAD;
+   task->affinity               = TASK_AFFINITY_SERIAL;
    task->callback               = content_load_state_cb;
    task->title                  = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 
@@ -37,15 +37,11 @@ struct tm { unsigned int time; };
 #include <string/stdstring.h>
 #include <gfx/video_frame.h>
 
-#ifdef HAVE_RBMP
 #include <formats/rbmp.h>
-#endif
+#include <formats/rqoi.h>
 
 #ifdef HAVE_RPNG
 #include <formats/rpng.h>
-#define IMG_EXT "png"
-#else
-#define IMG_EXT "bmp"
 #endif
 
 #if defined(HAVE_GFX_WIDGETS)
@@ -88,6 +84,7 @@ struct screenshot_task_state
    unsigned pixel_format_type;
 
    uint8_t flags;
+   uint8_t format; /* enum screenshot_format */
 
    char filename[PATH_MAX_LENGTH];
    char shotname[NAME_MAX_LENGTH];
@@ -98,7 +95,24 @@ static bool screenshot_dump_direct(screenshot_task_state_t *state)
    struct scaler_ctx *scaler     = (struct scaler_ctx*)&state->scaler;
    bool ret                      = false;
 
-#if defined(HAVE_RPNG)
+   /* BMP stores rows bottom-up, which is how
+    * the frame is passed in */
+   if (state->format == SCREENSHOT_FORMAT_BMP)
+   {
+      enum rbmp_source_type bmp_type = RBMP_SOURCE_TYPE_DONT_CARE;
+      if (state->flags & SS_TASK_FLAG_BGR24)
+         bmp_type = RBMP_SOURCE_TYPE_BGR24;
+      else if (state->pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888)
+         bmp_type = RBMP_SOURCE_TYPE_XRGB888;
+
+      return rbmp_save_image(state->filename,
+            state->frame,
+            state->width,
+            state->height,
+            state->pitch,
+            bmp_type);
+   }
+
    if (state->flags & SS_TASK_FLAG_BGR24)
       scaler->in_fmt             = SCALER_FMT_BGR24;
    else if (state->pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888)
@@ -116,32 +130,28 @@ static bool screenshot_dump_direct(screenshot_task_state_t *state)
 
    scaler_ctx_gen_reset(&state->scaler);
 
-   ret = rpng_save_image_bgr24(
-         state->filename,
-         state->out_buffer,
-         state->width,
-         state->height,
-         state->width * 3
-         );
-
-   free(state->out_buffer);
-#elif defined(HAVE_RBMP)
-   {
-      enum rbmp_source_type bmp_type = RBMP_SOURCE_TYPE_DONT_CARE;
-      if (state->bgr24)
-         bmp_type = RBMP_SOURCE_TYPE_BGR24;
-      else if (state->pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888)
-         bmp_type = RBMP_SOURCE_TYPE_XRGB888;
-
-      ret = rbmp_save_image(state->filename,
-            state->frame,
+   if (state->format == SCREENSHOT_FORMAT_QOI)
+      ret = rqoi_save_image_bgr24(
+            state->filename,
+            state->out_buffer,
             state->width,
             state->height,
-            state->pitch,
-            bmp_type);
-   }
+            state->width * 3
+            );
+#if defined(HAVE_RPNG)
+   else
+      ret = rpng_save_image_bgr24(
+            state->filename,
+            state->out_buffer,
+            state->width,
+            state->height,
+            state->width * 3
+            );
 #endif
 
+   free(state->out_buffer);
+   state->out_buffer = NULL;
+
    return ret;
 }
 
@@ -258,6 +268,48 @@ static void task_screenshot_callback(retro_task_t *task,
 }
 #endif
 
+static const char *screenshot_format_ext(enum screenshot_format format)
+{
+   switch (format)
+   {
+      case SCREENSHOT_FORMAT_QOI:
+         return "qoi";
+      case SCREENSHOT_FORMAT_BMP:
+         return "bmp";
+      default:
+         break;
+   }
+   return "png";
+}
+
+static enum screenshot_format screenshot_get_format(
+      settings_t *settings, const char *name_base,
+      bool savestate, bool fullpath)
+{
+   enum screenshot_format format = SCREENSHOT_FORMAT_PNG;
+
+   /* Savestate thumbnails are read back as PNG. A full
+    * path picks the format from its extension. */
+   if (savestate)
+      format = SCREENSHOT_FORMAT_PNG;
+   else if (fullpath)
+   {
+      const char *ext = path_get_extension(name_base);
+      if (string_is_equal_noncase(ext, "qoi"))
+         format = SCREENSHOT_FORMAT_QOI;
+      else if (string_is_equal_noncase(ext, "bmp"))
+         format = SCREENSHOT_FORMAT_BMP;
+   }
+   else if (settings->uints.screenshot_format <= SCREENSHOT_FORMAT_BMP)
+      format = (enum screenshot_format)settings->uints.screenshot_format;
+
+#if !defined(HAVE_RPNG)
+   if (format == SCREENSHOT_FORMAT_PNG)
+      format = SCREENSHOT_FORMAT_BMP;
+#endif
+   return format;
+}
+
 /* Take frame bottom-up. */
 static bool screenshot_dump(
       const char *screenshot_dir,
@@ -277,12 +329,16 @@ static bool screenshot_dump(
    uint8_t *buf                   = NULL;
    settings_t *settings           = config_get_ptr();
    bool history_list_enable       = settings->bools.history_list_enable;
+   enum screenshot_format format  = screenshot_get_format(settings,
+         name_base, savestate, fullpath);
    screenshot_task_state_t *state = (screenshot_task_state_t*)
          calloc(1, sizeof(*state));
 
    if (!state)
       return false;
 
+   state->format                 = format;
+
    /* If fullpath is true, name_base already contains a
     * static path + filename to save the screenshot to. */
    if (fullpath)
@@ -369,15 +425,18 @@ static bool screenshot_dump(
                screenshot_name = path_basename_nocompression(name_base);
 
             fill_str_dated_filename(state->shotname, screenshot_name,
-                  IMG_EXT, sizeof(state->shotname));
+                  screenshot_format_ext(format), sizeof(state->shotname));
          }
          else
          {
             size_t _len = strlcpy(state->shotname,
                 path_basename_nocompression(name_base),
                  sizeof(state->shotname));
+            _len       += strlcpy(state->shotname       + _len,
+                  ".",
+                  sizeof(state->shotname) - _len);
             strlcpy(state->shotname       + _len,
-                  ".png",
+                  screenshot_format_ext(format),
                   sizeof(state->shotname) - _len);
          }
 
@@ -396,22 +455,51 @@ static bool screenshot_dump(
       }
    }
 
-#if defined(HAVE_RPNG)
-   if (!(buf = (uint8_t*)malloc(width * height * 3)))
+   /* PNG and QOI are encoded from a top-down BGR24 copy */
+   if (format != SCREENSHOT_FORMAT_BMP)
    {
-      free(state);
-      return false;
+      if (!(buf = (uint8_t*)malloc(width * height * 3)))
+      {
+         free(state);
+         return false;
+      }
+      state->out_buffer     = buf;
    }
-   state->out_buffer     = buf;
-#endif
 
    if (use_thread)
    {
-      retro_task_t *task = task_init();
+      retro_task_t *task;
+
+      /* A raw frame still belongs to the core, which goes on
+       * to overwrite it. Convert and encode from a copy. */
+      if (!userbuf)
+      {
+         size_t row_size  = width * (bgr24 ? 3
+               : (pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888)
+               ? sizeof(uint32_t) : sizeof(uint16_t));
+         size_t abs_pitch = (pitch < 0) ? (size_t)-pitch : (size_t)pitch;
+         size_t _len      = abs_pitch * (height - 1) + row_size;
+         const uint8_t *first_row = (const uint8_t*)frame
+            + ((pitch < 0) ? (ptrdiff_t)pitch * (int)(height - 1) : 0);
+
+         if (!(state->userbuf = malloc(_len)))
+         {
+            if (state->out_buffer)
+               free(state->out_buffer);
+            free(state);
+            return false;
+         }
+         memcpy(state->userbuf, first_row, _len);
+         state->frame = (const uint8_t*)state->userbuf
+            + ((pitch < 0) ? abs_pitch * (height - 1) : 0);
+      }
+
+      task               = task_init();
 
       task->type         = TASK_TYPE_BLOCKING;
       task->state        = state;
       task->handler      = task_screenshot_handler;
+      task->priority     = TASK_PRIORITY_SAVE_LOAD;
       if (savestate)
          task->flags    |=  RETRO_TASK_FLG_MUTE;
       else
@@ -442,6 +530,9 @@ static bool screenshot_dump(
 
       if (state->out_buffer)
          free(state->out_buffer);
+      /* Only the copy made above, callers free their own */
+      if (!userbuf && state->userbuf)
+         free(state->userbuf);
 
       free(state);
 